@@ -35,6 +35,7 @@
 #include <CoreFoundation/CFNumberFormatter.h>
 #include <CoreFoundation/CFDateFormatter.h>
 #include <sys/types.h>
+#include <stdint.h>
 #if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED
 #include <unistd.h>
 #endif
@@ -176,6 +177,91 @@ void CFPreferencesSetAppValue(CFStringRef key, CFTypeRef value, CFStringRef appN
 static CFLock_t __CFApplicationPreferencesLock = CFLockInit; // Locks access to __CFStandardUserPreferences
 static CFMutableDictionaryRef __CFStandardUserPreferences = NULL; // Mutable dictionary; keys are app names, values are _CFApplicationPreferences 
 
+// Lookups read a published _dictRep without taking __CFApplicationPreferencesLock, and a published _dictRep is never mutated. Reclamation is epoch based: each reading thread announces the epoch it started in through its own reader record, and a replaced _dictRep is retired with the epoch it was replaced in. The epoch is then advanced, so a retired _dictRep can be released once no reader still announces an epoch at or before its own; readers that start later can only see its replacement.
+typedef struct __CFApplicationPreferencesReader {
+    volatile int64_t epoch; // The epoch the current lookup started in, or 0 when not reading
+    volatile int32_t inUse; // Owned by a thread
+    struct __CFApplicationPreferencesReader *next;
+} __CFApplicationPreferencesReader;
+
+static __CFApplicationPreferencesReader * volatile __CFApplicationPreferencesReaders = NULL; // Push-only; records are reused, never freed
+static volatile int64_t __CFApplicationPreferencesEpoch = 1; // Only advanced with __CFApplicationPreferencesLock held
+
+typedef struct {
+    CFDictionaryRef dictRep;
+    int64_t epoch;
+} __CFApplicationPreferencesRetiredDictRep;
+
+// Guarded by __CFApplicationPreferencesLock. The table grows rather than making a writer wait for slow readers while it holds the lock.
+static __CFApplicationPreferencesRetiredDictRep *__CFApplicationPreferencesRetired = NULL;
+static CFIndex __CFApplicationPreferencesRetiredCount = 0;
+static CFIndex __CFApplicationPreferencesRetiredCapacity = 0;
+
+static void __CFApplicationPreferencesReaderDestructor(void *rec) {
+    ((__CFApplicationPreferencesReader *)rec)->epoch = 0;
+    OSAtomicCompareAndSwap32Barrier(1, 0, &((__CFApplicationPreferencesReader *)rec)->inUse);
+}
+
+// Returns NULL if the thread cannot keep a reader record (e.g. it is exiting), in which case the lookup takes the lock
+static __CFApplicationPreferencesReader *__CFApplicationPreferencesGetReader(void) {
+    __CFApplicationPreferencesReader *rec = (__CFApplicationPreferencesReader *)_CFGetTSD(__CFTSDKeyPreferencesReader);
+    if (rec) return rec;
+    for (rec = __CFApplicationPreferencesReaders; rec; rec = rec->next) {
+        if (!rec->inUse && OSAtomicCompareAndSwap32Barrier(0, 1, &rec->inUse)) break;
+    }
+    if (!rec) {
+        rec = (__CFApplicationPreferencesReader *)calloc(1, sizeof(__CFApplicationPreferencesReader));
+        if (!rec) return NULL;
+        rec->inUse = 1;
+        do {
+            rec->next = __CFApplicationPreferencesReaders;
+        } while (!OSAtomicCompareAndSwapPtrBarrier(rec->next, rec, (void * volatile *)&__CFApplicationPreferencesReaders));
+    }
+    _CFSetTSD(__CFTSDKeyPreferencesReader, rec, __CFApplicationPreferencesReaderDestructor);
+    if (_CFGetTSD(__CFTSDKeyPreferencesReader) != rec) {
+        __CFApplicationPreferencesReaderDestructor(rec);
+        return NULL;
+    }
+    return rec;
+}
+
+// Must be called with __CFApplicationPreferencesLock held. Releases the retired _dictReps no reader can still hold.
+static void __CFApplicationPreferencesReclaimRetired(void) {
+    if (__CFApplicationPreferencesRetiredCount == 0) return;
+    OSMemoryBarrier();  // pairs with the barrier between a reader announcing its epoch and loading _dictRep
+    int64_t oldestEpoch = INT64_MAX;
+    for (__CFApplicationPreferencesReader *rec = __CFApplicationPreferencesReaders; rec; rec = rec->next) {
+        int64_t epoch = rec->epoch;
+        if (epoch != 0 && epoch < oldestEpoch) oldestEpoch = epoch;
+    }
+    CFIndex kept = 0;
+    for (CFIndex idx = 0; idx < __CFApplicationPreferencesRetiredCount; idx++) {
+        if (__CFApplicationPreferencesRetired[idx].epoch < oldestEpoch) {
+            CFRelease(__CFApplicationPreferencesRetired[idx].dictRep);
+        } else {
+            __CFApplicationPreferencesRetired[kept++] = __CFApplicationPreferencesRetired[idx];
+        }
+    }
+    __CFApplicationPreferencesRetiredCount = kept;
+}
+
+// Must be called with __CFApplicationPreferencesLock held; takes over the caller's reference to dictRep, which must no longer be published
+static void __CFApplicationPreferencesRetireDictRep(CFDictionaryRef dictRep) {
+    __CFApplicationPreferencesReclaimRetired();
+    if (__CFApplicationPreferencesRetiredCount == __CFApplicationPreferencesRetiredCapacity) {
+        CFIndex capacity = __CFApplicationPreferencesRetiredCapacity ? 2 * __CFApplicationPreferencesRetiredCapacity : 8;
+        __CFApplicationPreferencesRetiredDictRep *retired = (__CFApplicationPreferencesRetiredDictRep *)realloc(__CFApplicationPreferencesRetired, capacity * sizeof(__CFApplicationPreferencesRetiredDictRep));
+        if (!retired) HALT;
+        __CFApplicationPreferencesRetired = retired;
+        __CFApplicationPreferencesRetiredCapacity = capacity;
+    }
+    __CFApplicationPreferencesRetired[__CFApplicationPreferencesRetiredCount].dictRep = dictRep;
+    __CFApplicationPreferencesRetired[__CFApplicationPreferencesRetiredCount].epoch = __CFApplicationPreferencesEpoch;
+    __CFApplicationPreferencesRetiredCount++;
+    __CFApplicationPreferencesEpoch++;
+    __CFApplicationPreferencesReclaimRetired();
+}
+
 Boolean CFPreferencesAppSynchronize(CFStringRef appName) {
     _CFApplicationPreferences *standardPrefs;
     Boolean result;
@@ -254,9 +340,10 @@ void _CFApplicationPreferencesDomainHasChanged(CFPreferencesDomainRef changedDom
 
 
 static void updateDictRep(_CFApplicationPreferences *self) {
-    if (self->_dictRep) {
-        CFRelease(self->_dictRep);
+    CFMutableDictionaryRef dictRep = self->_dictRep;
+    if (dictRep) {
         self->_dictRep = NULL;
+        __CFApplicationPreferencesRetireDictRep(dictRep);
     }
 }
 
@@ -290,6 +377,15 @@ static CFMutableDictionaryRef computeDictRep(_CFApplicationPreferences *self, Bo
     return dictRep;
 }
 
+// Must be called with __CFApplicationPreferencesLock held. Publishes a fresh _dictRep if there is none; changes on disk drop it through _CFApplicationPreferencesDomainHasChanged().
+static void __CFApplicationPreferencesPublishDictRep(_CFApplicationPreferences *self) {
+    if (!self->_dictRep) {
+        CFMutableDictionaryRef dictRep = computeDictRep(self, true);
+        OSMemoryBarrier();  // the snapshot must be visible before the pointer to it
+        self->_dictRep = dictRep;
+    }
+}
+
 CFTypeRef _CFApplicationPreferencesSearchDownToDomain(_CFApplicationPreferences *self, CFPreferencesDomainRef stopper, CFStringRef key) {
     return NULL;
 }
@@ -309,13 +405,29 @@ CF_PRIVATE CFDictionaryRef __CFApplicationPreferencesCopyCurrentState(void) {
     return result;
 }
 
-// CACHING here - we will only return a value as current as the last time computeDictRep() was called
+// CACHING here - we will only return a value as current as the last time computeDictRep() was called, or, where file changes are watched, as the last change on disk
 static CFTypeRef _CFApplicationPreferencesCreateValueForKey2(_CFApplicationPreferences *self, CFStringRef defaultName) {
-    CFTypeRef result;
-    __CFLock(&__CFApplicationPreferencesLock);
-    if (!self->_dictRep) {
-        self->_dictRep = computeDictRep(self, true);
+    CFTypeRef result = NULL;
+    Boolean found = false;
+
+    __CFApplicationPreferencesReader *reader = __CFApplicationPreferencesGetReader();
+    if (reader) {
+        // The epoch has to be announced before the pointer is read; see __CFApplicationPreferencesReclaimRetired()
+        reader->epoch = __CFApplicationPreferencesEpoch;
+        OSMemoryBarrier();
+        CFDictionaryRef dictRep = *(CFMutableDictionaryRef volatile *)&self->_dictRep;
+        if (dictRep) {
+            result = CFDictionaryGetValue(dictRep, defaultName);
+            if (result) CFRetain(result);
+            found = true;
+        }
+        OSMemoryBarrier();
+        reader->epoch = 0;  // must be cleared before taking the lock below, which a writer may hold while waiting on readers
+        if (found) return result;
     }
+
+    __CFLock(&__CFApplicationPreferencesLock);
+    __CFApplicationPreferencesPublishDictRep(self);
     result = (self->_dictRep) ? (CFTypeRef )CFDictionaryGetValue(self->_dictRep, defaultName) : NULL;
     if (result) {
         CFRetain(result);
@@ -490,7 +602,7 @@ void _CFDeallocateApplicationPreferences(_CFApplicationPreferences *self) {
         CFDictionaryRemoveValue(__CFStandardUserPreferences, self->_appName);
     }
     
-    if (self->_dictRep) CFRelease(self->_dictRep);
+    updateDictRep(self);
     CFRelease(self->_search);
     CFRelease(self->_appName);
     CFAllocatorDeallocate(alloc, self);
@@ -502,9 +614,7 @@ CF_EXPORT
 CFDictionaryRef _CFApplicationPreferencesCopyRepresentation(_CFApplicationPreferences *self) {
     CFDictionaryRef dict;
     __CFLock(&__CFApplicationPreferencesLock);
-    if (!self->_dictRep) {
-        self->_dictRep = computeDictRep(self, true);
-    }
+    __CFApplicationPreferencesPublishDictRep(self);
     if (self->_dictRep) {
         CFRetain(self->_dictRep);
     }
@@ -52,8 +52,16 @@ struct __CFBinaryHeap {
     CFBinaryHeapCallBacks _callbacks;
     CFBinaryHeapCompareContext _context;
     struct __CFBinaryHeapBucket *_buckets;
+    _CFBinaryHeapPositionCallBack _setPosition;	/* told where values move to; NULL if nobody tracks them */
 };
 
+/* The heap is 4-ary rather than binary: a node's children are contiguous
+   and usually share a cache line, and the tree is half as deep, which
+   more than pays for the extra comparisons when sifting down. */
+#define __CFBinaryHeapArity 4
+#define __CFBinaryHeapParent(idx) (((idx) - 1) >> 2)
+#define __CFBinaryHeapFirstChild(idx) (((idx) << 2) + 1)
+
 CF_INLINE CFIndex __CFBinaryHeapCount(CFBinaryHeapRef heap) {
     return heap->_count;
 }
@@ -108,6 +116,70 @@ CF_INLINE UInt32 __CFBinaryHeapMutableVarietyFromFlags(UInt32 flags) {
     return __CFBitfieldGetValue(flags, 1, 0);
 }
 
+CF_INLINE Boolean __CFBinaryHeapGreaterThan(CFBinaryHeapRef heap, const void *item1, const void *item2) {
+    CFComparisonResult (*compare)(const void *, const void *, void *) = heap->_callbacks.compare;
+    return compare ? (kCFCompareGreaterThan == compare(item1, item2, heap->_context.info)) : (item1 > item2);
+}
+
+CF_INLINE void __CFBinaryHeapSetItem(CFBinaryHeapRef heap, CFIndex idx, const void *item) {
+    __CFAssignWithWriteBarrier((void **)&heap->_buckets[idx]._item, (void *)item);
+    if (heap->_setPosition) heap->_setPosition(item, idx, heap->_context.info);
+}
+
+/* Moves the hole at idx up towards the root until value can be stored there, and stores it */
+static CFIndex __CFBinaryHeapSiftUp(CFBinaryHeapRef heap, CFIndex idx, const void *value) {
+    while (0 < idx) {
+	CFIndex pidx = __CFBinaryHeapParent(idx);
+	void *item = heap->_buckets[pidx]._item;
+	if (!__CFBinaryHeapGreaterThan(heap, item, value)) break;
+	__CFBinaryHeapSetItem(heap, idx, item);
+	idx = pidx;
+    }
+    __CFBinaryHeapSetItem(heap, idx, value);
+    return idx;
+}
+
+/* Moves the hole at idx down towards the leaves until value can be stored there, and stores it */
+static CFIndex __CFBinaryHeapSiftDown(CFBinaryHeapRef heap, CFIndex idx, const void *value) {
+    CFIndex cnt = __CFBinaryHeapCount(heap);
+    CFIndex cidx = __CFBinaryHeapFirstChild(idx);
+    while (cidx < cnt) {
+	CFIndex lastChild = (cidx + __CFBinaryHeapArity <= cnt) ? cidx + __CFBinaryHeapArity : cnt;
+	void *item = heap->_buckets[cidx]._item;
+	for (CFIndex sidx = cidx + 1; sidx < lastChild; sidx++) {
+	    void *item2 = heap->_buckets[sidx]._item;
+	    if (__CFBinaryHeapGreaterThan(heap, item, item2)) {
+		cidx = sidx;
+		item = item2;
+	    }
+	}
+	if (__CFBinaryHeapGreaterThan(heap, item, value)) break;
+	__CFBinaryHeapSetItem(heap, idx, item);
+	idx = cidx;
+	cidx = __CFBinaryHeapFirstChild(idx);
+    }
+    __CFBinaryHeapSetItem(heap, idx, value);
+    return idx;
+}
+
+/* Restores the heap property for the value at idx after it has changed in either direction */
+static void __CFBinaryHeapReposition(CFBinaryHeapRef heap, CFIndex idx, const void *value) {
+    if (0 < idx && __CFBinaryHeapGreaterThan(heap, heap->_buckets[__CFBinaryHeapParent(idx)]._item, value)) {
+	__CFBinaryHeapSiftUp(heap, idx, value);
+    } else {
+	__CFBinaryHeapSiftDown(heap, idx, value);
+    }
+}
+
+/* Floyd's bottom-up construction: sifting down each interior node, last first, orders the whole array in O(n) */
+static void __CFBinaryHeapHeapify(CFBinaryHeapRef heap) {
+    CFIndex cnt = __CFBinaryHeapCount(heap);
+    if (cnt < 2) return;
+    for (CFIndex idx = __CFBinaryHeapParent(cnt - 1); 0 <= idx; idx--) {
+	__CFBinaryHeapSiftDown(heap, idx, heap->_buckets[idx]._item);
+    }
+}
+
 static Boolean __CFBinaryHeapEqual(CFTypeRef cf1, CFTypeRef cf2) {
     CFBinaryHeapRef heap1 = (CFBinaryHeapRef)cf1;
     CFBinaryHeapRef heap2 = (CFBinaryHeapRef)cf2;
@@ -227,8 +299,8 @@ static CFBinaryHeapRef __CFBinaryHeapInit(CFAllocatorRef allocator, UInt32 flags
     if (NULL == memory) {
 	return NULL;
     }
-	__CFBinaryHeapSetCapacity(memory, __CFBinaryHeapRoundUpCapacity(1));
-	__CFBinaryHeapSetNumBuckets(memory, __CFBinaryHeapNumBucketsForCapacity(__CFBinaryHeapRoundUpCapacity(1)));
+	__CFBinaryHeapSetCapacity(memory, __CFBinaryHeapRoundUpCapacity(numValues));
+	__CFBinaryHeapSetNumBuckets(memory, __CFBinaryHeapNumBucketsForCapacity(__CFBinaryHeapRoundUpCapacity(numValues)));
 	void *buckets = _CFAllocatorAllocateGC(allocator, __CFBinaryHeapNumBuckets(memory) * sizeof(struct __CFBinaryHeapBucket), isStrongMemory_Heap(memory) ? __kCFAllocatorGCScannedMemory : 0);
 	__CFAssignWithWriteBarrier((void **)&memory->_buckets, buckets);
 	if (__CFOASafe) __CFSetLastAllocationEventName(memory->_buckets, "CFBinaryHeap (store)");
@@ -253,8 +325,13 @@ static CFBinaryHeapRef __CFBinaryHeapInit(CFAllocatorRef allocator, UInt32 flags
 // CF: retain info for proper operation
     __CFBinaryHeapSetMutableVariety(memory, kCFBinaryHeapMutable);
     for (idx = 0; idx < numValues; idx++) {
-	CFBinaryHeapAddValue(memory, values[idx]);
+	const void *value = values[idx];
+	if (memory->_callbacks.retain) value = memory->_callbacks.retain(CFGetAllocator(memory), value);
+	__CFAssignWithWriteBarrier((void **)&memory->_buckets[idx]._item, (void *)value);
     }
+    __CFBinaryHeapSetNumBucketsUsed(memory, numValues);
+    __CFBinaryHeapSetCount(memory, numValues);
+    __CFBinaryHeapHeapify(memory);
     __CFBinaryHeapSetMutableVariety(memory, __CFBinaryHeapMutableVarietyFromFlags(flags));
     return memory;
 }
@@ -263,6 +340,11 @@ CFBinaryHeapRef CFBinaryHeapCreate(CFAllocatorRef allocator, CFIndex capacity, c
    return __CFBinaryHeapInit(allocator, kCFBinaryHeapMutable, capacity, NULL, 0, callBacks, compareContext);
 }
 
+CFBinaryHeapRef _CFBinaryHeapCreateWithValues(CFAllocatorRef allocator, const void **values, CFIndex numValues, const CFBinaryHeapCallBacks *callBacks, const CFBinaryHeapCompareContext *compareContext) {
+    CFAssert1(NULL != values || 0 == numValues, __kCFLogAssertion, "%s(): pointer to values may not be NULL", __PRETTY_FUNCTION__);
+    return __CFBinaryHeapInit(allocator, kCFBinaryHeapMutable, numValues, values, numValues, callBacks, compareContext);
+}
+
 CFBinaryHeapRef CFBinaryHeapCreateCopy(CFAllocatorRef allocator, CFIndex capacity, CFBinaryHeapRef heap) {
    __CFGenericValidateType(heap, CFBinaryHeapGetTypeID());
     return __CFBinaryHeapInit(allocator, kCFBinaryHeapMutable, capacity, (const void **)heap->_buckets, __CFBinaryHeapCount(heap), &(heap->_callbacks), &(heap->_context));
@@ -365,7 +447,6 @@ static void __CFBinaryHeapGrow(CFBinaryHeapRef heap, CFIndex numNewValues) {
 }
 
 void CFBinaryHeapAddValue(CFBinaryHeapRef heap, const void *value) {
-    CFIndex idx, pidx;
     CFIndex cnt;
     CFAllocatorRef allocator = CFGetAllocator(heap);
     __CFGenericValidateType(heap, CFBinaryHeapGetTypeID());
@@ -376,57 +457,67 @@ void CFBinaryHeapAddValue(CFBinaryHeapRef heap, const void *value) {
 	break;
     }
     cnt = __CFBinaryHeapCount(heap);
-    idx = cnt;
     __CFBinaryHeapSetNumBucketsUsed(heap, cnt + 1);
     __CFBinaryHeapSetCount(heap, cnt + 1);
-    CFComparisonResult (*compare)(const void *, const void *, void *) = heap->_callbacks.compare;
-    pidx = (idx - 1) >> 1;
-    while (0 < idx) {
-	void *item = heap->_buckets[pidx]._item;
-	if ((!compare && item <= value) || (compare && kCFCompareGreaterThan != compare(item, value, heap->_context.info))) break;
-	__CFAssignWithWriteBarrier((void **)&heap->_buckets[idx]._item, item);
-	idx = pidx;
-	pidx = (idx - 1) >> 1;
-    }
-    if (heap->_callbacks.retain) {
-	__CFAssignWithWriteBarrier((void **)&heap->_buckets[idx]._item, (void *)heap->_callbacks.retain(allocator, (void *)value));
-    } else {
-	__CFAssignWithWriteBarrier((void **)&heap->_buckets[idx]._item, (void *)value);
-    }
+    if (heap->_callbacks.retain) value = heap->_callbacks.retain(allocator, value);
+    __CFBinaryHeapSiftUp(heap, cnt, value);
 }
 
 void CFBinaryHeapRemoveMinimumValue(CFBinaryHeapRef heap) {
-    void *val;
-    CFIndex idx, cidx;
+    __CFGenericValidateType(heap, CFBinaryHeapGetTypeID());
+    if (0 == __CFBinaryHeapCount(heap)) return;
+    _CFBinaryHeapRemoveValueAtPosition(heap, 0);
+}
+
+void _CFBinaryHeapSetPositionCallBack(CFBinaryHeapRef heap, _CFBinaryHeapPositionCallBack callBack) {
+    __CFGenericValidateType(heap, CFBinaryHeapGetTypeID());
+    heap->_setPosition = callBack;
+    if (callBack) {
+	CFIndex cnt = __CFBinaryHeapCount(heap);
+	for (CFIndex idx = 0; idx < cnt; idx++) callBack(heap->_buckets[idx]._item, idx, heap->_context.info);
+    }
+}
+
+const void *_CFBinaryHeapGetValueAtPosition(CFBinaryHeapRef heap, CFIndex position) {
+    __CFGenericValidateType(heap, CFBinaryHeapGetTypeID());
+    CFAssert2(0 <= position && position < __CFBinaryHeapCount(heap), __kCFLogAssertion, "%s(): position (%d) out of bounds", __PRETTY_FUNCTION__, position);
+    return heap->_buckets[position]._item;
+}
+
+void _CFBinaryHeapValueChangedAtPosition(CFBinaryHeapRef heap, CFIndex position) {
+    __CFGenericValidateType(heap, CFBinaryHeapGetTypeID());
+    CFAssert2(0 <= position && position < __CFBinaryHeapCount(heap), __kCFLogAssertion, "%s(): position (%d) out of bounds", __PRETTY_FUNCTION__, position);
+    __CFBinaryHeapReposition(heap, position, heap->_buckets[position]._item);
+}
+
+void _CFBinaryHeapRemoveValueAtPosition(CFBinaryHeapRef heap, CFIndex position) {
+    void *item, *last;
     CFIndex cnt;
-    CFAllocatorRef allocator;
     __CFGenericValidateType(heap, CFBinaryHeapGetTypeID());
     cnt = __CFBinaryHeapCount(heap);
-    if (0 == cnt) return;
-    idx = 0;
+    CFAssert2(0 <= position && position < cnt, __kCFLogAssertion, "%s(): position (%d) out of bounds", __PRETTY_FUNCTION__, position);
+    item = heap->_buckets[position]._item;
+    last = heap->_buckets[cnt - 1]._item;
     __CFBinaryHeapSetNumBucketsUsed(heap, cnt - 1);
     __CFBinaryHeapSetCount(heap, cnt - 1);
-    CFComparisonResult (*compare)(const void *, const void *, void *) = heap->_callbacks.compare;
-    allocator = CFGetAllocator(heap);
-    if (heap->_callbacks.release)
-	heap->_callbacks.release(allocator, heap->_buckets[idx]._item);
-    val = heap->_buckets[cnt - 1]._item;
-    cidx = (idx << 1) + 1;
-    while (cidx < __CFBinaryHeapCount(heap)) {
-	void *item = heap->_buckets[cidx]._item;
-	if (cidx + 1 < __CFBinaryHeapCount(heap)) {
-	    void *item2 = heap->_buckets[cidx + 1]._item;
-	    if ((!compare && item > item2) || (compare && kCFCompareGreaterThan == compare(item, item2, heap->_context.info))) {
-		cidx++;
-		item = item2;
-	    }
-	}
-	if ((!compare && item > val) || (compare && kCFCompareGreaterThan == compare(item, val, heap->_context.info))) break;
-	__CFAssignWithWriteBarrier((void **)&heap->_buckets[idx]._item, item);
-	idx = cidx;
-	cidx = (idx << 1) + 1;
+    if (position < cnt - 1) __CFBinaryHeapReposition(heap, position, last);
+    if (heap->_setPosition) heap->_setPosition(item, kCFNotFound, heap->_context.info);
+    if (heap->_callbacks.release) heap->_callbacks.release(CFGetAllocator(heap), item);
+}
+
+static void __CFBinaryHeapApplyToSubheap(CFBinaryHeapRef heap, CFIndex idx, CFIndex cnt, _CFBinaryHeapSubheapApplierFunction applier, void *context) {
+    if (!applier(heap->_buckets[idx]._item, context)) return;
+    CFIndex first = __CFBinaryHeapFirstChild(idx);
+    for (CFIndex child = first; child < first + __CFBinaryHeapArity && child < cnt; child++) {
+	__CFBinaryHeapApplyToSubheap(heap, child, cnt, applier, context);
     }
-    __CFAssignWithWriteBarrier((void **)&heap->_buckets[idx]._item, val);
+}
+
+void _CFBinaryHeapApplyFunctionToSubheaps(CFBinaryHeapRef heap, _CFBinaryHeapSubheapApplierFunction applier, void *context) {
+    __CFGenericValidateType(heap, CFBinaryHeapGetTypeID());
+    CFAssert1(NULL != applier, __kCFLogAssertion, "%s(): pointer to applier function may not be NULL", __PRETTY_FUNCTION__);
+    CFIndex cnt = __CFBinaryHeapCount(heap);
+    if (0 < cnt) __CFBinaryHeapApplyToSubheap(heap, 0, cnt, applier, context);
 }
 
 void CFBinaryHeapRemoveAllValues(CFBinaryHeapRef heap) {
@@ -434,6 +525,9 @@ void CFBinaryHeapRemoveAllValues(CFBinaryHeapRef heap) {
     CFIndex cnt;
     __CFGenericValidateType(heap, CFBinaryHeapGetTypeID());
     cnt = __CFBinaryHeapCount(heap);
+    if (heap->_setPosition)
+	for (idx = 0; idx < cnt; idx++)
+	    heap->_setPosition(heap->_buckets[idx]._item, kCFNotFound, heap->_context.info);
     if (heap->_callbacks.release)
 	for (idx = 0; idx < cnt; idx++)
 	    heap->_callbacks.release(CFGetAllocator(heap), heap->_buckets[idx]._item);
@@ -27,6 +27,8 @@
 */
 
 #include <CoreFoundation/CFBitVector.h>
+#include <CoreFoundation/CFByteOrder.h>
+#include <CoreFoundation/CFPriv.h>
 #include "CFInternal.h"
 #include <string.h>
 
@@ -134,6 +136,70 @@ CF_INLINE void __CFFlipBitVectorBit(__CFBitVectorBucket *buckets, CFIndex idx) {
     buckets[bucketIdx] ^= (1 << (__CF_BITS_PER_BUCKET - 1 - bitOfBucket));
 }
 
+/* The bulk operations work a 64-bit word at a time. Storage is always a
+   whole number of words (capacity is rounded up to 64 bits), and loading
+   each word big-endian keeps bit 0 as the most significant bit, so a word
+   holds bits [64 * wordIdx, 64 * wordIdx + 63] in order. */
+#define __CF_BITS_PER_WORD 64
+
+CF_INLINE uint64_t __CFBitVectorWord(const __CFBitVectorBucket *buckets, CFIndex wordIdx) {
+    uint64_t word;
+    memcpy(&word, buckets + wordIdx * sizeof(uint64_t), sizeof(uint64_t));
+    return CFSwapInt64BigToHost(word);
+}
+
+CF_INLINE void __CFSetBitVectorWord(__CFBitVectorBucket *buckets, CFIndex wordIdx, uint64_t word) {
+    word = CFSwapInt64HostToBig(word);
+    memcpy(buckets + wordIdx * sizeof(uint64_t), &word, sizeof(uint64_t));
+}
+
+/* Mask of the bits of word wordIdx that fall in [firstBit, lastBit] */
+CF_INLINE uint64_t __CFBitVectorWordMask(CFIndex wordIdx, CFIndex firstBit, CFIndex lastBit) {
+    uint64_t mask = ~(uint64_t)0;
+    if (wordIdx == firstBit / __CF_BITS_PER_WORD) mask &= ~(uint64_t)0 >> (firstBit & (__CF_BITS_PER_WORD - 1));
+    if (wordIdx == lastBit / __CF_BITS_PER_WORD) mask &= ~(uint64_t)0 << (__CF_BITS_PER_WORD - 1 - (lastBit & (__CF_BITS_PER_WORD - 1)));
+    return mask;
+}
+
+enum {
+    __kCFBitVectorOperationSet = -1,
+    __kCFBitVectorOperationClear = -2,
+    __kCFBitVectorOperationFlip = -3,
+};
+
+CF_INLINE uint64_t __CFBitVectorCombineWords(uint64_t word, uint64_t other, CFIndex operation) {
+    switch (operation) {
+    case __kCFBitVectorOperationSet: return ~(uint64_t)0;
+    case __kCFBitVectorOperationClear: return 0;
+    case __kCFBitVectorOperationFlip: return ~word;
+    case _CFBitVectorOperationAnd: return word & other;
+    case _CFBitVectorOperationOr: return word | other;
+    case _CFBitVectorOperationXor: return word ^ other;
+    case _CFBitVectorOperationAndNot: return word & ~other;
+    }
+    return word;
+}
+
+CF_INLINE void __CFBitVectorCombineWordAtIndex(__CFBitVectorBucket *buckets, const __CFBitVectorBucket *otherBuckets, CFIndex wordIdx, uint64_t mask, CFIndex operation) {
+    uint64_t word = __CFBitVectorWord(buckets, wordIdx);
+    uint64_t other = otherBuckets ? __CFBitVectorWord(otherBuckets, wordIdx) : 0;
+    __CFSetBitVectorWord(buckets, wordIdx, (word & ~mask) | (__CFBitVectorCombineWords(word, other, operation) & mask));
+}
+
+/* Replaces the bits of buckets in range with operation applied to them and the same bits of otherBuckets (which may be NULL for the unary operations). The whole words in the middle go through a plain loop the compiler can vectorize. */
+static void __CFBitVectorCombine(__CFBitVectorBucket *buckets, const __CFBitVectorBucket *otherBuckets, CFRange range, CFIndex operation) {
+    CFIndex firstBit = range.location, lastBit = range.location + range.length - 1;
+    CFIndex firstWord = firstBit / __CF_BITS_PER_WORD, lastWord = lastBit / __CF_BITS_PER_WORD;
+    __CFBitVectorCombineWordAtIndex(buckets, otherBuckets, firstWord, __CFBitVectorWordMask(firstWord, firstBit, lastBit), operation);
+    if (firstWord == lastWord) return;
+    for (CFIndex wordIdx = firstWord + 1; wordIdx < lastWord; wordIdx++) {
+	uint64_t word = __CFBitVectorWord(buckets, wordIdx);
+	uint64_t other = otherBuckets ? __CFBitVectorWord(otherBuckets, wordIdx) : 0;
+	__CFSetBitVectorWord(buckets, wordIdx, __CFBitVectorCombineWords(word, other, operation));
+    }
+    __CFBitVectorCombineWordAtIndex(buckets, otherBuckets, lastWord, __CFBitVectorWordMask(lastWord, firstBit, lastBit), operation);
+}
+
 #if defined(DEBUG)
 CF_INLINE void __CFBitVectorValidateRange(CFBitVectorRef bv, CFRange range, const char *func) {
     CFAssert2(0 <= range.location && range.location < __CFBitVectorCount(bv), __kCFLogAssertion, "%s(): range.location index (%d) out of bounds", func, range.location);
@@ -315,38 +381,23 @@ static void __CFBitVectorInternalMap(CFMutableBitVectorRef bv, CFRange range, __
     }
 }
 
-struct _occursContext {
-    CFBit value;
-    CFIndex count;
-};
-
-static __CFBitVectorBucket __CFBitVectorCountBits(__CFBitVectorBucket bucketValue, __CFBitVectorBucket bucketValueMask, struct _occursContext *context) {
-    static const __CFBitVectorBucket __CFNibbleBitCount[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
-    __CFBitVectorBucket val;
-    CFIndex idx;
-    val = (context->value) ? (bucketValue & bucketValueMask) : (~bucketValue & bucketValueMask);
-    for (idx = 0; idx < (CFIndex)sizeof(__CFBitVectorBucket) * 2; idx++) {
-	context->count += __CFNibbleBitCount[val & 0xF];
-	val = val >> 4;
-    }
-    return bucketValue;
-}
-
 CFIndex CFBitVectorGetCountOfBit(CFBitVectorRef bv, CFRange range, CFBit value) {
-    struct _occursContext context;
+    CFIndex count = 0;
     __CFGenericValidateType(bv, CFBitVectorGetTypeID());
     __CFBitVectorValidateRange(bv, range, __PRETTY_FUNCTION__);
     if (0 == range.length) return 0;
-    context.value = value;
-    context.count = 0;
-    __CFBitVectorInternalMap((CFMutableBitVectorRef)bv, range, (__CFInternalMapper)__CFBitVectorCountBits, &context);
-    return context.count;
+    CFIndex firstBit = range.location, lastBit = range.location + range.length - 1;
+    CFIndex lastWord = lastBit / __CF_BITS_PER_WORD;
+    for (CFIndex wordIdx = firstBit / __CF_BITS_PER_WORD; wordIdx <= lastWord; wordIdx++) {
+	count += __builtin_popcountll(__CFBitVectorWord(bv->_buckets, wordIdx) & __CFBitVectorWordMask(wordIdx, firstBit, lastBit));
+    }
+    return value ? count : range.length - count;
 }
 
 Boolean CFBitVectorContainsBit(CFBitVectorRef bv, CFRange range, CFBit value) {
     __CFGenericValidateType(bv, CFBitVectorGetTypeID());
     __CFBitVectorValidateRange(bv, range, __PRETTY_FUNCTION__);
-    return (CFBitVectorGetCountOfBit(bv, range, value) != 0) ? true : false;
+    return (CFBitVectorGetFirstIndexOfBit(bv, range, value) != kCFNotFound) ? true : false;
 }
 
 CFBit CFBitVectorGetBitAtIndex(CFBitVectorRef bv, CFIndex idx) {
@@ -411,25 +462,31 @@ void CFBitVectorGetBits(CFBitVectorRef bv, CFRange range, uint8_t *bytes) {
 }
 
 CFIndex CFBitVectorGetFirstIndexOfBit(CFBitVectorRef bv, CFRange range, CFBit value) {
-    CFIndex idx;
     __CFGenericValidateType(bv, CFBitVectorGetTypeID());
     __CFBitVectorValidateRange(bv, range, __PRETTY_FUNCTION__);
-    for (idx = 0; idx < range.length; idx++) {
-	if (value == CFBitVectorGetBitAtIndex(bv, range.location + idx)) {
-	    return range.location + idx;
-	}
+    if (0 == range.length) return kCFNotFound;
+    CFIndex firstBit = range.location, lastBit = range.location + range.length - 1;
+    CFIndex lastWord = lastBit / __CF_BITS_PER_WORD;
+    for (CFIndex wordIdx = firstBit / __CF_BITS_PER_WORD; wordIdx <= lastWord; wordIdx++) {
+	uint64_t word = __CFBitVectorWord(bv->_buckets, wordIdx);
+	if (!value) word = ~word;
+	word &= __CFBitVectorWordMask(wordIdx, firstBit, lastBit);
+	if (word) return wordIdx * __CF_BITS_PER_WORD + __builtin_clzll(word);
     }
     return kCFNotFound;
 }
 
 CFIndex CFBitVectorGetLastIndexOfBit(CFBitVectorRef bv, CFRange range, CFBit value) {
-    CFIndex idx;
     __CFGenericValidateType(bv, CFBitVectorGetTypeID());
     __CFBitVectorValidateRange(bv, range, __PRETTY_FUNCTION__);
-    for (idx = range.length; idx--;) {
-	if (value == CFBitVectorGetBitAtIndex(bv, range.location + idx)) {
-	    return range.location + idx;
-	}
+    if (0 == range.length) return kCFNotFound;
+    CFIndex firstBit = range.location, lastBit = range.location + range.length - 1;
+    CFIndex firstWord = firstBit / __CF_BITS_PER_WORD;
+    for (CFIndex wordIdx = lastBit / __CF_BITS_PER_WORD; firstWord <= wordIdx; wordIdx--) {
+	uint64_t word = __CFBitVectorWord(bv->_buckets, wordIdx);
+	if (!value) word = ~word;
+	word &= __CFBitVectorWordMask(wordIdx, firstBit, lastBit);
+	if (word) return wordIdx * __CF_BITS_PER_WORD + (__CF_BITS_PER_WORD - 1 - __builtin_ctzll(word));
     }
     return kCFNotFound;
 }
@@ -479,16 +536,12 @@ void CFBitVectorFlipBitAtIndex(CFMutableBitVectorRef bv, CFIndex idx) {
     __CFFlipBitVectorBit(bv->_buckets, idx);
 }
 
-static __CFBitVectorBucket __CFBitVectorFlipBits(__CFBitVectorBucket bucketValue, __CFBitVectorBucket bucketValueMask, void *context) {
-    return (~(__CFBitVectorBucket)0) ^ bucketValue;
-}
-
 void CFBitVectorFlipBits(CFMutableBitVectorRef bv, CFRange range) {
     __CFGenericValidateType(bv, CFBitVectorGetTypeID());
     __CFBitVectorValidateRange(bv, range, __PRETTY_FUNCTION__);
     CFAssert1(__CFBitVectorMutableVariety(bv) == kCFBitVectorMutable, __kCFLogAssertion, "%s(): bit vector is immutable", __PRETTY_FUNCTION__);
     if (0 == range.length) return;
-    __CFBitVectorInternalMap(bv, range, __CFBitVectorFlipBits, NULL);
+    __CFBitVectorCombine(bv->_buckets, NULL, range, __kCFBitVectorOperationFlip);
 }
 
 void CFBitVectorSetBitAtIndex(CFMutableBitVectorRef bv, CFIndex idx, CFBit value) {
@@ -503,11 +556,7 @@ void CFBitVectorSetBits(CFMutableBitVectorRef bv, CFRange range, CFBit value) {
     __CFBitVectorValidateRange(bv, range, __PRETTY_FUNCTION__);
     CFAssert1(__CFBitVectorMutableVariety(bv) == kCFBitVectorMutable , __kCFLogAssertion, "%s(): bit vector is immutable", __PRETTY_FUNCTION__);
     if (0 == range.length) return;
-    if (value) {
-	__CFBitVectorInternalMap(bv, range, __CFBitVectorOneBits, NULL);
-    } else {
-	__CFBitVectorInternalMap(bv, range, __CFBitVectorZeroBits, NULL);
-    }
+    __CFBitVectorCombine(bv->_buckets, NULL, range, value ? __kCFBitVectorOperationSet : __kCFBitVectorOperationClear);
 }
 
 void CFBitVectorSetAllBits(CFMutableBitVectorRef bv, CFBit value) {
@@ -527,5 +576,16 @@ void CFBitVectorSetAllBits(CFMutableBitVectorRef bv, CFBit value) {
     memset(bv->_buckets, (value ? ~0 : 0), nBuckets);
 }
 
+void _CFBitVectorCombineBits(CFMutableBitVectorRef bv, CFBitVectorRef other, CFRange range, _CFBitVectorOperation operation) {
+    __CFGenericValidateType(bv, CFBitVectorGetTypeID());
+    __CFGenericValidateType(other, CFBitVectorGetTypeID());
+    __CFBitVectorValidateRange(bv, range, __PRETTY_FUNCTION__);
+    __CFBitVectorValidateRange(other, range, __PRETTY_FUNCTION__);
+    CFAssert1(__CFBitVectorMutableVariety(bv) == kCFBitVectorMutable , __kCFLogAssertion, "%s(): bit vector is immutable", __PRETTY_FUNCTION__);
+    CFAssert2(_CFBitVectorOperationAnd <= operation && operation <= _CFBitVectorOperationAndNot, __kCFLogAssertion, "%s(): unknown operation (%d)", __PRETTY_FUNCTION__, operation);
+    if (0 == range.length) return;
+    __CFBitVectorCombine(bv->_buckets, other->_buckets, range, operation);
+}
+
 #undef __CFBitVectorValidateRange
 
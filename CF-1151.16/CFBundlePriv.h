@@ -242,6 +242,12 @@ void _CFBundleFlushCachesForURL(CFURLRef url) CF_DEPRECATED(10_0, 10_8, 2_0, 6_0
 CF_EXPORT
 void _CFBundleFlushBundleCaches(CFBundleRef bundle);    // The previous two functions flush cached resource paths; this one also flushes bundle-specific caches such as the info dictionary and strings files
 
+CF_EXPORT
+void _CFBundleSetInfoPlistCachePath(CFStringRef path) CF_AVAILABLE(10_10, 8_0);    // Maps a compiled cache of info dictionaries at path (NULL turns it off); info dictionaries read afterwards come from it while their Info.plist's modification date and size still match
+
+CF_EXPORT
+Boolean _CFBundleWriteInfoPlistCache(void) CF_AVAILABLE(10_10, 8_0);    // Merges the info dictionaries parsed since the cache was mapped into the cache file, replacing it atomically
+
 CF_EXPORT 
 CFArrayRef _CFBundleCopyAllBundles(void); // Pending publication, the only known client of this is PowerBox. Email david_smith@apple.com before using this.
 
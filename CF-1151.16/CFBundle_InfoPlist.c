@@ -39,6 +39,8 @@
 #include <dirent.h>
 #include <sys/sysctl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 // The following strings are initialized 'later' (i.e., not at static initialization time) because static init time is too early for CFSTR to work, on platforms without constant CF strings
@@ -415,6 +417,242 @@ CF_PRIVATE void _CFBundleInfoPlistProcessInfoDictionary(CFMutableDictionaryRef d
     }
 }
 
+#pragma mark -
+#pragma mark Compiled Info Plist Cache
+
+// from CFUtilities.c
+CF_PRIVATE Boolean _CFReadMappedFromFile(CFStringRef path, Boolean map, Boolean uncached, void **outBytes, CFIndex *outLength, CFErrorRef *errorPtr);
+
+// The cache file is a binary plist dictionary mapping each Info.plist path to [stamp, info dictionary], where the stamp is [modification time in nanoseconds, size, inode]. It stays mapped, and only the entries for bundles actually opened are decoded. Dictionaries parsed while the cache is in use collect in memory until _CFBundleWriteInfoPlistCache merges them into the file.
+static CFLock_t _CFBundleInfoPlistCacheLock = CFLockInit;
+static CFStringRef _CFBundleInfoPlistCachePath = NULL;
+static void *_CFBundleInfoPlistCacheBytes = NULL;
+static CFIndex _CFBundleInfoPlistCacheLength = 0;
+static uint64_t _CFBundleInfoPlistCacheTopOffset = 0;
+static CFBinaryPlistTrailer _CFBundleInfoPlistCacheTrailer;
+static CFMutableDictionaryRef _CFBundleInfoPlistCachePending = NULL;
+static uint64_t _CFBundleInfoPlistCacheGeneration = 0;  // Bumped whenever the cache path is set or the file is rewritten
+
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_LINUX || DEPLOYMENT_TARGET_EMBEDDED_MINI
+#define _CFBundleInfoPlistCacheMapped true
+#else
+#define _CFBundleInfoPlistCacheMapped false
+#endif
+
+static void _CFBundleUnmapInfoPlistCacheLocked(void) {
+    if (_CFBundleInfoPlistCacheBytes) {
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_LINUX || DEPLOYMENT_TARGET_EMBEDDED_MINI
+        munmap(_CFBundleInfoPlistCacheBytes, _CFBundleInfoPlistCacheLength);
+#else
+        free(_CFBundleInfoPlistCacheBytes);
+#endif
+        _CFBundleInfoPlistCacheBytes = NULL;
+        _CFBundleInfoPlistCacheLength = 0;
+    }
+}
+
+static void _CFBundleMapInfoPlistCacheLocked(void) {
+    void *bytes = NULL;
+    CFIndex length = 0;
+    uint8_t marker;
+    _CFBundleUnmapInfoPlistCacheLocked();
+    if (!_CFReadMappedFromFile(_CFBundleInfoPlistCachePath, _CFBundleInfoPlistCacheMapped, false, &bytes, &length, NULL)) return;
+    if (0 == length) {
+        // Empty files come back malloced rather than mapped
+        free(bytes);
+        return;
+    }
+    _CFBundleInfoPlistCacheBytes = bytes;
+    _CFBundleInfoPlistCacheLength = length;
+    if (!__CFBinaryPlistGetTopLevelInfo((const uint8_t *)bytes, length, &marker, &_CFBundleInfoPlistCacheTopOffset, &_CFBundleInfoPlistCacheTrailer) || (marker & 0xf0) != kCFBinaryPlistMarkerDict) {
+        _CFBundleUnmapInfoPlistCacheLocked();
+    }
+}
+
+CF_EXPORT void _CFBundleSetInfoPlistCachePath(CFStringRef path) {
+    __CFLock(&_CFBundleInfoPlistCacheLock);
+    _CFBundleUnmapInfoPlistCacheLocked();
+    if (_CFBundleInfoPlistCachePath) CFRelease(_CFBundleInfoPlistCachePath);
+    if (_CFBundleInfoPlistCachePending) CFRelease(_CFBundleInfoPlistCachePending);
+    _CFBundleInfoPlistCachePath = path ? CFStringCreateCopy(kCFAllocatorSystemDefault, path) : NULL;
+    _CFBundleInfoPlistCachePending = NULL;
+    _CFBundleInfoPlistCacheGeneration++;
+    if (_CFBundleInfoPlistCachePath) _CFBundleMapInfoPlistCacheLocked();
+    __CFUnlock(&_CFBundleInfoPlistCacheLock);
+}
+
+// Whole-second modification times would miss an Info.plist rewritten at the same size within a second, so the stamp carries the nanoseconds and the inode as well
+static Boolean _CFBundleGetInfoPlistStamp(CFURLRef infoPlistURL, CFStringRef *outPath, CFArrayRef *outStamp) {
+    char cpath[CFMaxPathSize];
+    struct stat statBuf;
+    if (!CFURLGetFileSystemRepresentation(infoPlistURL, true, (uint8_t *)cpath, CFMaxPathSize) || stat(cpath, &statBuf) != 0) return false;
+    SInt64 modTime = (SInt64)statBuf.st_mtime * 1000000000LL;
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
+    modTime += statBuf.st_mtimespec.tv_nsec;
+#elif DEPLOYMENT_TARGET_LINUX
+    modTime += statBuf.st_mtim.tv_nsec;
+#endif
+    SInt64 size = (SInt64)statBuf.st_size;
+    SInt64 inode = (SInt64)statBuf.st_ino;
+    CFNumberRef values[3];
+    values[0] = CFNumberCreate(kCFAllocatorSystemDefault, kCFNumberSInt64Type, &modTime);
+    values[1] = CFNumberCreate(kCFAllocatorSystemDefault, kCFNumberSInt64Type, &size);
+    values[2] = CFNumberCreate(kCFAllocatorSystemDefault, kCFNumberSInt64Type, &inode);
+    *outStamp = CFArrayCreate(kCFAllocatorSystemDefault, (const void **)values, 3, &kCFTypeArrayCallBacks);
+    for (CFIndex i = 0; i < 3; i++) CFRelease(values[i]);
+    *outPath = CFStringCreateWithFileSystemRepresentation(kCFAllocatorSystemDefault, cpath);
+    return true;
+}
+
+// Returns a mutable copy of the cached info dictionary for infoPlistURL, or NULL if there is none or it is out of date. On a miss with the cache enabled, *outPath and *outEntry are set for _CFBundleAddInfoDictionaryToCache, with the entry stamped before the file is read.
+static CFMutableDictionaryRef _CFBundleCopyCachedInfoDictionary(CFAllocatorRef alloc, CFURLRef infoPlistURL, CFStringRef *outPath, CFMutableArrayRef *outEntry) {
+    CFMutableDictionaryRef result = NULL;
+    CFStringRef path = NULL;
+    CFArrayRef stamp = NULL;
+    *outPath = NULL;
+    *outEntry = NULL;
+    if (!_CFBundleInfoPlistCachePath || !_CFBundleGetInfoPlistStamp(infoPlistURL, &path, &stamp)) return NULL;
+
+    __CFLock(&_CFBundleInfoPlistCacheLock);
+    CFArrayRef pendingEntry = _CFBundleInfoPlistCachePending ? (CFArrayRef)CFDictionaryGetValue(_CFBundleInfoPlistCachePending, path) : NULL;
+    if (pendingEntry) {
+        if (CFEqual(CFArrayGetValueAtIndex(pendingEntry, 0), stamp)) {
+            result = (CFMutableDictionaryRef)CFPropertyListCreateDeepCopy(alloc, CFArrayGetValueAtIndex(pendingEntry, 1), kCFPropertyListMutableContainers);
+        }
+    } else if (_CFBundleInfoPlistCacheBytes) {
+        // Decode just this bundle's entry, checking the stamp before the dictionary itself
+        const uint8_t *bytes = (const uint8_t *)_CFBundleInfoPlistCacheBytes;
+        CFBinaryPlistTrailer *trailer = &_CFBundleInfoPlistCacheTrailer;
+        uint64_t entryOffset, stampOffset, dictOffset;
+        CFPropertyListRef cachedStamp = NULL, cachedDict = NULL;
+        if (__CFBinaryPlistGetOffsetForValueFromDictionary3(bytes, _CFBundleInfoPlistCacheLength, _CFBundleInfoPlistCacheTopOffset, trailer, path, NULL, &entryOffset, false, NULL) &&
+            __CFBinaryPlistGetOffsetForValueFromArray2(bytes, _CFBundleInfoPlistCacheLength, entryOffset, trailer, 0, &stampOffset, NULL) &&
+            __CFBinaryPlistGetOffsetForValueFromArray2(bytes, _CFBundleInfoPlistCacheLength, entryOffset, trailer, 1, &dictOffset, NULL) &&
+            __CFBinaryPlistCreateObject(bytes, _CFBundleInfoPlistCacheLength, stampOffset, trailer, kCFAllocatorSystemDefault, kCFPropertyListImmutable, NULL, &cachedStamp) &&
+            CFEqual(cachedStamp, stamp) &&
+            __CFBinaryPlistCreateObject(bytes, _CFBundleInfoPlistCacheLength, dictOffset, trailer, alloc, kCFPropertyListMutableContainers, NULL, &cachedDict)) {
+            if (CFGetTypeID(cachedDict) == CFDictionaryGetTypeID()) {
+                result = (CFMutableDictionaryRef)cachedDict;
+            } else {
+                CFRelease(cachedDict);
+            }
+        }
+        if (cachedStamp) CFRelease(cachedStamp);
+    }
+    __CFUnlock(&_CFBundleInfoPlistCacheLock);
+
+    if (!result) {
+        *outEntry = CFArrayCreateMutable(kCFAllocatorSystemDefault, 2, &kCFTypeArrayCallBacks);
+        CFArrayAppendValue(*outEntry, stamp);
+        *outPath = path;
+    } else {
+        CFRelease(path);
+    }
+    CFRelease(stamp);
+    return result;
+}
+
+// Completes an entry from _CFBundleCopyCachedInfoDictionary with a freshly parsed dictionary, before the dictionary is annotated with its URL
+static void _CFBundleAddInfoDictionaryToCache(CFStringRef path, CFMutableArrayRef entry, CFDictionaryRef infoDict) {
+    CFPropertyListRef dictCopy = CFPropertyListCreateDeepCopy(kCFAllocatorSystemDefault, infoDict, kCFPropertyListImmutable);
+    CFArrayAppendValue(entry, dictCopy);
+    CFRelease(dictCopy);
+    __CFLock(&_CFBundleInfoPlistCacheLock);
+    if (_CFBundleInfoPlistCachePath) {
+        if (!_CFBundleInfoPlistCachePending) _CFBundleInfoPlistCachePending = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+        CFDictionarySetValue(_CFBundleInfoPlistCachePending, path, entry);
+    }
+    __CFUnlock(&_CFBundleInfoPlistCacheLock);
+}
+
+static void _CFBundleMergeInfoPlistCacheEntry(const void *key, const void *value, void *context) {
+    CFDictionarySetValue((CFMutableDictionaryRef)context, key, value);
+}
+
+CF_EXPORT Boolean _CFBundleWriteInfoPlistCache(void) {
+    Boolean result = false;
+    __CFLock(&_CFBundleInfoPlistCacheLock);
+    if (!_CFBundleInfoPlistCachePath) {
+        __CFUnlock(&_CFBundleInfoPlistCacheLock);
+        return false;
+    }
+    if (!_CFBundleInfoPlistCachePending) {
+        __CFUnlock(&_CFBundleInfoPlistCacheLock);
+        return true;
+    }
+    
+    uint64_t generation = _CFBundleInfoPlistCacheGeneration;
+    CFMutableDictionaryRef merged = NULL;
+    if (_CFBundleInfoPlistCacheBytes) {
+        CFPropertyListRef existing = NULL;
+        if (__CFBinaryPlistCreateObject((const uint8_t *)_CFBundleInfoPlistCacheBytes, _CFBundleInfoPlistCacheLength, _CFBundleInfoPlistCacheTopOffset, &_CFBundleInfoPlistCacheTrailer, kCFAllocatorSystemDefault, kCFPropertyListMutableContainers, NULL, &existing)) {
+            merged = (CFMutableDictionaryRef)existing;
+        }
+    }
+    if (!merged) merged = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    CFDictionaryApplyFunction(_CFBundleInfoPlistCachePending, _CFBundleMergeInfoPlistCacheEntry, merged);
+    __CFUnlock(&_CFBundleInfoPlistCacheLock);
+
+    // Find the entries of bundles that have since gone away, so the file does not keep growing. The stats run unlocked so bundle lookups are not held up behind them.
+    CFMutableArrayRef gone = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
+    CFIndex count = CFDictionaryGetCount(merged);
+    if (count > 0) {
+        CFStringRef *paths = (CFStringRef *)malloc(count * sizeof(CFStringRef));
+        CFDictionaryGetKeysAndValues(merged, (const void **)paths, NULL);
+        for (CFIndex i = 0; i < count; i++) {
+            char entryPath[CFMaxPathSize];
+            struct stat statBuf;
+            if (CFGetTypeID(paths[i]) != CFStringGetTypeID() || !CFStringGetFileSystemRepresentation(paths[i], entryPath, CFMaxPathSize) || stat(entryPath, &statBuf) != 0) {
+                CFArrayAppendValue(gone, paths[i]);
+            }
+        }
+        free(paths);
+    }
+
+    __CFLock(&_CFBundleInfoPlistCacheLock);
+    if (_CFBundleInfoPlistCacheGeneration != generation) {
+        // The cache was moved or written by another thread while unlocked; merged no longer matches the file
+        __CFUnlock(&_CFBundleInfoPlistCacheLock);
+        CFRelease(gone);
+        CFRelease(merged);
+        return _CFBundleWriteInfoPlistCache();
+    }
+    // Pick up entries added while unlocked; those were stamped just now, so they are not pruned
+    CFDictionaryApplyFunction(_CFBundleInfoPlistCachePending, _CFBundleMergeInfoPlistCacheEntry, merged);
+    for (CFIndex i = 0; i < CFArrayGetCount(gone); i++) {
+        CFStringRef path = (CFStringRef)CFArrayGetValueAtIndex(gone, i);
+        if (!CFDictionaryContainsKey(_CFBundleInfoPlistCachePending, path)) CFDictionaryRemoveValue(merged, path);
+    }
+    CFRelease(gone);
+    
+    CFDataRef data = CFPropertyListCreateData(kCFAllocatorSystemDefault, merged, kCFPropertyListBinaryFormat_v1_0, 0, NULL);
+    CFRelease(merged);
+    if (data) {
+        // Write beside the cache and rename over it, so processes that have the old file mapped keep a consistent view
+        char cpath[CFMaxPathSize], tmpPath[CFMaxPathSize];
+        if (CFStringGetFileSystemRepresentation(_CFBundleInfoPlistCachePath, cpath, CFMaxPathSize) && snprintf(tmpPath, CFMaxPathSize, "%s.%d", cpath, (int)getpid()) < CFMaxPathSize) {
+            CFURLRef tmpURL = CFURLCreateFromFileSystemRepresentation(kCFAllocatorSystemDefault, (const uint8_t *)tmpPath, strlen(tmpPath), false);
+            if (tmpURL && _CFWriteBytesToFile(tmpURL, CFDataGetBytePtr(data), CFDataGetLength(data))) {
+                if (rename(tmpPath, cpath) == 0) {
+                    result = true;
+                } else {
+                    unlink(tmpPath);
+                }
+            }
+            if (tmpURL) CFRelease(tmpURL);
+        }
+        CFRelease(data);
+    }
+    if (result) {
+        CFRelease(_CFBundleInfoPlistCachePending);
+        _CFBundleInfoPlistCachePending = NULL;
+        _CFBundleInfoPlistCacheGeneration++;
+        _CFBundleMapInfoPlistCacheLocked();
+    }
+    __CFUnlock(&_CFBundleInfoPlistCacheLock);
+    return result;
+}
+
 #pragma mark -
 #pragma mark Info Plist Functions
 
@@ -514,30 +752,43 @@ CF_PRIVATE CFDictionaryRef _CFBundleCopyInfoDictionaryInDirectoryWithVersion(CFA
         CFRelease(directoryPath);
         CFRelease(directoryURL);
         
-        // Attempt to read in the data from the Info.plist we found - first the platform-specific one.
+        // Attempt to read in the data from the Info.plist we found - first the platform-specific one. The compiled cache, when enabled, stands in for reading and parsing a file that has not changed.
         CFDataRef infoData = NULL;
         CFURLRef finalInfoPlistURL = NULL;
+        CFStringRef cachePath = NULL;
+        CFMutableArrayRef cacheEntry = NULL;
         if (platformInfoPlistURL) {
+            result = _CFBundleCopyCachedInfoDictionary(alloc, platformInfoPlistURL, &cachePath, &cacheEntry);
+            if (!result) {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wdeprecated"
-            CFURLCreateDataAndPropertiesFromResource(kCFAllocatorSystemDefault, platformInfoPlistURL, &infoData, NULL, NULL, NULL);
+                CFURLCreateDataAndPropertiesFromResource(kCFAllocatorSystemDefault, platformInfoPlistURL, &infoData, NULL, NULL, NULL);
 #pragma GCC diagnostic pop
-            if (infoData) finalInfoPlistURL = platformInfoPlistURL;
+            }
+            if (result || infoData) finalInfoPlistURL = platformInfoPlistURL;
         }
         
-        if (!infoData && infoPlistURL) {
+        if (!result && !infoData && infoPlistURL) {
+            if (cachePath) CFRelease(cachePath);
+            if (cacheEntry) CFRelease(cacheEntry);
+            result = _CFBundleCopyCachedInfoDictionary(alloc, infoPlistURL, &cachePath, &cacheEntry);
+            if (!result) {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wdeprecated"
-            CFURLCreateDataAndPropertiesFromResource(kCFAllocatorSystemDefault, infoPlistURL, &infoData, NULL, NULL, NULL);
+                CFURLCreateDataAndPropertiesFromResource(kCFAllocatorSystemDefault, infoPlistURL, &infoData, NULL, NULL, NULL);
 #pragma GCC diagnostic pop
-            if (infoData) finalInfoPlistURL = infoPlistURL;
+            }
+            if (result || infoData) finalInfoPlistURL = infoPlistURL;
         }
         
-        if (infoData) {
+        if (result) {
+            CFDictionarySetValue((CFMutableDictionaryRef)result, _kCFBundleInfoPlistURLKey, finalInfoPlistURL);
+        } else if (infoData) {
             CFErrorRef error = NULL;
             result = (CFDictionaryRef)CFPropertyListCreateWithData(alloc, infoData, kCFPropertyListMutableContainers, NULL, &error);
             if (result) {
                 if (CFDictionaryGetTypeID() == CFGetTypeID(result)) {
+                    if (cacheEntry) _CFBundleAddInfoDictionaryToCache(cachePath, cacheEntry, result);
                     CFDictionarySetValue((CFMutableDictionaryRef)result, _kCFBundleInfoPlistURLKey, finalInfoPlistURL);
                 } else {
                     CFRelease(result);
@@ -558,6 +809,8 @@ CF_PRIVATE CFDictionaryRef _CFBundleCopyInfoDictionaryInDirectoryWithVersion(CFA
             CFRelease(infoData);
         }
         
+        if (cachePath) CFRelease(cachePath);
+        if (cacheEntry) CFRelease(cacheEntry);
         if (platformInfoPlistURL) CFRelease(platformInfoPlistURL);
         if (infoPlistURL) CFRelease(infoPlistURL);
     }
@@ -859,9 +1112,6 @@ static void __addPlatformAndProductNamesToKeys(const void *value, void *context)
     CFRelease(newKeyWithProductAndPlatform);
 }
 
-// from CFUtilities.c
-CF_PRIVATE Boolean _CFReadMappedFromFile(CFStringRef path, Boolean map, Boolean uncached, void **outBytes, CFIndex *outLength, CFErrorRef *errorPtr);
-
 // implementation of below functions - takes URL as parameter
 static CFPropertyListRef _CFBundleCreateFilteredInfoPlistWithURL(CFURLRef infoPlistURL, CFSetRef keyPaths, _CFBundleFilteredPlistOptions options) {
     CFPropertyListRef result = NULL;
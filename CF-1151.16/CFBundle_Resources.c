@@ -81,6 +81,9 @@ CF_PRIVATE void _CFBundleFlushQueryTableCache(CFBundleRef bundle) {
     if (bundle->_queryTable) {
         CFDictionaryRemoveAllValues(bundle->_queryTable);
     }
+    if (bundle->_resourceDirectoryContents) {
+        CFDictionaryRemoveAllValues(bundle->_resourceDirectoryContents);
+    }
     __CFUnlock(&bundle->_queryLock);
 }
 
@@ -605,7 +608,88 @@ static void _CFBundleSplitFileName(CFStringRef fileName, CFStringRef *noProductO
     }    
 }
 
-static Boolean _CFBundleReadDirectory(CFStringRef pathOfDir, CFStringRef subdirectory, CFMutableArrayRef allFiles, Boolean hasFileAdded, CFMutableDictionaryRef queryTable, CFMutableDictionaryRef typeDir, CFMutableDictionaryRef addedTypes, Boolean firstLproj, CFStringRef product, CFStringRef platform, CFStringRef lprojName, Boolean appendLprojCharacters) {
+// Scans a directory once into a listing of [names, types]. Entries that readdir leaves untyped are resolved here, so replaying the listing never needs another stat.
+static CFArrayRef _CFBundleCreateDirectoryListing(CFStringRef pathOfDir) {
+    CFMutableArrayRef names = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
+    CFMutableDataRef types = CFDataCreateMutable(kCFAllocatorSystemDefault, 0);
+    _CFIterateDirectory(pathOfDir, ^Boolean(CFStringRef fileName, uint8_t fileType) {
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI || DEPLOYMENT_TARGET_LINUX || DEPLOYMENT_TARGET_FREEBSD
+        if (fileType == DT_UNKNOWN) {
+            char subdirPath[CFMaxPathLength];
+            char fileNameBuf[CFMaxPathLength];
+            struct stat statBuf;
+            if (CFStringGetFileSystemRepresentation(pathOfDir, subdirPath, sizeof(subdirPath)) && CFStringGetFileSystemRepresentation(fileName, fileNameBuf, sizeof(fileNameBuf))) {
+                strlcat(subdirPath, "/", sizeof(subdirPath));
+                strlcat(subdirPath, fileNameBuf, sizeof(subdirPath));
+                if (stat(subdirPath, &statBuf) == 0) {
+                    fileType = ((statBuf.st_mode & S_IFMT) == S_IFDIR) ? DT_DIR : DT_REG;
+                }
+            }
+        }
+#endif
+        CFArrayAppendValue(names, fileName);
+        CFDataAppendBytes(types, &fileType, 1);
+        return true;
+    });
+    CFTypeRef values[2] = {names, types};
+    CFArrayRef listing = CFArrayCreate(kCFAllocatorSystemDefault, values, 2, &kCFTypeArrayCallBacks);
+    CFRelease(names);
+    CFRelease(types);
+    return listing;
+}
+
+// Returns false only when the parent of pathOfDir is already in the index and lists nothing that could name it. Names are matched ignoring case and Unicode normalization, since on case-insensitive volumes, or where readdir returns decomposed names, opendir finds directories under a name that differs from the listed one.
+static Boolean _CFBundleIndexedDirectoryMayExist(CFDictionaryRef directoryIndex, CFStringRef pathOfDir) {
+    CFIndex length = CFStringGetLength(pathOfDir);
+    CFRange slashRange;
+    if (length < 2 || CFStringGetCharacterAtIndex(pathOfDir, length - 1) == _CFGetSlash()) return true;
+    if (!CFStringFindWithOptions(pathOfDir, _CFGetSlashStr(), CFRangeMake(0, length), kCFCompareBackwards, &slashRange) || slashRange.location == 0) return true;
+
+    CFStringRef parentPath = CFStringCreateWithSubstring(kCFAllocatorSystemDefault, pathOfDir, CFRangeMake(0, slashRange.location));
+    CFTypeRef parentListing = CFDictionaryGetValue(directoryIndex, parentPath);
+    CFRelease(parentPath);
+    if (!parentListing) return true;
+    if (parentListing == kCFNull) return false;
+
+    CFArrayRef names = (CFArrayRef)CFArrayGetValueAtIndex((CFArrayRef)parentListing, 0);
+    CFStringRef childName = CFStringCreateWithSubstring(kCFAllocatorSystemDefault, pathOfDir, CFRangeMake(slashRange.location + 1, length - slashRange.location - 1));
+    CFIndex count = CFArrayGetCount(names);
+    Boolean result = CFArrayContainsValue(names, CFRangeMake(0, count), childName);
+    for (CFIndex i = 0; !result && i < count; i++) {
+        result = (CFStringCompare((CFStringRef)CFArrayGetValueAtIndex(names, i), childName, kCFCompareCaseInsensitive | kCFCompareNonliteral) == kCFCompareEqualTo);
+    }
+    CFRelease(childName);
+    return result;
+}
+
+// Iterates pathOfDir through the bundle's directory index, so each directory in the bundle is read at most once and probing missing .lproj or subdirectory folders costs no system calls. Without an index this reads the directory directly. The caller must hold the bundle's query lock.
+static void _CFBundleIterateIndexedDirectory(CFMutableDictionaryRef directoryIndex, CFStringRef pathOfDir, Boolean (^fileHandler)(CFStringRef fileName, uint8_t fileType)) {
+    if (!directoryIndex) {
+        _CFIterateDirectory(pathOfDir, fileHandler);
+        return;
+    }
+    CFTypeRef listing = CFDictionaryGetValue(directoryIndex, pathOfDir);
+    if (!listing) {
+        if (_CFBundleIndexedDirectoryMayExist(directoryIndex, pathOfDir)) {
+            listing = _CFBundleCreateDirectoryListing(pathOfDir);
+            CFDictionarySetValue(directoryIndex, pathOfDir, listing);
+            CFRelease(listing);
+        } else {
+            CFDictionarySetValue(directoryIndex, pathOfDir, kCFNull);
+            listing = kCFNull;
+        }
+    }
+    if (listing == kCFNull) return;
+
+    CFArrayRef names = (CFArrayRef)CFArrayGetValueAtIndex((CFArrayRef)listing, 0);
+    const uint8_t *types = CFDataGetBytePtr((CFDataRef)CFArrayGetValueAtIndex((CFArrayRef)listing, 1));
+    CFIndex count = CFArrayGetCount(names);
+    for (CFIndex i = 0; i < count; i++) {
+        if (!fileHandler((CFStringRef)CFArrayGetValueAtIndex(names, i), types[i])) break;
+    }
+}
+
+static Boolean _CFBundleReadDirectory(CFMutableDictionaryRef directoryIndex, CFStringRef pathOfDir, CFStringRef subdirectory, CFMutableArrayRef allFiles, Boolean hasFileAdded, CFMutableDictionaryRef queryTable, CFMutableDictionaryRef typeDir, CFMutableDictionaryRef addedTypes, Boolean firstLproj, CFStringRef product, CFStringRef platform, CFStringRef lprojName, Boolean appendLprojCharacters) {
     
     Boolean result = true;
     CFMutableStringRef pathPrefix = NULL;
@@ -626,7 +710,7 @@ static Boolean _CFBundleReadDirectory(CFStringRef pathOfDir, CFStringRef subdire
         }
     }
     
-    _CFIterateDirectory(pathOfDir, ^Boolean(CFStringRef fileName, uint8_t fileType) {
+    _CFBundleIterateIndexedDirectory(directoryIndex, pathOfDir, ^Boolean(CFStringRef fileName, uint8_t fileType) {
         CFStringRef startType = NULL, endType = NULL, noProductOrPlatform = NULL;
         _CFBundleFileVersion fileVersion;
         _CFBundleSplitFileName(fileName, &noProductOrPlatform, &endType, &startType, product, platform, &fileVersion);
@@ -748,7 +832,7 @@ static Boolean _CFBundleReadDirectory(CFStringRef pathOfDir, CFStringRef subdire
 }
 
 
-static CFDictionaryRef _CFBundleCreateQueryTableAtPath(CFStringRef inPath, CFArrayRef languages, CFStringRef resourcesDirectory, CFStringRef subdirectory)
+static CFDictionaryRef _CFBundleCreateQueryTableAtPath(CFMutableDictionaryRef directoryIndex, CFStringRef inPath, CFArrayRef languages, CFStringRef resourcesDirectory, CFStringRef subdirectory)
 {
     
     CFMutableDictionaryRef queryTable = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, &kCFCopyStringDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
@@ -776,7 +860,7 @@ static CFDictionaryRef _CFBundleCreateQueryTableAtPath(CFStringRef inPath, CFArr
         _CFAppendPathComponent2(path, subdirectory);
     }
     // read the content in sub dir and put them into query table
-    _CFBundleReadDirectory(path, subdirectory, allFiles, false, queryTable, typeDir, NULL, false, product, platform, NULL, false);
+    _CFBundleReadDirectory(directoryIndex, path, subdirectory, allFiles, false, queryTable, typeDir, NULL, false, product, platform, NULL, false);
     CFStringDelete(path, CFRangeMake(basePathLen, CFStringGetLength(path) - basePathLen));    // Strip the string back to the base path
     
     CFIndex numOfAllFiles = CFArrayGetCount(allFiles);
@@ -795,7 +879,7 @@ static CFDictionaryRef _CFBundleCreateQueryTableAtPath(CFStringRef inPath, CFArr
         if (subdirectory) {
             _CFAppendPathComponent2(path, subdirectory);
         }
-        _CFBundleReadDirectory(path, subdirectory, allFiles, hasFileAdded, queryTable, typeDir, addedTypes, firstLproj, product, platform, lprojTarget, true);
+        _CFBundleReadDirectory(directoryIndex, path, subdirectory, allFiles, hasFileAdded, queryTable, typeDir, addedTypes, firstLproj, product, platform, lprojTarget, true);
         CFStringDelete(path, CFRangeMake(basePathLen, CFStringGetLength(path) - basePathLen));         // Strip the string back to the base path
 
         if (!hasFileAdded && numOfAllFiles < CFArrayGetCount(allFiles)) {
@@ -810,7 +894,7 @@ static CFDictionaryRef _CFBundleCreateQueryTableAtPath(CFStringRef inPath, CFArr
     if (subdirectory) {
         _CFAppendPathComponent2(path, subdirectory);
     }
-    _CFBundleReadDirectory(path, subdirectory, allFiles, hasFileAdded, queryTable, typeDir, addedTypes, YES, product, platform, _CFBundleBaseDirectory, true);
+    _CFBundleReadDirectory(directoryIndex, path, subdirectory, allFiles, hasFileAdded, queryTable, typeDir, addedTypes, YES, product, platform, _CFBundleBaseDirectory, true);
     CFStringDelete(path, CFRangeMake(basePathLen, CFStringGetLength(path) - basePathLen));    // Strip the string back to the base path
     
     if (!hasFileAdded && numOfAllFiles < CFArrayGetCount(allFiles)) {
@@ -827,7 +911,7 @@ static CFDictionaryRef _CFBundleCreateQueryTableAtPath(CFStringRef inPath, CFArr
             if (subdirectory) {
                 _CFAppendPathComponent2(path, subdirectory);
             }
-            _CFBundleReadDirectory(path, subdirectory, allFiles, hasFileAdded, queryTable, typeDir, addedTypes, false, product, platform, lprojTarget, true);
+            _CFBundleReadDirectory(directoryIndex, path, subdirectory, allFiles, hasFileAdded, queryTable, typeDir, addedTypes, false, product, platform, lprojTarget, true);
             CFStringDelete(path, CFRangeMake(basePathLen, CFStringGetLength(path) - basePathLen));         // Strip the string back to the base path
             
             if (!hasFileAdded && numOfAllFiles < CFArrayGetCount(allFiles)) {
@@ -878,8 +962,11 @@ static CFDictionaryRef _CFBundleCopyQueryTable(CFBundleRef bundle, CFURLRef bund
         subTable = (CFDictionaryRef) CFDictionaryGetValue(bundle->_queryTable, argDirStr);
         
         if (!subTable) {
+            if (!bundle->_resourceDirectoryContents) {
+                bundle->_resourceDirectoryContents = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, &kCFCopyStringDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+            }
             // create the query table for the given sub dir
-            subTable = _CFBundleCreateQueryTableAtPath(bundle->_bundleBasePath, languages, resourcesDirectory, subdirectory);
+            subTable = _CFBundleCreateQueryTableAtPath(bundle->_resourceDirectoryContents, bundle->_bundleBasePath, languages, resourcesDirectory, subdirectory);
             
             CFDictionarySetValue(bundle->_queryTable, argDirStr, subTable);
         } else {
@@ -891,7 +978,7 @@ static CFDictionaryRef _CFBundleCopyQueryTable(CFBundleRef bundle, CFURLRef bund
         CFURLRef url = CFURLCopyAbsoluteURL(bundleURL);
         CFStringRef bundlePath = CFURLCopyFileSystemPath(url, PLATFORM_PATH_STYLE);
         CFRelease(url);
-        subTable = _CFBundleCreateQueryTableAtPath(bundlePath, languages, resourcesDirectory, subdirectory);
+        subTable = _CFBundleCreateQueryTableAtPath(NULL, bundlePath, languages, resourcesDirectory, subdirectory);
         CFRelease(bundlePath);
     }
     
@@ -108,6 +108,7 @@ typedef struct _TrieLevel {
     NextTrie slots[CHARACTER_SET_SIZE];
     uint32_t weight;        
     uint32_t payload;
+    uint32_t maxWeight;     // largest weight of any term at or below this level
 } TrieLevel;
 typedef TrieLevel *TrieLevelRef;
 
@@ -124,6 +125,12 @@ typedef struct _CompactMapTrieLevel {
 } CompactMapTrieLevel;
 typedef CompactMapTrieLevel *CompactMapTrieLevelRef;
 
+// With kCFBurstTrieStoreWeights, this directly follows each MapTrieLevel or CompactMapTrieLevel.
+typedef struct _MapTrieLevelWeights {
+    uint32_t maxWeight;
+    uint32_t weight;
+} MapTrieLevelWeights;
+
 typedef struct _ListNode {
     struct _ListNode *next;
     uint32_t weight;
@@ -150,6 +157,9 @@ typedef struct _PageEntry {
     UInt8 string[];
 } PageEntry;
 
+// With kCFBurstTriePackedPageEntries, a front-coded entry is the pfxLen byte, then strlen and payload as little-endian base-128 varints, then the string.
+#define MAX_PACKED_PAGE_ENTRY_HEADER_SIZE (1 + 2 + 5)
+
 typedef struct _TrieHeader {
     uint32_t signature;
     uint32_t rootOffset; 
@@ -253,6 +263,15 @@ typedef struct _fileHeader {
 // **
 #pragma pack()
 
+// Decoded form of a front-coded page entry, in either the fixed-width or the packed encoding.
+typedef struct _PageEntryView {
+    uint32_t pfxLen;
+    uint32_t strlen;
+    uint32_t payload;
+    const UInt8 *string;
+    uint32_t size;      // bytes the entry takes up on the page
+} PageEntryView;
+
 struct _CFBurstTrie {
     union {
         TrieLevel root;
@@ -295,7 +314,7 @@ static bool foundKey(void *context, const uint8_t *key, uint32_t payload, bool e
 
 void CFBurstTrieTraverseWithCursor(CFBurstTrieRef trie, const uint8_t *prefix, uint32_t prefixLen, void **cursor, void *ctx, bool (*callback)(void *, const uint8_t *, uint32_t, bool));
 
-static CFBTInsertCode addCFBurstTrieLevel(CFBurstTrieRef trie, TrieLevelRef root, const uint8_t *key, uint32_t keylen, uint32_t weight, uint32_t payload);
+static CFBTInsertCode addCFBurstTrieLevel(CFBurstTrieRef trie, TrieLevelRef root, const uint8_t *key, uint32_t keylen, uint32_t weight, uint32_t payload, uint32_t *termWeight);
 
 static void findCFBurstTrieLevel(CFBurstTrieRef trie, TrieCursor *cursor, bool exactmatch, void *ctx, bool (*callback)(void*, const uint8_t*, uint32_t, bool));
 static void findCFBurstTrieMappedLevel(CFBurstTrieRef trie, MapCursor *cursor, bool exactmatch, void *ctx, bool (*callback)(void*, const uint8_t*, uint32_t, bool));
@@ -327,7 +346,8 @@ static Boolean getMapCursorPayload(CFBurstTrieRef trie, const CompactMapCursor *
 static void copyMapCursor(const CompactMapCursor *source, CompactMapCursor* destination);
 static Boolean areMapCursorsEqual(const CompactMapCursor *lhs, const CompactMapCursor *rhs);
 static void traverseFromMapCursor(CFBurstTrieRef trie, CompactMapCursor *cursor, UInt8* bytes, uint32_t capacity, uint32_t length, Boolean *stop, void *ctx, CFBurstTrieTraversalCallback callback);
-static Boolean getMapCursorPayloadFromPackedPageEntry(PageEntryPacked *entry, const CompactMapCursor *cursor, uint32_t *payload);
+static Boolean getMapCursorPayloadFromPackedPageEntry(const PageEntryView *entry, const CompactMapCursor *cursor, uint32_t *payload);
+static void getPackedPageEntry(Page *page, uint32_t offset, Boolean packed, PageEntryView *entry);
 static Boolean getMapCursorPayloadFromPageEntry(PageEntry *entry, const CompactMapCursor *cursor, uint32_t *payload);
 
 CFBurstTrieRef CFBurstTrieCreateWithOptions(CFDictionaryRef options) {
@@ -527,7 +547,8 @@ Boolean CFBurstTrieAddUTF8StringWithWeight(CFBurstTrieRef trie, UInt8 *chars, CF
     CFBTInsertCode code = FailedInsert;
     
     if (!trie->mapBase && numChars < MAX_STRING_SIZE*4 && payload > 0) {
-        code = addCFBurstTrieLevel(trie, &trie->root, chars, numChars, weight, payload);
+        uint32_t termWeight = 0;
+        code = addCFBurstTrieLevel(trie, &trie->root, chars, numChars, weight, payload, &termWeight);
         if (code == NewTerm) trie->count++;
     }
     return code > FailedInsert;
@@ -856,10 +877,18 @@ static ListNodeRef makeCFBurstTrieListNode(const uint8_t *key, uint32_t keylen,
 static void addCFBurstTrieBurstLevel(CFBurstTrieRef trie, TrieLevelRef root, const uint8_t *key, uint32_t keylen, uint32_t weight, uint32_t payload) {
     if (keylen) {
         NextTrie next = root->slots[*key];
+        ListNodeRef head = (ListNodeRef) NextTrie_GetPtr(next);
         ListNodeRef newNode = makeCFBurstTrieListNode(key+1, keylen-1, weight, payload);
         newNode->weight = weight;
-        newNode->next = (ListNodeRef) NextTrie_GetPtr(next);
-        next = (uintptr_t) newNode;
+        // ** Keep the heaviest node first.
+        if (!head || weight >= head->weight) {
+            newNode->next = head;
+            head = newNode;
+        } else {
+            newNode->next = head->next;
+            head->next = newNode;
+        }
+        next = (uintptr_t) head;
         NextTrie_SetKind(next, ListKind);
         root->slots[*key] = next;
     } else { 
@@ -867,6 +896,7 @@ static void addCFBurstTrieBurstLevel(CFBurstTrieRef trie, TrieLevelRef root, con
         root->weight = weight;
         root->payload = payload;
     }
+    if (weight > root->maxWeight) root->maxWeight = weight;
 }
 
 static TrieLevelRef burstCFBurstTrieLevel(CFBurstTrieRef trie, ListNodeRef list, uint32_t listCount) {
@@ -880,12 +910,14 @@ static TrieLevelRef burstCFBurstTrieLevel(CFBurstTrieRef trie, ListNodeRef list,
     return newLevel;
 }
 
-static CFBTInsertCode addCFBurstTrieListNode(CFBurstTrieRef trie, ListNodeRef list, const uint8_t *key, uint32_t keylen, uint32_t weight, uint32_t payload, uint32_t *listCount)
+// Lists keep their heaviest node first, so that the largest weight in a list can be read off its head.
+static CFBTInsertCode addCFBurstTrieListNode(CFBurstTrieRef trie, ListNodeRef *head, const uint8_t *key, uint32_t keylen, uint32_t weight, uint32_t payload, uint32_t *listCount, uint32_t *termWeight)
 {
     CFBTInsertCode code = FailedInsert;
     uint32_t count = 1;
     
-    ListNodeRef last = list;
+    ListNodeRef list = *head;
+    ListNodeRef last = NULL;
     while (list) {
         if (list->length == keylen && memcmp(key, list->string, keylen) == 0) {
             list->weight += weight;
@@ -900,36 +932,47 @@ static CFBTInsertCode addCFBurstTrieListNode(CFBurstTrieRef trie, ListNodeRef li
     }
     
     if (!list) {
-        last->next = makeCFBurstTrieListNode(key, keylen, weight, payload);
+        list = last->next = makeCFBurstTrieListNode(key, keylen, weight, payload);
         code = NewTerm;
     }
     
+    if (list != *head && list->weight > (*head)->weight) {
+        last->next = list->next;
+        list->next = *head;
+        *head = list;
+    }
+    
+    *termWeight = list->weight;
     *listCount = count;
     return code;
 }
 
-static CFBTInsertCode addCFBurstTrieLevel(CFBurstTrieRef trie, TrieLevelRef root, const uint8_t *key, uint32_t keylen, uint32_t weight, uint32_t payload)
+static CFBTInsertCode addCFBurstTrieLevel(CFBurstTrieRef trie, TrieLevelRef root, const uint8_t *key, uint32_t keylen, uint32_t weight, uint32_t payload, uint32_t *termWeight)
 {
     CFBTInsertCode code = FailedInsert;
     if (keylen) {
         NextTrie next = root->slots[*key];
         if (NextTrie_GetKind(next) == TrieKind) {
             TrieLevelRef nextLevel = (TrieLevelRef) NextTrie_GetPtr(next);
-            code = addCFBurstTrieLevel(trie, nextLevel, key+1, keylen-1, weight, payload);
+            code = addCFBurstTrieLevel(trie, nextLevel, key+1, keylen-1, weight, payload, termWeight);
         } else {
             if (NextTrie_GetKind(next) == ListKind) {
                 uint32_t listCount;
                 ListNodeRef listNode = (ListNodeRef) NextTrie_GetPtr(next);
-                code = addCFBurstTrieListNode(trie, listNode, key+1, keylen-1, weight, payload, &listCount);
+                code = addCFBurstTrieListNode(trie, &listNode, key+1, keylen-1, weight, payload, &listCount, termWeight);
                 if (listCount > trie->containerSize) {
                     next = (uintptr_t) burstCFBurstTrieLevel(trie, listNode, listCount);
                     NextTrie_SetKind(next, TrieKind);
+                } else {
+                    next = (uintptr_t) listNode;
+                    NextTrie_SetKind(next, ListKind);
                 }
             } else {
                 // ** Make a new list node
                 next = (uintptr_t) makeCFBurstTrieListNode(key+1, keylen-1, weight, payload);
                 NextTrie_SetKind(next, ListKind);
                 code = NewTerm;
+                *termWeight = weight;
             }
             root->slots[*key] = next;
         }
@@ -939,8 +982,10 @@ static CFBTInsertCode addCFBurstTrieLevel(CFBurstTrieRef trie, TrieLevelRef root
         else code = ExistingTerm;
         root->weight += weight;
         root->payload = payload;
+        *termWeight = root->weight;
     }
     
+    if (code != FailedInsert && *termWeight > root->maxWeight) root->maxWeight = *termWeight;
     return code;
 }
 #if 0
@@ -973,22 +1018,25 @@ static void findCFBurstTrieMappedPage(CFBurstTrieRef trie, MapCursor *cursor, vo
     int len = cursor->prefixlen-cursor->keylen;
     len = len <= 0 ? 0 : len;
     if (trie->cflags & kCFBurstTriePrefixCompression) {
+        Boolean packed = (trie->cflags & kCFBurstTriePackedPageEntries) != 0;
         uint8_t pfx[CHARACTER_SET_SIZE];
-        PageEntryPacked *lastEntry = 0;
+        PageEntryView lastEntry, entry;
+        Boolean hasLastEntry = false;
         while (cur < end) {
-            PageEntryPacked *entry = (PageEntryPacked *)&page->data[cur];
-            int lencompare = (entry->strlen+entry->pfxLen)-len;
-            if (lastEntry && entry->pfxLen>lastEntry->pfxLen) memcpy(pfx+lastEntry->pfxLen, lastEntry->string, entry->pfxLen-lastEntry->pfxLen);
+            getPackedPageEntry(page, cur, packed, &entry);
+            int lencompare = (entry.strlen+entry.pfxLen)-len;
+            if (hasLastEntry && entry.pfxLen>lastEntry.pfxLen) memcpy(pfx+lastEntry.pfxLen, lastEntry.string, entry.pfxLen-lastEntry.pfxLen);
             if (lencompare >= 0 &&
-                (len == 0 || (__builtin_memcmp(pfx, cursor->prefix+cursor->keylen, entry->pfxLen) == 0 && 
-                              __builtin_memcmp(entry->string, cursor->prefix+cursor->keylen+entry->pfxLen, cursor->prefixlen-cursor->keylen-entry->pfxLen) == 0))) {
-                memcpy(cursor->key+cursor->keylen, pfx, entry->pfxLen);
-                memcpy(cursor->key+cursor->keylen+entry->pfxLen, entry->string, entry->strlen);
-                cursor->key[cursor->keylen+entry->pfxLen+entry->strlen] = 0;
-                if (entry->payload && callback(ctx, (const uint8_t *)cursor->key, entry->payload, lencompare==0)) return;
+                (len == 0 || (__builtin_memcmp(pfx, cursor->prefix+cursor->keylen, entry.pfxLen) == 0 && 
+                              __builtin_memcmp(entry.string, cursor->prefix+cursor->keylen+entry.pfxLen, cursor->prefixlen-cursor->keylen-entry.pfxLen) == 0))) {
+                memcpy(cursor->key+cursor->keylen, pfx, entry.pfxLen);
+                memcpy(cursor->key+cursor->keylen+entry.pfxLen, entry.string, entry.strlen);
+                cursor->key[cursor->keylen+entry.pfxLen+entry.strlen] = 0;
+                if (entry.payload && callback(ctx, (const uint8_t *)cursor->key, entry.payload, lencompare==0)) return;
             }
             lastEntry = entry;
-            cur += sizeof(*entry) + entry->strlen;
+            hasLastEntry = true;
+            cur += entry.size;
         }
     } else {
         while (cur < end) {
@@ -1192,9 +1240,36 @@ static void traverseCFBurstTrieWithCursor(CFBurstTrieRef trie, const uint8_t *pr
     }
 }
 
-CF_INLINE uint32_t getPackedPageEntrySize(PageEntryPacked *entry)
+CF_INLINE uint32_t readPackedPageEntryVarint(const UInt8 **bytes)
+{
+    uint32_t value = 0;
+    uint32_t shift = 0;
+    UInt8 byte;
+    do {
+        byte = *(*bytes)++;
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && shift < 35);
+    return value;
+}
+
+static void getPackedPageEntry(Page *page, uint32_t offset, Boolean packed, PageEntryView *entry)
 {
-    return sizeof(PageEntryPacked) + entry->strlen;
+    if (packed) {
+        const UInt8 *bytes = (const UInt8 *)&page->data[offset];
+        entry->pfxLen = *bytes++;
+        entry->strlen = readPackedPageEntryVarint(&bytes);
+        entry->payload = readPackedPageEntryVarint(&bytes);
+        entry->string = bytes;
+        entry->size = (uint32_t)(bytes - (const UInt8 *)&page->data[offset]) + entry->strlen;
+    } else {
+        PageEntryPacked *packedEntry = (PageEntryPacked *)&page->data[offset];
+        entry->pfxLen = packedEntry->pfxLen;
+        entry->strlen = packedEntry->strlen;
+        entry->payload = packedEntry->payload;
+        entry->string = packedEntry->string;
+        entry->size = sizeof(PageEntryPacked) + packedEntry->strlen;
+    }
 }
 
 CF_INLINE uint32_t getPageEntrySize(PageEntry *entry)
@@ -1215,29 +1290,29 @@ static void _printPageEntry(PageEntryPacked *entry) {
     printf("\n");
 }
 */
-static Boolean advanceCursorOnMappedPageForByte(Page *page, CompactMapCursor *cursor, UInt8 byte) {
-    PageEntryPacked *entry;
+static Boolean advanceCursorOnMappedPageForByte(Page *page, Boolean packed, CompactMapCursor *cursor, UInt8 byte) {
+    PageEntryView entry;
     Boolean found = FALSE;
     uint32_t minPrefixLength = 0;
 
     if (cursor->isOnPage) {
-        entry = (PageEntryPacked *)&page->data[cursor->entryOffsetInPage];
+        getPackedPageEntry(page, cursor->entryOffsetInPage, packed, &entry);
         //_printPageEntry(entry);
         BOOL shouldContinue = TRUE;
 
-        if (!(cursor->entryOffsetInPage  == 0 && entry->strlen == 0)) {
-            if (cursor->entryOffsetInPage == entry->strlen - 1) {
-                minPrefixLength = entry->pfxLen + entry->strlen;
-                cursor->entryOffsetInPage += getPackedPageEntrySize(entry);
+        if (!(cursor->entryOffsetInPage  == 0 && entry.strlen == 0)) {
+            if (cursor->offsetInEntry == entry.strlen - 1) {
+                minPrefixLength = entry.pfxLen + entry.strlen;
+                cursor->entryOffsetInPage += entry.size;
             } else {
                 cursor->offsetInEntry++;
-                if (entry->string[cursor->offsetInEntry] == byte)
+                if (entry.string[cursor->offsetInEntry] == byte)
                     found = TRUE;
-                else if (entry->string[cursor->offsetInEntry] > byte)
+                else if (entry.string[cursor->offsetInEntry] > byte)
                     shouldContinue = FALSE;
                 else {
-                    minPrefixLength = entry->pfxLen + cursor->offsetInEntry;
-                    cursor->entryOffsetInPage += getPackedPageEntrySize(entry);
+                    minPrefixLength = entry.pfxLen + cursor->offsetInEntry;
+                    cursor->entryOffsetInPage += entry.size;
                 }
             }
         }
@@ -1251,23 +1326,23 @@ static Boolean advanceCursorOnMappedPageForByte(Page *page, CompactMapCursor *cu
         cursor->entryOffsetInPage = 0;
     }
 
-    uint32_t pageSize = page->length - sizeof(Page);
+    uint32_t pageSize = page->length;
     while (cursor->entryOffsetInPage < pageSize) {
-        entry = (PageEntryPacked *)&page->data[cursor->entryOffsetInPage];
+        getPackedPageEntry(page, cursor->entryOffsetInPage, packed, &entry);
         //_printPageEntry(entry);
-        if (minPrefixLength > entry->pfxLen)
+        if (minPrefixLength > entry.pfxLen)
             break;
-        else if (minPrefixLength < entry->pfxLen)
-            cursor->entryOffsetInPage += getPackedPageEntrySize(entry);
+        else if (minPrefixLength < entry.pfxLen)
+            cursor->entryOffsetInPage += entry.size;
         else {
-            if (entry->strlen == 0)
-                cursor->entryOffsetInPage += getPackedPageEntrySize(entry);
+            if (entry.strlen == 0)
+                cursor->entryOffsetInPage += entry.size;
             else {
-                if (entry->string[0] > byte)
+                if (entry.string[0] > byte)
                     // Entries are sorted alphabetically
                     break;
-                else if (entry->string[0] < byte)
-                    cursor->entryOffsetInPage += getPackedPageEntrySize(entry);
+                else if (entry.string[0] < byte)
+                    cursor->entryOffsetInPage += entry.size;
                 else {
                     cursor->offsetInEntry = 0;
                     found = TRUE;
@@ -1283,25 +1358,27 @@ static Boolean advanceCursorOnMappedPageForByte(Page *page, CompactMapCursor *cu
     return found;
 }
 
-static Boolean advanceCursorMappedPageWithPerfixCompression(Page *page, CompactMapCursor *cursor, const UInt8* bytes, CFIndex length)
+static Boolean advanceCursorMappedPageWithPerfixCompression(Page *page, Boolean packed, CompactMapCursor *cursor, const UInt8* bytes, CFIndex length)
 {
     if (length == 0) {
-        PageEntryPacked *entry = (PageEntryPacked*)&page->data[0];
+        PageEntryView entry;
+        getPackedPageEntry(page, 0, packed, &entry);
         if (!cursor->isOnPage) {
             cursor->entryOffsetInPage = 0;
             cursor->offsetInEntry = 0;
-            cursor->isOnPage = entry->pfxLen == 0 && entry->strlen == 0;
+            cursor->isOnPage = entry.pfxLen == 0 && entry.strlen == 0;
         }
-        getMapCursorPayloadFromPackedPageEntry(entry, cursor, &cursor->payload);
+        getMapCursorPayloadFromPackedPageEntry(&entry, cursor, &cursor->payload);
         return TRUE;
     }
 
     for (CFIndex i = 0; i < length; ++i) {
-        if (!advanceCursorOnMappedPageForByte(page, cursor, bytes[i]))
+        if (!advanceCursorOnMappedPageForByte(page, packed, cursor, bytes[i]))
             return FALSE;
     }
-    PageEntryPacked *entry = (PageEntryPacked*)&page->data[cursor->entryOffsetInPage];
-    getMapCursorPayloadFromPackedPageEntry(entry, cursor, &cursor->payload);
+    PageEntryView entry;
+    getPackedPageEntry(page, cursor->entryOffsetInPage, packed, &entry);
+    getMapCursorPayloadFromPackedPageEntry(&entry, cursor, &cursor->payload);
     return TRUE;
 }
 
@@ -1319,7 +1396,7 @@ static Boolean advanceCursorMappedPageSortedByKey(Page *page, CompactMapCursor *
     }
 
     PageEntry *entry;
-    uint32_t pageSize = page->length - sizeof(Page);
+    uint32_t pageSize = page->length;
     const UInt8 * prefix = NULL;
     uint32_t prefixLength = 0;
 
@@ -1376,14 +1453,14 @@ static Boolean advanceCursorMappedPage(CFBurstTrieRef trie, CompactMapCursor *cu
         return FALSE;
 
     Page *page = (Page *)DiskNextTrie_GetPtr(trie->mapBase, cursor->next);
-    uint32_t pageSize = page->length - sizeof(Page);
+    uint32_t pageSize = page->length;
     if (pageSize == 0)
         return FALSE;
 
     if (trie->cflags & kCFBurstTrieSortByKey)
         return advanceCursorMappedPageSortedByKey(page, cursor, bytes, length);
     else if (trie->cflags & kCFBurstTriePrefixCompression)
-        return advanceCursorMappedPageWithPerfixCompression(page, cursor, bytes, length);
+        return advanceCursorMappedPageWithPerfixCompression(page, (trie->cflags & kCFBurstTriePackedPageEntries) != 0, cursor, bytes, length);
     else
         return FALSE;
 }
@@ -1513,45 +1590,48 @@ static void traverseFromMapCursorCompactMappedLevel(CFBurstTrieRef trie, Compact
     }
 }
 
-static void traverseFromMapCursorMappedPageWithPrefixCompression(Page *page, CompactMapCursor *cursor, UInt8* bytes, uint32_t capacity, uint32_t length, Boolean *stop, void *ctx, CFBurstTrieTraversalCallback callback)
+static void traverseFromMapCursorMappedPageWithPrefixCompression(Page *page, Boolean packed, CompactMapCursor *cursor, UInt8* bytes, uint32_t capacity, uint32_t length, Boolean *stop, void *ctx, CFBurstTrieTraversalCallback callback)
 {
-    uint32_t pageSize = page->length - sizeof(Page);
+    uint32_t pageSize = page->length;
     uint32_t offset = cursor->entryOffsetInPage;
     uint32_t minPrefixLength = 0;
     if (cursor->isOnPage) {
-        PageEntryPacked *entry = (PageEntryPacked*)&page->data[offset];
-        int32_t remainingLength = entry->strlen - cursor->offsetInEntry - 1;
+        PageEntryView entry;
+        getPackedPageEntry(page, offset, packed, &entry);
+        int32_t remainingLength = entry.strlen - cursor->offsetInEntry - 1;
         if (remainingLength >= 0 && remainingLength <= capacity) {
-            memcpy(bytes + length, entry->string + cursor->offsetInEntry + 1, remainingLength);
-            callback(ctx, bytes, length + remainingLength, entry->payload, stop);
+            memcpy(bytes + length, entry.string + cursor->offsetInEntry + 1, remainingLength);
+            callback(ctx, bytes, length + remainingLength, entry.payload, stop);
             if (*stop)
                 return;
         }
-        minPrefixLength = entry->pfxLen + cursor->offsetInEntry;
-        offset += getPackedPageEntrySize(entry);
+        minPrefixLength = entry.pfxLen + cursor->offsetInEntry;
+        offset += entry.size;
     }
-    PageEntryPacked *previousEntry = NULL;
+    PageEntryView previousEntry, entry;
+    Boolean hasPreviousEntry = false;
     while (offset < pageSize) {
-        PageEntryPacked *entry = (PageEntryPacked*)&page->data[offset];
-        if (minPrefixLength > entry->pfxLen)
+        getPackedPageEntry(page, offset, packed, &entry);
+        if (minPrefixLength > entry.pfxLen)
             break;
-        else if (entry->payload && entry->strlen <= capacity) {
-            if (previousEntry)
-                length -=   previousEntry->strlen + previousEntry->pfxLen - entry->pfxLen;
-            memcpy(bytes + length, entry->string, entry->strlen);
-            callback(ctx, bytes, length + entry->strlen, entry->payload, stop);
-            length += entry->strlen;
+        else if (entry.payload && entry.strlen <= capacity) {
+            if (hasPreviousEntry)
+                length -=   previousEntry.strlen + previousEntry.pfxLen - entry.pfxLen;
+            memcpy(bytes + length, entry.string, entry.strlen);
+            callback(ctx, bytes, length + entry.strlen, entry.payload, stop);
+            length += entry.strlen;
             if (*stop)
                 return;
         }
         previousEntry = entry;
-        offset += getPackedPageEntrySize(entry);
+        hasPreviousEntry = true;
+        offset += entry.size;
     }
 }
 
 static void traverseFromMapCursorMappedPageSortedByKey(Page *page, CompactMapCursor *cursor, UInt8* bytes, uint32_t capacity, uint32_t length, Boolean *stop, void *ctx, CFBurstTrieTraversalCallback callback)
 {
-    uint32_t pageSize = page->length - sizeof(Page);
+    uint32_t pageSize = page->length;
     uint32_t offset = cursor->entryOffsetInPage;
     uint32_t prefixLength = 0;
     const UInt8 *prefix = NULL;
@@ -1595,7 +1675,7 @@ static void traverseFromMapCursorMappedPage(CFBurstTrieRef trie, CompactMapCurso
     if (trie->cflags & kCFBurstTrieSortByKey)
         traverseFromMapCursorMappedPageSortedByKey(page, cursor, bytes, capacity, length, stop, ctx, callback);
     else if (trie->cflags & kCFBurstTriePrefixCompression)
-        traverseFromMapCursorMappedPageWithPrefixCompression(page, cursor, bytes, capacity, length, stop, ctx, callback);
+        traverseFromMapCursorMappedPageWithPrefixCompression(page, (trie->cflags & kCFBurstTriePackedPageEntries) != 0, cursor, bytes, capacity, length, stop, ctx, callback);
 }
 
 void traverseFromMapCursor(CFBurstTrieRef trie, CompactMapCursor *cursor, UInt8* bytes, uint32_t capacity, uint32_t length, Boolean *stop, void *ctx, CFBurstTrieTraversalCallback callback)
@@ -1634,7 +1714,7 @@ Boolean areMapCursorsEqual(const CompactMapCursor *lhs, const CompactMapCursor *
     return lhs->entryOffsetInPage == rhs->entryOffsetInPage && lhs->isOnPage == rhs->isOnPage && lhs->next == rhs->next && lhs->offsetInEntry == rhs->offsetInEntry;
 }
 
-static Boolean getMapCursorPayloadFromPackedPageEntry(PageEntryPacked *entry, const CompactMapCursor *cursor, uint32_t *payload)
+static Boolean getMapCursorPayloadFromPackedPageEntry(const PageEntryView *entry, const CompactMapCursor *cursor, uint32_t *payload)
 {
     if (payload)
         *payload = 0;
@@ -1779,6 +1859,268 @@ static Boolean burstTrieMappedPageFind(StringPage *page, const UInt8 *key, uint3
 }
 
 
+#if 0
+#pragma mark -
+#pragma mark Top-K Completions
+#endif
+
+// A best-first search over the subtree below a prefix. Subtrees enter the queue keyed by the largest weight they contain and terms by their own weight, so once a term reaches the top of the queue nothing left can outweigh it. Only the subtrees along the way to the k heaviest terms are ever opened.
+
+typedef struct _TopKCandidate {
+    uint32_t weight;
+    uint32_t payload;       // the term's payload, or 0 for a subtree
+    uintptr_t next;         // NextTrie, or offset and kind in the map, of a subtree
+    uint32_t keylen;
+    UInt8 *key;
+} TopKCandidate;
+
+typedef struct _TopKQueue {
+    TopKCandidate *items;
+    uint32_t count;
+    uint32_t capacity;
+} TopKQueue;
+
+static void pushTopKCandidate(TopKQueue *queue, uint32_t weight, uint32_t payload, uintptr_t next, const UInt8 *prefix, uint32_t prefixlen, const UInt8 *suffix, uint32_t suffixlen)
+{
+    if (queue->count == queue->capacity) {
+        queue->capacity = queue->capacity ? queue->capacity * 2 : 64;
+        queue->items = (TopKCandidate *)realloc(queue->items, sizeof(TopKCandidate) * queue->capacity);
+    }
+    TopKCandidate candidate;
+    candidate.weight = weight;
+    candidate.payload = payload;
+    candidate.next = next;
+    candidate.keylen = prefixlen + suffixlen;
+    candidate.key = (UInt8 *)malloc(candidate.keylen + 1);
+    memcpy(candidate.key, prefix, prefixlen);
+    memcpy(candidate.key + prefixlen, suffix, suffixlen);
+    candidate.key[candidate.keylen] = 0;
+    
+    uint32_t i = queue->count++;
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (queue->items[parent].weight >= weight) break;
+        queue->items[i] = queue->items[parent];
+        i = parent;
+    }
+    queue->items[i] = candidate;
+}
+
+static TopKCandidate popTopKCandidate(TopKQueue *queue)
+{
+    TopKCandidate top = queue->items[0];
+    TopKCandidate last = queue->items[--queue->count];
+    uint32_t i = 0;
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= queue->count) break;
+        if (child + 1 < queue->count && queue->items[child + 1].weight > queue->items[child].weight) child++;
+        if (last.weight >= queue->items[child].weight) break;
+        queue->items[i] = queue->items[child];
+        i = child;
+    }
+    if (queue->count) queue->items[i] = last;
+    return top;
+}
+
+static void pushTopKList(TopKQueue *queue, ListNodeRef list, const UInt8 *key, uint32_t keylen, const UInt8 *filter, uint32_t filterlen)
+{
+    for (; list; list = list->next) {
+        if (list->payload && list->length >= filterlen && memcmp(list->string, filter, filterlen) == 0)
+            pushTopKCandidate(queue, list->weight, list->payload, 0, key, keylen, list->string, list->length);
+    }
+}
+
+static void pushTopKLevel(TopKQueue *queue, TrieLevelRef level, const UInt8 *key, uint32_t keylen)
+{
+    if (level->payload) pushTopKCandidate(queue, level->weight, level->payload, 0, key, keylen, NULL, 0);
+    for (int i=0; i < CHARACTER_SET_SIZE; i++) {
+        NextTrie next = level->slots[i];
+        UInt8 byte = i;
+        if (NextTrie_GetKind(next) == TrieKind)
+            pushTopKCandidate(queue, ((TrieLevelRef)NextTrie_GetPtr(next))->maxWeight, 0, next, key, keylen, &byte, 1);
+        else if (NextTrie_GetKind(next) == ListKind)
+            pushTopKCandidate(queue, ((ListNodeRef)NextTrie_GetPtr(next))->weight, 0, next, key, keylen, &byte, 1);
+    }
+}
+
+CF_INLINE const uint32_t *getMappedPageWeights(Page *page)
+{
+    return (const uint32_t *)((char *)page + ((sizeof(Page) + page->length + 3) & ~3));
+}
+
+static const MapTrieLevelWeights *getMappedLevelWeights(CFBurstTrieRef trie, uint32_t next)
+{
+    char *level = (char *)DiskNextTrie_GetPtr(trie->mapBase, next);
+    if (DiskNextTrie_GetKind(next) == CompactTrieKind) {
+        CompactMapTrieLevelRef compact = (CompactMapTrieLevelRef)level;
+        uint32_t count = 0;
+        for (int i=0; i < 4; i++) count += __builtin_popcountll(compact->bitmap[i]);
+        return (const MapTrieLevelWeights *)(level + sizeof(CompactMapTrieLevel) + sizeof(uint32_t) * count);
+    }
+    return (const MapTrieLevelWeights *)(level + sizeof(MapTrieLevel));
+}
+
+CF_INLINE uint32_t getMappedMaxWeight(CFBurstTrieRef trie, uint32_t next)
+{
+    if (DiskNextTrie_GetKind(next) == ListKind) return getMappedPageWeights((Page *)DiskNextTrie_GetPtr(trie->mapBase, next))[0];
+    return getMappedLevelWeights(trie, next)->maxWeight;
+}
+
+static void pushTopKMappedPage(CFBurstTrieRef trie, TopKQueue *queue, uint32_t next, const UInt8 *key, uint32_t keylen, const UInt8 *filter, uint32_t filterlen)
+{
+    Page *page = (Page *)DiskNextTrie_GetPtr(trie->mapBase, next);
+    const uint32_t *weights = getMappedPageWeights(page) + 1;
+    uint32_t cur = 0;
+    if (trie->cflags & kCFBurstTriePrefixCompression) {
+        Boolean packed = (trie->cflags & kCFBurstTriePackedPageEntries) != 0;
+        UInt8 string[CHARACTER_SET_SIZE + MAX_STRING_SIZE];
+        PageEntryView entry;
+        for (uint32_t i = 0; cur < page->length; i++) {
+            getPackedPageEntry(page, cur, packed, &entry);
+            memcpy(string + entry.pfxLen, entry.string, entry.strlen);
+            uint32_t length = entry.pfxLen + entry.strlen;
+            if (entry.payload && length >= filterlen && memcmp(string, filter, filterlen) == 0)
+                pushTopKCandidate(queue, weights[i], entry.payload, 0, key, keylen, string, length);
+            cur += entry.size;
+        }
+    } else {
+        for (uint32_t i = 0; cur < page->length; i++) {
+            PageEntry *entry = (PageEntry *)&page->data[cur];
+            if (entry->payload && entry->strlen >= filterlen && memcmp(entry->string, filter, filterlen) == 0)
+                pushTopKCandidate(queue, weights[i], entry->payload, 0, key, keylen, entry->string, entry->strlen);
+            cur += getPageEntrySize(entry);
+        }
+    }
+}
+
+static void pushTopKMappedChild(CFBurstTrieRef trie, TopKQueue *queue, uint32_t next, const UInt8 *key, uint32_t keylen, UInt8 byte)
+{
+    if (DiskNextTrie_GetKind(next) != Nothing)
+        pushTopKCandidate(queue, getMappedMaxWeight(trie, next), 0, next, key, keylen, &byte, 1);
+}
+
+static void pushTopKMappedLevel(CFBurstTrieRef trie, TopKQueue *queue, uint32_t next, const UInt8 *key, uint32_t keylen)
+{
+    const MapTrieLevelWeights *weights = getMappedLevelWeights(trie, next);
+    if (DiskNextTrie_GetKind(next) == CompactTrieKind) {
+        CompactMapTrieLevelRef level = (CompactMapTrieLevelRef)DiskNextTrie_GetPtr(trie->mapBase, next);
+        if (level->payload) pushTopKCandidate(queue, weights->weight, level->payload, 0, key, keylen, NULL, 0);
+        uint32_t item = 0;
+        for (int i=0; i < CHARACTER_SET_SIZE; i++) {
+            if (level->bitmap[i / 64] & (1ull << (i % 64))) pushTopKMappedChild(trie, queue, level->slots[item++], key, keylen, i);
+        }
+    } else {
+        MapTrieLevelRef level = (MapTrieLevelRef)DiskNextTrie_GetPtr(trie->mapBase, next);
+        if (level->payload) pushTopKCandidate(queue, weights->weight, level->payload, 0, key, keylen, NULL, 0);
+        for (int i=0; i < CHARACTER_SET_SIZE; i++) pushTopKMappedChild(trie, queue, level->slots[i], key, keylen, i);
+    }
+}
+
+// Walks down to where prefix ends and seeds the queue from there. When the prefix ends inside a list, the matching terms of the list are queued directly.
+static void seedTopKQueue(CFBurstTrieRef trie, TopKQueue *queue, const UInt8 *prefix, uint32_t prefixlen)
+{
+    uint32_t depth = 0;
+    if (trie->mapBase) {
+        uint32_t next = ((TrieHeader *)trie->mapBase)->rootOffset | TrieKind;
+        while (depth < prefixlen) {
+            UInt8 byte = prefix[depth++];
+            if (DiskNextTrie_GetKind(next) == CompactTrieKind) {
+                CompactMapTrieLevelRef level = (CompactMapTrieLevelRef)DiskNextTrie_GetPtr(trie->mapBase, next);
+                uint64_t bword = level->bitmap[byte / 64];
+                if (!(bword & (1ull << (byte % 64)))) return;
+                uint32_t item = 0;
+                for (int i=0; i < byte / 64; i++) item += __builtin_popcountll(level->bitmap[i]);
+                item += __builtin_popcountll(bword & ((1ull << (byte % 64)) - 1));
+                next = level->slots[item];
+            } else {
+                next = ((MapTrieLevelRef)DiskNextTrie_GetPtr(trie->mapBase, next))->slots[byte];
+            }
+            if (DiskNextTrie_GetKind(next) == Nothing) return;
+            if (DiskNextTrie_GetKind(next) == ListKind) {
+                pushTopKMappedPage(trie, queue, next, prefix, depth, prefix + depth, prefixlen - depth);
+                return;
+            }
+        }
+        pushTopKCandidate(queue, getMappedMaxWeight(trie, next), 0, next, prefix, prefixlen, NULL, 0);
+    } else {
+        NextTrie next = ((uintptr_t)&trie->root)|TrieKind;
+        while (depth < prefixlen) {
+            next = ((TrieLevelRef)NextTrie_GetPtr(next))->slots[prefix[depth++]];
+            if (NextTrie_GetKind(next) == ListKind) {
+                pushTopKList(queue, (ListNodeRef)NextTrie_GetPtr(next), prefix, depth, prefix + depth, prefixlen - depth);
+                return;
+            }
+            if (NextTrie_GetKind(next) != TrieKind) return;
+        }
+        pushTopKCandidate(queue, ((TrieLevelRef)NextTrie_GetPtr(next))->maxWeight, 0, next, prefix, prefixlen, NULL, 0);
+    }
+}
+
+void CFBurstTrieTraverseTopKCompletions(CFBurstTrieRef trie, const UInt8 *prefix, CFIndex prefixLength, CFIndex k, void *ctx, CFBurstTrieTraversalCallback callback)
+{
+    if (!trie || k <= 0 || prefixLength < 0 || prefixLength >= MAX_KEY_LENGTH) return;
+    if (trie->mapBase) {
+        TrieHeader *header = (TrieHeader *)trie->mapBase;
+        // ** Weights are only in the map when it was written with kCFBurstTrieStoreWeights
+        if (!(header->signature == 0xcafebabe || header->signature == 0x0ddba11) || !(trie->cflags & kCFBurstTrieStoreWeights)) return;
+    }
+    
+    TopKQueue queue = {NULL, 0, 0};
+    seedTopKQueue(trie, &queue, prefix, (uint32_t)prefixLength);
+    
+    Boolean stop = false;
+    while (queue.count && k > 0 && !stop) {
+        TopKCandidate top = popTopKCandidate(&queue);
+        if (top.payload) {
+            callback(ctx, top.key, top.keylen, top.payload, &stop);
+            k--;
+        } else if (trie->mapBase) {
+            if (DiskNextTrie_GetKind(top.next) == ListKind) pushTopKMappedPage(trie, &queue, (uint32_t)top.next, top.key, top.keylen, NULL, 0);
+            else pushTopKMappedLevel(trie, &queue, (uint32_t)top.next, top.key, top.keylen);
+        } else {
+            if (NextTrie_GetKind(top.next) == ListKind) pushTopKList(&queue, (ListNodeRef)NextTrie_GetPtr(top.next), top.key, top.keylen, NULL, 0);
+            else pushTopKLevel(&queue, (TrieLevelRef)NextTrie_GetPtr(top.next), top.key, top.keylen);
+        }
+        free(top.key);
+    }
+    
+    for (uint32_t i = 0; i < queue.count; i++) free(queue.items[i].key);
+    free(queue.items);
+}
+
+static void appendCompletion(void *context, const UInt8 *key, uint32_t keyLength, uint32_t payload, Boolean *stop)
+{
+    CFStringRef completion = CFStringCreateWithBytes(kCFAllocatorSystemDefault, key, keyLength, kCFStringEncodingUTF8, false);
+    if (completion) {
+        CFArrayAppendValue((CFMutableArrayRef)context, completion);
+        CFRelease(completion);
+    }
+}
+
+CFArrayRef CFBurstTrieCopyTopKCompletions(CFBurstTrieRef trie, CFStringRef prefix, CFIndex k)
+{
+    CFRange prefixRange = CFRangeMake(0, CFStringGetLength(prefix));
+    if (prefixRange.length >= MAX_STRING_SIZE) return NULL;
+    
+    CFIndex length;
+    UInt8 buffer[MAX_STRING_ALLOCATION_SIZE + 1];
+    UInt8 *key = buffer;
+    CFIndex size = MAX_STRING_ALLOCATION_SIZE;
+    CFIndex bytesize = prefixRange.length * 4; //** 4-byte max character size
+    if (bytesize >= size) {
+        size = bytesize;
+        key = (UInt8 *) malloc(sizeof(UInt8) * size + 1);
+    }
+    CFStringGetBytes(prefix, prefixRange, kCFStringEncodingUTF8, (UInt8)'-', (Boolean)0, key, size, &length);
+    key[length] = 0;
+    
+    CFMutableArrayRef completions = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
+    CFBurstTrieTraverseTopKCompletions(trie, key, length, k, completions, appendCompletion);
+    if (buffer != key) free(key);
+    return completions;
+}
+
 #if 0
 #pragma mark -
 #pragma mark Serialization
@@ -1793,13 +2135,16 @@ static bool serializeCFBurstTrieLevels(CFBurstTrieRef trie, TrieLevelRef root, u
     
     uint32_t this_offset = *offset;
     
+    MapTrieLevelWeights weights = {root->maxWeight, root->weight};
+    size_t weightsSize = (trie->cflags & kCFBurstTrieStoreWeights) ? sizeof(weights) : 0;
+    
     if ((trie->cflags & kCFBurstTrieBitmapCompression) && count < MAX_BITMAP_SIZE && !isroot) {
         size_t size = sizeof(CompactMapTrieLevel) + sizeof(uint32_t) * count;
         int offsetSlot = 0;
         
         CompactMapTrieLevel *maptrie = (CompactMapTrieLevel *)alloca(size);
         bzero(maptrie, size);
-        *offset += size;
+        *offset += size + weightsSize;
         
         for (int i=0; i < CHARACTER_SET_SIZE; i++) {
             NextTrie next = root->slots[i];
@@ -1828,10 +2173,11 @@ static bool serializeCFBurstTrieLevels(CFBurstTrieRef trie, TrieLevelRef root, u
         assert(bitcount == count);
         
         pwrite(fd, maptrie, size, this_offset+start_offset);
+        if (weightsSize) pwrite(fd, &weights, weightsSize, this_offset+start_offset+size);
         dense = false;
     } else {
         MapTrieLevel maptrie;
-        *offset += sizeof(maptrie);
+        *offset += sizeof(maptrie) + weightsSize;
         
         for (int i=0; i < CHARACTER_SET_SIZE; i++) {
             NextTrie next = root->slots[i];
@@ -1849,12 +2195,23 @@ static bool serializeCFBurstTrieLevels(CFBurstTrieRef trie, TrieLevelRef root, u
         }
         maptrie.payload = root->payload;
         pwrite(fd, &maptrie, sizeof(maptrie), this_offset+start_offset);
+        if (weightsSize) pwrite(fd, &weights, weightsSize, this_offset+start_offset+sizeof(maptrie));
     }
     
     if (dispose) free(root);
     return dense;
 }
 
+static UInt8 *writePackedPageEntryVarint(UInt8 *bytes, uint32_t value)
+{
+    while (value >= 0x80) {
+        *bytes++ = (UInt8)(value | 0x80);
+        value >>= 7;
+    }
+    *bytes++ = (UInt8)value;
+    return bytes;
+}
+
 static void serializeCFBurstTrieList(CFBurstTrieRef trie, ListNodeRef listNode, int fd)
 {
     uint32_t listCount;
@@ -1872,7 +2229,7 @@ static void serializeCFBurstTrieList(CFBurstTrieRef trie, ListNodeRef listNode,
     }
     
     char _buffer[MAX_BUFFER_SIZE];
-    size_t bufferSize = (sizeof(Page) + size * (sizeof(PageEntryPacked) + MAX_STRING_SIZE));
+    size_t bufferSize = (sizeof(Page) + size * (MAX(sizeof(PageEntryPacked), MAX_PACKED_PAGE_ENTRY_HEADER_SIZE) + MAX_STRING_SIZE));
     char *buffer = bufferSize < MAX_BUFFER_SIZE ? _buffer : (char *) malloc(bufferSize);
     
     Page *page = (Page *)buffer;
@@ -1894,12 +2251,21 @@ static void serializeCFBurstTrieList(CFBurstTrieRef trie, ListNodeRef listNode,
                      pfxLen++);
             }
             
-            PageEntryPacked *entry = (PageEntryPacked *)(&page->data[current]);
-            entry->strlen = listNode->length - pfxLen;
-            entry->payload = listNode->payload;
-            entry->pfxLen = pfxLen;
-            memcpy(entry->string, listNode->string+pfxLen, listNode->length-pfxLen);
-            current += listNode->length - pfxLen + sizeof(PageEntryPacked);
+            if (trie->cflags & kCFBurstTriePackedPageEntries) {
+                UInt8 *bytes = (UInt8 *)(&page->data[current]);
+                *bytes++ = pfxLen;
+                bytes = writePackedPageEntryVarint(bytes, listNode->length - pfxLen);
+                bytes = writePackedPageEntryVarint(bytes, listNode->payload);
+                memcpy(bytes, listNode->string+pfxLen, listNode->length-pfxLen);
+                current = (uint32_t)(bytes - (UInt8 *)page->data) + listNode->length - pfxLen;
+            } else {
+                PageEntryPacked *entry = (PageEntryPacked *)(&page->data[current]);
+                entry->strlen = listNode->length - pfxLen;
+                entry->payload = listNode->payload;
+                entry->pfxLen = pfxLen;
+                memcpy(entry->string, listNode->string+pfxLen, listNode->length-pfxLen);
+                current += listNode->length - pfxLen + sizeof(PageEntryPacked);
+            }
             last = listNode;
         }
     } else {
@@ -1922,6 +2288,18 @@ static void serializeCFBurstTrieList(CFBurstTrieRef trie, ListNodeRef listNode,
     page->length = current;
     write(fd, page, len);
     
+    if (trie->cflags & kCFBurstTrieStoreWeights) {
+        // ** The largest weight on the page, then the weight of each entry in page order
+        uint32_t *weights = (uint32_t *)malloc(sizeof(uint32_t) * (listCount + 1));
+        weights[0] = 0;
+        for (int i=0; i < listCount; i++) {
+            weights[i + 1] = nodes[i]->weight;
+            if (weights[i + 1] > weights[0]) weights[0] = weights[i + 1];
+        }
+        write(fd, weights, sizeof(uint32_t) * (listCount + 1));
+        free(weights);
+    }
+    
     free(nodes);
     if (buffer != _buffer) free(buffer);
 }
@@ -69,7 +69,24 @@ typedef CF_OPTIONS(CFOptionFlags, CFBurstTrieOpts) {
         By default, keys at list level are sorted by weight. Use this option to sort them by key value.
         This allow you to use cursor interface.
      */
-    kCFBurstTrieSortByKey = 1 << 4
+    kCFBurstTrieSortByKey = 1 << 4,
+
+    /*
+        kCFBurstTriePackedPageEntries
+        This option can only be used together with kCFBurstTriePrefixCompression. The suffix length and
+        payload of each front-coded list entry are written as variable-length integers instead of
+        fixed-width fields, which shrinks the typical entry header from seven bytes to three. The
+        resulting file is still searched in place once mapped.
+     */
+    kCFBurstTriePackedPageEntries CF_ENUM_AVAILABLE(10_10, 8_0) = 1 << 5,
+
+    /*
+        kCFBurstTrieStoreWeights
+        This option can only be used with a read-only trie. The weight of every term, and the largest
+        weight found below every level and list, are written alongside the trie so that the top-K
+        completion functions also work on the memory-mapped file. Other lookups are unaffected.
+     */
+    kCFBurstTrieStoreWeights CF_ENUM_AVAILABLE(10_10, 8_0) = 1 << 6
 };
 
 // Value for this option should be a CFNumber which contains an int.
@@ -194,6 +211,17 @@ void CFBurstTrieTraverseFromCursor(CFBurstTrieCursorRef cursor, void *ctx, CFBur
 CF_EXPORT
 void CFBurstTrieCursorRelease(CFBurstTrieCursorRef cursor) CF_AVAILABLE(10_8, 6_0);
 
+/*  Calls callback for the k terms with the largest weights that start with prefix, heaviest first.
+    Weights are accumulated across repeated additions of the same term. A memory-mapped trie must have
+    been serialized with kCFBurstTrieStoreWeights; otherwise nothing is found.
+*/
+CF_EXPORT
+void CFBurstTrieTraverseTopKCompletions(CFBurstTrieRef trie, const UInt8 *prefix, CFIndex prefixLength, CFIndex k, void *ctx, CFBurstTrieTraversalCallback callback) CF_AVAILABLE(10_10, 8_0);
+
+/*  Returns an array of the same completions as CFStrings, heaviest first. */
+CF_EXPORT
+CFArrayRef CFBurstTrieCopyTopKCompletions(CFBurstTrieRef trie, CFStringRef prefix, CFIndex k) CF_AVAILABLE(10_10, 8_0);
+
 CF_EXTERN_C_END
 
 #endif /* __COREFOUNDATION_CFBURSTTRIE__ */
@@ -32,6 +32,8 @@
 #include "CFInternal.h"
 #include "CFPriv.h"
 #include <unicode/ucal.h>
+#include <float.h>
+#include <math.h>
 
 #define BUFFER_SIZE 512
 
@@ -787,6 +789,96 @@ Boolean _CFCalendarDecomposeAbsoluteTimeV(CFCalendarRef calendar, CFAbsoluteTime
     return false;
 }
 
+/* Gregorian components that do not depend on the week settings are
+ * computed directly from the local day number; others, and any time before
+ * the calendar's Gregorian change date, go through ICU. The zone offset
+ * comes from ICU's own zone, one lookup per period between transitions, so
+ * the result agrees with CFCalendarDecomposeAbsoluteTime().
+ */
+static Boolean __CFCalendarCanDecomposeGregorian(const char *componentDesc) {
+    for (const char *desc = componentDesc; *desc; desc++) {
+        if (!strchr("GyMdhHmsSEDFag", *desc)) return false;
+    }
+    return true;
+}
+
+typedef struct {
+    UDate start;	// inclusive
+    UDate end;	// exclusive
+    int32_t offset;	// milliseconds, daylight saving included
+} __CFCalendarZonePeriod;
+
+// Finds the period of the calendar's zone holding udate; no transition on a side means the offset holds for all time in that direction
+static Boolean __CFCalendarGetZonePeriod(CFCalendarRef calendar, UDate udate, __CFCalendarZonePeriod *period) {
+    UErrorCode status = U_ZERO_ERROR;
+    UDate transition;
+    ucal_clear(calendar->_cal);
+    ucal_setMillis(calendar->_cal, udate, &status);
+    period->offset = ucal_get(calendar->_cal, UCAL_ZONE_OFFSET, &status) + ucal_get(calendar->_cal, UCAL_DST_OFFSET, &status);
+    period->start = ucal_getTimeZoneTransitionDate(calendar->_cal, UCAL_TZ_TRANSITION_PREVIOUS_INCLUSIVE, &transition, &status) ? transition : -DBL_MAX;
+    period->end = ucal_getTimeZoneTransitionDate(calendar->_cal, UCAL_TZ_TRANSITION_NEXT, &transition, &status) ? transition : DBL_MAX;
+    if (U_FAILURE(status)) {
+        period->start = DBL_MAX;
+        period->end = -DBL_MAX;
+        return false;
+    }
+    return true;
+}
+
+static Boolean __CFCalendarDecomposeGregorianTime(CFCalendarRef calendar, CFAbsoluteTime at, __CFCalendarZonePeriod *period, UDate gregorianChange, const char *componentDesc, int **vectors, CFIndex idx) {
+    UDate udate = floor((at + kCFAbsoluteTimeIntervalSince1970) * 1000.0);
+    if (!(gregorianChange <= udate && udate < 253402300800000.0)) return false;	// through the year 9999
+    if (!(period->start <= udate && udate < period->end) && !__CFCalendarGetZonePeriod(calendar, udate, period)) return false;
+    int64_t local = (int64_t)udate + period->offset;
+    int64_t days = (0 <= local ? local : local - 86399999) / 86400000;
+    int64_t millis = local - days * 86400000;
+    int64_t year;
+    int32_t month, day;
+    __CFCivilFromDays(days, &year, &month, &day);
+    for (CFIndex cidx = 0; componentDesc[cidx]; cidx++) {
+        int value = 0;
+        switch (componentDesc[cidx]) {
+        case 'G': value = 1; break;
+        case 'y': value = (int)year; break;
+        case 'M': value = month; break;
+        case 'd': value = day; break;
+        case 'h': value = (int)(millis / 3600000) % 12; break;
+        case 'H': value = (int)(millis / 3600000); break;
+        case 'm': value = (int)(millis / 60000) % 60; break;
+        case 's': value = (int)(millis / 1000) % 60; break;
+        case 'S': value = (int)(millis % 1000); break;
+        case 'E': value = (int)((days % 7 + 11) % 7) + 1; break;	// 1970-01-01 was a Thursday
+        case 'D': value = (int)(days - __CFDaysFromCivil(year, 1, 1)) + 1; break;
+        case 'F': value = (day - 1) / 7 + 1; break;
+        case 'a': value = (millis < 43200000) ? 0 : 1; break;
+        case 'g': value = (int)(days + 2440588); break;	// Julian day of 1970-01-01
+        }
+        vectors[cidx][idx] = value;
+    }
+    return true;
+}
+
+Boolean _CFCalendarDecomposeAbsoluteTimes(CFCalendarRef calendar, const CFAbsoluteTime *ats, CFIndex count, const char *componentDesc, int **vectors) {
+    __CFGenericValidateType(calendar, CFCalendarGetTypeID());
+    if (count <= 0) return true;
+    if (!calendar->_cal) __CFCalendarSetupCal(calendar);
+    if (!calendar->_cal) return false;
+    int cidx, cnt = strlen((char *)componentDesc);
+    STACK_BUFFER_DECL(int *, vector, cnt);
+    Boolean fast = CFEqual(calendar->_identifier, kCFGregorianCalendar) && __CFCalendarCanDecomposeGregorian(componentDesc);
+    UErrorCode status = U_ZERO_ERROR;
+    UDate gregorianChange = fast ? ucal_getGregorianChange(calendar->_cal, &status) : 0.0;
+    if (U_FAILURE(status)) fast = false;
+    __CFCalendarZonePeriod period = {DBL_MAX, -DBL_MAX, 0};	// empty, so the first time looks its period up
+    Boolean success = true;
+    for (CFIndex idx = 0; idx < count; idx++) {
+        if (fast && __CFCalendarDecomposeGregorianTime(calendar, ats[idx], &period, gregorianChange, componentDesc, vectors, idx)) continue;
+        for (cidx = 0; cidx < cnt; cidx++) vector[cidx] = vectors[cidx] + idx;
+        if (!_CFCalendarDecomposeAbsoluteTimeV(calendar, ats[idx], componentDesc, vector, cnt)) success = false;
+    }
+    return success;
+}
+
 Boolean _CFCalendarAddComponentsV(CFCalendarRef calendar, /* inout */ CFAbsoluteTime *atp, CFOptionFlags options, const char *componentDesc, int *vector, int count) {
     if (!calendar->_cal) __CFCalendarSetupCal(calendar);
     if (calendar->_cal) {
@@ -63,12 +63,14 @@ typedef struct {
 #endif
     CFOptionFlags flags;    
     off_t offset;
+    int64_t mapThreshold;   // readers of the stream, such as CFPropertyListCreateWithStream, may map this much or more of the file; 0 if they must read it
 } _CFFileStreamContext;
 
 
 CONST_STRING_DECL(kCFStreamPropertyFileCurrentOffset, "kCFStreamPropertyFileCurrentOffset");
-#if DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
+#if !DEPLOYMENT_TARGET_WINDOWS
 CONST_STRING_DECL(_kCFStreamPropertyFileNativeHandle, "_kCFStreamPropertyFileNativeHandle");
+CONST_STRING_DECL(_kCFStreamPropertyFileMapThreshold, "_kCFStreamPropertyFileMapThreshold");
 #endif
 
 #ifdef REAL_FILE_SCHEDULING
@@ -435,12 +437,16 @@ static CFTypeRef fileCopyProperty(struct _CFStream *stream, CFStringRef property
         if (fileStream->offset != -1) {
             result = CFNumberCreate(CFGetAllocator((CFTypeRef)stream), kCFNumberSInt64Type, &(fileStream->offset));
         }
-#if DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
+#if !DEPLOYMENT_TARGET_WINDOWS
     } else if (CFEqual(propertyName, _kCFStreamPropertyFileNativeHandle)) {
 		int fd = fileStream->fd;
 		if (fd != -1) {
 			result = CFDataCreate(CFGetAllocator((CFTypeRef) stream), (const uint8_t *)&fd, sizeof(fd));
 		}
+    } else if (CFEqual(propertyName, _kCFStreamPropertyFileMapThreshold)) {
+        if (fileStream->mapThreshold > 0) {
+            result = CFNumberCreate(CFGetAllocator((CFTypeRef)stream), kCFNumberSInt64Type, &(fileStream->mapThreshold));
+        }
 #endif
 	}
 
@@ -476,6 +482,18 @@ static Boolean fileSetProperty(struct _CFStream *stream, CFStringRef prop, CFTyp
         }
     }
     
+#if !DEPLOYMENT_TARGET_WINDOWS
+    else if (CFEqual(prop, _kCFStreamPropertyFileMapThreshold) && CFGetTypeID(stream) == CFReadStreamGetTypeID()) {
+        if (!val) {
+            fileStream->mapThreshold = 0;
+            result = TRUE;
+        } else if (CFGetTypeID(val) == CFNumberGetTypeID()) {
+            result = CFNumberGetValue((CFNumberRef)val, kCFNumberSInt64Type, &(fileStream->mapThreshold));
+            if (fileStream->mapThreshold < 0) fileStream->mapThreshold = 0;
+        }
+    }
+#endif
+    
     return result;
 }
 
@@ -495,6 +513,7 @@ static void *fileCreate(struct _CFStream *stream, void *info) {
 #endif
     newCtxt->flags = 0;
     newCtxt->offset = -1;
+    newCtxt->mapThreshold = 0;
     return newCtxt;
 }
 
@@ -41,6 +41,7 @@
 
 #if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
 #import <mach/mach.h>
+#include <malloc/malloc.h>
 CF_INLINE unsigned long __CFPageSize() { return vm_page_size; }
 #elif DEPLOYMENT_TARGET_WINDOWS
 CF_INLINE unsigned long __CFPageSize() {
@@ -50,6 +51,7 @@ CF_INLINE unsigned long __CFPageSize() {
 }
 #elif DEPLOYMENT_TARGET_LINUX
 #include <unistd.h>
+#include <malloc.h>
 CF_INLINE unsigned long __CFPageSize() {
     return (unsigned long)getpagesize();
 }
@@ -297,6 +299,18 @@ static void *__CFDataAllocate(CFDataRef data, CFIndex size, Boolean clear) {
     return bytes;
 }
 
+// malloc hands back blocks rounded up to its size classes; the slack past numBytes is ours to use, and claiming it as capacity saves a realloc at the next size class boundary.
+static CFIndex __CFDataUsableSize(CFDataRef data, void *bytes, CFIndex numBytes) {
+    if (__CFDataUseAllocator(data) || __CFDataAllocatesCollectable(data)) return numBytes;
+    CFIndex usable = numBytes;
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
+    usable = (CFIndex)malloc_size(bytes);
+#elif DEPLOYMENT_TARGET_LINUX
+    usable = (CFIndex)malloc_usable_size(bytes);
+#endif
+    return __CFMin(__CFMax(usable, numBytes), CFDATA_MAX_SIZE);
+}
+
 static void __CFDataDeallocate(CFTypeRef cf) {
     CFMutableDataRef data = (CFMutableDataRef)cf;
     if (!__CFDataBytesInline(data)) {
@@ -506,12 +520,9 @@ void CFDataGetBytes(CFDataRef data, CFRange range, uint8_t *buffer) {
     memmove(buffer, CFDataGetBytePtr(data) + range.location, range.length);
 }
 
-/* Allocates new block of data with at least numNewValues more bytes than the current length. If clear is true, the new bytes up to at least the new length with be zeroed. */
-static void __CFDataGrow(CFMutableDataRef data, CFIndex numNewValues, Boolean clear) {
+/* Reallocates the block of data to hold at least capacity bytes. If clear is true, the bytes from the current length up to newLength will be zeroed. */
+static void __CFDataSetStorageCapacity(CFMutableDataRef data, CFIndex capacity, CFIndex newLength, Boolean clear) {
     CFIndex oldLength = __CFDataLength(data);
-    CFIndex newLength = oldLength + numNewValues;
-    if (newLength > CFDATA_MAX_SIZE || newLength < 0) __CFDataHandleOutOfMemory(data, newLength * sizeof(uint8_t));
-    CFIndex capacity = __CFDataRoundUpCapacity(newLength);
     CFIndex numBytes = __CFDataNumBytesForCapacity(capacity);
     CFAllocatorRef allocator = CFGetAllocator(data);
     void *bytes = NULL;
@@ -535,6 +546,8 @@ static void __CFDataGrow(CFMutableDataRef data, CFIndex numNewValues, Boolean cl
 	}
     }
     if (NULL == bytes) __CFDataHandleOutOfMemory(data, numBytes * sizeof(uint8_t));
+    // Bytes calloc'd beyond numBytes are not known to be zero, so only claim the slack when the tail gets zeroed on demand anyway.
+    if (!allocateCleared) capacity = numBytes = __CFDataUsableSize(data, bytes, numBytes);
     __CFDataSetCapacity(data, capacity);
     __CFDataSetNumBytes(data, numBytes);
     if (clear && !allocateCleared && oldLength < newLength) memset((uint8_t *)bytes + oldLength, 0, newLength - oldLength);
@@ -543,6 +556,13 @@ static void __CFDataGrow(CFMutableDataRef data, CFIndex numNewValues, Boolean cl
     if (__CFOASafe) __CFSetLastAllocationEventName(data->_bytes, "CFData (store)");
 }
 
+/* Allocates new block of data with at least numNewValues more bytes than the current length. If clear is true, the new bytes up to at least the new length with be zeroed. */
+static void __CFDataGrow(CFMutableDataRef data, CFIndex numNewValues, Boolean clear) {
+    CFIndex newLength = __CFDataLength(data) + numNewValues;
+    if (newLength > CFDATA_MAX_SIZE || newLength < 0) __CFDataHandleOutOfMemory(data, newLength * sizeof(uint8_t));
+    __CFDataSetStorageCapacity(data, __CFDataRoundUpCapacity(newLength), newLength, clear);
+}
+
 void CFDataSetLength(CFMutableDataRef data, CFIndex newLength) {
     CFIndex oldLength, capacity;
     Boolean isGrowable;
@@ -574,6 +594,17 @@ void CFDataSetLength(CFMutableDataRef data, CFIndex newLength) {
     __CFDataSetNumBytesUsed(data, newLength);
 }
 
+void CFDataReserveCapacity(CFMutableDataRef data, CFIndex capacity) {
+    if (CF_IS_OBJC(CFDataGetTypeID(), data)) return;	// NSMutableData has no equivalent; capacity is only a hint
+    __CFGenericValidateType(data, CFDataGetTypeID());
+    CFAssert1(__CFDataIsMutable(data), __kCFLogAssertion, "%s(): data is immutable", __PRETTY_FUNCTION__);
+    CFAssert2(0 <= capacity, __kCFLogAssertion, "%s(): capacity (%d) cannot be less than zero", __PRETTY_FUNCTION__, capacity);
+    if (!__CFDataIsGrowable(data) || capacity <= __CFDataCapacity(data)) return;
+    if (capacity > CFDATA_MAX_SIZE) __CFDataHandleOutOfMemory(data, capacity * sizeof(uint8_t));
+    // The caller knows how much is coming, so allocate exactly that rather than rounding up to the next growth step.
+    __CFDataSetStorageCapacity(data, capacity, __CFDataLength(data), false);
+}
+
 void CFDataIncreaseLength(CFMutableDataRef data, CFIndex extraLength) {
     CF_OBJC_FUNCDISPATCHV(CFDataGetTypeID(), void, (NSMutableData *)data, increaseLengthBy:(NSUInteger)extraLength);
     CFAssert1(__CFDataIsMutable(data), __kCFLogAssertion, "%s(): data is immutable", __PRETTY_FUNCTION__);
@@ -799,6 +830,87 @@ CFRange CFDataFind(CFDataRef data, CFDataRef dataToFind, CFRange searchRange, CF
     return _CFDataFindBytes(data, dataToFind, searchRange, compareOptions);
 }
 
+// ========================================================================
+#pragma mark -
+#pragma mark Data Builder
+
+#define DATA_BUILDER_MIN_SEGMENT (4 * 1024)
+#define DATA_BUILDER_MAX_SEGMENT (256 * 1024)
+
+struct __CFDataBuilderSegment {
+    struct __CFDataBuilderSegment *_next;
+    CFIndex _capacity;
+    CFIndex _length;
+    uint8_t _bytes[];
+};
+
+void _CFDataBuilderInit(_CFDataBuilder *builder) {
+    builder->_head = NULL;
+    builder->_tail = NULL;
+    builder->_length = 0;
+}
+
+void _CFDataBuilderDestroy(_CFDataBuilder *builder) {
+    struct __CFDataBuilderSegment *segment = builder->_head;
+    while (segment) {
+        struct __CFDataBuilderSegment *next = segment->_next;
+        free(segment);
+        segment = next;
+    }
+    _CFDataBuilderInit(builder);
+}
+
+void _CFDataBuilderAppendBytes(_CFDataBuilder *builder, const uint8_t *bytes, CFIndex length) {
+    struct __CFDataBuilderSegment *tail = builder->_tail;
+    if (length <= 0) return;
+    if (builder->_length + length > CFDATA_MAX_SIZE || builder->_length + length < 0) __CFDataHandleOutOfMemory(NULL, builder->_length + length);
+    if (tail) {
+        CFIndex room = tail->_capacity - tail->_length;
+        if (length <= room) {
+            memmove(tail->_bytes + tail->_length, bytes, length);
+            tail->_length += length;
+            builder->_length += length;
+            return;
+        }
+        memmove(tail->_bytes + tail->_length, bytes, room);
+        tail->_length += room;
+        builder->_length += room;
+        bytes += room;
+        length -= room;
+    }
+    // Segments double in size up to a limit, so the number of segments stays logarithmic for small outputs and the slack stays bounded for big ones. Existing bytes are never moved.
+    CFIndex capacity = tail ? __CFMin(tail->_capacity * 2, DATA_BUILDER_MAX_SEGMENT) : DATA_BUILDER_MIN_SEGMENT;
+    if (capacity < length) capacity = length;
+    struct __CFDataBuilderSegment *segment = (struct __CFDataBuilderSegment *)malloc(sizeof(struct __CFDataBuilderSegment) + capacity);
+    if (NULL == segment) __CFDataHandleOutOfMemory(NULL, sizeof(struct __CFDataBuilderSegment) + capacity);
+    segment->_next = NULL;
+    segment->_capacity = capacity;
+    segment->_length = length;
+    memmove(segment->_bytes, bytes, length);
+    if (tail) tail->_next = segment; else builder->_head = segment;
+    builder->_tail = segment;
+    builder->_length += length;
+}
+
+Boolean _CFDataBuilderApplyFunction(_CFDataBuilder *builder, Boolean (*applier)(const uint8_t *bytes, CFIndex length, void *context), void *context) {
+    for (struct __CFDataBuilderSegment *segment = builder->_head; segment; segment = segment->_next) {
+        if (!applier(segment->_bytes, segment->_length, context)) return false;
+    }
+    return true;
+}
+
+CFMutableDataRef _CFDataBuilderCreateMutableData(CFAllocatorRef allocator, _CFDataBuilder *builder) {
+    CFMutableDataRef data = CFDataCreateMutable(allocator, 0);
+    if (!data) return NULL;
+    CFDataReserveCapacity(data, builder->_length);
+    for (struct __CFDataBuilderSegment *segment = builder->_head; segment; segment = segment->_next) {
+        CFDataAppendBytes(data, segment->_bytes, segment->_length);
+    }
+    return data;
+}
+
+#undef DATA_BUILDER_MIN_SEGMENT
+#undef DATA_BUILDER_MAX_SEGMENT
 #undef __CFDataValidateRange
 #undef __CFGenericValidateMutabilityFlags
 #undef INLINE_BYTES_THRESHOLD
@@ -90,6 +90,10 @@ typedef CF_OPTIONS(CFOptionFlags, CFDataSearchFlags) {
 CF_EXPORT
 CFRange CFDataFind(CFDataRef theData, CFDataRef dataToFind, CFRange searchRange, CFDataSearchFlags compareOptions) CF_AVAILABLE(10_6, 4_0);
 
+/* Grows the storage of a variable-capacity mutable data so that at least capacity bytes fit without further reallocation. The length is unchanged. Has no effect on fixed-capacity datas or when the capacity is already sufficient. */
+CF_EXPORT
+void CFDataReserveCapacity(CFMutableDataRef theData, CFIndex capacity) CF_AVAILABLE(10_10, 8_0);
+
 CF_EXTERN_C_END
 CF_IMPLICIT_BRIDGING_DISABLED
 
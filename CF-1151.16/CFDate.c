@@ -152,11 +152,12 @@ CFTypeID CFDateGetTypeID(void) {
     __CFTSRRate = (double)freq.QuadPart;
     __CF1_TSRRate = 1.0 / __CFTSRRate;
 #elif DEPLOYMENT_TARGET_LINUX
+    // mach_absolute_time() reports CLOCK_MONOTONIC in nanoseconds whatever the clock's resolution
     struct timespec res;
     if (clock_getres(CLOCK_MONOTONIC, &res) != 0) {
         HALT;
     }
-    __CFTSRRate = res.tv_sec + (1000000000 * res.tv_nsec);
+    __CFTSRRate = 1.0E9;
     __CF1_TSRRate = 1.0 / __CFTSRRate;
 #else
 #error Unable to initialize date
@@ -285,6 +286,28 @@ static double __CFAbsoluteFromYMD(int64_t year, int8_t month, int8_t day) {
     return absolute;
 }
 
+/* Days since 1970-01-01 in the proleptic Gregorian calendar, and back */
+CF_PRIVATE int64_t __CFDaysFromCivil(int64_t year, int32_t month, int32_t day) {
+    year -= (month <= 2) ? 1 : 0;
+    int64_t era = (0 <= year ? year : year - 399) / 400;
+    int64_t yearOfEra = year - era * 400;
+    int64_t dayOfYear = (153 * (month + (2 < month ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+CF_PRIVATE void __CFCivilFromDays(int64_t days, int64_t *year, int32_t *month, int32_t *day) {
+    days += 719468;
+    int64_t era = (0 <= days ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t mp = (5 * dayOfYear + 2) / 153;
+    *day = (int32_t)(dayOfYear - (153 * mp + 2) / 5 + 1);
+    *month = (int32_t)(mp < 10 ? mp + 3 : mp - 9);
+    *year = yearOfEra + era * 400 + (*month <= 2 ? 1 : 0);
+}
+
 Boolean CFGregorianDateIsValid(CFGregorianDate gdate, CFOptionFlags unitFlags) {
     if ((unitFlags & kCFGregorianUnitsYears) && (gdate.year <= 0)) return false;
     if ((unitFlags & kCFGregorianUnitsMonths) && (gdate.month < 1 || 12 < gdate.month)) return false;
@@ -214,6 +214,13 @@ CFStringRef CFDateFormatterCreateDateFormatFromTemplate(CFAllocatorRef allocator
     return (CFStringRef)result;
 }
 
+enum {
+    __kCFISO8601ZoneNone = 0,		// no zone in the pattern
+    __kCFISO8601ZoneLiteralZ,		// 'Z'
+    __kCFISO8601ZoneBasic,		// Z: +hhmm
+    __kCFISO8601ZoneExtended,		// ZZZZZ, XXX or XXXXX: Z or +hh:mm
+};
+
 struct __CFDateFormatter {
     CFRuntimeBase _base;
     UDateFormat *_df;
@@ -222,6 +229,13 @@ struct __CFDateFormatter {
     CFDateFormatterStyle _dateStyle;
     CFStringRef _format;
     CFStringRef _defformat;
+    struct {			/* see __CFDateFormatterUpdateISO8601 */
+        uint8_t _state;		/* 0: not yet checked, 1: use ICU, 2: fixed ISO 8601 pattern */
+        uint8_t _zoneStyle;
+        Boolean _millis;
+        Boolean _fixedZone;
+        int32_t _offset;	/* seconds from GMT when _fixedZone */
+    } _iso8601;
     struct {
         CFBooleanRef _IsLenient;
 	CFBooleanRef _DoesRelativeDateFormatting;
@@ -596,6 +610,7 @@ static void __SetCalendarProperties(CFDateFormatterRef df) {
     if (df->_property. C) __CFDateFormatterSetProperty(df, K, df->_property. C, true);
 
 static void __ResetUDateFormat(CFDateFormatterRef df, Boolean goingToHaveCustomFormat) {
+    df->_iso8601._state = 0;
     if (df->_df) __cficu_udat_close(df->_df);
     df->_df = NULL;
 
@@ -783,6 +798,98 @@ CFTypeID CFDateFormatterGetTypeID(void) {
     return __kCFDateFormatterTypeID;
 }
 
+/* Creating a formatter opens an ICU formatter and applies the user's
+ * preferences to it, which is expensive. A few fully set up formatters are
+ * kept as templates, keyed by locale (which includes the preferences of a
+ * user locale), styles and time zone; new formatters with the same key clone
+ * the template's ICU formatter and share its property values. Templates are
+ * never handed out, so they stay unmodified.
+ */
+#define __kCFDateFormatterCacheSize 8
+
+static CFDateFormatterRef __CFDateFormatterCache[__kCFDateFormatterCacheSize] = {NULL};
+static CFIndex __CFDateFormatterCacheNext = 0;
+static CFIndex __CFDateFormatterCacheHits = 0;
+static CFIndex __CFDateFormatterCacheMisses = 0;
+static CFLock_t __CFDateFormatterCacheLock = CFLockInit;
+
+// dst has its _locale and _property._TimeZone set, and everything else NULL
+static Boolean __CFDateFormatterCopyTemplate(struct __CFDateFormatter *dst, CFDateFormatterRef src) {
+    UErrorCode status = U_ZERO_ERROR;
+    UDateFormat *icudf = __cficu_udat_clone(src->_df, &status);
+    if (NULL == icudf || U_FAILURE(status)) {
+        if (icudf) __cficu_udat_close(icudf);
+        return false;
+    }
+    CFTimeZoneRef tz = dst->_property._TimeZone;
+    dst->_df = icudf;
+    dst->_format = src->_format ? (CFStringRef)CFRetain(src->_format) : NULL;
+    dst->_defformat = src->_defformat ? (CFStringRef)CFRetain(src->_defformat) : NULL;
+    dst->_property = src->_property;
+    // every _property field is a CF object or NULL
+    CFTypeRef *properties = (CFTypeRef *)&dst->_property;
+    for (CFIndex idx = 0; idx < (CFIndex)(sizeof(dst->_property) / sizeof(CFTypeRef)); idx++) {
+        if (properties[idx]) CFRetain(properties[idx]);
+    }
+    if (tz) CFRelease(tz);
+    return true;
+}
+
+static Boolean __CFDateFormatterCopyFromCache(struct __CFDateFormatter *formatter) {
+    Boolean found = false;
+    __CFLock(&__CFDateFormatterCacheLock);
+    for (CFIndex idx = 0; idx < __kCFDateFormatterCacheSize && !found; idx++) {
+        CFDateFormatterRef tmpl = __CFDateFormatterCache[idx];
+        if (tmpl && tmpl->_dateStyle == formatter->_dateStyle && tmpl->_timeStyle == formatter->_timeStyle && CFEqual(tmpl->_locale, formatter->_locale) && CFEqual(tmpl->_property._TimeZone, formatter->_property._TimeZone)) {
+            found = __CFDateFormatterCopyTemplate(formatter, tmpl);
+        }
+    }
+    if (found) __CFDateFormatterCacheHits++; else __CFDateFormatterCacheMisses++;
+    __CFUnlock(&__CFDateFormatterCacheLock);
+    return found;
+}
+
+static void __CFDateFormatterAddToCache(CFDateFormatterRef formatter) {
+    uint32_t size = sizeof(struct __CFDateFormatter) - sizeof(CFRuntimeBase);
+    struct __CFDateFormatter *tmpl = (struct __CFDateFormatter *)_CFRuntimeCreateInstance(kCFAllocatorSystemDefault, CFDateFormatterGetTypeID(), size, NULL);
+    if (NULL == tmpl) return;
+    tmpl->_locale = (CFLocaleRef)CFRetain(formatter->_locale);
+    tmpl->_dateStyle = formatter->_dateStyle;
+    tmpl->_timeStyle = formatter->_timeStyle;
+    tmpl->_property._TimeZone = NULL;
+    if (!__CFDateFormatterCopyTemplate(tmpl, formatter)) {
+        CFRelease(tmpl);
+        return;
+    }
+    __CFLock(&__CFDateFormatterCacheLock);
+    CFDateFormatterRef old = __CFDateFormatterCache[__CFDateFormatterCacheNext];
+    __CFDateFormatterCache[__CFDateFormatterCacheNext] = tmpl;
+    __CFDateFormatterCacheNext = (__CFDateFormatterCacheNext + 1) % __kCFDateFormatterCacheSize;
+    __CFUnlock(&__CFDateFormatterCacheLock);
+    if (old) CFRelease(old);
+}
+
+CF_PRIVATE void __CFDateFormatterFlushCache(void) {
+    CFDateFormatterRef old[__kCFDateFormatterCacheSize];
+    __CFLock(&__CFDateFormatterCacheLock);
+    for (CFIndex idx = 0; idx < __kCFDateFormatterCacheSize; idx++) {
+        old[idx] = __CFDateFormatterCache[idx];
+        __CFDateFormatterCache[idx] = NULL;
+    }
+    __CFDateFormatterCacheNext = 0;
+    __CFUnlock(&__CFDateFormatterCacheLock);
+    for (CFIndex idx = 0; idx < __kCFDateFormatterCacheSize; idx++) {
+        if (old[idx]) CFRelease(old[idx]);
+    }
+}
+
+void _CFDateFormatterGetCacheStatistics(CFIndex *hits, CFIndex *misses) {
+    __CFLock(&__CFDateFormatterCacheLock);
+    if (hits) *hits = __CFDateFormatterCacheHits;
+    if (misses) *misses = __CFDateFormatterCacheMisses;
+    __CFUnlock(&__CFDateFormatterCacheLock);
+}
+
 CFDateFormatterRef CFDateFormatterCreate(CFAllocatorRef allocator, CFLocaleRef locale, CFDateFormatterStyle dateStyle, CFDateFormatterStyle timeStyle) {
     struct __CFDateFormatter *memory;
     uint32_t size = sizeof(struct __CFDateFormatter) - sizeof(CFRuntimeBase);
@@ -883,6 +990,9 @@ CFDateFormatterRef CFDateFormatterCreate(CFAllocatorRef allocator, CFLocaleRef l
 
     memory->_locale = locale ? CFLocaleCreateCopy(allocator, locale) : (CFLocaleRef)CFRetain(CFLocaleGetSystem());
     memory->_property._TimeZone = CFTimeZoneCopyDefault();
+    if (__CFDateFormatterCopyFromCache(memory)) {
+        return (CFDateFormatterRef)memory;
+    }
     
     CFStringRef calident = (CFStringRef)CFLocaleGetValue(memory->_locale, kCFLocaleCalendarIdentifierKey);
     if (calident && CFEqual(calident, kCFCalendarIdentifierGregorian)) {
@@ -894,6 +1004,7 @@ CFDateFormatterRef CFDateFormatterCreate(CFAllocatorRef allocator, CFLocaleRef l
         CFRelease(memory);
 	return NULL;
     }
+    __CFDateFormatterAddToCache(memory);
     return (CFDateFormatterRef)memory;
 }
 
@@ -1212,10 +1323,196 @@ void CFDateFormatterSetFormat(CFDateFormatterRef formatter, CFStringRef formatSt
             formatter->_format = (CFStringRef)CFStringCreateCopy(CFGetAllocator(formatter), formatString);
             formatter->_property._HasCustomFormat = kCFBooleanTrue;
         }
+        formatter->_iso8601._state = 0;
     }
     if (formatString) CFRelease(formatString);
 }
 
+/* Fixed-format ISO 8601 / RFC 3339 timestamps.
+ *
+ * Formatters with a custom yyyy-MM-dd'T'HH:mm:ss[.SSS][zone] pattern, the
+ * en_US_POSIX locale and the Gregorian calendar format and parse without
+ * going through ICU. The results are the same as ICU's; anything the fast
+ * path is not certain about goes to ICU instead: years outside 1600-9999
+ * (ICU switches to the Julian calendar in 1582), time zones whose offset
+ * varies over time (ICU has its own copy of the zone data), and any input
+ * string that is not exactly in the form the formatter would produce.
+ *
+ * A formatter may format and parse on several threads at once, so the first
+ * use can race to fill in _iso8601. Every racer computes the same fields; they
+ * are all written before a barrier and _state after it, and a reader that
+ * sees _state 2 takes a barrier before reading them.
+ */
+
+static uint8_t __CFDateFormatterUpdateISO8601(CFDateFormatterRef df) {
+    char pattern[64];
+    const char *rest;
+    Boolean millis;
+    uint8_t zoneStyle;
+    if (df->_property._HasCustomFormat != kCFBooleanTrue || df->_property._DoesRelativeDateFormatting == kCFBooleanTrue) goto useICU;
+    if (NULL == df->_format || NULL != df->_property._GregorianStartDate) goto useICU;
+    if (!CFStringGetCString(df->_format, pattern, sizeof(pattern), kCFStringEncodingASCII)) goto useICU;
+    if (0 != strncmp(pattern, "yyyy-MM-dd'T'HH:mm:ss", 21)) goto useICU;
+    rest = pattern + 21;
+    millis = (0 == strncmp(rest, ".SSS", 4));
+    if (millis) rest += 4;
+    if (0 == strcmp(rest, "")) {
+        zoneStyle = __kCFISO8601ZoneNone;
+    } else if (0 == strcmp(rest, "'Z'")) {
+        zoneStyle = __kCFISO8601ZoneLiteralZ;
+    } else if (0 == strcmp(rest, "Z")) {
+        zoneStyle = __kCFISO8601ZoneBasic;
+    } else if (0 == strcmp(rest, "ZZZZZ") || 0 == strcmp(rest, "XXX") || 0 == strcmp(rest, "XXXXX")) {
+        zoneStyle = __kCFISO8601ZoneExtended;
+    } else {
+        goto useICU;
+    }
+    if (!df->_locale || !CFEqual(CFLocaleGetIdentifier(df->_locale), CFSTR("en_US_POSIX"))) goto useICU;
+    CFStringRef calendarID = (CFStringRef)CFDateFormatterCopyProperty(df, kCFDateFormatterCalendarIdentifierKey);
+    Boolean gregorian = calendarID && CFEqual(calendarID, kCFCalendarIdentifierGregorian);
+    if (calendarID) CFRelease(calendarID);
+    if (!gregorian) goto useICU;
+    int32_t offset = 0;
+    Boolean fixedZone = df->_property._TimeZone && _CFTimeZoneGetFixedSecondsFromGMT(df->_property._TimeZone, &offset) && 0 == offset % 60;
+    df->_iso8601._millis = millis;
+    df->_iso8601._zoneStyle = zoneStyle;
+    df->_iso8601._fixedZone = fixedZone;
+    df->_iso8601._offset = fixedZone ? offset : 0;
+    OSMemoryBarrier();	// the fields must be visible before the state that says they are valid
+    df->_iso8601._state = 2;
+    return 2;
+useICU:
+    df->_iso8601._state = 1;
+    return 1;
+}
+
+CF_INLINE Boolean __CFDateFormatterUsesISO8601(CFDateFormatterRef df) {
+    uint8_t state = ((volatile struct __CFDateFormatter *)df)->_iso8601._state;
+    if (0 == state) return 2 == __CFDateFormatterUpdateISO8601(df);
+    if (2 == state) OSMemoryBarrier();	// pairs with the barrier in __CFDateFormatterUpdateISO8601
+    return 2 == state;
+}
+
+CF_INLINE char *__CFDateFormatterPutDigits(char *buffer, int64_t value, int count) {
+    for (int idx = count - 1; 0 <= idx; idx--) {
+        buffer[idx] = '0' + (char)(value % 10);
+        value /= 10;
+    }
+    return buffer + count;
+}
+
+static CFStringRef __CFDateFormatterCreateISO8601String(CFAllocatorRef allocator, CFDateFormatterRef df, CFAbsoluteTime at) {
+    // Same rounding as the UDate handed to ICU
+    UDate ud = (at + kCFAbsoluteTimeIntervalSince1970) * 1000.0 + 0.5;
+    if (!(-1.0e15 < ud && ud < 1.0e15)) return NULL;
+    int32_t offset = df->_iso8601._offset;
+    int64_t millis = (int64_t)floor(ud) + (int64_t)offset * 1000;
+    int64_t days = (0 <= millis ? millis : millis - 86399999) / 86400000;
+    int64_t millisOfDay = millis - days * 86400000;
+    int64_t year;
+    int32_t month, day;
+    __CFCivilFromDays(days, &year, &month, &day);
+    if (year < 1600 || 9999 < year) return NULL;
+
+    char buffer[32], *ptr = buffer;
+    ptr = __CFDateFormatterPutDigits(ptr, year, 4); *ptr++ = '-';
+    ptr = __CFDateFormatterPutDigits(ptr, month, 2); *ptr++ = '-';
+    ptr = __CFDateFormatterPutDigits(ptr, day, 2); *ptr++ = 'T';
+    ptr = __CFDateFormatterPutDigits(ptr, millisOfDay / 3600000, 2); *ptr++ = ':';
+    ptr = __CFDateFormatterPutDigits(ptr, (millisOfDay / 60000) % 60, 2); *ptr++ = ':';
+    ptr = __CFDateFormatterPutDigits(ptr, (millisOfDay / 1000) % 60, 2);
+    if (df->_iso8601._millis) {
+        *ptr++ = '.';
+        ptr = __CFDateFormatterPutDigits(ptr, millisOfDay % 1000, 3);
+    }
+    int32_t absOffset = (offset < 0) ? -offset : offset;
+    switch (df->_iso8601._zoneStyle) {
+    case __kCFISO8601ZoneLiteralZ:
+        *ptr++ = 'Z';
+        break;
+    case __kCFISO8601ZoneBasic:
+        *ptr++ = (offset < 0) ? '-' : '+';
+        ptr = __CFDateFormatterPutDigits(ptr, absOffset / 3600, 2);
+        ptr = __CFDateFormatterPutDigits(ptr, (absOffset / 60) % 60, 2);
+        break;
+    case __kCFISO8601ZoneExtended:
+        if (0 == offset) {
+            *ptr++ = 'Z';
+        } else {
+            *ptr++ = (offset < 0) ? '-' : '+';
+            ptr = __CFDateFormatterPutDigits(ptr, absOffset / 3600, 2);
+            *ptr++ = ':';
+            ptr = __CFDateFormatterPutDigits(ptr, (absOffset / 60) % 60, 2);
+        }
+        break;
+    }
+    return CFStringCreateWithBytes(allocator, (const UInt8 *)buffer, ptr - buffer, kCFStringEncodingASCII, false);
+}
+
+CF_INLINE Boolean __CFDateFormatterGetDigits(const UChar *ustr, int count, int32_t *value) {
+    int32_t result = 0;
+    for (int idx = 0; idx < count; idx++) {
+        if (ustr[idx] < '0' || '9' < ustr[idx]) return false;
+        result = result * 10 + (ustr[idx] - '0');
+    }
+    *value = result;
+    return true;
+}
+
+static Boolean __CFDateFormatterParseISO8601(CFDateFormatterRef df, const UChar *ustr, CFIndex length, CFAbsoluteTime *atp) {
+    static const int32_t daysInMonth[13] = {0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int32_t year, month, day, hour, minute, second, millis = 0, offset;
+    CFIndex pos = 19;
+    if (length < 19) return false;
+    if (!__CFDateFormatterGetDigits(ustr, 4, &year) || '-' != ustr[4] || !__CFDateFormatterGetDigits(ustr + 5, 2, &month) || '-' != ustr[7] || !__CFDateFormatterGetDigits(ustr + 8, 2, &day) || 'T' != ustr[10]) return false;
+    if (!__CFDateFormatterGetDigits(ustr + 11, 2, &hour) || ':' != ustr[13] || !__CFDateFormatterGetDigits(ustr + 14, 2, &minute) || ':' != ustr[16] || !__CFDateFormatterGetDigits(ustr + 17, 2, &second)) return false;
+    if (df->_iso8601._millis) {
+        if (length < pos + 4 || '.' != ustr[pos] || !__CFDateFormatterGetDigits(ustr + pos + 1, 3, &millis)) return false;
+        pos += 4;
+    }
+    if (year < 1600 || 9999 < year || month < 1 || 12 < month || day < 1 || daysInMonth[month] < day) return false;
+    if (2 == month && 29 == day && !((0 == year % 4 && 0 != year % 100) || 0 == year % 400)) return false;
+    if (23 < hour || 59 < minute || 59 < second) return false;
+    switch (df->_iso8601._zoneStyle) {
+    case __kCFISO8601ZoneNone:
+    case __kCFISO8601ZoneLiteralZ:
+        if (!df->_iso8601._fixedZone) return false;
+        if (__kCFISO8601ZoneLiteralZ == df->_iso8601._zoneStyle) {
+            if (length < pos + 1 || 'Z' != ustr[pos]) return false;
+            pos += 1;
+        }
+        offset = df->_iso8601._offset;
+        break;
+    case __kCFISO8601ZoneBasic:
+    case __kCFISO8601ZoneExtended: {
+        Boolean extended = (__kCFISO8601ZoneExtended == df->_iso8601._zoneStyle);
+        int32_t offsetHours, offsetMinutes;
+        if (extended && pos + 1 == length && 'Z' == ustr[pos]) {
+            offset = 0;
+            pos += 1;
+            break;
+        }
+        if (length < pos + (extended ? 6 : 5) || ('+' != ustr[pos] && '-' != ustr[pos])) return false;
+        if (!__CFDateFormatterGetDigits(ustr + pos + 1, 2, &offsetHours)) return false;
+        if (extended && ':' != ustr[pos + 3]) return false;
+        if (!__CFDateFormatterGetDigits(ustr + pos + (extended ? 4 : 3), 2, &offsetMinutes)) return false;
+        if (14 < offsetHours || 59 < offsetMinutes) return false;
+        if (extended && 0 == offsetHours && 0 == offsetMinutes) return false;	// written as Z
+        offset = (offsetHours * 3600 + offsetMinutes * 60) * ('-' == ustr[pos] ? -1 : 1);
+        pos += extended ? 6 : 5;
+        break;
+    }
+    default:
+        return false;
+    }
+    if (pos != length) return false;
+    int64_t seconds = __CFDaysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset;
+    // Same arithmetic as converting ICU's UDate result
+    UDate udate = (UDate)(seconds * 1000 + millis);
+    if (atp) *atp = (double)udate / 1000.0 - kCFAbsoluteTimeIntervalSince1970;
+    return true;
+}
+
 CFStringRef CFDateFormatterCreateStringWithDate(CFAllocatorRef allocator, CFDateFormatterRef formatter, CFDateRef date) {
     if (allocator == NULL) allocator = __CFGetDefaultAllocator();
     __CFGenericValidateType(allocator, CFAllocatorGetTypeID());
@@ -1228,6 +1525,10 @@ CFStringRef CFDateFormatterCreateStringWithAbsoluteTime(CFAllocatorRef allocator
     if (allocator == NULL) allocator = __CFGetDefaultAllocator();
     __CFGenericValidateType(allocator, CFAllocatorGetTypeID());
     __CFGenericValidateType(formatter, CFDateFormatterGetTypeID());
+    if (__CFDateFormatterUsesISO8601(formatter) && formatter->_iso8601._fixedZone) {
+        CFStringRef string = __CFDateFormatterCreateISO8601String(allocator, formatter, at);
+        if (string) return string;
+    }
     UChar *ustr = NULL, ubuffer[BUFFER_SIZE + 1];
     UErrorCode status = U_ZERO_ERROR;
     CFIndex used, cnt = BUFFER_SIZE;
@@ -1558,6 +1859,9 @@ Boolean CFDateFormatterGetAbsoluteTimeFromString(CFDateFormatterRef formatter, C
     } else {
         ustr += range.location;
     }
+    if (__CFDateFormatterUsesISO8601(formatter) && __CFDateFormatterParseISO8601(formatter, ustr, range.length, atp)) {
+        return true;
+    }
     UDate udate;
     int32_t dpos = 0;
     UErrorCode status = U_ZERO_ERROR;
@@ -1660,6 +1964,7 @@ static void __CFDateFormatterSetProperty(CFDateFormatterRef formatter, CFStringR
     __CFGenericValidateType(key, CFStringGetTypeID());
     CFTypeRef oldProperty = NULL;
     UErrorCode status = U_ZERO_ERROR;
+    formatter->_iso8601._state = 0;
 
     if (kCFDateFormatterIsLenientKey == key) {
 	if (!directToICU) {
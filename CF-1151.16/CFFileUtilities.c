@@ -179,6 +179,55 @@ CF_PRIVATE Boolean _CFReadBytesFromFile(CFAllocatorRef alloc, CFURLRef url, void
     return _CFReadBytesFromPath(alloc, (const char *)path, bytes, length, maxLength, extraOpenFlags);
 }
 
+#if !DEPLOYMENT_TARGET_WINDOWS
+#include <sys/mman.h>
+
+// The bytes deallocator for mapped data. The mapping always begins on the page holding the first byte of the data, and its length is kept as the allocator's info.
+static void __CFMappedFileDeallocate(void *ptr, void *info) {
+    uintptr_t pageMask = (uintptr_t)getpagesize() - 1;
+    munmap((void *)((uintptr_t)ptr & ~pageMask), (size_t)(uintptr_t)info);
+}
+
+CF_PRIVATE CFDataRef _CFDataCreateWithMappedFileDescriptor(CFAllocatorRef alloc, int fd, off_t offset, CFIndex length) {
+    if (fd < 0 || offset < 0 || length <= 0) return NULL;
+    off_t pageOffset = offset & ~((off_t)getpagesize() - 1);
+    size_t mapLength = (size_t)(offset - pageOffset) + (size_t)length;
+    void *base = mmap(0, mapLength, PROT_READ, MAP_PRIVATE, fd, pageOffset);
+    if ((void *)-1 == base) return NULL;
+    
+    CFAllocatorContext context = {0, (void *)(uintptr_t)mapLength, NULL, NULL, NULL, NULL, NULL, __CFMappedFileDeallocate, NULL};
+    CFAllocatorRef deallocator = CFAllocatorCreate(kCFAllocatorSystemDefault, &context);
+    CFDataRef data = deallocator ? CFDataCreateWithBytesNoCopy(alloc, (const UInt8 *)base + (offset - pageOffset), length, deallocator) : NULL;
+    if (deallocator) CFRelease(deallocator); // the data keeps its own reference
+    if (!data) munmap(base, mapLength);
+    return data;
+}
+
+CF_PRIVATE CFDataRef _CFDataCreateWithMappedPath(CFAllocatorRef alloc, const char *path, CFIndex mapThreshold) {
+    void *bytes = NULL;
+    CFIndex length = 0;
+    int fd = -1;
+    CFDataRef result = NULL;
+    
+    int no_hang_fd = openAutoFSNoWait();
+    fd = open(path, O_RDONLY|CF_OPENFLGS, 0666);
+    closeAutoFSNoWait(no_hang_fd);
+    if (fd < 0) return NULL;
+    
+    struct statinfo statBuf;
+    if (fstat(fd, &statBuf) == 0 && (statBuf.st_mode & S_IFMT) == S_IFREG && statBuf.st_size >= mapThreshold && statBuf.st_size > 0 && (uint64_t)statBuf.st_size <= (uint64_t)LONG_MAX) {
+        result = _CFDataCreateWithMappedFileDescriptor(alloc, fd, 0, (CFIndex)statBuf.st_size);
+    }
+    close(fd);
+    if (result) return result;
+    
+    // Small, empty or unmappable files are read as usual
+    if (!alloc) alloc = __CFGetDefaultAllocator();
+    if (!_CFReadBytesFromPath(alloc, path, &bytes, &length, 0, 0)) return NULL;
+    return CFDataCreateWithBytesNoCopy(alloc, (const UInt8 *)bytes, length, alloc);
+}
+#endif
+
 CF_PRIVATE Boolean _CFWriteBytesToFile(CFURLRef url, const void *bytes, CFIndex length) {
     int fd = -1;
     int mode;
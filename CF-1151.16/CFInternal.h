@@ -217,6 +217,8 @@ enum {
 	__CFTSDKeyRunLoopCntr = 11,
         __CFTSDKeyMachMessageBoost = 12, // valid only in the context of a CFMachPort callout
         __CFTSDKeyMachMessageHasVoucher = 13,
+	__CFTSDKeyPreferencesReader = 14,
+	__CFTSDKeyUUIDRandomBuffer = 15,
 	// autorelease pool stuff must be higher than run loop constants
 	__CFTSDKeyAutoreleaseData2 = 61,
 	__CFTSDKeyAutoreleaseData1 = 62,
@@ -371,6 +373,17 @@ CF_EXPORT CFIndex	CFBSearch(const void *element, CFIndex elementSize, const void
 
 CF_EXPORT CFHashCode	CFHashBytes(UInt8 *bytes, CFIndex length);
 
+/* Proleptic Gregorian year, month (1-12) and day of a day number counted from 1970-01-01, and back */
+CF_PRIVATE void __CFCivilFromDays(int64_t days, int64_t *year, int32_t *month, int32_t *day);
+CF_PRIVATE int64_t __CFDaysFromCivil(int64_t year, int32_t month, int32_t day);
+
+/* Returns true, and the offset, if the zone has a single period and so the same offset at all times */
+CF_PRIVATE Boolean _CFTimeZoneGetFixedSecondsFromGMT(CFTimeZoneRef tz, int32_t *seconds);
+
+/* Drop the formatter templates kept by CFDateFormatterCreate and CFNumberFormatterCreate */
+CF_PRIVATE void __CFDateFormatterFlushCache(void);
+CF_PRIVATE void __CFNumberFormatterFlushCache(void);
+
 CF_EXPORT CFStringEncoding CFStringFileSystemEncoding(void);
 
 CF_PRIVATE CFStringRef __CFStringCreateImmutableFunnel3(CFAllocatorRef alloc, const void *bytes, CFIndex numBytes, CFStringEncoding encoding, Boolean possiblyExternalFormat, Boolean tryToReduceUnicode, Boolean hasLengthByte, Boolean hasNullByte, Boolean noCopy, CFAllocatorRef contentsDeallocator, UInt32 converterFlags);
@@ -497,6 +510,22 @@ extern void __THE_PROCESS_HAS_FORKED_AND_YOU_CANNOT_USE_THIS_COREFOUNDATION_FUNC
 
 extern void *__CFStartSimpleThread(void *func, void *arg);
 
+/* ==================== Data builder ==================== */
+/* Accumulates bytes in a chain of segments, so appending never moves what has already been written. The bytes are only copied into one contiguous CFData by _CFDataBuilderCreateMutableData; _CFDataBuilderApplyFunction hands out the segments in order without copying. */
+
+typedef struct {
+    struct __CFDataBuilderSegment *_head;
+    struct __CFDataBuilderSegment *_tail;
+    CFIndex _length;
+} _CFDataBuilder;
+
+CF_PRIVATE void _CFDataBuilderInit(_CFDataBuilder *builder);
+CF_PRIVATE void _CFDataBuilderDestroy(_CFDataBuilder *builder);
+CF_PRIVATE void _CFDataBuilderAppendBytes(_CFDataBuilder *builder, const uint8_t *bytes, CFIndex length);
+CF_PRIVATE Boolean _CFDataBuilderApplyFunction(_CFDataBuilder *builder, Boolean (*applier)(const uint8_t *bytes, CFIndex length, void *context), void *context);
+    /* Stops and returns false as soon as applier returns false. */
+CF_PRIVATE CFMutableDataRef _CFDataBuilderCreateMutableData(CFAllocatorRef allocator, _CFDataBuilder *builder);
+
 /* ==================== Simple file access ==================== */
 /* For dealing with abstract types.  MF:!!! These ought to be somewhere else and public. */
     
@@ -513,6 +542,14 @@ CF_PRIVATE Boolean _CFReadBytesFromFile(CFAllocatorRef alloc, CFURLRef url, void
     /* resulting bytes are allocated from alloc which MUST be non-NULL. */
     /* maxLength of zero means the whole file.  Otherwise it sets a limit on the number of bytes read. */
 
+#if !DEPLOYMENT_TARGET_WINDOWS
+CF_PRIVATE CFDataRef _CFDataCreateWithMappedFileDescriptor(CFAllocatorRef alloc, int fd, off_t offset, CFIndex length);
+    /* Maps length bytes of the file starting at offset read-only, and returns a CFData of them which unmaps the file when it is deallocated. */
+    /* The descriptor may be closed afterwards. The file must not be truncated while the data is alive. */
+CF_PRIVATE CFDataRef _CFDataCreateWithMappedPath(CFAllocatorRef alloc, const char *path, CFIndex mapThreshold);
+    /* Maps the whole file if it is at least mapThreshold bytes long, otherwise reads it like _CFReadBytesFromFile. */
+#endif
+
 CF_EXPORT Boolean _CFWriteBytesToFile(CFURLRef url, const void *bytes, CFIndex length);
 
 CF_PRIVATE CFMutableArrayRef _CFCreateContentsOfDirectory(CFAllocatorRef alloc, char *dirPath, void *dirSpec, CFURLRef dirURL, CFStringRef matchingAbstractType);
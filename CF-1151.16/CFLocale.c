@@ -334,7 +334,11 @@ static CFLocaleRef _CFLocaleCopyCurrentGuts(CFStringRef name, Boolean useCache,
             }
         }
         __CFLocaleUnlockGlobal();
-        if (oldLocale) CFRelease(oldLocale);
+        if (oldLocale) {
+            CFRelease(oldLocale);
+            __CFDateFormatterFlushCache();
+            __CFNumberFormatterFlushCache();
+        }
     }
     
     CFDictionaryRef prefs = NULL;
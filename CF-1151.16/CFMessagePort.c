@@ -79,6 +79,10 @@ struct __CFMessagePort {
     CFMessagePortInvalidationCallBack _icallout;
     CFMessagePortCallBack _callout;	/* only used by local port; immutable */
     CFMessagePortCallBackEx _calloutEx;	/* only used by local port; immutable */
+    struct __CFMessagePortRing *_ring;	/* only used by remote port; invalidated */
+    int32_t _ringState;			/* only used by remote port */
+    int32_t _ringThreshold;		/* smallest payload sent through a ring, or 0 for none */
+    CFMutableDictionaryRef _rings;	/* only used by local port; token -> ring; invalidated */
     CFMessagePortContext _context;	/* not part of remote port; immutable; invalidated */
 };
 
@@ -146,6 +150,9 @@ CF_INLINE void __CFMessagePortUnlock(CFMessagePortRef ms) {
 // Just a heuristic
 #define __CFMessagePortMaxInlineBytes ((int32_t)4000)
 
+// Out-of-line data at least this large is handed to the receiver in place rather than copied into a new CFData
+#define __CFMessagePortMinNoCopyBytes ((mach_msg_size_t)65536)
+
 struct __CFMessagePortMachMessage {
     mach_msg_base_t base;
     mach_msg_ool_descriptor_t ool;
@@ -205,6 +212,393 @@ static mach_msg_base_t *__CFMessagePortCreateMessage(bool reply, mach_port_t por
     return (mach_msg_base_t *)msg;
 }
 
+// The bytes deallocator for data received out-of-line. The region's size is kept as the allocator's info.
+static void __CFMessagePortOOLDeallocate(void *ptr, void *info) {
+    vm_deallocate(mach_task_self(), (vm_address_t)ptr, (vm_size_t)(uintptr_t)info);
+}
+
+// Takes ownership of an out-of-line region received from the kernel. Large regions are wrapped rather than copied, since the kernel has already mapped them into this task copy-on-write.
+static CFDataRef __CFMessagePortCreateDataWithOOLRegion(void *address, mach_msg_size_t size) {
+    CFDataRef data = NULL;
+    if (__CFMessagePortMinNoCopyBytes <= size) {
+        CFAllocatorContext context = {0, (void *)(uintptr_t)size, NULL, NULL, NULL, NULL, NULL, __CFMessagePortOOLDeallocate, NULL};
+        CFAllocatorRef deallocator = CFAllocatorCreate(kCFAllocatorSystemDefault, &context);
+        if (deallocator) {
+            data = CFDataCreateWithBytesNoCopy(kCFAllocatorSystemDefault, (const UInt8 *)address, size, deallocator);
+            CFRelease(deallocator); // the data keeps its own reference
+            if (data) return data;
+        }
+    }
+    data = CFDataCreate(kCFAllocatorSystemDefault, (const UInt8 *)address, size);
+    vm_deallocate(mach_task_self(), (vm_address_t)address, size);
+    return data;
+}
+
+// Copies bytes into a region allocated for an out-of-line send. Whole pages of page-aligned bytes are copied with vm_copy, which only remaps them copy-on-write.
+static void __CFMessagePortCopyToOOLRegion(void *dst, const void *src, CFIndex length) {
+    CFIndex pageBytes = ((uintptr_t)src & vm_page_mask) ? 0 : (length & ~(CFIndex)vm_page_mask);
+    if (0 < pageBytes && KERN_SUCCESS != vm_copy(mach_task_self(), (vm_address_t)src, (vm_size_t)pageBytes, (vm_address_t)dst)) pageBytes = 0;
+    if (pageBytes < length) memmove((uint8_t *)dst + pageBytes, (const uint8_t *)src + pageBytes, length - pageBytes);
+}
+
+/* Shared-memory rings. A local port can opt in with _CFMessagePortSetSharedMemoryThreshold(). A
+ * client in another task then offers it a region of its own memory the first time it sends a large
+ * payload: the first half carries requests, the second replies. Once the offer is accepted, a
+ * payload at or above the port's threshold is copied into a record in the sender's half, and the
+ * Mach message only carries a __CFMessagePortRingRef to it, so the payload never goes through the
+ * kernel. The receiver marks the record done when it no longer needs the bytes, and the sender
+ * reuses records in order once they are done. Whenever a ring is full or missing, the message is
+ * sent out-of-line as before. */
+
+// Clients only offer a ring once they send a payload at least this large
+#define __CFMessagePortRingOfferBytes ((CFIndex)262144)
+// Bytes in each half of a ring a client offers, and the most a server accepts
+#define __CFMessagePortRingHalfSize ((vm_size_t)(32 * 1024 * 1024))
+#define __CFMessagePortRingMaxHalfSize ((vm_size_t)(256 * 1024 * 1024))
+// How long a client waits for the answer to an offer, in milliseconds
+#define __CFMessagePortRingOfferTimeout 1000
+#define __CFMessagePortRingAlign ((uint64_t)64)
+
+#define RING_MAGIC 0xF0F2F4FA
+#define __CFMessagePortRingOfferID 0x43465247	/* msgh_id of offers and their answers */
+
+enum {
+    __CFMessagePortRingUntried = 0,
+    __CFMessagePortRingOffering,
+    __CFMessagePortRingActive,
+    __CFMessagePortRingDeclined
+};
+
+typedef struct {
+    volatile uint32_t done;	/* set by the receiver once it no longer needs the payload */
+    uint32_t size;		/* of the whole record, payload and padding included */
+} __CFMessagePortRingRecord;
+
+// Sent in place of the payload, as the inline bytes of a message whose magic is RING_MAGIC
+struct __CFMessagePortRingRef {
+    uint64_t token;	/* which of the server's rings */
+    uint64_t offset;	/* of the record in the sender's half */
+    uint64_t length;	/* of the payload */
+};
+
+struct __CFMessagePortRingOffer {
+    mach_msg_base_t base;
+    mach_msg_port_descriptor_t memory;	/* memory entry for both halves */
+    mach_msg_port_descriptor_t client;	/* send right that dies with the client's side of the ring */
+    int32_t magic;
+    uint32_t halfSize;
+};
+
+struct __CFMessagePortRingAnswer {
+    mach_msg_header_t header;
+    int32_t magic;
+    int32_t threshold;	/* the server's threshold, or 0 if it declined */
+    uint64_t token;
+};
+
+struct __CFMessagePortRing {
+    volatile int32_t _refCount;
+    volatile int32_t _dead;	/* server only: the client went away */
+    CFLock_t _lock;		/* guards _head and _tail */
+    uint8_t *_base;		/* the request half, then the reply half */
+    vm_size_t _halfSize;
+    uint8_t *_produce;		/* the half this task writes records into */
+    uint8_t *_consume;		/* the half the peer writes records into */
+    uint64_t _head;		/* positions in _produce; only this task moves them */
+    uint64_t _tail;
+    uint64_t _token;
+    mach_port_t _clientPort;	/* the client's receive right, or the server's send right to it */
+    CFMachPortRef _deathPort;	/* server only; watches _clientPort */
+};
+
+static struct __CFMessagePortRing *__CFMessagePortRingCreate(uint8_t *base, vm_size_t halfSize, Boolean isServer) {
+    struct __CFMessagePortRing *ring = (struct __CFMessagePortRing *)calloc(1, sizeof(struct __CFMessagePortRing));
+    if (!ring) return NULL;
+    ring->_refCount = 1;
+    ring->_lock = CFLockInit;
+    ring->_base = base;
+    ring->_halfSize = halfSize;
+    ring->_produce = isServer ? base + halfSize : base;
+    ring->_consume = isServer ? base : base + halfSize;
+    ring->_clientPort = MACH_PORT_NULL;
+    return ring;
+}
+
+static const void *__CFMessagePortRingRetain(const void *info) {
+    OSAtomicIncrement32Barrier(&((struct __CFMessagePortRing *)info)->_refCount);
+    return info;
+}
+
+static void __CFMessagePortRingRelease(const void *info) {
+    struct __CFMessagePortRing *ring = (struct __CFMessagePortRing *)info;
+    if (0 != OSAtomicDecrement32Barrier(&ring->_refCount)) return;
+    vm_deallocate(mach_task_self(), (vm_address_t)ring->_base, 2 * ring->_halfSize);
+    // On the client this destroys the receive right, which tells the server to let go of the ring
+    if (MACH_PORT_NULL != ring->_clientPort && ring->_produce == ring->_base) mach_port_mod_refs(mach_task_self(), ring->_clientPort, MACH_PORT_RIGHT_RECEIVE, -1);
+    free(ring);
+}
+
+// Returns the payload of a new record in the half this task produces into, or NULL if the ring has no room for length bytes
+static uint8_t *__CFMessagePortRingReserve(struct __CFMessagePortRing *ring, CFIndex length, uint64_t *offset) {
+    uint64_t size = ring->_halfSize;
+    uint64_t need = (sizeof(__CFMessagePortRingRecord) + (uint64_t)length + __CFMessagePortRingAlign - 1) & ~(__CFMessagePortRingAlign - 1);
+    uint8_t *payload = NULL;
+    if (need > size) return NULL;
+    __CFLock(&ring->_lock);
+    // Reclaim done records in order; the sizes are in shared memory, so only trust ones that stay in bounds
+    while (ring->_tail < ring->_head) {
+        __CFMessagePortRingRecord *rec = (__CFMessagePortRingRecord *)(ring->_produce + ring->_tail % size);
+        uint32_t recSize = rec->size;
+        if (!rec->done || recSize < __CFMessagePortRingAlign || (recSize & (__CFMessagePortRingAlign - 1)) || ring->_head - ring->_tail < recSize) break;
+        ring->_tail += recSize;
+    }
+    OSMemoryBarrier();	// the receiver's last reads of a record happen before we write over it
+    uint64_t start = ring->_head % size;
+    uint64_t pad = (size - start < need) ? size - start : 0;
+    if (ring->_head + pad + need - ring->_tail <= size) {
+        if (0 < pad) {
+            __CFMessagePortRingRecord *padding = (__CFMessagePortRingRecord *)(ring->_produce + start);
+            padding->size = (uint32_t)pad;
+            padding->done = 1;
+            ring->_head += pad;
+            start = 0;
+        }
+        __CFMessagePortRingRecord *rec = (__CFMessagePortRingRecord *)(ring->_produce + start);
+        rec->size = (uint32_t)need;
+        rec->done = 0;
+        ring->_head += need;
+        *offset = start;
+        payload = (uint8_t *)(rec + 1);
+    }
+    __CFUnlock(&ring->_lock);
+    return payload;
+}
+
+// Hands a record back to its sender; payload must not be touched afterwards
+static void __CFMessagePortRingRelinquish(const uint8_t *payload) {
+    __CFMessagePortRingRecord *rec = (__CFMessagePortRingRecord *)payload - 1;
+    OSMemoryBarrier();
+    rec->done = 1;
+}
+
+// Validates a ref received from the peer and returns the payload it names, or NULL
+static const uint8_t *__CFMessagePortRingGetPayload(struct __CFMessagePortRing *ring, const struct __CFMessagePortRingRef *ref) {
+    if (ref->token != ring->_token) return NULL;
+    if ((ref->offset & (__CFMessagePortRingAlign - 1)) || ring->_halfSize <= ref->offset) return NULL;
+    if (ring->_halfSize - ref->offset - sizeof(__CFMessagePortRingRecord) < ref->length || __CFMessagePortMaxDataSize < ref->length) return NULL;
+    return ring->_consume + ref->offset + sizeof(__CFMessagePortRingRecord);
+}
+
+// Copies bytes into a new record and fills in the ref to send in their place. Returns the record's payload, or NULL if the ring is full.
+static const uint8_t *__CFMessagePortRingWrite(struct __CFMessagePortRing *ring, const uint8_t *bytes, CFIndex length, struct __CFMessagePortRingRef *ref) {
+    uint64_t offset = 0;
+    uint8_t *payload = __CFMessagePortRingReserve(ring, length, &offset);
+    if (!payload) return NULL;
+    memmove(payload, bytes, length);
+    ref->token = ring->_token;
+    ref->offset = offset;
+    ref->length = length;
+    return payload;
+}
+
+static void __CFMessagePortRingDataDeallocate(void *ptr, void *info) {
+    __CFMessagePortRingRelinquish((const uint8_t *)ptr);
+}
+
+// Wraps a reply payload in the client's reply half; the record is handed back when the data is freed
+static CFDataRef __CFMessagePortRingCreateData(struct __CFMessagePortRing *ring, const uint8_t *payload, CFIndex length) {
+    CFAllocatorContext context = {0, ring, __CFMessagePortRingRetain, __CFMessagePortRingRelease, NULL, NULL, NULL, __CFMessagePortRingDataDeallocate, NULL};
+    CFAllocatorRef deallocator = CFAllocatorCreate(kCFAllocatorSystemDefault, &context);
+    CFDataRef data = NULL;
+    if (deallocator) {
+        data = CFDataCreateWithBytesNoCopy(kCFAllocatorSystemDefault, payload, length, deallocator);
+        CFRelease(deallocator);
+    }
+    if (!data) {
+        data = CFDataCreate(kCFAllocatorSystemDefault, payload, length);
+        __CFMessagePortRingRelinquish(payload);
+    }
+    return data;
+}
+
+// Offers the server behind port a ring, and waits briefly for its answer. Returns the ring if the server accepted it.
+static struct __CFMessagePortRing *__CFMessagePortOfferRing(mach_port_t port, int32_t *threshold) {
+    mach_port_type_t type = 0;
+    // A port served in this task gains nothing from a ring, and answering the offer could need this very thread
+    if (KERN_SUCCESS != mach_port_type(mach_task_self(), port, &type) || (type & MACH_PORT_TYPE_RECEIVE)) return NULL;
+
+    vm_size_t halfSize = __CFMessagePortRingHalfSize;
+    vm_address_t address = 0;
+    if (KERN_SUCCESS != vm_allocate(mach_task_self(), &address, 2 * halfSize, VM_FLAGS_ANYWHERE | VM_MAKE_TAG(VM_MEMORY_MACH_MSG))) return NULL;
+    memory_object_size_t entrySize = 2 * halfSize;
+    mach_port_t entry = MACH_PORT_NULL, clientPort = MACH_PORT_NULL, answerPort = MACH_PORT_NULL;
+    kern_return_t ret = mach_make_memory_entry_64(mach_task_self(), &entrySize, address, VM_PROT_READ | VM_PROT_WRITE, &entry, MACH_PORT_NULL);
+    if (KERN_SUCCESS == ret) ret = mach_port_allocate(mach_task_self(), MACH_PORT_RIGHT_RECEIVE, &clientPort);
+    if (KERN_SUCCESS == ret) ret = mach_port_allocate(mach_task_self(), MACH_PORT_RIGHT_RECEIVE, &answerPort);
+
+    union {
+        struct __CFMessagePortRingOffer offer;
+        struct __CFMessagePortRingAnswer answer;
+        uint8_t buffer[sizeof(struct __CFMessagePortRingAnswer) + MAX_TRAILER_SIZE];
+    } msg;
+    if (KERN_SUCCESS == ret) {
+        memset(&msg, 0, sizeof(msg));
+        msg.offer.base.header.msgh_bits = MACH_MSGH_BITS_COMPLEX | MACH_MSGH_BITS(MACH_MSG_TYPE_COPY_SEND, MACH_MSG_TYPE_MAKE_SEND_ONCE);
+        msg.offer.base.header.msgh_size = sizeof(struct __CFMessagePortRingOffer);
+        msg.offer.base.header.msgh_remote_port = port;
+        msg.offer.base.header.msgh_local_port = answerPort;
+        msg.offer.base.header.msgh_id = __CFMessagePortRingOfferID;
+        msg.offer.base.body.msgh_descriptor_count = 2;
+        msg.offer.memory.name = entry;
+        msg.offer.memory.disposition = MACH_MSG_TYPE_COPY_SEND;
+        msg.offer.memory.type = MACH_MSG_PORT_DESCRIPTOR;
+        msg.offer.client.name = clientPort;
+        msg.offer.client.disposition = MACH_MSG_TYPE_MAKE_SEND;
+        msg.offer.client.type = MACH_MSG_PORT_DESCRIPTOR;
+        msg.offer.magic = RING_MAGIC;
+        msg.offer.halfSize = (uint32_t)halfSize;
+        ret = mach_msg(&msg.offer.base.header, MACH_SEND_MSG | MACH_SEND_TIMEOUT | MACH_RCV_MSG | MACH_RCV_TIMEOUT, sizeof(struct __CFMessagePortRingOffer), sizeof(msg), answerPort, __CFMessagePortRingOfferTimeout, MACH_PORT_NULL);
+    }
+    if (MACH_SEND_TIMED_OUT == ret) mach_msg_destroy(&msg.offer.base.header);	// the kernel handed the rights back
+    Boolean accepted = (MACH_MSG_SUCCESS == ret) && sizeof(struct __CFMessagePortRingAnswer) <= msg.answer.header.msgh_size && !(msg.answer.header.msgh_bits & MACH_MSGH_BITS_COMPLEX) && __CFMessagePortRingOfferID == msg.answer.header.msgh_id && RING_MAGIC == msg.answer.magic && __CFMessagePortMaxInlineBytes <= msg.answer.threshold;
+    if (MACH_MSG_SUCCESS == ret && !accepted) mach_msg_destroy(&msg.answer.header);
+    if (MACH_PORT_NULL != entry) mach_port_deallocate(mach_task_self(), entry);	// the server maps it from its own copy
+    if (MACH_PORT_NULL != answerPort) mach_port_mod_refs(mach_task_self(), answerPort, MACH_PORT_RIGHT_RECEIVE, -1);
+
+    struct __CFMessagePortRing *ring = accepted ? __CFMessagePortRingCreate((uint8_t *)address, halfSize, false) : NULL;
+    if (!ring) {
+        if (MACH_PORT_NULL != clientPort) mach_port_mod_refs(mach_task_self(), clientPort, MACH_PORT_RIGHT_RECEIVE, -1);
+        vm_deallocate(mach_task_self(), address, 2 * halfSize);
+        return NULL;
+    }
+    ring->_token = msg.answer.token;
+    ring->_clientPort = clientPort;
+    *threshold = msg.answer.threshold;
+    return ring;
+}
+
+static void __CFMessagePortRingClientDied(CFMachPortRef port, void *info) {
+    ((struct __CFMessagePortRing *)info)->_dead = 1;
+}
+
+// Server side: stops watching the client and drops the port's reference to the ring
+static void __CFMessagePortRingDetach(struct __CFMessagePortRing *ring) {
+    if (ring->_deathPort) {
+        CFMachPortSetInvalidationCallBack(ring->_deathPort, NULL);
+        CFMachPortInvalidate(ring->_deathPort);
+        CFRelease(ring->_deathPort);
+        ring->_deathPort = NULL;
+    }
+    if (MACH_PORT_NULL != ring->_clientPort) {
+        mach_port_deallocate(mach_task_self(), ring->_clientPort);
+        ring->_clientPort = MACH_PORT_NULL;
+    }
+    __CFMessagePortRingRelease(ring);
+}
+
+static void __CFMessagePortCollectDeadRing(const void *key, const void *value, void *context) {
+    if (((struct __CFMessagePortRing *)value)->_dead) CFArrayAppendValue((CFMutableArrayRef)context, value);
+}
+
+// Detaches the rings of clients that went away; the port must not be locked
+static void __CFMessagePortPurgeDeadRings(CFMessagePortRef ms) {
+    CFMutableArrayRef dead = NULL;
+    __CFMessagePortLock(ms);
+    if (ms->_rings && 0 < CFDictionaryGetCount(ms->_rings)) {
+        dead = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, NULL);
+        CFDictionaryApplyFunction(ms->_rings, __CFMessagePortCollectDeadRing, dead);
+        for (CFIndex idx = 0, cnt = CFArrayGetCount(dead); idx < cnt; idx++) {
+            CFDictionaryRemoveValue(ms->_rings, (const void *)(uintptr_t)((struct __CFMessagePortRing *)CFArrayGetValueAtIndex(dead, idx))->_token);
+        }
+    }
+    __CFMessagePortUnlock(ms);
+    if (dead) {
+        for (CFIndex idx = 0, cnt = CFArrayGetCount(dead); idx < cnt; idx++) __CFMessagePortRingDetach((struct __CFMessagePortRing *)CFArrayGetValueAtIndex(dead, idx));
+        CFRelease(dead);
+    }
+}
+
+// Server side: maps the ring a client offers, if this port accepts rings, and returns the answer to send back
+static void *__CFMessagePortAnswerRingOffer(CFMessagePortRef ms, mach_msg_base_t *msgp, CFIndex size) {
+    struct __CFMessagePortRingOffer *offer = (struct __CFMessagePortRingOffer *)msgp;
+    Boolean valid = sizeof(struct __CFMessagePortRingOffer) <= size && sizeof(struct __CFMessagePortRingOffer) <= offer->base.header.msgh_size && (offer->base.header.msgh_bits & MACH_MSGH_BITS_COMPLEX) && 2 == offer->base.body.msgh_descriptor_count && MACH_MSG_PORT_DESCRIPTOR == offer->memory.type && MACH_MSG_PORT_DESCRIPTOR == offer->client.type && RING_MAGIC == offer->magic && MACH_PORT_NULL != offer->base.header.msgh_remote_port;
+    vm_size_t halfSize = valid ? offer->halfSize : 0;
+    if (!valid || 0 == halfSize || __CFMessagePortRingMaxHalfSize < halfSize || (halfSize & vm_page_mask)) {
+        CFLog(kCFLogLevelWarning, CFSTR("*** CFMessagePort: dropping corrupt shared memory offer Mach message"));
+        mach_msg_destroy(&offer->base.header);
+        return NULL;
+    }
+    __CFMessagePortPurgeDeadRings(ms);
+    __CFMessagePortLock(ms);
+    int32_t threshold = __CFMessagePortIsValid(ms) ? ms->_ringThreshold : 0;
+    __CFMessagePortUnlock(ms);
+
+    struct __CFMessagePortRing *ring = NULL;
+    vm_address_t address = 0;
+    if (0 < threshold && KERN_SUCCESS == vm_map(mach_task_self(), &address, 2 * halfSize, 0, VM_FLAGS_ANYWHERE, offer->memory.name, 0, false, VM_PROT_READ | VM_PROT_WRITE, VM_PROT_READ | VM_PROT_WRITE, VM_INHERIT_NONE)) {
+        ring = __CFMessagePortRingCreate((uint8_t *)address, halfSize, true);
+        if (!ring) vm_deallocate(mach_task_self(), address, 2 * halfSize);
+    }
+    mach_port_deallocate(mach_task_self(), offer->memory.name);	// the mapping keeps the memory
+    if (ring) {
+        CFMachPortContext context = {0, ring, __CFMessagePortRingRetain, __CFMessagePortRingRelease, NULL};
+        ring->_clientPort = offer->client.name;
+        ring->_deathPort = CFMachPortCreateWithPort(kCFAllocatorSystemDefault, offer->client.name, NULL, &context, NULL);
+        if (ring->_deathPort) CFMachPortSetInvalidationCallBack(ring->_deathPort, __CFMessagePortRingClientDied);
+        __CFMessagePortLock(ms);
+        if (ring->_deathPort && !ring->_dead && __CFMessagePortIsValid(ms)) {
+            if (!ms->_rings) ms->_rings = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, NULL, NULL);
+            do {
+                ring->_token = (uintptr_t)(((uint64_t)arc4random() << 32) | arc4random());
+            } while (0 == ring->_token || CFDictionaryContainsKey(ms->_rings, (const void *)(uintptr_t)ring->_token));
+            CFDictionarySetValue(ms->_rings, (const void *)(uintptr_t)ring->_token, ring);
+        } else {
+            threshold = 0;
+        }
+        __CFMessagePortUnlock(ms);
+        if (0 == threshold) {
+            __CFMessagePortRingDetach(ring);
+            ring = NULL;
+        }
+    } else {
+        threshold = 0;
+        if (MACH_PORT_NULL != offer->client.name) mach_port_deallocate(mach_task_self(), offer->client.name);
+    }
+
+    struct __CFMessagePortRingAnswer *answer = (struct __CFMessagePortRingAnswer *)CFAllocatorAllocate(kCFAllocatorSystemDefault, sizeof(struct __CFMessagePortRingAnswer), 0);
+    if (!answer) {
+        mach_port_deallocate(mach_task_self(), offer->base.header.msgh_remote_port);
+        return NULL;
+    }
+    memset(answer, 0, sizeof(struct __CFMessagePortRingAnswer));
+    answer->header.msgh_bits = MACH_MSGH_BITS(MACH_MSG_TYPE_MOVE_SEND_ONCE, 0);
+    answer->header.msgh_size = sizeof(struct __CFMessagePortRingAnswer);
+    answer->header.msgh_remote_port = offer->base.header.msgh_remote_port;
+    answer->header.msgh_local_port = MACH_PORT_NULL;
+    answer->header.msgh_id = __CFMessagePortRingOfferID;
+    answer->magic = RING_MAGIC;
+    answer->threshold = threshold;
+    answer->token = ring ? ring->_token : 0;
+    return answer;
+}
+
+// Looks up and retains the server's ring named by a ref, or returns NULL
+static struct __CFMessagePortRing *__CFMessagePortCopyRing(CFMessagePortRef ms, uint64_t token) {
+    struct __CFMessagePortRing *ring = NULL;
+    __CFMessagePortLock(ms);
+    if (ms->_rings && (uintptr_t)token == token) ring = (struct __CFMessagePortRing *)CFDictionaryGetValue(ms->_rings, (const void *)(uintptr_t)token);
+    if (ring) __CFMessagePortRingRetain(ring);
+    __CFMessagePortUnlock(ms);
+    return ring;
+}
+
+// Creates a message whose payload is in a ring; the ref goes where the bytes would be inline
+static mach_msg_base_t *__CFMessagePortCreateRingMessage(bool reply, mach_port_t port, mach_port_t replyPort, int32_t convid, int32_t msgid, const struct __CFMessagePortRingRef *ref) {
+    mach_msg_base_t *msg = __CFMessagePortCreateMessage(reply, port, replyPort, convid, msgid, (const uint8_t *)ref, (int32_t)sizeof(struct __CFMessagePortRingRef));
+    if (msg) ((struct __CFMessagePortMachMessage *)msg)->innards.magic = RING_MAGIC;
+    return msg;
+}
+
 static CFStringRef __CFMessagePortCopyDescription(CFTypeRef cf) {
     CFMessagePortRef ms = (CFMessagePortRef)cf;
     CFStringRef result;
@@ -388,6 +782,10 @@ static CFMessagePortRef __CFMessagePortCreateLocal(CFAllocatorRef allocator, CFS
     memory->_icallout = NULL;
     memory->_callout = callout;
     memory->_calloutEx = calloutEx;
+    memory->_ring = NULL;
+    memory->_ringState = __CFMessagePortRingUntried;
+    memory->_ringThreshold = 0;
+    memory->_rings = NULL;
     memory->_context.info = NULL;
     memory->_context.retain = NULL;
     memory->_context.release = NULL;
@@ -547,6 +945,10 @@ static CFMessagePortRef __CFMessagePortCreateRemote(CFAllocatorRef allocator, CF
     memory->_icallout = NULL;
     memory->_callout = NULL;
     memory->_calloutEx = NULL;
+    memory->_ring = NULL;
+    memory->_ringState = __CFMessagePortRingUntried;
+    memory->_ringThreshold = 0;
+    memory->_rings = NULL;
     ctx.version = 0;
     ctx.info = memory;
     ctx.retain = NULL;
@@ -734,6 +1136,8 @@ void CFMessagePortInvalidate(CFMessagePortRef ms) {
 	CFMachPortRef replyPort = ms->_replyPort;
 	CFMachPortRef port = ms->_port;
 	CFStringRef name = ms->_name;
+	struct __CFMessagePortRing *ring = ms->_ring;
+	CFMutableDictionaryRef rings = ms->_rings;
 	void *info = NULL;
 
 	__CFMessagePortUnsetValid(ms);
@@ -744,6 +1148,8 @@ void CFMessagePortInvalidate(CFMessagePortRef ms) {
 	ms->_source = NULL;
 	ms->_replyPort = NULL;
         ms->_port = NULL;
+	ms->_ring = NULL;
+	ms->_rings = NULL;
 	__CFMessagePortUnlock(ms);
 
 	__CFLock(&__CFAllMessagePortsLock);
@@ -765,6 +1171,20 @@ void CFMessagePortInvalidate(CFMessagePortRef ms) {
 	    CFMachPortInvalidate(replyPort);
 	    CFRelease(replyPort);
 	}
+	if (NULL != ring) {
+	    // Replies still wrapped in the ring keep it mapped until they are freed
+	    __CFMessagePortRingRelease(ring);
+	}
+	if (NULL != rings) {
+	    CFIndex cnt = CFDictionaryGetCount(rings);
+	    struct __CFMessagePortRing **list = CFAllocatorAllocate(kCFAllocatorSystemDefault, cnt * sizeof(struct __CFMessagePortRing *), 0);
+	    CFDictionaryGetKeysAndValues(rings, NULL, (const void **)list);
+	    for (CFIndex idx = 0; idx < cnt; idx++) {
+		__CFMessagePortRingDetach(list[idx]);
+	    }
+	    CFAllocatorDeallocate(kCFAllocatorSystemDefault, list);
+	    CFRelease(rings);
+	}
 	if (__CFMessagePortIsRemote(ms)) {
 	    // Get rid of our extra ref on the Mach port gotten from bs server
 	    mach_port_deallocate(mach_task_self(), CFMachPortGetPort(port));
@@ -823,6 +1243,17 @@ void CFMessagePortSetInvalidationCallBack(CFMessagePortRef ms, CFMessagePortInva
     }
 }
 
+void _CFMessagePortSetSharedMemoryThreshold(CFMessagePortRef ms, CFIndex minBytes) {
+    __CFGenericValidateType(ms, CFMessagePortGetTypeID());
+    __CFMessagePortLock(ms);
+    if (!__CFMessagePortIsRemote(ms)) {
+        // Smaller payloads are inline in the message anyway
+        if (0 < minBytes && minBytes < __CFMessagePortMaxInlineBytes) minBytes = __CFMessagePortMaxInlineBytes;
+        ms->_ringThreshold = (minBytes <= 0) ? 0 : (INT32_MAX < minBytes) ? INT32_MAX : (int32_t)minBytes;
+    }
+    __CFMessagePortUnlock(ms);
+}
+
 static void __CFMessagePortReplyCallBack(CFMachPortRef port, void *msg, CFIndex size, void *info) {
     CFMessagePortRef ms = info;
     mach_msg_base_t *msgp = msg;
@@ -839,9 +1270,11 @@ static void __CFMessagePortReplyCallBack(CFMachPortRef port, void *msg, CFIndex
     Boolean invalidMagic = false;
     Boolean invalidComplex = false;
     Boolean wayTooBig = false;
+    Boolean isRing = false;
     if (!wayTooSmall) {
-        invalidMagic = ((MSGP_INFO(msgp, magic) != MAGIC) && (CFSwapInt32(MSGP_INFO(msgp, magic)) != MAGIC));
-        invalidComplex = (msgp->header.msgh_bits & MACH_MSGH_BITS_COMPLEX) && (1 != msgp->body.msgh_descriptor_count);
+        isRing = (MSGP_INFO(msgp, magic) == RING_MAGIC);
+        invalidMagic = !isRing && ((MSGP_INFO(msgp, magic) != MAGIC) && (CFSwapInt32(MSGP_INFO(msgp, magic)) != MAGIC));
+        invalidComplex = (msgp->header.msgh_bits & MACH_MSGH_BITS_COMPLEX) && (isRing || 1 != msgp->body.msgh_descriptor_count);
         wayTooBig = ((int32_t)MSGP_SIZE(msgp) + __CFMessagePortMaxInlineBytes) < msgp->header.msgh_size; // also less than a 32-bit signed int can hold
     }
     Boolean wrongSize = false;
@@ -853,6 +1286,7 @@ static void __CFMessagePortReplyCallBack(CFMachPortRef port, void *msg, CFIndex
         } else {
             wrongSize = wrongSize || ((int32_t)msgp->header.msgh_size - (int32_t)MSGP_SIZE(msgp) < byteslen);
         }
+        wrongSize = wrongSize || (isRing && (int32_t)sizeof(struct __CFMessagePortRingRef) != byteslen);
     }
     Boolean invalidMsgID = wayTooSmall ? false : ((0 <= MSGP_INFO(msgp, convid)) && (MSGP_INFO(msgp, convid) <= INT32_MAX)); // conversation id
     if (invalidMagic || invalidComplex || wayTooBig || wayTooSmall || wrongSize || invalidMsgID) {
@@ -862,10 +1296,26 @@ static void __CFMessagePortReplyCallBack(CFMachPortRef port, void *msg, CFIndex
         return;
     }
 
+    const uint8_t *ringPayload = NULL;
+    CFIndex ringLength = 0;
+    if (isRing) {
+        struct __CFMessagePortRingRef ref;
+        memmove(&ref, MSGP_INFO(msgp, bytes), sizeof(ref));
+        ringPayload = ms->_ring ? __CFMessagePortRingGetPayload(ms->_ring, &ref) : NULL;
+        if (!ringPayload) {
+            CFLog(kCFLogLevelWarning, CFSTR("*** CFMessagePort: dropping reply Mach message for an unknown shared memory region"));
+            __CFMessagePortUnlock(ms);
+            return;
+        }
+        ringLength = (CFIndex)ref.length;
+    }
+
     if (CFDictionaryContainsKey(ms->_replies, (void *)(uintptr_t)MSGP_INFO(msgp, convid))) {
 	CFDataRef reply = NULL;
 	replymsg = (mach_msg_base_t *)msg;
-	if (!(replymsg->header.msgh_bits & MACH_MSGH_BITS_COMPLEX)) {
+	if (ringPayload) {
+	    reply = __CFMessagePortRingCreateData(ms->_ring, ringPayload, ringLength);
+	} else if (!(replymsg->header.msgh_bits & MACH_MSGH_BITS_COMPLEX)) {
 	    uintptr_t msgp_extent = (uintptr_t)((uint8_t *)msgp + msgp->header.msgh_size);
 	    uintptr_t data_extent = (uintptr_t)((uint8_t *)&(MSGP_INFO(replymsg, bytes)) + byteslen);
             if (byteslen < 0) byteslen = 0; // from here on, treat negative same as zero -- this is historical behavior: a NULL return from the callback on the other side results in empty data to the original requestor
@@ -875,21 +1325,52 @@ static void __CFMessagePortReplyCallBack(CFMachPortRef port, void *msg, CFIndex
 		reply = (void *)~0;	// means NULL data
 	    }
 	} else {
-//#warning CF: should create a no-copy data here that has a custom VM-freeing allocator, and not vm_dealloc here
-	    reply = CFDataCreate(kCFAllocatorSystemDefault, MSGP_GET(replymsg, ool).address, MSGP_GET(replymsg, ool).size);
-	    vm_deallocate(mach_task_self(), (vm_address_t)MSGP_GET(replymsg, ool).address, MSGP_GET(replymsg, ool).size);
+	    reply = __CFMessagePortCreateDataWithOOLRegion(MSGP_GET(replymsg, ool).address, MSGP_GET(replymsg, ool).size);
 	}
 	CFDictionarySetValue(ms->_replies, (void *)(uintptr_t)MSGP_INFO(msgp, convid), (void *)reply);
     } else {	/* discard message */
-	if (msgp->header.msgh_bits & MACH_MSGH_BITS_COMPLEX) {
+	if (ringPayload) {
+	    __CFMessagePortRingRelinquish(ringPayload);
+	} else if (msgp->header.msgh_bits & MACH_MSGH_BITS_COMPLEX) {
 	    vm_deallocate(mach_task_self(), (vm_address_t)MSGP_GET(msgp, ool).address, MSGP_GET(msgp, ool).size);
 	}
     }
     __CFMessagePortUnlock(ms);
 }
 
+// Offers the server a ring the first time a large payload is sent to it; a server that declines, or does not answer, is not asked again
+static void __CFMessagePortNegotiateRing(CFMessagePortRef remote) {
+    __CFMessagePortLock(remote);
+    if (!__CFMessagePortIsValid(remote) || __CFMessagePortRingUntried != remote->_ringState) {
+        __CFMessagePortUnlock(remote);
+        return;
+    }
+    remote->_ringState = __CFMessagePortRingOffering;
+    mach_port_t port = CFMachPortGetPort(remote->_port);
+    // Hold our own send right, since invalidation may give up the port's while the offer is out
+    Boolean held = (KERN_SUCCESS == mach_port_mod_refs(mach_task_self(), port, MACH_PORT_RIGHT_SEND, 1));
+    __CFMessagePortUnlock(remote);
+    int32_t threshold = 0;
+    struct __CFMessagePortRing *ring = held ? __CFMessagePortOfferRing(port, &threshold) : NULL;
+    if (held) mach_port_deallocate(mach_task_self(), port);
+    __CFMessagePortLock(remote);
+    if (ring && __CFMessagePortIsValid(remote)) {
+        remote->_ring = ring;
+        remote->_ringThreshold = threshold;
+        remote->_ringState = __CFMessagePortRingActive;
+        ring = NULL;
+    } else {
+        remote->_ringState = __CFMessagePortRingDeclined;
+    }
+    __CFMessagePortUnlock(remote);
+    if (ring) __CFMessagePortRingRelease(ring);
+}
+
 SInt32 CFMessagePortSendRequest(CFMessagePortRef remote, SInt32 msgid, CFDataRef data, CFTimeInterval sendTimeout, CFTimeInterval rcvTimeout, CFStringRef replyMode, CFDataRef *returnDatap) {
-    mach_msg_base_t *sendmsg;
+    mach_msg_base_t *sendmsg = NULL;
+    struct __CFMessagePortRing *ring = NULL;
+    struct __CFMessagePortRingRef ref;
+    const uint8_t *ringPayload = NULL;
     CFRunLoopRef currentRL = CFRunLoopGetCurrent();
     CFRunLoopSourceRef source = NULL;
     CFDataRef reply = NULL;
@@ -905,9 +1386,21 @@ SInt32 CFMessagePortSendRequest(CFMessagePortRef remote, SInt32 msgid, CFDataRef
         CFLog(kCFLogLevelWarning, CFSTR("*** CFMessagePortSendRequest: CFMessagePort cannot send more than %lu bytes of data"), __CFMessagePortMaxDataSize);
         return kCFMessagePortTransportError;
     }
+    if (data && __CFMessagePortRingOfferBytes <= CFDataGetLength(data) && __CFMessagePortRingUntried == remote->_ringState) {
+        __CFMessagePortNegotiateRing(remote);
+    }
+    if (data && __CFMessagePortMaxInlineBytes <= CFDataGetLength(data)) {
+        __CFMessagePortLock(remote);
+        if (remote->_ring && remote->_ringThreshold <= CFDataGetLength(data)) ring = (struct __CFMessagePortRing *)__CFMessagePortRingRetain(remote->_ring);
+        __CFMessagePortUnlock(remote);
+        // Copy outside the port's lock; a full ring just means this payload goes out-of-line
+        if (ring) ringPayload = __CFMessagePortRingWrite(ring, CFDataGetBytePtr(data), CFDataGetLength(data), &ref);
+    }
     __CFMessagePortLock(remote);
     if (!__CFMessagePortIsValid(remote)) {
         __CFMessagePortUnlock(remote);
+        if (ringPayload) __CFMessagePortRingRelinquish(ringPayload);
+        if (ring) __CFMessagePortRingRelease(ring);
         return kCFMessagePortIsInvalid;
     }
     CFRetain(remote); // retain during run loop to avoid invalidation causing freeing
@@ -922,9 +1415,15 @@ SInt32 CFMessagePortSendRequest(CFMessagePortRef remote, SInt32 msgid, CFDataRef
     }
     remote->_convCounter++;
     desiredReply = -remote->_convCounter;
-    sendmsg = __CFMessagePortCreateMessage(false, CFMachPortGetPort(remote->_port), (replyMode != NULL ? CFMachPortGetPort(remote->_replyPort) : MACH_PORT_NULL), -desiredReply, msgid, (data ? CFDataGetBytePtr(data) : NULL), (data ? CFDataGetLength(data) : -1));
+    if (ringPayload) {
+        sendmsg = __CFMessagePortCreateRingMessage(false, CFMachPortGetPort(remote->_port), (replyMode != NULL ? CFMachPortGetPort(remote->_replyPort) : MACH_PORT_NULL), -desiredReply, msgid, &ref);
+    } else {
+        sendmsg = __CFMessagePortCreateMessage(false, CFMachPortGetPort(remote->_port), (replyMode != NULL ? CFMachPortGetPort(remote->_replyPort) : MACH_PORT_NULL), -desiredReply, msgid, (data ? CFDataGetBytePtr(data) : NULL), (data ? CFDataGetLength(data) : -1));
+    }
     if (!sendmsg) {
         __CFMessagePortUnlock(remote);
+        if (ringPayload) __CFMessagePortRingRelinquish(ringPayload);
+        if (ring) __CFMessagePortRingRelease(ring);
         CFRelease(remote);
         return kCFMessagePortTransportError;
     }
@@ -954,11 +1453,14 @@ SInt32 CFMessagePortSendRequest(CFMessagePortRef remote, SInt32 msgid, CFDataRef
 	}
 	if (source) CFRelease(source);
         __CFMessagePortUnlock(remote);
+	if (ringPayload) __CFMessagePortRingRelinquish(ringPayload);	// the server never saw it
+	if (ring) __CFMessagePortRingRelease(ring);
         CFAllocatorDeallocate(kCFAllocatorSystemDefault, sendmsg);
         CFRelease(remote);
 	return (MACH_SEND_TIMED_OUT == ret) ? kCFMessagePortSendTimeout : kCFMessagePortTransportError;
     }
     __CFMessagePortUnlock(remote);
+    if (ring) __CFMessagePortRingRelease(ring);	// the server hands the record back through the shared memory
     CFAllocatorDeallocate(kCFAllocatorSystemDefault, sendmsg);
     if (replyMode == NULL) {
         CFRelease(remote);
@@ -1015,6 +1517,14 @@ static void *__CFMessagePortPerform(void *msg, CFIndex size, CFAllocatorRef allo
     void *return_bytes = NULL;
     CFIndex return_len = -1;
     int32_t msgid;
+    struct __CFMessagePortRing *ring = NULL;
+    const uint8_t *ringPayload = NULL;
+    struct __CFMessagePortRingRef replyRef;
+    const uint8_t *replyPayload = NULL;
+
+    if (sizeof(mach_msg_header_t) <= size && __CFMessagePortRingOfferID == msgp->header.msgh_id) {
+	return __CFMessagePortAnswerRingOffer(ms, msgp, size);
+    }
 
     __CFMessagePortLock(ms);
     if (!__CFMessagePortIsValid(ms)) {
@@ -1037,9 +1547,11 @@ static void *__CFMessagePortPerform(void *msg, CFIndex size, CFAllocatorRef allo
     Boolean invalidMagic = false;
     Boolean invalidComplex = false;
     Boolean wayTooBig = false;
+    Boolean isRing = false;
     if (!wayTooSmall) {
-        invalidMagic = ((MSGP_INFO(msgp, magic) != MAGIC) && (CFSwapInt32(MSGP_INFO(msgp, magic)) != MAGIC));
-        invalidComplex = (msgp->header.msgh_bits & MACH_MSGH_BITS_COMPLEX) && (1 != msgp->body.msgh_descriptor_count);
+        isRing = (MSGP_INFO(msgp, magic) == RING_MAGIC);
+        invalidMagic = !isRing && ((MSGP_INFO(msgp, magic) != MAGIC) && (CFSwapInt32(MSGP_INFO(msgp, magic)) != MAGIC));
+        invalidComplex = (msgp->header.msgh_bits & MACH_MSGH_BITS_COMPLEX) && (isRing || 1 != msgp->body.msgh_descriptor_count);
         wayTooBig = ((int32_t)MSGP_SIZE(msgp) + __CFMessagePortMaxInlineBytes) < msgp->header.msgh_size; // also less than a 32-bit signed int can hold
     }
     Boolean wrongSize = false;
@@ -1051,6 +1563,7 @@ static void *__CFMessagePortPerform(void *msg, CFIndex size, CFAllocatorRef allo
         } else {
             wrongSize = wrongSize || ((int32_t)msgp->header.msgh_size - (int32_t)MSGP_SIZE(msgp) < byteslen);
         }
+        wrongSize = wrongSize || (isRing && (int32_t)sizeof(struct __CFMessagePortRingRef) != byteslen);
     }
     Boolean invalidMsgID = wayTooSmall ? false : ((MSGP_INFO(msgp, convid) <= 0) || (INT32_MAX < MSGP_INFO(msgp, convid))); // conversation id
     if (invalidMagic || invalidComplex || wayTooBig || wayTooSmall || wrongSize || invalidMsgID) {
@@ -1059,10 +1572,29 @@ static void *__CFMessagePortPerform(void *msg, CFIndex size, CFAllocatorRef allo
         return NULL;
     }
 
+    if (isRing) {
+        struct __CFMessagePortRingRef ref;
+        memmove(&ref, MSGP_INFO(msgp, bytes), sizeof(ref));
+        __CFMessagePortPurgeDeadRings(ms);
+        ring = __CFMessagePortCopyRing(ms, ref.token);
+        ringPayload = ring ? __CFMessagePortRingGetPayload(ring, &ref) : NULL;
+        if (!ringPayload) {
+            CFLog(kCFLogLevelWarning, CFSTR("*** CFMessagePort: dropping request Mach message for an unknown shared memory region"));
+            if (ring) __CFMessagePortRingRelease(ring);
+            mach_msg_destroy((mach_msg_header_t *)msgp);
+            if (context_release) context_release(context_info);
+            return NULL;
+        }
+        byteslen = (int32_t)ref.length;
+    }
+
     if (byteslen < 0) byteslen = 0; // from here on, treat negative same as zero
 
     /* Create no-copy, no-free-bytes wrapper CFData */
-    if (!(msgp->header.msgh_bits & MACH_MSGH_BITS_COMPLEX)) {
+    if (ringPayload) {
+	msgid = CFSwapInt32LittleToHost(MSGP_INFO(msgp, msgid));
+	data = CFDataCreateWithBytesNoCopy(allocator, ringPayload, byteslen, kCFAllocatorNull);
+    } else if (!(msgp->header.msgh_bits & MACH_MSGH_BITS_COMPLEX)) {
 	uintptr_t msgp_extent = (uintptr_t)((uint8_t *)msgp + msgp->header.msgh_size);
 	uintptr_t data_extent = (uintptr_t)((uint8_t *)&(MSGP_INFO(msgp, bytes)) + byteslen);
 	msgid = CFSwapInt32LittleToHost(MSGP_INFO(msgp, msgid));
@@ -1099,22 +1631,42 @@ static void *__CFMessagePortPerform(void *msg, CFIndex size, CFAllocatorRef allo
         }
 	if (returnData && return_len < __CFMessagePortMaxInlineBytes) {
 	    return_bytes = (void *)CFDataGetBytePtr(returnData);
+	} else if (returnData && ring && ms->_ringThreshold <= return_len && MACH_PORT_NULL != msgp->header.msgh_remote_port && (replyPayload = __CFMessagePortRingWrite(ring, CFDataGetBytePtr(returnData), return_len, &replyRef))) {
+	    // Only a sender waiting on a reply port can ever hand the record back
+	    return_bytes = NULL;
 	} else if (returnData) {
 	    return_bytes = NULL;
 	    vm_allocate(mach_task_self(), (vm_address_t *)&return_bytes, return_len, VM_FLAGS_ANYWHERE | VM_MAKE_TAG(VM_MEMORY_MACH_MSG));
-	    /* vm_copy would only be a win here if the source address
+	    /* vm_copy is only a win here if the source address
 		is page aligned; it is a lose in all other cases, since
 		the kernel will just do the memmove for us (but not in
-		as simple a way). */
-	    memmove(return_bytes, CFDataGetBytePtr(returnData), return_len);
+		as simple a way). Large malloc blocks are page aligned. */
+	    __CFMessagePortCopyToOOLRegion(return_bytes, CFDataGetBytePtr(returnData), return_len);
 	}
     }
-    replymsg = __CFMessagePortCreateMessage(true, msgp->header.msgh_remote_port, MACH_PORT_NULL, -1 * (int32_t)MSGP_INFO(msgp, convid), msgid, return_bytes, return_len);
-    if (replymsg->header.msgh_bits & MACH_MSGH_BITS_COMPLEX) {
+    if (replyPayload) {
+	replymsg = __CFMessagePortCreateRingMessage(true, msgp->header.msgh_remote_port, MACH_PORT_NULL, -1 * (int32_t)MSGP_INFO(msgp, convid), msgid, &replyRef);
+	/* The reply is sent here rather than by the caller, which does not know about rings.
+	   If it cannot be delivered, for instance because the sender gave up waiting and
+	   destroyed its reply port, nobody else will hand the record back. */
+	if (!replymsg || KERN_SUCCESS != mach_msg((mach_msg_header_t *)replymsg, MACH_SEND_MSG, replymsg->header.msgh_size, 0, MACH_PORT_NULL, 0, MACH_PORT_NULL)) {
+	    if (replymsg) mach_msg_destroy((mach_msg_header_t *)replymsg);
+	    __CFMessagePortRingRelinquish(replyPayload);
+	}
+	if (replymsg) CFAllocatorDeallocate(kCFAllocatorSystemDefault, replymsg);
+	replymsg = NULL;
+    } else {
+	replymsg = __CFMessagePortCreateMessage(true, msgp->header.msgh_remote_port, MACH_PORT_NULL, -1 * (int32_t)MSGP_INFO(msgp, convid), msgid, return_bytes, return_len);
+    }
+    if (replymsg && (replymsg->header.msgh_bits & MACH_MSGH_BITS_COMPLEX)) {
 	MSGP_GET(replymsg, ool).deallocate = true;
     }
     if (data) CFRelease(data);
-    if (msgp->header.msgh_bits & MACH_MSGH_BITS_COMPLEX) {
+    if (ringPayload) {
+	// The reply has been copied out, so the request's bytes can go back to the client
+	__CFMessagePortRingRelinquish(ringPayload);
+	__CFMessagePortRingRelease(ring);
+    } else if (msgp->header.msgh_bits & MACH_MSGH_BITS_COMPLEX) {
 	vm_deallocate(mach_task_self(), (vm_address_t)MSGP_GET(msgp, ool).address, MSGP_GET(msgp, ool).size);
     }
     if (returnData) CFRelease(returnData);
@@ -56,6 +56,14 @@ struct __CFNumberFormatter {
     Boolean _isLenient;
     Boolean _userSetMultiplier;
     Boolean _usesCharacterDirection;
+    struct {			/* see __CFNumberFormatterUpdateSimpleDecimal */
+        uint8_t _state;		/* 0: not yet checked, 1: use ICU, 2: plain ASCII decimal */
+        int32_t _minInt;
+        int32_t _maxInt;
+        int32_t _minFrac;
+        int32_t _maxFrac;
+        int32_t _groupingSize;	/* 0 when grouping is off */
+    } _simple;
 };
 
 static CFStringRef __CFNumberFormatterCopyDescription(CFTypeRef cf) {
@@ -94,6 +102,92 @@ CFTypeID CFNumberFormatterGetTypeID(void) {
     return __kCFNumberFormatterTypeID;
 }
 
+/* A few fully set up formatters are kept as templates, keyed by locale
+ * (which includes the preferences of a user locale) and style; new formatters
+ * with the same key clone the template's ICU formatter instead of opening one
+ * and reapplying the preferences. Templates are never handed out.
+ */
+#define __kCFNumberFormatterCacheSize 8
+
+static CFNumberFormatterRef __CFNumberFormatterCache[__kCFNumberFormatterCacheSize] = {NULL};
+static CFIndex __CFNumberFormatterCacheNext = 0;
+static CFIndex __CFNumberFormatterCacheHits = 0;
+static CFIndex __CFNumberFormatterCacheMisses = 0;
+static CFLock_t __CFNumberFormatterCacheLock = CFLockInit;
+
+// dst has its _locale and _style set, and everything else NULL
+static Boolean __CFNumberFormatterCopyTemplate(struct __CFNumberFormatter *dst, CFNumberFormatterRef src) {
+    UErrorCode status = U_ZERO_ERROR;
+    UNumberFormat *nf = __cficu_unum_clone(src->_nf, &status);
+    if (NULL == nf || U_FAILURE(status)) {
+        if (nf) __cficu_unum_close(nf);
+        return false;
+    }
+    dst->_nf = nf;
+    dst->_format = src->_format ? (CFStringRef)CFRetain(src->_format) : NULL;
+    dst->_defformat = src->_defformat ? (CFStringRef)CFRetain(src->_defformat) : NULL;
+    dst->_compformat = src->_compformat ? (CFStringRef)CFRetain(src->_compformat) : NULL;
+    dst->_multiplier = src->_multiplier ? (CFNumberRef)CFRetain(src->_multiplier) : NULL;
+    dst->_zeroSym = src->_zeroSym ? (CFStringRef)CFRetain(src->_zeroSym) : NULL;
+    dst->_isLenient = src->_isLenient;
+    dst->_userSetMultiplier = src->_userSetMultiplier;
+    dst->_usesCharacterDirection = src->_usesCharacterDirection;
+    return true;
+}
+
+static Boolean __CFNumberFormatterCopyFromCache(struct __CFNumberFormatter *formatter) {
+    Boolean found = false;
+    __CFLock(&__CFNumberFormatterCacheLock);
+    for (CFIndex idx = 0; idx < __kCFNumberFormatterCacheSize && !found; idx++) {
+        CFNumberFormatterRef tmpl = __CFNumberFormatterCache[idx];
+        if (tmpl && tmpl->_style == formatter->_style && CFEqual(tmpl->_locale, formatter->_locale)) {
+            found = __CFNumberFormatterCopyTemplate(formatter, tmpl);
+        }
+    }
+    if (found) __CFNumberFormatterCacheHits++; else __CFNumberFormatterCacheMisses++;
+    __CFUnlock(&__CFNumberFormatterCacheLock);
+    return found;
+}
+
+static void __CFNumberFormatterAddToCache(CFNumberFormatterRef formatter) {
+    uint32_t size = sizeof(struct __CFNumberFormatter) - sizeof(CFRuntimeBase);
+    struct __CFNumberFormatter *tmpl = (struct __CFNumberFormatter *)_CFRuntimeCreateInstance(kCFAllocatorSystemDefault, CFNumberFormatterGetTypeID(), size, NULL);
+    if (NULL == tmpl) return;
+    tmpl->_locale = (CFLocaleRef)CFRetain(formatter->_locale);
+    tmpl->_style = formatter->_style;
+    if (!__CFNumberFormatterCopyTemplate(tmpl, formatter)) {
+        CFRelease(tmpl);
+        return;
+    }
+    __CFLock(&__CFNumberFormatterCacheLock);
+    CFNumberFormatterRef old = __CFNumberFormatterCache[__CFNumberFormatterCacheNext];
+    __CFNumberFormatterCache[__CFNumberFormatterCacheNext] = tmpl;
+    __CFNumberFormatterCacheNext = (__CFNumberFormatterCacheNext + 1) % __kCFNumberFormatterCacheSize;
+    __CFUnlock(&__CFNumberFormatterCacheLock);
+    if (old) CFRelease(old);
+}
+
+CF_PRIVATE void __CFNumberFormatterFlushCache(void) {
+    CFNumberFormatterRef old[__kCFNumberFormatterCacheSize];
+    __CFLock(&__CFNumberFormatterCacheLock);
+    for (CFIndex idx = 0; idx < __kCFNumberFormatterCacheSize; idx++) {
+        old[idx] = __CFNumberFormatterCache[idx];
+        __CFNumberFormatterCache[idx] = NULL;
+    }
+    __CFNumberFormatterCacheNext = 0;
+    __CFUnlock(&__CFNumberFormatterCacheLock);
+    for (CFIndex idx = 0; idx < __kCFNumberFormatterCacheSize; idx++) {
+        if (old[idx]) CFRelease(old[idx]);
+    }
+}
+
+void _CFNumberFormatterGetCacheStatistics(CFIndex *hits, CFIndex *misses) {
+    __CFLock(&__CFNumberFormatterCacheLock);
+    if (hits) *hits = __CFNumberFormatterCacheHits;
+    if (misses) *misses = __CFNumberFormatterCacheMisses;
+    __CFUnlock(&__CFNumberFormatterCacheLock);
+}
+
 CFNumberFormatterRef CFNumberFormatterCreate(CFAllocatorRef allocator, CFLocaleRef locale, CFNumberFormatterStyle style) {
     struct __CFNumberFormatter *memory;
     uint32_t size = sizeof(struct __CFNumberFormatter) - sizeof(CFRuntimeBase);
@@ -132,6 +226,10 @@ CFNumberFormatterRef CFNumberFormatterCreate(CFAllocatorRef allocator, CFLocaleR
 	memory->_style = kCFNumberFormatterDecimalStyle;
 	break;
     }
+    memory->_locale = CFLocaleCreateCopy(allocator, locale);
+    if (__CFNumberFormatterCopyFromCache(memory)) {
+        return (CFNumberFormatterRef)memory;
+    }
     CFStringRef localeName = locale ? CFLocaleGetIdentifier(locale) : CFSTR("");
     char buffer[BUFFER_SIZE];
     const char *cstr = CFStringGetCStringPtr(localeName, kCFStringEncodingASCII);
@@ -157,7 +255,6 @@ CFNumberFormatterRef CFNumberFormatterCreate(CFAllocatorRef allocator, CFLocaleR
 	__cficu_unum_setAttribute(memory->_nf, UNUM_MAX_INTEGER_DIGITS, 42);
 	__cficu_unum_setAttribute(memory->_nf, UNUM_MAX_FRACTION_DIGITS, 0);
     }
-    memory->_locale = locale ? CFLocaleCreateCopy(allocator, locale) : CFLocaleGetSystem();
     __CFNumberFormatterCustomize(memory);
     if (kCFNumberFormatterSpellOutStyle != memory->_style && kCFNumberFormatterOrdinalStyle != memory->_style && kCFNumberFormatterDurationStyle != memory->_style) {
 	UChar ubuffer[BUFFER_SIZE];
@@ -178,6 +275,7 @@ CFNumberFormatterRef CFNumberFormatterCreate(CFAllocatorRef allocator, CFLocaleR
     }
     __cficu_unum_setAttribute(memory->_nf, UNUM_LENIENT_PARSE, 0);
     __cficu_unum_setContext(memory->_nf, UDISPCTX_CAPITALIZATION_NONE, &status);
+    __CFNumberFormatterAddToCache(memory);
     return (CFNumberFormatterRef)memory;
 }
 
@@ -307,6 +405,7 @@ static void __CFNumberFormatterApplySymbolPrefs(const void *key, const void *val
 
 // Should not be called for rule-based ICU formatters
 static UErrorCode __CFNumberFormatterApplyPattern(CFNumberFormatterRef formatter, CFStringRef pattern) {
+    formatter->_simple._state = 0;
     if (kCFNumberFormatterSpellOutStyle == formatter->_style) return U_UNSUPPORTED_ERROR;
     if (kCFNumberFormatterOrdinalStyle == formatter->_style) return U_UNSUPPORTED_ERROR;
     if (kCFNumberFormatterDurationStyle == formatter->_style) return U_UNSUPPORTED_ERROR;
@@ -466,11 +565,182 @@ CFStringRef CFNumberFormatterCreateStringWithNumber(CFAllocatorRef allocator, CF
             used = __cficu_unum_formatDecimal(formatter->_nf, buffer, strlen(buffer), ustr + 1, cnt, NULL, &status);            \
         }                                                           \
 
+/* Plain decimal numbers.
+ *
+ * A decimal or unstyled formatter whose ICU settings come down to an
+ * optional '-', ASCII digits and a '.' (no affixes, padding, exponent,
+ * significant digits or rounding increment, and no grouping separator in
+ * the number at hand) formats and parses such numbers without calling ICU.
+ * Doubles are only handled when their rounded decimal form converts back to
+ * exactly the same double, which keeps them well away from rounding ties, so
+ * the result is the same as ICU's. The en_US_POSIX locale is the usual case.
+ */
+
+static Boolean __CFNumberFormatterTextAttributeIs(CFNumberFormatterRef formatter, UNumberFormatTextAttribute attr, const char *expected) {
+    UChar ubuffer[8];
+    UErrorCode status = U_ZERO_ERROR;
+    int32_t len = __cficu_unum_getTextAttribute(formatter->_nf, attr, ubuffer, 8, &status);
+    if (U_FAILURE(status) || len != (int32_t)strlen(expected)) return false;
+    for (int32_t idx = 0; idx < len; idx++) {
+        if (ubuffer[idx] != (UChar)expected[idx]) return false;
+    }
+    return true;
+}
+
+static Boolean __CFNumberFormatterSymbolIs(CFNumberFormatterRef formatter, UNumberFormatSymbol symbol, UChar expected) {
+    UChar ubuffer[8];
+    UErrorCode status = U_ZERO_ERROR;
+    int32_t len = __cficu_unum_getSymbol(formatter->_nf, symbol, ubuffer, 8, &status);
+    return U_SUCCESS(status) && 1 == len && expected == ubuffer[0];
+}
+
+static void __CFNumberFormatterUpdateSimpleDecimal(CFNumberFormatterRef formatter) {
+    UNumberFormat *nf = formatter->_nf;
+    formatter->_simple._state = 1;
+    if (kCFNumberFormatterDecimalStyle != formatter->_style && kCFNumberFormatterNoStyle != formatter->_style) return;
+    if (formatter->_usesCharacterDirection && CFLocaleGetLanguageCharacterDirection(CFLocaleGetIdentifier(formatter->_locale)) == kCFLocaleLanguageDirectionRightToLeft) return;
+    if (__cficu_unum_getAttribute(nf, UNUM_SIGNIFICANT_DIGITS_USED) || __cficu_unum_getAttribute(nf, UNUM_DECIMAL_ALWAYS_SHOWN) || __cficu_unum_getAttribute(nf, UNUM_FORMAT_WIDTH)) return;
+    if (1 != __cficu_unum_getAttribute(nf, UNUM_MULTIPLIER) || 0.0 != __cficu_unum_getDoubleAttribute(nf, UNUM_ROUNDING_INCREMENT)) return;
+    switch (__cficu_unum_getAttribute(nf, UNUM_ROUNDING_MODE)) {
+    case UNUM_ROUND_HALFEVEN: case UNUM_ROUND_HALFDOWN: case UNUM_ROUND_HALFUP: break;
+    default: return;
+    }
+    int32_t minInt = __cficu_unum_getAttribute(nf, UNUM_MIN_INTEGER_DIGITS);
+    int32_t maxInt = __cficu_unum_getAttribute(nf, UNUM_MAX_INTEGER_DIGITS);
+    int32_t minFrac = __cficu_unum_getAttribute(nf, UNUM_MIN_FRACTION_DIGITS);
+    int32_t maxFrac = __cficu_unum_getAttribute(nf, UNUM_MAX_FRACTION_DIGITS);
+    int32_t groupingSize = __cficu_unum_getAttribute(nf, UNUM_GROUPING_USED) ? __cficu_unum_getAttribute(nf, UNUM_GROUPING_SIZE) : 0;
+    if (minInt < 0 || 20 < minInt || maxInt < minInt || minFrac < 0 || maxFrac < minFrac || 15 < maxFrac || groupingSize < 0) return;
+    if (__cficu_unum_getAttribute(nf, UNUM_GROUPING_USED) && 0 == groupingSize) return;
+    if (!__CFNumberFormatterTextAttributeIs(formatter, UNUM_POSITIVE_PREFIX, "") || !__CFNumberFormatterTextAttributeIs(formatter, UNUM_POSITIVE_SUFFIX, "")) return;
+    if (!__CFNumberFormatterTextAttributeIs(formatter, UNUM_NEGATIVE_PREFIX, "-") || !__CFNumberFormatterTextAttributeIs(formatter, UNUM_NEGATIVE_SUFFIX, "")) return;
+    if (!__CFNumberFormatterSymbolIs(formatter, UNUM_DECIMAL_SEPARATOR_SYMBOL, '.') || !__CFNumberFormatterSymbolIs(formatter, UNUM_ZERO_DIGIT_SYMBOL, '0') || !__CFNumberFormatterSymbolIs(formatter, UNUM_MINUS_SIGN_SYMBOL, '-')) return;
+    // the affixes are plain, so anything else in the pattern (an exponent, say) shows up as an unexpected character
+    UChar ubuffer[BUFFER_SIZE];
+    UErrorCode status = U_ZERO_ERROR;
+    int32_t len = __cficu_unum_toPattern(nf, false, ubuffer, BUFFER_SIZE, &status);
+    if (U_FAILURE(status) || BUFFER_SIZE < len) return;
+    for (int32_t idx = 0; idx < len; idx++) {
+        if (0 == ubuffer[idx] || 0x80 <= ubuffer[idx] || !strchr("#0123456789,.;-", (char)ubuffer[idx])) return;
+    }
+    formatter->_simple._minInt = minInt;
+    formatter->_simple._maxInt = maxInt;
+    formatter->_simple._minFrac = minFrac;
+    formatter->_simple._maxFrac = maxFrac;
+    formatter->_simple._groupingSize = groupingSize;
+    formatter->_simple._state = 2;
+}
+
+CF_INLINE Boolean __CFNumberFormatterUsesSimpleDecimal(CFNumberFormatterRef formatter) {
+    if (0 == formatter->_simple._state) __CFNumberFormatterUpdateSimpleDecimal(formatter);
+    return 2 == formatter->_simple._state;
+}
+
+static const uint64_t __CFNumberFormatterPowersOf10[16] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL, 1000000000000000ULL};
+
+static CFStringRef __CFNumberFormatterCreateSimpleDecimalString(CFAllocatorRef allocator, CFNumberFormatterRef formatter, CFNumberType numberType, const void *valuePtr) {
+    Boolean negative = false, isFloat = false;
+    uint64_t intPart = 0, fracPart = 0;
+    int32_t fracDigits = formatter->_simple._minFrac;
+    double dvalue = 0.0;
+    int64_t ivalue = 0;
+    switch (numberType) {
+    case kCFNumberFloat64Type: case kCFNumberDoubleType: dvalue = *(double *)valuePtr; isFloat = true; break;
+    case kCFNumberFloat32Type: case kCFNumberFloatType: dvalue = *(float *)valuePtr; isFloat = true; break;
+    case kCFNumberSInt64Type: case kCFNumberLongLongType: ivalue = *(int64_t *)valuePtr; break;
+#if __LP64__
+    case kCFNumberLongType: case kCFNumberCFIndexType: ivalue = *(int64_t *)valuePtr; break;
+#else
+    case kCFNumberLongType: case kCFNumberCFIndexType: ivalue = *(int32_t *)valuePtr; break;
+#endif
+    case kCFNumberSInt32Type: case kCFNumberIntType: ivalue = *(int32_t *)valuePtr; break;
+    case kCFNumberSInt16Type: case kCFNumberShortType: ivalue = *(int16_t *)valuePtr; break;
+    case kCFNumberSInt8Type: case kCFNumberCharType: ivalue = *(int8_t *)valuePtr; break;
+    default: return NULL;
+    }
+    if (isFloat) {
+        // zero (with its sign), NaN and infinity are left to ICU
+        if (0.0 == dvalue || !isfinite(dvalue)) return NULL;
+        int32_t maxFrac = formatter->_simple._maxFrac;
+        double scale = (double)__CFNumberFormatterPowersOf10[maxFrac];
+        double magnitude = fabs(dvalue);
+        if ((double)__CFNumberFormatterPowersOf10[15 - maxFrac] <= magnitude) return NULL;
+        // The nearest multiple of 10^-maxFrac; if it converts back to the same double, no rounding was needed
+        uint64_t scaled = (uint64_t)llround(magnitude * scale);
+        if ((double)scaled / scale != magnitude) return NULL;
+        negative = (dvalue < 0.0);
+        intPart = scaled / __CFNumberFormatterPowersOf10[maxFrac];
+        fracPart = scaled % __CFNumberFormatterPowersOf10[maxFrac];
+        fracDigits = maxFrac;
+        while (formatter->_simple._minFrac < fracDigits && 0 == fracPart % 10) {
+            fracPart /= 10;
+            fracDigits--;
+        }
+    } else {
+        if (0 == ivalue && formatter->_zeroSym) return NULL;
+        negative = (ivalue < 0);
+        intPart = negative ? (0 - (uint64_t)ivalue) : (uint64_t)ivalue;
+    }
+
+    char buffer[64], digits[24];
+    int32_t intDigits = 0;
+    for (uint64_t rest = intPart; 0 != rest; rest /= 10) digits[intDigits++] = '0' + (char)(rest % 10);
+    while (intDigits < formatter->_simple._minInt) digits[intDigits++] = '0';
+    if (formatter->_simple._maxInt < intDigits) return NULL;
+    if (0 < formatter->_simple._groupingSize && formatter->_simple._groupingSize < intDigits) return NULL;
+    char *ptr = buffer;
+    if (negative) *ptr++ = '-';
+    while (0 < intDigits) *ptr++ = digits[--intDigits];
+    if (0 < fracDigits) {
+        *ptr++ = '.';
+        for (int32_t idx = fracDigits - 1; 0 <= idx; idx--) {
+            ptr[idx] = '0' + (char)(fracPart % 10);
+            fracPart /= 10;
+        }
+        ptr += fracDigits;
+    } else if (ptr == buffer + (negative ? 1 : 0)) {
+        *ptr++ = '0';
+    }
+    return CFStringCreateWithBytes(allocator, (const UInt8 *)buffer, ptr - buffer, kCFStringEncodingASCII, false);
+}
+
+// Copies -?[0-9]+(.[0-9]+)? covering the whole of ustr into buffer; returns its length, or 0 if ustr is anything else
+static int32_t __CFNumberFormatterCopySimpleDecimal(CFNumberFormatterRef formatter, const UChar *ustr, CFIndex length, Boolean integerOnly, char *buffer, CFIndex bufferSize) {
+    CFIndex idx = 0, intDigits = 0, fracDigits = 0;
+    if (length <= 0 || bufferSize <= length) return 0;
+    if ('-' == ustr[idx]) buffer[idx++] = '-';
+    while (idx < length && '0' <= ustr[idx] && ustr[idx] <= '9') {
+        buffer[idx] = (char)ustr[idx];
+        idx++;
+        intDigits++;
+    }
+    if (0 == intDigits) return 0;
+    if (idx < length && '.' == ustr[idx]) {
+        // ICU's handling of a decimal point in integer-only parsing, or with a pattern that has none, is left to ICU
+        if (integerOnly || 0 == formatter->_simple._maxFrac) return 0;
+        buffer[idx] = '.';
+        idx++;
+        while (idx < length && '0' <= ustr[idx] && ustr[idx] <= '9') {
+            buffer[idx] = (char)ustr[idx];
+            idx++;
+            fracDigits++;
+        }
+        if (0 == fracDigits) return 0;
+    }
+    if (idx != length) return 0;
+    buffer[idx] = '\0';
+    return (int32_t)idx;
+}
+
 CFStringRef CFNumberFormatterCreateStringWithValue(CFAllocatorRef allocator, CFNumberFormatterRef formatter, CFNumberType numberType, const void *valuePtr) {
     if (allocator == NULL) allocator = __CFGetDefaultAllocator();
     __CFGenericValidateType(allocator, CFAllocatorGetTypeID());
     __CFGenericValidateType(formatter, CFNumberFormatterGetTypeID());
     GET_MULTIPLIER;
+    if (1.0 == multiplier && __CFNumberFormatterUsesSimpleDecimal(formatter)) {
+        CFStringRef string = __CFNumberFormatterCreateSimpleDecimalString(allocator, formatter, numberType, valuePtr);
+        if (string) return string;
+    }
     UChar *ustr = NULL, ubuffer[BUFFER_SIZE + 1];
     UErrorCode status = U_ZERO_ERROR;
     CFIndex used, cnt = BUFFER_SIZE;
@@ -670,7 +940,12 @@ Boolean CFNumberFormatterGetValueFromString(CFNumberFormatterRef formatter, CFSt
     } else {
 	char buffer[1024];
         memset(buffer, 0, sizeof(buffer));
-	int32_t len = __cficu_unum_parseDecimal(formatter->_nf, ustr, range.length, &dpos, buffer, sizeof(buffer), &status);
+	int32_t len = 0;
+	if (!formatter->_isLenient && __CFNumberFormatterUsesSimpleDecimal(formatter)) {
+	    len = __CFNumberFormatterCopySimpleDecimal(formatter, ustr, range.length, integerOnly, buffer, sizeof(buffer));
+	    dpos = len;
+	}
+	if (0 == len) len = __cficu_unum_parseDecimal(formatter->_nf, ustr, range.length, &dpos, buffer, sizeof(buffer), &status);
         if (!U_FAILURE(status) && 0 < len && integerOnly) {
 	    char *endptr = NULL;
 	    errno = 0;
@@ -767,6 +1042,7 @@ void CFNumberFormatterSetProperty(CFNumberFormatterRef formatter, CFStringRef ke
     CFIndex cnt;
     __CFGenericValidateType(formatter, CFNumberFormatterGetTypeID());
     __CFGenericValidateType(key, CFStringGetTypeID());
+    formatter->_simple._state = 0;
     // rule-based formatters don't do attributes and symbols, except for one
     if (CFEqual(kCFNumberFormatterFormattingContextKey, key)) {
         __CFGenericValidateType(value, CFNumberGetTypeID());
@@ -46,6 +46,9 @@ CF_INLINE void __CFPListRelease(CFTypeRef cf, CFAllocatorRef allocator) {
 }
 
 CF_PRIVATE CFErrorRef __CFPropertyListCreateError(CFIndex code, CFStringRef debugString, ...);
+CF_PRIVATE void __CFPropertyListCreateSplitKeypaths(CFAllocatorRef allocator, CFSetRef currentKeys, CFSetRef *theseKeys, CFSetRef *nextKeys);
+CF_PRIVATE CFIndex __CFPropertyListCreateKeypathIndexes(CFAllocatorRef allocator, CFSetRef theseKeys, CFIndex **indexes);
+CF_PRIVATE Boolean __CFPropertyListKeypathIndexesContain(const CFIndex *indexes, CFIndex indexCount, CFIndex *cursor, CFIndex idx);
 
 typedef struct {
     const UniChar *begin;
@@ -55,6 +58,7 @@ typedef struct {
     CFAllocatorRef allocator;
     UInt32 mutabilityOption;
     CFMutableSetRef stringSet;  // set of all strings involved in this parse; allows us to share non-mutable strings in the returned plist
+    CFSetRef keyPaths; // split key paths (a set of arrays) for the current level; if NULL, no filtering
 } _CFStringsFileParseInfo;
 
 // warning: doesn't have a good idea of Unicode line separators
@@ -75,6 +79,7 @@ static UInt32 lineNumberStrings(_CFStringsFileParseInfo *pInfo) {
 }
 
 static CFTypeRef parsePlistObject(_CFStringsFileParseInfo *pInfo, bool requireObject);
+static Boolean skipPlistObject(_CFStringsFileParseInfo *pInfo, bool requireObject);
 
 #define isValidUnquotedStringCharacter(x) (((x) >= 'a' && (x) <= 'z') || ((x) >= 'A' && (x) <= 'Z') || ((x) >= '0' && (x) <= '9') || (x) == '_' || (x) == '$' || (x) == '/' || (x) == ':' || (x) == '.' || (x) == '-')
 
@@ -310,28 +315,43 @@ static CFStringRef parsePlistString(_CFStringsFileParseInfo *pInfo, bool require
 
 static CFTypeRef parsePlistArray(_CFStringsFileParseInfo *pInfo) {
     CFMutableArrayRef array = CFArrayCreateMutable(pInfo->allocator, 0, &kCFTypeArrayCallBacks);
-    CFTypeRef tmp = parsePlistObject(pInfo, false);
+    CFSetRef oldKeyPaths = pInfo->keyPaths;
+    CFSetRef theseKeyPaths, nextKeyPaths;
+    __CFPropertyListCreateSplitKeypaths(pInfo->allocator, pInfo->keyPaths, &theseKeyPaths, &nextKeyPaths);
+    CFIndex *indexes = NULL, indexCount = 0, cursor = 0, count = 0;
+    if (theseKeyPaths) indexCount = __CFPropertyListCreateKeypathIndexes(pInfo->allocator, theseKeyPaths, &indexes);
     Boolean foundChar;
-    while (tmp) {
-        CFArrayAppendValue(array, tmp);
-        __CFPListRelease(tmp, pInfo->allocator);
+    while (true) {
+        if (theseKeyPaths && !__CFPropertyListKeypathIndexesContain(indexes, indexCount, &cursor, count)) {
+            if (!skipPlistObject(pInfo, false)) break;
+        } else {
+            if (theseKeyPaths) pInfo->keyPaths = nextKeyPaths;
+            CFTypeRef tmp = parsePlistObject(pInfo, false);
+            pInfo->keyPaths = oldKeyPaths;
+            if (!tmp) break;
+            CFArrayAppendValue(array, tmp);
+            __CFPListRelease(tmp, pInfo->allocator);
+        }
+        count ++;
         foundChar = advanceToNonSpace(pInfo);
 	if (!foundChar) {
 	    __CFPListRelease(array, pInfo->allocator);
+            array = NULL;
 	    pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Expected ',' for array at line %d"), lineNumberStrings(pInfo));
-	    return NULL;
+	    break;
 	}
-        if (*pInfo->curr != ',') {
-            tmp = NULL;
-        } else {
-            pInfo->curr ++;
-            tmp = parsePlistObject(pInfo, false);
-        }
+        if (*pInfo->curr != ',') break;
+        pInfo->curr ++;
     }
+    __CFPListRelease(theseKeyPaths, pInfo->allocator);
+    __CFPListRelease(nextKeyPaths, pInfo->allocator);
+    if (indexes) CFAllocatorDeallocate(pInfo->allocator, indexes);
+    if (!array) return NULL;
     foundChar = advanceToNonSpace(pInfo);
     if (!foundChar || *pInfo->curr != ')') {
         __CFPListRelease(array, pInfo->allocator);
-        pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Expected terminating ')' for array at line %d"), lineNumberStrings(pInfo));
+        // An element that failed to parse has already said why
+        if (!pInfo->error) pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Expected terminating ')' for array at line %d"), lineNumberStrings(pInfo));
         return NULL;
     }
     if (pInfo->error) {
@@ -354,9 +374,13 @@ static CFDictionaryRef parsePlistDictContent(_CFStringsFileParseInfo *pInfo) {
     CFMutableDictionaryRef dict = CFDictionaryCreateMutable(pInfo->allocator, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
     CFStringRef key = NULL;
     Boolean failedParse = false;
+    CFSetRef oldKeyPaths = pInfo->keyPaths;
+    CFSetRef theseKeyPaths, nextKeyPaths;
+    __CFPropertyListCreateSplitKeypaths(pInfo->allocator, pInfo->keyPaths, &theseKeyPaths, &nextKeyPaths);
     key = parsePlistString(pInfo, false);
     while (key) {
-        CFTypeRef value;
+        CFTypeRef value = NULL;
+        Boolean wanted = !theseKeyPaths || CFSetContainsValue(theseKeyPaths, key);
         Boolean foundChar = advanceToNonSpace(pInfo);
         if (!foundChar) {
             UInt32 line = lineNumberStrings(pInfo);
@@ -369,20 +393,30 @@ static CFDictionaryRef parsePlistDictContent(_CFStringsFileParseInfo *pInfo) {
 	if (*pInfo->curr == ';') {
 	    /* This is a strings file using the shortcut format */
 	    /* although this check here really applies to all plists. */
-	    value = CFRetain(key);
+	    if (wanted) value = CFRetain(key);
 	} else if (*pInfo->curr == '=') {
 	    pInfo->curr ++;
-	    value = parsePlistObject(pInfo, true);
-	    if (!value) {
-		failedParse = true;
-		break;
+	    if (!wanted) {
+		// Not on any of the requested key paths; step over the value without creating it
+		if (!skipPlistObject(pInfo, true)) {
+		    failedParse = true;
+		    break;
+		}
+	    } else {
+		if (theseKeyPaths) pInfo->keyPaths = nextKeyPaths;
+		value = parsePlistObject(pInfo, true);
+		pInfo->keyPaths = oldKeyPaths;
+		if (!value) {
+		    failedParse = true;
+		    break;
+		}
 	    }
 	} else {
             pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Unexpected ';' or '=' after key at line %d"), lineNumberStrings(pInfo));
 	    failedParse = true;
 	    break;
 	}
-	CFDictionarySetValue(dict, key, value);
+	if (value) CFDictionarySetValue(dict, key, value);
 	__CFPListRelease(key, pInfo->allocator);
 	key = NULL;
 	__CFPListRelease(value, pInfo->allocator);
@@ -398,6 +432,8 @@ static CFDictionaryRef parsePlistDictContent(_CFStringsFileParseInfo *pInfo) {
 	    pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Missing ';' on line %d"), line);
 	}
     }
+    __CFPListRelease(theseKeyPaths, pInfo->allocator);
+    __CFPListRelease(nextKeyPaths, pInfo->allocator);
     
     if (failedParse) {
         __CFPListRelease(key, pInfo->allocator);
@@ -498,6 +534,169 @@ static CFTypeRef parsePlistData(_CFStringsFileParseInfo *pInfo) {
 }
 #undef numBytes
 
+/* The skip functions below step over what the matching parse function would read, for values which are not on any of the requested key paths. They apply the same grammar and leave the cursor and pInfo->error as the parse function would, so a plist that fails to parse also fails when filtered, but they create no objects. */
+
+static Boolean skipQuotedPlistString(_CFStringsFileParseInfo *pInfo, UniChar quote) {
+    const UniChar *startMark = pInfo->curr;
+    while (pInfo->curr < pInfo->end) {
+	UniChar ch = *(pInfo->curr);
+        if (ch == quote) break;
+        pInfo->curr ++;
+        if (ch == '\\') getSlashedChar(pInfo);
+    }
+    if (pInfo->end <= pInfo->curr) {
+        pInfo->curr = startMark;
+        pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Unterminated quoted string starting on line %d"), lineNumberStrings(pInfo));
+        return false;
+    }
+    pInfo->curr ++;  // Advance past the quote character before returning.
+    if (pInfo->error) {
+        CFRelease(pInfo->error);
+        pInfo->error = NULL;
+    }
+    return true;
+}
+
+static Boolean skipPlistString(_CFStringsFileParseInfo *pInfo, bool requireObject) {
+    Boolean foundChar = advanceToNonSpace(pInfo);
+    if (!foundChar) {
+        if (requireObject) {
+            pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Unexpected EOF while parsing string"));
+        }
+        return false;
+    }
+    UniChar ch = *(pInfo->curr);
+    if (ch == '\'' || ch == '\"') {
+        pInfo->curr ++;
+        return skipQuotedPlistString(pInfo, ch);
+    } else if (isValidUnquotedStringCharacter(ch)) {
+        while (pInfo->curr < pInfo->end && isValidUnquotedStringCharacter(*(pInfo->curr))) pInfo->curr ++;
+        return true;
+    } else {
+        if (requireObject) {
+            pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Invalid string character at line %d"), lineNumberStrings(pInfo));
+        }
+        return false;
+    }
+}
+
+static Boolean skipPlistArray(_CFStringsFileParseInfo *pInfo) {
+    while (skipPlistObject(pInfo, false)) {
+        if (!advanceToNonSpace(pInfo)) {
+	    pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Expected ',' for array at line %d"), lineNumberStrings(pInfo));
+            return false;
+        }
+        if (*pInfo->curr != ',') break;
+        pInfo->curr ++;
+    }
+    if (!advanceToNonSpace(pInfo) || *pInfo->curr != ')') {
+        if (!pInfo->error) pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Expected terminating ')' for array at line %d"), lineNumberStrings(pInfo));
+        return false;
+    }
+    if (pInfo->error) {
+        CFRelease(pInfo->error);
+        pInfo->error = NULL;
+    }
+    pInfo->curr ++;
+    return true;
+}
+
+static Boolean skipPlistDict(_CFStringsFileParseInfo *pInfo) {
+    Boolean foundKey = skipPlistString(pInfo, false);
+    while (foundKey) {
+        Boolean foundChar = advanceToNonSpace(pInfo);
+        if (!foundChar) {
+            UInt32 line = lineNumberStrings(pInfo);
+            _CFPropertyListMissingSemicolonOrValue(line);
+            pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Missing ';' on line %d"), line);
+            return false;
+        }
+        if (*pInfo->curr == '=') {
+            pInfo->curr ++;
+            if (!skipPlistObject(pInfo, true)) return false;
+        } else if (*pInfo->curr != ';') {
+            pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Unexpected ';' or '=' after key at line %d"), lineNumberStrings(pInfo));
+            return false;
+        }
+        foundChar = advanceToNonSpace(pInfo);
+        if (!foundChar || *pInfo->curr != ';') {
+            UInt32 line = lineNumberStrings(pInfo);
+            _CFPropertyListMissingSemicolon(line);
+            pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Missing ';' on line %d"), line);
+            return false;
+        }
+        pInfo->curr ++;
+        foundKey = skipPlistString(pInfo, false);
+    }
+    if (pInfo->error) {
+        CFRelease(pInfo->error);
+        pInfo->error = NULL;
+    }
+    if (!advanceToNonSpace(pInfo) || *pInfo->curr != '}') {
+        pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Expected terminating '}' for dictionary at line %d"), lineNumberStrings(pInfo));
+        return false;
+    }
+    pInfo->curr ++;
+    return true;
+}
+
+static Boolean skipPlistData(_CFStringsFileParseInfo *pInfo) {
+    unsigned char bytes[400];
+    int numBytesRead;
+    do {
+        numBytesRead = getDataBytes(pInfo, bytes, sizeof(bytes));
+    } while (numBytesRead > 0);
+    if (numBytesRead < 0) {
+        if (-2 == numBytesRead) {
+            pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Malformed data byte group at line %d; uneven length"), lineNumberStrings(pInfo));
+        } else {
+            pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Malformed data byte group at line %d; invalid hex"), lineNumberStrings(pInfo));
+        }
+        return false;
+    }
+    if (pInfo->error) {
+        CFRelease(pInfo->error);
+        pInfo->error = NULL;
+    }
+    if (*(pInfo->curr) == '>') {
+        pInfo->curr ++; // Move past '>'
+        return true;
+    }
+    pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Expected terminating '>' for data at line %d"), lineNumberStrings(pInfo));
+    return false;
+}
+
+// Like parsePlistObject, returns false without an error if there is no object here and requireObject is false
+static Boolean skipPlistObject(_CFStringsFileParseInfo *pInfo, bool requireObject) {
+    Boolean foundChar = advanceToNonSpace(pInfo);
+    if (!foundChar) {
+        if (requireObject) {
+            pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Unexpected EOF while parsing plist"));
+        }
+        return false;
+    }
+    UniChar ch = *(pInfo->curr);
+    pInfo->curr ++;
+    if (ch == '{') {
+        return skipPlistDict(pInfo);
+    } else if (ch == '(') {
+        return skipPlistArray(pInfo);
+    } else if (ch == '<') {
+        return skipPlistData(pInfo);
+    } else if (ch == '\'' || ch == '\"') {
+        return skipQuotedPlistString(pInfo, ch);
+    } else if (isValidUnquotedStringCharacter(ch)) {
+        while (pInfo->curr < pInfo->end && isValidUnquotedStringCharacter(*(pInfo->curr))) pInfo->curr ++;
+        return true;
+    } else {
+        pInfo->curr --;  // Must back off the charcter we just read
+        if (requireObject) {
+            pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Unexpected character '0x%x' at line %d"), ch, lineNumberStrings(pInfo));
+        }
+        return false;
+    }
+}
+
 // Returned object is retained; caller must free.
 static CFTypeRef parsePlistObject(_CFStringsFileParseInfo *pInfo, bool requireObject) {
     UniChar ch;
@@ -530,9 +729,8 @@ static CFTypeRef parsePlistObject(_CFStringsFileParseInfo *pInfo, bool requireOb
     }
 }
 
-// CFAllocatorRef allocator, CFDataRef xmlData, CFStringRef originalString, CFStringEncoding guessedEncoding, CFOptionFlags option, CFErrorRef *outError, Boolean allowNewTypes, CFPropertyListFormat *format, CFSetRef keyPaths
-
-CF_PRIVATE CFTypeRef __CFCreateOldStylePropertyListOrStringsFile(CFAllocatorRef allocator, CFDataRef xmlData, CFStringRef originalString, CFStringEncoding guessedEncoding, CFOptionFlags option, CFErrorRef *outError,CFPropertyListFormat *format) {
+// keyPaths is the set of already-split key paths (arrays of CFStrings) to decode; if NULL, all objects are decoded
+CF_PRIVATE CFTypeRef __CFCreateOldStylePropertyListOrStringsFile(CFAllocatorRef allocator, CFDataRef xmlData, CFStringRef originalString, CFStringEncoding guessedEncoding, CFOptionFlags option, CFErrorRef *outError, CFPropertyListFormat *format, CFSetRef keyPaths) {
     
     // Convert the string to UTF16 for parsing old-style
     if (originalString) {
@@ -573,6 +771,7 @@ CF_PRIVATE CFTypeRef __CFCreateOldStylePropertyListOrStringsFile(CFAllocatorRef
     stringsPInfo.allocator = allocator;
     stringsPInfo.mutabilityOption = option;
     stringsPInfo.stringSet = CFSetCreateMutable(allocator, 0, &kCFTypeSetCallBacks);
+    stringsPInfo.keyPaths = keyPaths;
     stringsPInfo.error = NULL;
     
     const UniChar *begin = stringsPInfo.curr;
@@ -576,6 +576,32 @@ CF_PRIVATE Boolean _CFSynchronizeDomainCache(void) {
     return result;
 }
 
+typedef struct {
+    void *domainStorage;
+    CFPreferencesDomainRef domain;
+} __CFPreferencesStorageLookup;
+
+static void __CFPreferencesFindDomainForStorage(const void *key, const void *value, void *context) {
+    CFPreferencesDomainRef domain = (CFPreferencesDomainRef)value;
+    __CFPreferencesStorageLookup *lookup = (__CFPreferencesStorageLookup *)context;
+    if (!lookup->domain && domain->_domain == lookup->domainStorage) lookup->domain = domain;
+}
+
+// Called when a domain's backing file is seen to change on disk; domainStorage is the domain's _domain
+CF_PRIVATE void _CFPreferencesDomainStorageHasChanged(void *domainStorage) {
+    __CFPreferencesStorageLookup lookup = {domainStorage, NULL};
+    __CFLock(&domainCacheLock);
+    if (domainCache) {
+        CFDictionaryApplyFunction(domainCache, __CFPreferencesFindDomainForStorage, &lookup);
+        if (lookup.domain) CFRetain(lookup.domain);
+    }
+    __CFUnlock(&domainCacheLock);
+    if (lookup.domain) {
+        _CFApplicationPreferencesDomainHasChanged(lookup.domain);
+        CFRelease(lookup.domain);
+    }
+}
+
 CF_PRIVATE void _CFPreferencesPurgeDomainCache(void) {
     _CFSynchronizeDomainCache();
     __CFLock(&domainCacheLock);
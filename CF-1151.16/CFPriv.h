@@ -40,6 +40,7 @@
 #include <CoreFoundation/CFLocale.h>
 #include <CoreFoundation/CFDate.h>
 #include <CoreFoundation/CFSet.h>
+#include <CoreFoundation/CFRunLoop.h>
 #include <math.h>
 
 
@@ -70,6 +71,20 @@ CF_EXPORT const char **_CFGetProgname(void);
 CF_EXPORT void _CFRunLoopSetCurrent(CFRunLoopRef rl);
 #endif
 
+// Callout profiling for a run loop. While enabled, every observer, timer, source, block and main queue callout the run loop makes is timed and aggregated by callout function and info pointer, along with the time spent asleep and the reason for each wakeup. The cost when disabled is a pointer test per callout. Enabling or disabling keeps the statistics gathered so far; _CFRunLoopResetProfile() clears them.
+CF_EXPORT void _CFRunLoopSetProfilingEnabled(CFRunLoopRef rl, Boolean enabled) CF_AVAILABLE(10_10, 8_0);
+CF_EXPORT void _CFRunLoopResetProfile(CFRunLoopRef rl) CF_AVAILABLE(10_10, 8_0);
+
+// Returns NULL if profiling was never enabled for the run loop. Otherwise returns a dictionary with:
+//   "callouts": an array of dictionaries with "kind" (observer, timer, source0, source1, block or mainQueue), "function" and "info" (addresses as CFNumbers), "count", and "totalTime" and "maxTime" (seconds). Times include any nested runs of the run loop made from the callout.
+//   "workTime" and "sleepTime": seconds spent in outermost callouts and blocked waiting for a wakeup.
+//   "wakeUps": a dictionary of wakeup counts keyed by reason (nothing, wakeUp, timer, dispatch, source, timeout).
+//   "droppedCallouts": callouts that were not recorded because too many distinct callouts were seen.
+CF_EXPORT CFDictionaryRef _CFRunLoopCopyProfile(CFRunLoopRef rl) CF_AVAILABLE(10_10, 8_0);
+
+// Signals each of the version 0 sources and then wakes every run loop they are scheduled in, once per run loop rather than once per source. Sources that were already signalled are skipped, as whoever signalled them is expected to have woken their run loops.
+CF_EXPORT void _CFRunLoopSourcesSignalAndWakeUp(const CFRunLoopSourceRef *sources, CFIndex count) CF_AVAILABLE(10_10, 8_0);
+
 #if (TARGET_OS_MAC && !(TARGET_OS_EMBEDDED || TARGET_OS_IPHONE || TARGET_OS_LINUX)) || (TARGET_OS_EMBEDDED || TARGET_OS_IPHONE)
 CF_EXPORT CFRunLoopRef CFRunLoopGetMain(void);
 CF_EXPORT SInt32 CFRunLoopRunSpecific(CFRunLoopRef rl, CFStringRef modeName, CFTimeInterval seconds, Boolean returnAfterSourceHandled);
@@ -86,6 +101,13 @@ CF_EXPORT CFURLRef _CFURLCreateFromPropertyListRepresentation(CFAllocatorRef all
 
 CF_EXPORT void CFPreferencesFlushCaches(void);
 
+// Turns on write-behind for preferences when interval is positive: CFPreferencesSynchronize then queues dirty domains and writes them together as binary plists once interval seconds have passed. An interval of 0 writes synchronously again. fsyncWrites says whether each file written by write-behind is fsynced before it is renamed into place; synchronous writes are always fsynced. Queued changes are written when the process calls exit(); a process that ends any other way (_exit(), a crash, a signal) loses them unless it calls _CFPreferencesFlushPendingWrites() first.
+CF_EXPORT void _CFPreferencesSetWriteBehindInterval(CFTimeInterval interval, Boolean fsyncWrites) CF_AVAILABLE(10_10, 8_0);
+// Writes every domain queued by write-behind now; returns false if any write failed
+CF_EXPORT Boolean _CFPreferencesFlushPendingWrites(void) CF_AVAILABLE(10_10, 8_0);
+// Returns the bytes written to preference files and the bytes of changed keys and values that caused those writes, counted only while write-behind is on
+CF_EXPORT void _CFPreferencesGetWriteStatistics(uint64_t *bytesWritten, uint64_t *bytesChanged) CF_AVAILABLE(10_10, 8_0);
+
 
 
 #if TARGET_OS_WIN32
@@ -151,6 +173,10 @@ CFURLRef _CFURLCreateFromComponents(CFAllocatorRef alloc, CFURLComponentDecompos
 #define CFURLCopyComponents _CFURLCopyComponents
 #define CFURLCreateFromComponents _CFURLCreateFromComponents
 
+// Returns the URL string's bytes and the byte range of every CFURLComponentType (indexed by component - 1) without copying; FALSE if the string has no plain ASCII 8-bit storage
+CF_EXPORT
+Boolean _CFURLGetComponentByteRanges(CFURLRef url, const UInt8 **bytes, CFIndex *length, CFRange *ranges, CFRange *rangesIncludingSeparators) CF_AVAILABLE(10_10, 8_0);
+
 
 
 CF_EXPORT Boolean _CFStringGetFileSystemRepresentation(CFStringRef string, UInt8 *buffer, CFIndex maxBufLen);
@@ -569,8 +595,16 @@ typedef CFDataRef (*CFMessagePortCallBackEx)(CFMessagePortRef local, SInt32 msgi
 
 CF_EXPORT CFMessagePortRef _CFMessagePortCreateLocalEx(CFAllocatorRef allocator, CFStringRef name, Boolean perPID, uintptr_t unused, CFMessagePortCallBackEx callout2, CFMessagePortContext *context, Boolean *shouldFreeInfo);
 
+// Lets clients in other processes send payloads of at least minBytes to local through shared memory instead of Mach messages, or stops accepting new clients if minBytes is 0. The callout then sees request data in memory the client can still write to.
+CF_EXPORT void _CFMessagePortSetSharedMemoryThreshold(CFMessagePortRef local, CFIndex minBytes) CF_AVAILABLE(10_10, 8_0);
+
 #endif
 
+#include <CoreFoundation/CFSocket.h>
+
+// Sends the concatenation of the given datas as a single write, without first copying them into one buffer. For connection-oriented sockets partial writes are continued until everything has been sent or an error occurs; for datagram sockets the datas form one datagram.
+CF_EXPORT CFSocketError _CFSocketSendDataVector(CFSocketRef s, CFDataRef address, const CFDataRef *datas, CFIndex count, CFTimeInterval timeout) CF_AVAILABLE(10_10, 8_0);
+
 #if TARGET_OS_MAC || TARGET_OS_EMBEDDED || TARGET_OS_IPHONE || TARGET_OS_LINUX
 #include <pthread.h>
 #else
@@ -602,6 +636,55 @@ CF_INLINE struct timespec _CFFileTimeSpecFromAbsoluteTime(CFAbsoluteTime at) {
    return ts;
 }
 
+// Returns the contents of a file as a CFData backed by a read-only memory mapping, which is unmapped when the data is deallocated. This avoids reading large files into memory up front, but the file must not be truncated or rewritten in place while the data is in use. Files shorter than mapThreshold bytes, and empty files, are read rather than mapped; a mapThreshold of 0 maps any non-empty file. Returns NULL if the file cannot be read.
+CF_EXPORT CFDataRef _CFDataCreateWithMappedFile(CFAllocatorRef allocator, CFURLRef url, CFIndex mapThreshold) CF_AVAILABLE(10_10, 8_0);
+
+// Like CFURLCreateDataAndPropertiesFromResource(), except that a file: URL whose file is at least mapThreshold bytes long has its data returned as by _CFDataCreateWithMappedFile(), with the same caveat about truncating the file. A mapThreshold of 0 never maps, which is what CFURLCreateDataAndPropertiesFromResource() does.
+CF_EXPORT Boolean _CFURLCreateDataAndPropertiesFromResourceMappingData(CFAllocatorRef alloc, CFURLRef url, CFDataRef *fetchedData, CFDictionaryRef *fetchedProperties, CFArrayRef desiredProperties, CFIndex mapThreshold, SInt32 *errorCode) CF_AVAILABLE(10_10, 8_0);
+
+#include <CoreFoundation/CFBinaryHeap.h>
+
+// Creates a mutable heap holding the given values, ordering them in O(n) rather than adding them one at a time.
+CF_EXPORT CFBinaryHeapRef _CFBinaryHeapCreateWithValues(CFAllocatorRef allocator, const void **values, CFIndex numValues, const CFBinaryHeapCallBacks *callBacks, const CFBinaryHeapCompareContext *compareContext) CF_AVAILABLE(10_10, 8_0);
+
+// Positions let a value be found in the heap again without searching for it. Once a position callback is set, it is called with a value's new position whenever the value is added to or moves within the heap, and with kCFNotFound when it is removed; the info passed is the compare context's info. Callers typically store the position in the value itself. After changing the value's ordering key in place (in either direction), call _CFBinaryHeapValueChangedAtPosition() to restore the heap order.
+typedef void (*_CFBinaryHeapPositionCallBack)(const void *value, CFIndex position, void *info);
+CF_EXPORT void _CFBinaryHeapSetPositionCallBack(CFBinaryHeapRef heap, _CFBinaryHeapPositionCallBack callBack) CF_AVAILABLE(10_10, 8_0);
+CF_EXPORT const void *_CFBinaryHeapGetValueAtPosition(CFBinaryHeapRef heap, CFIndex position) CF_AVAILABLE(10_10, 8_0);
+CF_EXPORT void _CFBinaryHeapValueChangedAtPosition(CFBinaryHeapRef heap, CFIndex position) CF_AVAILABLE(10_10, 8_0);
+CF_EXPORT void _CFBinaryHeapRemoveValueAtPosition(CFBinaryHeapRef heap, CFIndex position) CF_AVAILABLE(10_10, 8_0);
+
+// Calls the applier on the minimum, and then on each value below one for which the applier returned true; no value under one it returned false for is visited. Every value orders no earlier than those above it, so this finds, for instance, every value up to some bound without visiting the rest, in no particular order. The heap must not be changed until it returns.
+typedef Boolean (*_CFBinaryHeapSubheapApplierFunction)(const void *value, void *context);
+CF_EXPORT void _CFBinaryHeapApplyFunctionToSubheaps(CFBinaryHeapRef heap, _CFBinaryHeapSubheapApplierFunction applier, void *context) CF_AVAILABLE(10_10, 8_0);
+
+#include <CoreFoundation/CFBitVector.h>
+
+typedef CF_ENUM(CFIndex, _CFBitVectorOperation) {
+    _CFBitVectorOperationAnd = 0,
+    _CFBitVectorOperationOr,
+    _CFBitVectorOperationXor,
+    _CFBitVectorOperationAndNot	// bits of bv that are not set in other
+} CF_ENUM_AVAILABLE(10_10, 8_0);
+
+// Replaces the bits of bv in range with the result of combining them with the bits at the same indexes of other. The range must lie within both bit vectors; other may be bv itself.
+CF_EXPORT void _CFBitVectorCombineBits(CFMutableBitVectorRef bv, CFBitVectorRef other, CFRange range, _CFBitVectorOperation operation) CF_AVAILABLE(10_10, 8_0);
+
+#include <CoreFoundation/CFTimeZone.h>
+
+// Fills offsets[i] with CFTimeZoneGetSecondsFromGMT(tz, times[i]) for each of the count times. Runs of nearby times, as in sorted logs, mostly avoid searching the zone's transitions.
+CF_EXPORT void _CFTimeZoneGetSecondsFromGMTForTimes(CFTimeZoneRef tz, const CFAbsoluteTime *times, CFTimeInterval *offsets, CFIndex count) CF_AVAILABLE(10_10, 8_0);
+
+#include <CoreFoundation/CFCalendar.h>
+
+// Decomposes count times at once into the components of componentDesc: vectors holds one array of count ints for each character of componentDesc, and vectors[i][j] receives that component of ats[j]. Returns false if any time could not be decomposed.
+CF_EXPORT Boolean _CFCalendarDecomposeAbsoluteTimes(CFCalendarRef calendar, const CFAbsoluteTime *ats, CFIndex count, const char *componentDesc, int **vectors) CF_AVAILABLE(10_10, 8_0);
+
+#include <CoreFoundation/CFUUID.h>
+
+// Generates the bytes of a new UUID, as CFUUIDCreate() would, without creating or uniquing a CFUUID. Returns false if no UUID could be generated.
+CF_EXPORT Boolean _CFUUIDGenerateBytes(CFUUIDBytes *bytes) CF_AVAILABLE(10_10, 8_0);
+
 // The 'filtered' function below is preferred to this older one
 CF_EXPORT bool _CFPropertyListCreateSingleValue(CFAllocatorRef allocator, CFDataRef data, CFOptionFlags option, CFStringRef keyPath, CFPropertyListRef *value, CFErrorRef *error);
 
@@ -653,6 +736,10 @@ CF_EXPORT CFNotificationCenterRef CFNotificationCenterGetDistributedCenter(void)
 CF_EXPORT const CFStringRef kCFNumberFormatterUsesCharacterDirection CF_AVAILABLE(10_9, 6_0);	// CFBoolean
 CF_EXPORT const CFStringRef kCFDateFormatterUsesCharacterDirection CF_AVAILABLE(10_9, 6_0);	// CFBoolean
 
+// Number of formatter creations served by cloning a cached template, and the number that had to build one
+CF_EXPORT void _CFDateFormatterGetCacheStatistics(CFIndex *hits, CFIndex *misses) CF_AVAILABLE(10_10, 8_0);
+CF_EXPORT void _CFNumberFormatterGetCacheStatistics(CFIndex *hits, CFIndex *misses) CF_AVAILABLE(10_10, 8_0);
+
 
 CF_EXTERN_C_END
 
@@ -39,6 +39,10 @@
 #include <CoreFoundation/CFString.h>
 #if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_WINDOWS
 #include <CoreFoundation/CFStream.h>
+#include <CoreFoundation/CFStreamPriv.h>
+#endif
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED
+#include <sys/stat.h>
 #endif
 #include <CoreFoundation/CFCalendar.h>
 #include "CFLocaleInternal.h"
@@ -307,24 +311,24 @@ typedef struct {
     Boolean skip; // if true, do not create any objects.
 } _CFXMLPlistParseInfo;
 
-CF_PRIVATE CFTypeRef __CFCreateOldStylePropertyListOrStringsFile(CFAllocatorRef allocator, CFDataRef xmlData, CFStringRef originalString, CFStringEncoding guessedEncoding, CFOptionFlags option, CFErrorRef *outError,CFPropertyListFormat *format);
+CF_PRIVATE CFTypeRef __CFCreateOldStylePropertyListOrStringsFile(CFAllocatorRef allocator, CFDataRef xmlData, CFStringRef originalString, CFStringEncoding guessedEncoding, CFOptionFlags option, CFErrorRef *outError, CFPropertyListFormat *format, CFSetRef keyPaths);
 
 CF_INLINE void __CFPListRelease(CFTypeRef cf, CFAllocatorRef allocator) {
     if (cf && !(0)) CFRelease(cf);
 }
 
 
-// The following set of _plist... functions append various things to a mutable data which is in UTF8 encoding. These are pretty general. Assumption is call characters and CFStrings can be converted to UTF8 and appeneded.
+// The following set of _plist... functions append various things to a data builder which is in UTF8 encoding. These are pretty general. Assumption is call characters and CFStrings can be converted to UTF8 and appeneded.
 
 // Null-terminated, ASCII or UTF8 string
 //
-static void _plistAppendUTF8CString(CFMutableDataRef mData, const char *cString) {
-    CFDataAppendBytes (mData, (const UInt8 *)cString, strlen(cString));
+static void _plistAppendUTF8CString(_CFDataBuilder *mData, const char *cString) {
+    _CFDataBuilderAppendBytes(mData, (const UInt8 *)cString, strlen(cString));
 }
 
 // UniChars
 //
-static void _plistAppendCharacters(CFMutableDataRef mData, const UniChar *chars, CFIndex length) {
+static void _plistAppendCharacters(_CFDataBuilder *mData, const UniChar *chars, CFIndex length) {
     CFIndex curLoc = 0;
 
     do {	// Flush out ASCII chars, BUFLEN at a time
@@ -333,7 +337,7 @@ static void _plistAppendCharacters(CFMutableDataRef mData, const UniChar *chars,
 	CFIndex cnt = 0;
         while (cnt < length && (cnt - curLoc < BUFLEN) && (chars[cnt] < 128)) *bufPtr++ = (UInt8)(chars[cnt++]);
         if (cnt > curLoc) {	// Flush any ASCII bytes
-            CFDataAppendBytes(mData, buf, cnt - curLoc);
+            _CFDataBuilderAppendBytes(mData, buf, cnt - curLoc);
             curLoc = cnt;
         }
     } while (curLoc < length && (chars[curLoc] < 128));	// We will exit out of here when we run out of chars or hit a non-ASCII char
@@ -343,7 +347,7 @@ static void _plistAppendCharacters(CFMutableDataRef mData, const UniChar *chars,
         CFStringRef str = NULL;
         if ((str = CFStringCreateWithCharactersNoCopy(kCFAllocatorSystemDefault, chars + curLoc, length - curLoc, kCFAllocatorNull))) {
             if ((data = CFStringCreateExternalRepresentation(kCFAllocatorSystemDefault, str, kCFStringEncodingUTF8, 0))) {
-                CFDataAppendBytes (mData, CFDataGetBytePtr(data), CFDataGetLength(data));
+                _CFDataBuilderAppendBytes(mData, CFDataGetBytePtr(data), CFDataGetLength(data));
                 CFRelease(data);
             }
             CFRelease(str);
@@ -354,7 +358,7 @@ static void _plistAppendCharacters(CFMutableDataRef mData, const UniChar *chars,
 
 // Append CFString
 //
-static void _plistAppendString(CFMutableDataRef mData, CFStringRef str) {
+static void _plistAppendString(_CFDataBuilder *mData, CFStringRef str) {
     const UniChar *chars;
     const char *cStr;
     CFDataRef data;
@@ -363,7 +367,7 @@ static void _plistAppendString(CFMutableDataRef mData, CFStringRef str) {
     } else if ((cStr = CFStringGetCStringPtr(str, kCFStringEncodingASCII)) || (cStr = CFStringGetCStringPtr(str, kCFStringEncodingUTF8))) {
         _plistAppendUTF8CString(mData, cStr);
     } else if ((data = CFStringCreateExternalRepresentation(kCFAllocatorSystemDefault, str, kCFStringEncodingUTF8, 0))) {
-        CFDataAppendBytes (mData, CFDataGetBytePtr(data), CFDataGetLength(data));
+        _CFDataBuilderAppendBytes(mData, CFDataGetBytePtr(data), CFDataGetLength(data));
         CFRelease(data);
     } else {
 	CFAssert1(TRUE, __kCFLogAssertion, "%s(): Error in plist writing", __PRETTY_FUNCTION__);
@@ -373,7 +377,7 @@ static void _plistAppendString(CFMutableDataRef mData, CFStringRef str) {
 
 // Append CFString-style format + arguments
 //
-static void _plistAppendFormat(CFMutableDataRef mData, CFStringRef format, ...) {
+static void _plistAppendFormat(_CFDataBuilder *mData, CFStringRef format, ...) {
     CFStringRef fStr; 
     va_list argList;
 
@@ -388,7 +392,7 @@ static void _plistAppendFormat(CFMutableDataRef mData, CFStringRef format, ...)
 
 
 
-static void _appendIndents(CFIndex numIndents, CFMutableDataRef str) {
+static void _appendIndents(CFIndex numIndents, _CFDataBuilder *str) {
 #define NUMTABS 4
     static const UniChar tabs[NUMTABS] = {'\t','\t','\t','\t'};
     for (; numIndents > 0; numIndents -= NUMTABS) _plistAppendCharacters(str, tabs, (numIndents >= NUMTABS) ? NUMTABS : numIndents);
@@ -396,7 +400,7 @@ static void _appendIndents(CFIndex numIndents, CFMutableDataRef str) {
 
 /* Append the escaped version of origStr to mStr.
 */
-static void _appendEscapedString(CFStringRef origStr, CFMutableDataRef mStr) {
+static void _appendEscapedString(CFStringRef origStr, _CFDataBuilder *mStr) {
 #define BUFSIZE 64
     CFIndex i, length = CFStringGetLength(origStr);
     CFIndex bufCnt = 0;
@@ -460,7 +464,7 @@ static void _appendEscapedString(CFStringRef origStr, CFMutableDataRef mStr) {
 
 // Write the inputData to the mData using Base 64 encoding
 
-static void _XMLPlistAppendDataUsingBase64(CFMutableDataRef mData, CFDataRef inputData, CFIndex indent) {
+static void _XMLPlistAppendDataUsingBase64(_CFDataBuilder *mData, CFDataRef inputData, CFIndex indent) {
     static const char __CFPLDataEncodeTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
     #define MAXLINELEN 76
     char buf[MAXLINELEN + 4 + 2];	// For the slop and carriage return and terminating NULL
@@ -522,7 +526,7 @@ static void _XMLPlistAppendDataUsingBase64(CFMutableDataRef mData, CFDataRef inp
 
 extern CFStringRef __CFNumberCopyFormattingDescriptionAsFloat64(CFTypeRef cf);
 
-static void _CFAppendXML0(CFTypeRef object, UInt32 indentation, CFMutableDataRef xmlString) {
+static void _CFAppendXML0(CFTypeRef object, UInt32 indentation, _CFDataBuilder *xmlString) {
     UInt32 typeID = CFGetTypeID(object);
     _appendIndents(indentation, xmlString);
     if (typeID == stringtype) {
@@ -673,7 +677,7 @@ if (date.year != y || date.month != M || date.day != d || date.hour != H || date
     }
 }
 
-static void _CFGenerateXMLPropertyListToData(CFMutableDataRef xml, CFTypeRef propertyList) {
+static void _CFGenerateXMLPropertyListToData(_CFDataBuilder *xml, CFTypeRef propertyList) {
     _plistAppendUTF8CString(xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<!DOCTYPE ");
     _plistAppendCharacters(xml, CFXMLPlistTagsUnicode[PLIST_IX], PLIST_TAG_LENGTH);
     _plistAppendUTF8CString(xml, " PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" \"http://www.apple.com/DTDs/PropertyList-1.0.dtd\">\n<");
@@ -699,8 +703,11 @@ CFDataRef _CFPropertyListCreateXMLData(CFAllocatorRef allocator, CFPropertyListR
         __CFAssertIsPList(propertyList);
         return NULL;
     }
-    xml = CFDataCreateMutable(allocator, 0);
-    _CFGenerateXMLPropertyListToData(xml, propertyList);
+    _CFDataBuilder builder;
+    _CFDataBuilderInit(&builder);
+    _CFGenerateXMLPropertyListToData(&builder, propertyList);
+    xml = _CFDataBuilderCreateMutableData(allocator, &builder);
+    _CFDataBuilderDestroy(&builder);
     return xml;
 }
 
@@ -1344,6 +1351,48 @@ CF_PRIVATE void __CFPropertyListCreateSplitKeypaths(CFAllocatorRef allocator, CF
     *nextKeys = outNextKeys;
 }
 
+static CFComparisonResult __CFPropertyListCompareIndexes(const void *val1, const void *val2, void *context) {
+    CFIndex a = *(const CFIndex *)val1, b = *(const CFIndex *)val2;
+    return (a < b) ? kCFCompareLessThan : ((a > b) ? kCFCompareGreaterThan : kCFCompareEqualTo);
+}
+
+// Array elements are selected by their index, written as an integer in the key path. This converts the keys for one level into a sorted list of indexes, so that the parsers can test each element as they go without creating a string for it. Keys which are not proper integers never match, as in the binary plist parser.
+// Returns the number of indexes; *indexes must be freed with CFAllocatorDeallocate if non-NULL.
+CF_PRIVATE CFIndex __CFPropertyListCreateKeypathIndexes(CFAllocatorRef allocator, CFSetRef theseKeys, CFIndex **indexes) {
+    *indexes = NULL;
+    CFIndex count = theseKeys ? CFSetGetCount(theseKeys) : 0;
+    if (count == 0) return 0;
+
+    CFIndex *result = (CFIndex *)CFAllocatorAllocate(allocator, count * sizeof(CFIndex), 0);
+    CFIndex indexCount = 0;
+    new_cftype_array(keys, count);
+    CFSetGetValues(theseKeys, keys);
+    for (CFIndex i = 0; i < count; i++) {
+        CFStringRef key = (CFStringRef)keys[i];
+        SInt32 intValue = CFStringGetIntValue(key);
+        if ((intValue == 0 && CFStringCompare(CFSTR("0"), key, 0) != kCFCompareEqualTo) || intValue == INT_MAX || intValue == INT_MIN || intValue < 0) {
+            // skip, doesn't appear to be a proper integer
+        } else {
+            result[indexCount++] = intValue;
+        }
+    }
+    free_cftype_array(keys);
+
+    if (indexCount == 0) {
+        CFAllocatorDeallocate(allocator, result);
+        return 0;
+    }
+    CFQSortArray(result, indexCount, sizeof(CFIndex), __CFPropertyListCompareIndexes, NULL);
+    *indexes = result;
+    return indexCount;
+}
+
+// Elements are visited in increasing order, so *cursor only ever moves forward through the sorted indexes. Once it passes the last one, no further element of the array is wanted.
+CF_PRIVATE Boolean __CFPropertyListKeypathIndexesContain(const CFIndex *indexes, CFIndex indexCount, CFIndex *cursor, CFIndex idx) {
+    while (*cursor < indexCount && indexes[*cursor] < idx) (*cursor)++;
+    return (*cursor < indexCount && indexes[*cursor] == idx);
+}
+
 static Boolean parseArrayTag(_CFXMLPlistParseInfo *pInfo, CFTypeRef *out) {
     CFTypeRef tmp = NULL;
 
@@ -1376,11 +1425,11 @@ static Boolean parseArrayTag(_CFXMLPlistParseInfo *pInfo, CFTypeRef *out) {
     CFSetRef oldKeyPaths = pInfo->keyPaths;
     CFSetRef newKeyPaths, keys;
     __CFPropertyListCreateSplitKeypaths(pInfo->allocator, pInfo->keyPaths, &keys, &newKeyPaths);
+    CFIndex *indexes = NULL, indexCount = 0, cursor = 0;
+    if (keys) indexCount = __CFPropertyListCreateKeypathIndexes(pInfo->allocator, keys, &indexes);
     
     if (keys) {
-        CFStringRef countString = CFStringCreateWithFormat(pInfo->allocator, NULL, CFSTR("%ld"), count);
-        if (!CFSetContainsValue(keys, countString)) pInfo->skip = true;
-        __CFPListRelease(countString, pInfo->allocator);
+        if (!__CFPropertyListKeypathIndexesContain(indexes, indexCount, &cursor, count)) pInfo->skip = true;
         count++;
         pInfo->keyPaths = newKeyPaths;
     }
@@ -1398,9 +1447,7 @@ static Boolean parseArrayTag(_CFXMLPlistParseInfo *pInfo, CFTypeRef *out) {
         
         if (keys) {
             // prep for getting next object
-            CFStringRef countString = CFStringCreateWithFormat(pInfo->allocator, NULL, CFSTR("%ld"), count);
-            if (!CFSetContainsValue(keys, countString)) pInfo->skip = true;
-            __CFPListRelease(countString, pInfo->allocator);
+            if (!__CFPropertyListKeypathIndexesContain(indexes, indexCount, &cursor, count)) pInfo->skip = true;
             count++;
             pInfo->keyPaths = newKeyPaths;
         }
@@ -1415,6 +1462,7 @@ static Boolean parseArrayTag(_CFXMLPlistParseInfo *pInfo, CFTypeRef *out) {
     
     __CFPListRelease(newKeyPaths, pInfo->allocator);
     __CFPListRelease(keys, pInfo->allocator);
+    if (indexes) CFAllocatorDeallocate(pInfo->allocator, indexes);
 
     if (pInfo->error) { // getContentObject encountered a parse error
         __CFPListRelease(array, pInfo->allocator);
@@ -1475,9 +1523,10 @@ static Boolean parseDictTag(_CFXMLPlistParseInfo *pInfo, CFTypeRef *out) {
     __CFPropertyListCreateSplitKeypaths(pInfo->allocator, pInfo->keyPaths, &theseKeyPaths, &nextKeyPaths);
     
     CFMutableDictionaryRef dict = NULL;
+    Boolean skipRest = false; // set once every key wanted at this level has been found
     
     result = getContentObject(pInfo, &gotKey, &key);
-    while (result && key) {
+    while (result && (key || skipRest)) {
         if (!gotKey) { 
             if (!pInfo->error) pInfo->error = __CFPropertyListCreateError(kCFPropertyListReadCorruptError, CFSTR("Found non-key inside <dict> at line %d"), lineNumber(pInfo)); 
             __CFPListRelease(key, pInfo->allocator);
@@ -1488,7 +1537,7 @@ static Boolean parseDictTag(_CFXMLPlistParseInfo *pInfo, CFTypeRef *out) {
         }
         
         if (theseKeyPaths) {
-            if (!CFSetContainsValue(theseKeyPaths, key)) pInfo->skip = true;
+            if (skipRest || !CFSetContainsValue(theseKeyPaths, key)) pInfo->skip = true;
             pInfo->keyPaths = nextKeyPaths;
         }
         result = getContentObject(pInfo, NULL, &value);
@@ -1519,7 +1568,11 @@ static Boolean parseDictTag(_CFXMLPlistParseInfo *pInfo, CFTypeRef *out) {
         __CFPListRelease(value, pInfo->allocator);
         value = NULL;
         
+        // Only wanted keys are ever added, so once the dictionary holds all of them the remaining keys need not be created either
+        if (theseKeyPaths && dict && CFDictionaryGetCount(dict) == CFSetGetCount(theseKeyPaths)) skipRest = true;
+        if (skipRest) pInfo->skip = true;
         result = getContentObject(pInfo, &gotKey, &key);
+        if (skipRest) pInfo->skip = false;
     }
     
     __CFPListRelease(nextKeyPaths, pInfo->allocator);
@@ -2396,17 +2449,18 @@ static Boolean _CFPropertyListCreateFromUTF8Data(CFAllocatorRef allocator, CFDat
     if (success && result && format) *format = kCFPropertyListXMLFormat_v1_0;
     
     _cleanupStringMap(pInfo);
-    if (pInfo->keyPaths && !(0)) CFRelease(pInfo->keyPaths);
     CFRelease(xmlData);
 
     if (success) {
+        if (pInfo->keyPaths && !(0)) CFRelease(pInfo->keyPaths);
         *out = result; // caller releases
         return true;
     }
     
     // Try again, old-style
     CFErrorRef oldStyleError = NULL;
-    result = __CFCreateOldStylePropertyListOrStringsFile(allocator, xmlData, originalString, guessedEncoding, option, outError ? &oldStyleError : NULL, format);
+    result = __CFCreateOldStylePropertyListOrStringsFile(allocator, xmlData, originalString, guessedEncoding, option, outError ? &oldStyleError : NULL, format, pInfo->keyPaths);
+    if (pInfo->keyPaths && !(0)) CFRelease(pInfo->keyPaths);
     if (result) {
         // Release old error, return
         if (pInfo->error) CFRelease(pInfo->error);
@@ -2814,6 +2868,41 @@ CFDataRef CFPropertyListCreateData(CFAllocatorRef allocator, CFPropertyListRef p
 
 #if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_WINDOWS
 
+typedef struct {
+    CFWriteStreamRef stream;
+    CFErrorRef *error;
+} __CFPropertyListStreamWriteContext;
+
+static Boolean __CFPropertyListWriteBytesToStream(const uint8_t *ptr, CFIndex len, void *ctx) {
+    __CFPropertyListStreamWriteContext *context = (__CFPropertyListStreamWriteContext *)ctx;
+    CFErrorRef *error = context->error;
+    while (0 < len) {
+        CFIndex ret = CFWriteStreamWrite(context->stream, ptr, len);
+        if (ret == 0) {
+            if (error) *error = __CFPropertyListCreateError(kCFPropertyListWriteStreamError, CFSTR("Property list writing could not be completed because stream is full."));
+            return false;
+        }
+        if (ret < 0) {
+            CFErrorRef underlyingError = CFWriteStreamCopyError(context->stream);
+            if (underlyingError) {
+                if (error) {
+                    // Wrap the error from CFWriteStreamCopy in a new error
+                    CFMutableDictionaryRef userInfo = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, &kCFCopyStringDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks); 
+                    CFDictionarySetValue(userInfo, kCFErrorDebugDescriptionKey, CFSTR("Property list writing could not be completed because the stream had an unknown error."));
+                    CFDictionarySetValue(userInfo, kCFErrorUnderlyingErrorKey, underlyingError);
+                    *error = CFErrorCreate(kCFAllocatorSystemDefault, kCFErrorDomainCocoa, kCFPropertyListWriteStreamError, userInfo);
+                    CFRelease(userInfo);
+                }
+                CFRelease(underlyingError);
+            }
+            return false;
+        }
+        ptr += ret;
+        len -= ret;
+    }
+    return true;
+}
+
 CFIndex CFPropertyListWrite(CFPropertyListRef propertyList, CFWriteStreamRef stream, CFPropertyListFormat format, CFOptionFlags options, CFErrorRef *error) {
     initStatics();
     CFAssert1(stream != NULL, __kCFLogAssertion, "%s(): NULL stream not allowed", __PRETTY_FUNCTION__);
@@ -2835,41 +2924,13 @@ CFIndex CFPropertyListWrite(CFPropertyListRef propertyList, CFWriteStreamRef str
         return 0;
     }
     if (format == kCFPropertyListXMLFormat_v1_0) {
-        CFDataRef data = _CFPropertyListCreateXMLData(kCFAllocatorSystemDefault, propertyList, true);
-        if (!data) {
-            CFLog(kCFLogLevelError, CFSTR("Property list format kCFPropertyListXMLFormat_v1_0 specified but was not a valid property list type"));
-            return 0;
-        }
-        CFIndex len = CFDataGetLength(data);
-	const uint8_t *ptr = CFDataGetBytePtr(data);
-	while (0 < len) {
-	    CFIndex ret = CFWriteStreamWrite(stream, ptr, len);
-	    if (ret == 0) {
-                if (error) *error = __CFPropertyListCreateError(kCFPropertyListWriteStreamError, CFSTR("Property list writing could not be completed because stream is full."));
-                CFRelease(data);
-	        return 0;
-	    }
-	    if (ret < 0) {
-		CFErrorRef underlyingError = CFWriteStreamCopyError(stream);
-                if (underlyingError) {
-                    if (error) {
-                        // Wrap the error from CFWriteStreamCopy in a new error
-                        CFMutableDictionaryRef userInfo = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, &kCFCopyStringDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks); 
-                        CFDictionarySetValue(userInfo, kCFErrorDebugDescriptionKey, CFSTR("Property list writing could not be completed because the stream had an unknown error."));
-                        CFDictionarySetValue(userInfo, kCFErrorUnderlyingErrorKey, underlyingError);
-                        *error = CFErrorCreate(kCFAllocatorSystemDefault, kCFErrorDomainCocoa, kCFPropertyListWriteStreamError, userInfo);
-                        CFRelease(userInfo);
-                    }
-                    CFRelease(underlyingError);
-                }
-		CFRelease(data);
-		return 0;
-	    }
-	    ptr += ret;
-	    len -= ret;
-	}
-	len = CFDataGetLength(data);
-	CFRelease(data);
+        // The plist was validated above, so generate straight into a builder and hand its segments to the stream; the XML never needs to be contiguous.
+        _CFDataBuilder builder;
+        _CFDataBuilderInit(&builder);
+        _CFGenerateXMLPropertyListToData(&builder, propertyList);
+        __CFPropertyListStreamWriteContext context = {stream, error};
+        CFIndex len = _CFDataBuilderApplyFunction(&builder, __CFPropertyListWriteBytesToStream, &context) ? builder._length : 0;
+        _CFDataBuilderDestroy(&builder);
         return len;
     }
     if (format == kCFPropertyListBinaryFormat_v1_0) {
@@ -2952,6 +3013,49 @@ static bool __convertReadStreamToBytes(CFReadStreamRef stream, CFIndex max, uint
     return true;
 }
 
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED
+// Reading a file stream copies every byte twice, through the stack buffer above and into the growing heap buffer. A caller that sets _kCFStreamPropertyFileMapThreshold on the stream accepts mapped data instead, and the risk of a fault if the file is truncated while it is parsed.
+// If the stream reads from a regular file with at least its map threshold of bytes left, returns up to max of them as mapped data and moves the stream past them, just as if they had been read. Otherwise returns NULL and leaves the stream where it was.
+static CFDataRef __createMappedDataFromFileStream(CFReadStreamRef stream, CFIndex max) {
+    CFNumberRef thresholdNum = (CFNumberRef)CFReadStreamCopyProperty(stream, _kCFStreamPropertyFileMapThreshold);
+    if (!thresholdNum) return NULL;
+    int64_t threshold = 0;
+    CFNumberGetValue(thresholdNum, kCFNumberSInt64Type, &threshold);
+    CFRelease(thresholdNum);
+    if (threshold <= 0) return NULL;
+    
+    CFDataRef handle = (CFDataRef)CFReadStreamCopyProperty(stream, _kCFStreamPropertyFileNativeHandle);
+    if (!handle) return NULL;
+    int fd = -1;
+    if (CFDataGetLength(handle) == sizeof(int)) memmove(&fd, CFDataGetBytePtr(handle), sizeof(int));
+    CFRelease(handle);
+    
+    CFNumberRef offsetNum = (CFNumberRef)CFReadStreamCopyProperty(stream, kCFStreamPropertyFileCurrentOffset);
+    if (!offsetNum) return NULL;
+    int64_t offset = -1;
+    CFNumberGetValue(offsetNum, kCFNumberSInt64Type, &offset);
+    CFRelease(offsetNum);
+    
+    struct stat statBuf;
+    if (fd < 0 || offset < 0 || fstat(fd, &statBuf) != 0 || (statBuf.st_mode & S_IFMT) != S_IFREG) return NULL;
+    int64_t remaining = (int64_t)statBuf.st_size - offset;
+    if (remaining > max) remaining = max;
+    if (remaining <= 0 || remaining < threshold) return NULL;
+    
+    CFDataRef data = _CFDataCreateWithMappedFileDescriptor(kCFAllocatorSystemDefault, fd, offset, (CFIndex)remaining);
+    if (!data) return NULL;
+    int64_t newOffset = offset + remaining;
+    CFNumberRef newOffsetNum = CFNumberCreate(kCFAllocatorSystemDefault, kCFNumberSInt64Type, &newOffset);
+    Boolean advanced = CFReadStreamSetProperty(stream, kCFStreamPropertyFileCurrentOffset, newOffsetNum);
+    CFRelease(newOffsetNum);
+    if (!advanced) {
+        CFRelease(data);
+        return NULL;
+    }
+    return data;
+}
+#endif
+
 CFPropertyListRef CFPropertyListCreateWithStream(CFAllocatorRef allocator, CFReadStreamRef stream, CFIndex streamLength, CFOptionFlags mutabilityOption, CFPropertyListFormat *format, CFErrorRef *error) {
     initStatics();
     
@@ -2961,6 +3065,15 @@ CFPropertyListRef CFPropertyListCreateWithStream(CFAllocatorRef allocator, CFRea
     CFAssert2(mutabilityOption == kCFPropertyListImmutable || mutabilityOption == kCFPropertyListMutableContainers || mutabilityOption == kCFPropertyListMutableContainersAndLeaves, __kCFLogAssertion, "%s(): Unrecognized option %d", __PRETTY_FUNCTION__, mutabilityOption);
     
     if (0 == streamLength) streamLength = LONG_MAX;
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED
+    CFDataRef mappedData = __createMappedDataFromFileStream(stream, streamLength);
+    if (mappedData) {
+        CFPropertyListRef pl = NULL;
+        _CFPropertyListCreateWithData(allocator, mappedData, mutabilityOption, error, true, format, NULL, &pl);
+        CFRelease(mappedData);
+        return pl;
+    }
+#endif
     CFErrorRef underlyingError = NULL;
     CFIndex buflen = 0;
     uint8_t *buffer = NULL;
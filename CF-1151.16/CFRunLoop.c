@@ -42,7 +42,16 @@
 #if DEPLOYMENT_TARGET_WINDOWS
 #include <typeinfo.h>
 #endif
+#if DEPLOYMENT_TARGET_LINUX
+#define CHECKINT_NO_ERROR 0
+#define CHECKINT_OVERFLOW_ERROR 1
+CF_INLINE uint64_t check_uint64_add(uint64_t x, uint64_t y, int32_t *err) {
+    if (UINT64_MAX - x < y) *err |= CHECKINT_OVERFLOW_ERROR;
+    return x + y;
+}
+#else
 #include <checkint.h>
+#endif
 
 #if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
 #include <sys/param.h>
@@ -70,9 +79,31 @@ DISPATCH_EXPORT void _dispatch_main_queue_callback_4CF(void);
 
 #define AbsoluteTime LARGE_INTEGER 
 
+#elif DEPLOYMENT_TARGET_LINUX
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+// libdispatch signals the main queue through an eventfd on Linux
+DISPATCH_EXPORT int _dispatch_get_main_queue_handle_4CF(void);
+DISPATCH_EXPORT void _dispatch_main_queue_callback_4CF(void *msg);
+
+#define MACH_PORT_NULL (-1)
+#define mach_port_name_t int
+#define mach_port_t int
+#define _dispatch_get_main_queue_port_4CF _dispatch_get_main_queue_handle_4CF
+
+// TSR values are CLOCK_MONOTONIC nanoseconds on Linux
+#define AbsoluteTime uint64_t
+
+typedef int kern_return_t;
+#define KERN_SUCCESS 0
+
 #endif
 
-#if DEPLOYMENT_TARGET_WINDOWS || DEPLOYMENT_TARGET_IPHONESIMULATOR
+#if DEPLOYMENT_TARGET_WINDOWS || DEPLOYMENT_TARGET_IPHONESIMULATOR || DEPLOYMENT_TARGET_LINUX
 CF_EXPORT pthread_t _CF_pthread_main_thread_np(void);
 #define pthread_main_thread_np() _CF_pthread_main_thread_np()
 #endif
@@ -110,7 +141,7 @@ typedef	int kern_return_t;
 #else
 
 static pthread_t kNilPthreadT = (pthread_t)0;
-#define pthreadPointer(a) a
+#define pthreadPointer(a) ((void *)(a))
 #define lockCount(a) a
 #endif
 
@@ -151,8 +182,8 @@ static pthread_t kNilPthreadT = (pthread_t)0;
 #define	CFRUNLOOP_WAKEUP_FOR_WAKEUP_ENABLED() (0)
 #endif
 
-// In order to reuse most of the code across Mach and Windows v1 RunLoopSources, we define a
-// simple abstraction layer spanning Mach ports and Windows HANDLES
+// In order to reuse most of the code across Mach, Windows and Linux v1 RunLoopSources, we define a
+// simple abstraction layer spanning Mach ports, Windows HANDLES and Linux file descriptors
 #if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
 
 CF_PRIVATE uint32_t __CFGetProcessPortCount(void) {
@@ -406,9 +437,75 @@ static kern_return_t __CFPortSetRemove(__CFPort port, __CFPortSet portSet) {
     return KERN_SUCCESS;
 }
 
+#elif DEPLOYMENT_TARGET_LINUX
+
+// A port is an eventfd (or any other pollable descriptor handed to us by a version 1 source)
+// and a port set is an epoll instance watching the ports for readability. epoll is level
+// triggered here, so whoever services a port is responsible for draining it.
+typedef int __CFPort;
+#define CFPORT_NULL (-1)
+typedef int __CFPortSet;
+
+static void __THE_SYSTEM_HAS_NO_PORTS_AVAILABLE__(int err) __attribute__((noinline));
+static void __THE_SYSTEM_HAS_NO_PORTS_AVAILABLE__(int err) { HALT; };
+
+static __CFPort __CFPortAllocate(void) {
+    __CFPort result = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (CFPORT_NULL == result) {
+        char msg[256];
+        snprintf(msg, 256, "*** The system has no file descriptors available for an eventfd. (%d) ***", errno);
+        CRSetCrashLogMessage(msg);
+        __THE_SYSTEM_HAS_NO_PORTS_AVAILABLE__(errno);
+    }
+    return result;
+}
+
+CF_INLINE void __CFPortFree(__CFPort port) {
+    close(port);
+}
+
+static void __THE_SYSTEM_HAS_NO_PORT_SETS_AVAILABLE__(int err) __attribute__((noinline));
+static void __THE_SYSTEM_HAS_NO_PORT_SETS_AVAILABLE__(int err) { HALT; };
+
+CF_INLINE __CFPortSet __CFPortSetAllocate(void) {
+    __CFPortSet result = epoll_create1(EPOLL_CLOEXEC);
+    if (CFPORT_NULL == result) { __THE_SYSTEM_HAS_NO_PORT_SETS_AVAILABLE__(errno); }
+    return result;
+}
+
+CF_INLINE kern_return_t __CFPortSetInsert(__CFPort port, __CFPortSet portSet) {
+    if (CFPORT_NULL == port) {
+        return -1;
+    }
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = port;
+    return epoll_ctl(portSet, EPOLL_CTL_ADD, port, &event);
+}
+
+CF_INLINE kern_return_t __CFPortSetRemove(__CFPort port, __CFPortSet portSet) {
+    if (CFPORT_NULL == port) {
+        return -1;
+    }
+    return epoll_ctl(portSet, EPOLL_CTL_DEL, port, NULL);
+}
+
+CF_INLINE void __CFPortSetFree(__CFPortSet portSet) {
+    // closing the epoll instance drops its interest list; the member descriptors stay open
+    close(portSet);
+}
+
+// Consume whatever made an eventfd or timerfd port readable, so that the level triggered
+// port set stops reporting it. Both kinds of descriptor are nonblocking and yield 8 bytes.
+CF_INLINE void __CFPortDrain(__CFPort port) {
+    uint64_t count;
+    while (-1 == read(port, &count, sizeof(count)) && EINTR == errno);
+}
+
 #endif
 
-#if !defined(__MACTYPES__) && !defined(_OS_OSTYPES_H)
+#if !defined(__MACTYPES__) && !defined(_OS_OSTYPES_H) && !defined(AbsoluteTime)
 #if defined(__BIG_ENDIAN__)
 typedef	struct UnsignedWide {
     UInt32		hi;
@@ -503,6 +600,45 @@ CF_INLINE LARGE_INTEGER __CFUInt64ToAbsoluteTime(uint64_t desiredFireTime) {
     return result;
 }
 
+#elif DEPLOYMENT_TARGET_LINUX
+
+static int mk_timer_create(void) {
+    return timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+}
+
+static kern_return_t mk_timer_destroy(int name) {
+    return close(name);
+}
+
+static kern_return_t mk_timer_arm(int name, uint64_t expire_time) {
+    struct itimerspec value;
+    memset(&value, 0, sizeof(value));
+    // An all-zero it_value disarms a timerfd, so a deadline at the epoch fires as soon as possible instead
+    if (0 == expire_time) expire_time = 1;
+    value.it_value.tv_sec = (time_t)(expire_time / 1000000000ULL);
+    value.it_value.tv_nsec = (long)(expire_time % 1000000000ULL);
+    int res = timerfd_settime(name, TFD_TIMER_ABSTIME, &value, NULL);
+    if (0 != res) {
+        CFLog(kCFLogLevelError, CFSTR("CFRunLoop: Unable to set timer: %d"), errno);
+    }
+    return res;
+}
+
+static kern_return_t mk_timer_cancel(int name, uint64_t *result_time) {
+    struct itimerspec value;
+    memset(&value, 0, sizeof(value));
+    int res = timerfd_settime(name, 0, &value, NULL);
+    if (0 != res) {
+        CFLog(kCFLogLevelError, CFSTR("CFRunLoop: Unable to cancel timer: %d"), errno);
+    }
+    return res;
+}
+
+// The TSR is already CLOCK_MONOTONIC nanoseconds, which is what an absolute timerfd expects
+CF_INLINE uint64_t __CFUInt64ToAbsoluteTime(uint64_t x) {
+    return x;
+}
+
 #endif
 
 #pragma mark -
@@ -528,9 +664,13 @@ struct __CFRunLoopMode {
     Boolean _stopped;
     char _padding[3];
     CFMutableSetRef _sources0;
+    CFMutableArrayRef _orderedSources0;	/* _sources0 sorted by order, for firing */
+    uintptr_t _sources0Generation;	/* signal generation at the last scan of _sources0 */
+    Boolean _sources0Pending;		/* a scan is needed whatever the generation */
     CFMutableSetRef _sources1;
     CFMutableArrayRef _observers;
-    CFMutableArrayRef _timers;
+    CFBinaryHeapRef _timers;		/* ordered by fire TSR, see __CFRunLoopTimerHeapCreate */
+    CFMutableDictionaryRef _timerIndexes;	/* timer -> its position in _timers */
     CFMutableDictionaryRef _portToV1SourceMap;
     __CFPortSet _portSet;
     CFIndex _observerMask;
@@ -596,9 +736,11 @@ static CFStringRef __CFRunLoopModeCopyDescription(CFTypeRef cf) {
 static void __CFRunLoopModeDeallocate(CFTypeRef cf) {
     CFRunLoopModeRef rlm = (CFRunLoopModeRef)cf;
     if (NULL != rlm->_sources0) CFRelease(rlm->_sources0);
+    if (NULL != rlm->_orderedSources0) CFRelease(rlm->_orderedSources0);
     if (NULL != rlm->_sources1) CFRelease(rlm->_sources1);
     if (NULL != rlm->_observers) CFRelease(rlm->_observers);
     if (NULL != rlm->_timers) CFRelease(rlm->_timers);
+    if (NULL != rlm->_timerIndexes) CFRelease(rlm->_timerIndexes);
     if (NULL != rlm->_portToV1SourceMap) CFRelease(rlm->_portToV1SourceMap);
     CFRelease(rlm->_name);
     __CFPortSetFree(rlm->_portSet);
@@ -651,6 +793,7 @@ struct __CFRunLoop {
     CFAbsoluteTime _runTime;
     CFAbsoluteTime _sleepTime;
     CFTypeRef _counterpart;
+    struct __CFRunLoopProfile *_profile;	/* NULL until profiling is first enabled */
 };
 
 /* Bit 0 of the base reserved bits is used for stopped state */
@@ -778,9 +921,13 @@ static CFRunLoopModeRef __CFRunLoopFindMode(CFRunLoopRef rl, CFStringRef modeNam
     rlm->_stopped = false;
     rlm->_portToV1SourceMap = NULL;
     rlm->_sources0 = NULL;
+    rlm->_orderedSources0 = NULL;
+    rlm->_sources0Generation = 0;
+    rlm->_sources0Pending = false;
     rlm->_sources1 = NULL;
     rlm->_observers = NULL;
     rlm->_timers = NULL;
+    rlm->_timerIndexes = NULL;
     rlm->_observerMask = 0;
     rlm->_portSet = __CFPortSetAllocate();
     rlm->_timerSoftDeadline = UINT64_MAX;
@@ -838,7 +985,7 @@ static Boolean __CFRunLoopModeIsEmpty(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFR
     if (libdispatchQSafe && (CFRunLoopGetMain() == rl) && CFSetContainsValue(rl->_commonModes, rlm->_name)) return false; // represents the libdispatch main queue
     if (NULL != rlm->_sources0 && 0 < CFSetGetCount(rlm->_sources0)) return false;
     if (NULL != rlm->_sources1 && 0 < CFSetGetCount(rlm->_sources1)) return false;
-    if (NULL != rlm->_timers && 0 < CFArrayGetCount(rlm->_timers)) return false;
+    if (NULL != rlm->_timers && 0 < CFBinaryHeapGetCount(rlm->_timers)) return false;
     struct _block_item *item = rl->_blocks_head;
     while (item) {
         struct _block_item *curr = item;
@@ -926,6 +1073,295 @@ void _CFRunLoopSetWindowsMessageQueueHandler(CFRunLoopRef rl, CFStringRef modeNa
 
 #endif
 
+#pragma mark -
+#pragma mark Profiling
+
+/* Per-run loop callout profile, enabled with _CFRunLoopSetProfilingEnabled().
+   Callouts are only ever made on the run loop's own thread, so the begin/end
+   pair needs no lock unless profiling is on; the profile lock only guards the
+   statistics against a concurrent _CFRunLoopCopyProfile() or reset. The
+   profile is kept until the run loop is deallocated once it has been created,
+   so turning profiling off never frees it out from under a callout. */
+
+enum {
+    __kCFRunLoopProfileObserver = 0,
+    __kCFRunLoopProfileTimer,
+    __kCFRunLoopProfileSource0,
+    __kCFRunLoopProfileSource1,
+    __kCFRunLoopProfileBlock,
+    __kCFRunLoopProfileMainQueue,
+    __kCFRunLoopProfileCalloutKindCount
+};
+
+enum {
+    __kCFRunLoopProfileWakeUpForNothing = 0,
+    __kCFRunLoopProfileWakeUpForWakeUp,
+    __kCFRunLoopProfileWakeUpForTimer,
+    __kCFRunLoopProfileWakeUpForDispatch,
+    __kCFRunLoopProfileWakeUpForSource,
+    __kCFRunLoopProfileWakeUpForTimeout,
+    __kCFRunLoopProfileWakeUpReasonCount
+};
+
+static CFStringRef __CFRunLoopProfileCalloutKindName(uint32_t kind) {
+    switch (kind) {
+        case __kCFRunLoopProfileObserver: return CFSTR("observer");
+        case __kCFRunLoopProfileTimer: return CFSTR("timer");
+        case __kCFRunLoopProfileSource0: return CFSTR("source0");
+        case __kCFRunLoopProfileSource1: return CFSTR("source1");
+        case __kCFRunLoopProfileBlock: return CFSTR("block");
+        case __kCFRunLoopProfileMainQueue: return CFSTR("mainQueue");
+    }
+    return CFSTR("unknown");
+}
+
+static CFStringRef __CFRunLoopProfileWakeUpReasonName(uint32_t reason) {
+    switch (reason) {
+        case __kCFRunLoopProfileWakeUpForNothing: return CFSTR("nothing");
+        case __kCFRunLoopProfileWakeUpForWakeUp: return CFSTR("wakeUp");
+        case __kCFRunLoopProfileWakeUpForTimer: return CFSTR("timer");
+        case __kCFRunLoopProfileWakeUpForDispatch: return CFSTR("dispatch");
+        case __kCFRunLoopProfileWakeUpForSource: return CFSTR("source");
+        case __kCFRunLoopProfileWakeUpForTimeout: return CFSTR("timeout");
+    }
+    return CFSTR("unknown");
+}
+
+struct __CFRunLoopProfileEntry {
+    uintptr_t _function;		/* 0 marks an empty slot */
+    uintptr_t _info;
+    uint32_t _kind;
+    uint64_t _count;
+    uint64_t _totalTSR;
+    uint64_t _maxTSR;
+};
+
+#define __CFRunLoopProfileInitialCapacity 64
+#define __CFRunLoopProfileMaxCapacity 4096
+
+struct __CFRunLoopProfile {
+    CFLock_t _lock;
+    volatile Boolean _enabled;
+    uint32_t _depth;			/* callout nesting; changed under _lock, like the statistics it decides */
+    CFIndex _capacity;			/* power of two, kept at most half full */
+    CFIndex _count;
+    struct __CFRunLoopProfileEntry *_entries;
+    uint64_t _droppedCallouts;		/* callouts not recorded because the table was full */
+    uint64_t _workTSR;			/* time in outermost callouts */
+    uint64_t _sleepTSR;			/* time blocked waiting for a wakeup */
+    uint64_t _wakeUps[__kCFRunLoopProfileWakeUpReasonCount];
+};
+
+CF_INLINE Boolean __CFRunLoopIsProfiling(CFRunLoopRef rl) {
+    struct __CFRunLoopProfile *profile = rl->_profile;
+    return NULL != profile && profile->_enabled;
+}
+
+static void __CFRunLoopProfileFree(CFRunLoopRef rl) {
+    struct __CFRunLoopProfile *profile = rl->_profile;
+    if (NULL == profile) return;
+    rl->_profile = NULL;
+    free(profile->_entries);
+    free(profile);
+}
+
+CF_INLINE CFIndex __CFRunLoopProfileHash(uintptr_t function, uintptr_t info, uint32_t kind) {
+    uint64_t h = ((uint64_t)function * 0x9E3779B97F4A7C15ULL) ^ ((uint64_t)info * 0xC2B2AE3D27D4EB4FULL) ^ kind;
+    return (CFIndex)(h ^ (h >> 29));
+}
+
+// profile must be locked
+static struct __CFRunLoopProfileEntry *__CFRunLoopProfileFindEntry(struct __CFRunLoopProfile *profile, uintptr_t function, uintptr_t info, uint32_t kind) {
+    if (NULL == profile->_entries) {
+        profile->_entries = (struct __CFRunLoopProfileEntry *)calloc(__CFRunLoopProfileInitialCapacity, sizeof(struct __CFRunLoopProfileEntry));
+        if (NULL == profile->_entries) return NULL;
+        profile->_capacity = __CFRunLoopProfileInitialCapacity;
+    }
+    CFIndex mask = profile->_capacity - 1;
+    for (CFIndex idx = __CFRunLoopProfileHash(function, info, kind) & mask;; idx = (idx + 1) & mask) {
+        struct __CFRunLoopProfileEntry *entry = profile->_entries + idx;
+        if (0 == entry->_function) break;
+        if (entry->_function == function && entry->_info == info && entry->_kind == kind) return entry;
+    }
+    if (profile->_capacity < 2 * (profile->_count + 1)) {
+        if (__CFRunLoopProfileMaxCapacity <= profile->_capacity) return NULL;
+        CFIndex newCapacity = profile->_capacity * 2;
+        struct __CFRunLoopProfileEntry *newEntries = (struct __CFRunLoopProfileEntry *)calloc(newCapacity, sizeof(struct __CFRunLoopProfileEntry));
+        if (NULL == newEntries) return NULL;
+        for (CFIndex old = 0; old < profile->_capacity; old++) {
+            struct __CFRunLoopProfileEntry *entry = profile->_entries + old;
+            if (0 == entry->_function) continue;
+            CFIndex idx = __CFRunLoopProfileHash(entry->_function, entry->_info, entry->_kind) & (newCapacity - 1);
+            while (0 != newEntries[idx]._function) idx = (idx + 1) & (newCapacity - 1);
+            newEntries[idx] = *entry;
+        }
+        free(profile->_entries);
+        profile->_entries = newEntries;
+        profile->_capacity = newCapacity;
+        mask = newCapacity - 1;
+    }
+    CFIndex idx = __CFRunLoopProfileHash(function, info, kind) & mask;
+    while (0 != profile->_entries[idx]._function) idx = (idx + 1) & mask;
+    struct __CFRunLoopProfileEntry *entry = profile->_entries + idx;
+    entry->_function = function;
+    entry->_info = info;
+    entry->_kind = kind;
+    profile->_count++;
+    return entry;
+}
+
+// Returns the TSR at which the callout started, or 0 if the run loop is not being profiled
+CF_INLINE uint64_t __CFRunLoopProfileCalloutBegin(CFRunLoopRef rl) {
+    if (__CFRunLoopIsProfiling(rl)) {
+        struct __CFRunLoopProfile *profile = rl->_profile;
+        __CFLock(&profile->_lock);
+        profile->_depth++;
+        __CFUnlock(&profile->_lock);
+        return mach_absolute_time();
+    }
+    return 0ULL;
+}
+
+static void __CFRunLoopProfileCalloutEnd(CFRunLoopRef rl, uint64_t startTSR, uint32_t kind, const void *function, const void *info) {
+    if (0ULL == startTSR) return;
+    uint64_t elapsed = mach_absolute_time() - startTSR;
+    struct __CFRunLoopProfile *profile = rl->_profile;
+    __CFLock(&profile->_lock);
+    if (0 == --profile->_depth) profile->_workTSR += elapsed;
+    // a NULL callout is still worth counting, so key it on the kind alone
+    struct __CFRunLoopProfileEntry *entry = __CFRunLoopProfileFindEntry(profile, function ? (uintptr_t)function : (uintptr_t)-1, (uintptr_t)info, kind);
+    if (entry) {
+        entry->_count++;
+        entry->_totalTSR += elapsed;
+        if (entry->_maxTSR < elapsed) entry->_maxTSR = elapsed;
+    } else {
+        profile->_droppedCallouts++;
+    }
+    __CFUnlock(&profile->_lock);
+}
+
+CF_INLINE void __CFRunLoopProfileWakeUp(CFRunLoopRef rl, uint32_t reason) {
+    if (!__CFRunLoopIsProfiling(rl)) return;
+    struct __CFRunLoopProfile *profile = rl->_profile;
+    __CFLock(&profile->_lock);
+    profile->_wakeUps[reason]++;
+    __CFUnlock(&profile->_lock);
+}
+
+CF_INLINE void __CFRunLoopProfileSleep(CFRunLoopRef rl, uint64_t startTSR) {
+    if (0ULL == startTSR || !__CFRunLoopIsProfiling(rl)) return;
+    uint64_t elapsed = mach_absolute_time() - startTSR;
+    struct __CFRunLoopProfile *profile = rl->_profile;
+    __CFLock(&profile->_lock);
+    profile->_sleepTSR += elapsed;
+    __CFUnlock(&profile->_lock);
+}
+
+static CFLock_t __CFRunLoopProfileCreateLock = CFLockInit;
+
+void _CFRunLoopSetProfilingEnabled(CFRunLoopRef rl, Boolean enabled) {
+    CHECK_FOR_FORK();
+    __CFGenericValidateType(rl, CFRunLoopGetTypeID());
+    if (__CFRunLoopIsDeallocating(rl)) return;
+    if (NULL == rl->_profile) {
+        if (!enabled) return;
+        __CFLock(&__CFRunLoopProfileCreateLock);
+        if (NULL == rl->_profile) {
+            struct __CFRunLoopProfile *profile = (struct __CFRunLoopProfile *)calloc(1, sizeof(struct __CFRunLoopProfile));
+            if (NULL == profile) {
+                __CFUnlock(&__CFRunLoopProfileCreateLock);
+                return;
+            }
+            CF_LOCK_INIT_FOR_STRUCTS(profile->_lock);
+            __sync_synchronize(); // publish the initialized profile before the pointer
+            rl->_profile = profile;
+        }
+        __CFUnlock(&__CFRunLoopProfileCreateLock);
+    }
+    rl->_profile->_enabled = enabled;
+}
+
+void _CFRunLoopResetProfile(CFRunLoopRef rl) {
+    CHECK_FOR_FORK();
+    __CFGenericValidateType(rl, CFRunLoopGetTypeID());
+    struct __CFRunLoopProfile *profile = rl->_profile;
+    if (NULL == profile) return;
+    __CFLock(&profile->_lock);
+    if (profile->_entries) memset(profile->_entries, 0, profile->_capacity * sizeof(struct __CFRunLoopProfileEntry));
+    profile->_count = 0;
+    profile->_droppedCallouts = 0;
+    profile->_workTSR = 0;
+    profile->_sleepTSR = 0;
+    memset(profile->_wakeUps, 0, sizeof(profile->_wakeUps));
+    __CFUnlock(&profile->_lock);
+}
+
+static void __CFRunLoopProfileSetNumber(CFMutableDictionaryRef dict, CFStringRef key, CFNumberType type, const void *value) {
+    CFNumberRef num = CFNumberCreate(kCFAllocatorSystemDefault, type, value);
+    CFDictionarySetValue(dict, key, num);
+    CFRelease(num);
+}
+
+static void __CFRunLoopProfileSetTime(CFMutableDictionaryRef dict, CFStringRef key, uint64_t tsr) {
+    CFTimeInterval ti = __CFTSRToTimeInterval(tsr);
+    __CFRunLoopProfileSetNumber(dict, key, kCFNumberDoubleType, &ti);
+}
+
+CFDictionaryRef _CFRunLoopCopyProfile(CFRunLoopRef rl) {
+    CHECK_FOR_FORK();
+    __CFGenericValidateType(rl, CFRunLoopGetTypeID());
+    struct __CFRunLoopProfile *profile = rl->_profile;
+    if (NULL == profile) return NULL;
+
+    // snapshot under the lock, build the CF objects after, so callouts are held up as little as possible
+    __CFLock(&profile->_lock);
+    CFIndex count = profile->_count;
+    struct __CFRunLoopProfileEntry *entries = (struct __CFRunLoopProfileEntry *)malloc((count ? count : 1) * sizeof(struct __CFRunLoopProfileEntry));
+    CFIndex used = 0;
+    for (CFIndex idx = 0; entries && idx < profile->_capacity; idx++) {
+        if (0 != profile->_entries[idx]._function) entries[used++] = profile->_entries[idx];
+    }
+    uint64_t workTSR = profile->_workTSR, sleepTSR = profile->_sleepTSR;
+    long long dropped = (long long)profile->_droppedCallouts;
+    uint64_t wakeUps[__kCFRunLoopProfileWakeUpReasonCount];
+    memmove(wakeUps, profile->_wakeUps, sizeof(wakeUps));
+    __CFUnlock(&profile->_lock);
+
+    CFMutableDictionaryRef result = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    CFMutableArrayRef callouts = CFArrayCreateMutable(kCFAllocatorSystemDefault, used, &kCFTypeArrayCallBacks);
+    for (CFIndex idx = 0; idx < used; idx++) {
+        struct __CFRunLoopProfileEntry *entry = entries + idx;
+        CFMutableDictionaryRef callout = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+        CFDictionarySetValue(callout, CFSTR("kind"), __CFRunLoopProfileCalloutKindName(entry->_kind));
+        long long function = ((uintptr_t)-1 == entry->_function) ? 0 : (long long)entry->_function;
+        long long info = (long long)entry->_info;
+        long long calls = (long long)entry->_count;
+        __CFRunLoopProfileSetNumber(callout, CFSTR("function"), kCFNumberLongLongType, &function);
+        __CFRunLoopProfileSetNumber(callout, CFSTR("info"), kCFNumberLongLongType, &info);
+        __CFRunLoopProfileSetNumber(callout, CFSTR("count"), kCFNumberLongLongType, &calls);
+        __CFRunLoopProfileSetTime(callout, CFSTR("totalTime"), entry->_totalTSR);
+        __CFRunLoopProfileSetTime(callout, CFSTR("maxTime"), entry->_maxTSR);
+        CFArrayAppendValue(callouts, callout);
+        CFRelease(callout);
+    }
+    free(entries);
+    CFDictionarySetValue(result, CFSTR("callouts"), callouts);
+    CFRelease(callouts);
+
+    CFMutableDictionaryRef wakeUpCounts = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    for (CFIndex idx = 0; idx < __kCFRunLoopProfileWakeUpReasonCount; idx++) {
+        long long n = (long long)wakeUps[idx];
+        __CFRunLoopProfileSetNumber(wakeUpCounts, __CFRunLoopProfileWakeUpReasonName((uint32_t)idx), kCFNumberLongLongType, &n);
+    }
+    CFDictionarySetValue(result, CFSTR("wakeUps"), wakeUpCounts);
+    CFRelease(wakeUpCounts);
+
+    __CFRunLoopProfileSetTime(result, CFSTR("workTime"), workTSR);
+    __CFRunLoopProfileSetTime(result, CFSTR("sleepTime"), sleepTSR);
+    __CFRunLoopProfileSetNumber(result, CFSTR("droppedCallouts"), kCFNumberLongLongType, &dropped);
+    return result;
+}
+
 #pragma mark -
 #pragma mark Sources
 
@@ -956,17 +1392,33 @@ struct __CFRunLoopSource {
 };
 
 /* Bit 1 of the base reserved bits is used for signalled state */
+/* It is the only bit in _bits, and is set and cleared atomically, so signalling needs no lock */
+#define __kCFRunLoopSourceSignaledBit ((uint32_t)1 << 1)
 
 CF_INLINE Boolean __CFRunLoopSourceIsSignaled(CFRunLoopSourceRef rls) {
-    return (Boolean)__CFBitfieldGetValue(rls->_bits, 1, 1);
+    return 0 != (((volatile struct __CFRunLoopSource *)rls)->_bits & __kCFRunLoopSourceSignaledBit);
 }
 
-CF_INLINE void __CFRunLoopSourceSetSignaled(CFRunLoopSourceRef rls) {
-    __CFBitfieldSetValue(rls->_bits, 1, 1, 1);
+// Returns true if the source was not already signalled
+CF_INLINE Boolean __CFRunLoopSourceSetSignaled(CFRunLoopSourceRef rls) {
+    // Signalling is lock-free only because no other bit lives in _bits. A flag
+    // added here would have to be changed with __sync operations as well, never
+    // with __CFBitfieldSetValue under the source lock, or a plain read-modify-write
+    // could undo a concurrent signal.
+    return 0 == (__sync_fetch_and_or(&rls->_bits, __kCFRunLoopSourceSignaledBit) & __kCFRunLoopSourceSignaledBit);
 }
 
 CF_INLINE void __CFRunLoopSourceUnsetSignaled(CFRunLoopSourceRef rls) {
-    __CFBitfieldSetValue(rls->_bits, 1, 1, 0);
+    __sync_fetch_and_and(&rls->_bits, ~__kCFRunLoopSourceSignaledBit);
+}
+
+/* Bumped whenever some version 0 source becomes signalled. A mode whose last
+   scan saw the current generation has no newly signalled sources, and can
+   skip walking its sources altogether. */
+static volatile uintptr_t __CFRunLoopSources0SignalGeneration = 1;
+
+CF_INLINE void __CFRunLoopNoteSources0Signaled(void) {
+    __sync_fetch_and_add(&__CFRunLoopSources0SignalGeneration, 1);
 }
 
 CF_INLINE void __CFRunLoopSourceLock(CFRunLoopSourceRef rls) {
@@ -979,6 +1431,15 @@ CF_INLINE void __CFRunLoopSourceUnlock(CFRunLoopSourceRef rls) {
     pthread_mutex_unlock(&(rls->_lock));
 }
 
+// Linux version 1 sources return their file descriptor from getPort as (void *)(intptr_t)fd
+CF_INLINE __CFPort __CFRunLoopSourceGetPort(CFRunLoopSourceRef rls) {	/* DOES CALLOUT */
+#if DEPLOYMENT_TARGET_LINUX
+    return (__CFPort)(intptr_t)rls->_context.version1.getPort(rls->_context.version1.info);
+#else
+    return rls->_context.version1.getPort(rls->_context.version1.info);
+#endif
+}
+
 #pragma mark Observers
 
 struct __CFRunLoopObserver {
@@ -1059,6 +1520,7 @@ struct __CFRunLoopTimer {
     CFTimeInterval _interval;		/* immutable */
     CFTimeInterval _tolerance;          /* mutable */
     uint64_t _fireTSR;			/* TSR units */
+    uint64_t _fireSequence;		/* orders timers with equal _fireTSR */
     CFIndex _order;			/* immutable */
     CFRunLoopTimerCallBack _callout;	/* immutable */
     CFRunLoopTimerContext _context;	/* immutable, except invalidation */
@@ -1108,6 +1570,14 @@ CF_INLINE void __CFRunLoopTimerFireTSRUnlock(void) {
     __CFUnlock(&__CFRLTFireTSRLock);
 }
 
+static uint64_t __CFRLTFireSequence = 0ULL;
+
+// call with the TSRLock locked; the timer must be repositioned in each of its modes afterwards
+CF_INLINE void __CFRunLoopTimerSetFireTSR(CFRunLoopTimerRef rlt, uint64_t fireTSR) {
+    rlt->_fireTSR = fireTSR;
+    rlt->_fireSequence = ++__CFRLTFireSequence;
+}
+
 #pragma mark -
 
 /* CFRunLoop */
@@ -1165,6 +1635,7 @@ static void __CFRunLoopDeallocateSources(const void *value, void *context) {
 	CFRetain(list[idx]);
     }
     if (rlm->_sources0) CFSetRemoveAllValues(rlm->_sources0);
+    if (rlm->_orderedSources0) CFArrayRemoveAllValues(rlm->_orderedSources0);
     if (rlm->_sources1) CFSetRemoveAllValues(rlm->_sources1);
     for (idx = 0; idx < cnt; idx++) {
         CFRunLoopSourceRef rls = (CFRunLoopSourceRef)list[idx];
@@ -1178,7 +1649,7 @@ static void __CFRunLoopDeallocateSources(const void *value, void *context) {
                 rls->_context.version0.cancel(rls->_context.version0.info, rl, rlm->_name);	/* CALLOUT */
             }
         } else if (1 == rls->_context.version0.version) {
-            __CFPort port = rls->_context.version1.getPort(rls->_context.version1.info);	/* CALLOUT */
+            __CFPort port = __CFRunLoopSourceGetPort(rls);	/* CALLOUT */
             if (CFPORT_NULL != port) {
                 __CFPortSetRemove(port, rlm->_portSet);
             }
@@ -1211,16 +1682,16 @@ static void __CFRunLoopDeallocateObservers(const void *value, void *context) {
 static void __CFRunLoopDeallocateTimers(const void *value, void *context) {
     CFRunLoopModeRef rlm = (CFRunLoopModeRef)value;
     if (NULL == rlm->_timers) return;
-    void (^deallocateTimers)(CFMutableArrayRef timers) = ^(CFMutableArrayRef timers) {
+    void (^deallocateTimers)(CFBinaryHeapRef timers) = ^(CFBinaryHeapRef timers) {
         CFIndex idx, cnt;
         const void **list, *buffer[256];
-        cnt = CFArrayGetCount(timers);
+        cnt = CFBinaryHeapGetCount(timers);
         list = (const void **)((cnt <= 256) ? buffer : CFAllocatorAllocate(kCFAllocatorSystemDefault, cnt * sizeof(void *), 0));
-        CFArrayGetValues(timers, CFRangeMake(0, CFArrayGetCount(timers)), list);
         for (idx = 0; idx < cnt; idx++) {
+            list[idx] = _CFBinaryHeapGetValueAtPosition(timers, idx);
             CFRetain(list[idx]);
         }
-        CFArrayRemoveAllValues(timers);
+        CFBinaryHeapRemoveAllValues(timers);
         for (idx = 0; idx < cnt; idx++) {
             CFRunLoopTimerRef rlt = (CFRunLoopTimerRef)list[idx];
             __CFRunLoopTimerLock(rlt);
@@ -1235,7 +1706,7 @@ static void __CFRunLoopDeallocateTimers(const void *value, void *context) {
         if (list != buffer) CFAllocatorDeallocate(kCFAllocatorSystemDefault, list);
     };
     
-    if (rlm->_timers && CFArrayGetCount(rlm->_timers)) deallocateTimers(rlm->_timers);
+    if (rlm->_timers && CFBinaryHeapGetCount(rlm->_timers)) deallocateTimers(rlm->_timers);
 }
 
 CF_EXPORT CFRunLoopRef _CFRunLoopGet0b(pthread_t t);
@@ -1281,6 +1752,7 @@ static void __CFRunLoopDeallocate(CFTypeRef cf) {
     __CFPortFree(rl->_wakeUpPort);
     rl->_wakeUpPort = CFPORT_NULL;
     __CFRunLoopPopPerRunData(rl, NULL);
+    __CFRunLoopProfileFree(rl);
     __CFRunLoopUnlock(rl);
     pthread_mutex_destroy(&rl->_lock);
     memset((char *)cf + sizeof(CFRuntimeBase), 0x8C, sizeof(struct __CFRunLoop) - sizeof(CFRuntimeBase));
@@ -1339,6 +1811,7 @@ static CFRunLoopRef __CFRunLoopCreate(pthread_t t) {
     loop->_blocks_head = NULL;
     loop->_blocks_tail = NULL;
     loop->_counterpart = NULL;
+    loop->_profile = NULL;
     loop->_pthread = t;
 #if DEPLOYMENT_TARGET_WINDOWS
     loop->_winthread = GetCurrentThreadId();
@@ -1647,7 +2120,9 @@ static Boolean __CFRunLoopDoBlocks(CFRunLoopRef rl, CFRunLoopModeRef rlm) { // C
             CFRelease(curr->_mode);
             free(curr);
 	    if (doit) {
+                uint64_t calloutStartTSR = __CFRunLoopProfileCalloutBegin(rl);
                 __CFRUNLOOP_IS_CALLING_OUT_TO_A_BLOCK__(block);
+                __CFRunLoopProfileCalloutEnd(rl, calloutStartTSR, __kCFRunLoopProfileBlock, (const void *)((struct Block_layout *)block)->invoke, NULL);
 	        did = true;
 	    }
             Block_release(block); // do this before relocking to prevent deadlocks where some yahoo wants to run the run loop reentrantly from their dealloc
@@ -1690,7 +2165,9 @@ static void __CFRunLoopDoObservers(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunL
             Boolean doInvalidate = !__CFRunLoopObserverRepeats(rlo);
             __CFRunLoopObserverSetFiring(rlo);
             __CFRunLoopObserverUnlock(rlo);
+            uint64_t calloutStartTSR = __CFRunLoopProfileCalloutBegin(rl);
             __CFRUNLOOP_IS_CALLING_OUT_TO_AN_OBSERVER_CALLBACK_FUNCTION__(rlo->_callout, rlo, activity, rlo->_context.info);
+            __CFRunLoopProfileCalloutEnd(rl, calloutStartTSR, __kCFRunLoopProfileObserver, (const void *)rlo->_callout, rlo->_context.info);
             if (doInvalidate) {
                 CFRunLoopObserverInvalidate(rlo);
             }
@@ -1706,12 +2183,15 @@ static void __CFRunLoopDoObservers(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunL
     if (collectedObservers != buffer) free(collectedObservers);
 }
 
-static CFComparisonResult __CFRunLoopSourceComparator(const void *val1, const void *val2, void *context) {
-    CFRunLoopSourceRef o1 = (CFRunLoopSourceRef)val1;
-    CFRunLoopSourceRef o2 = (CFRunLoopSourceRef)val2;
-    if (o1->_order < o2->_order) return kCFCompareLessThan;
-    if (o2->_order < o1->_order) return kCFCompareGreaterThan;
-    return kCFCompareEqualTo;
+/* rlm is locked; keeps _orderedSources0 sorted, with sources of equal order in the order they were added */
+static void __CFRunLoopModeInsertOrderedSource0(CFRunLoopModeRef rlm, CFRunLoopSourceRef rls) {
+    CFIndex lo = 0, hi = CFArrayGetCount(rlm->_orderedSources0);
+    while (lo < hi) {
+        CFIndex mid = lo + (hi - lo) / 2;
+        CFRunLoopSourceRef other = (CFRunLoopSourceRef)CFArrayGetValueAtIndex(rlm->_orderedSources0, mid);
+        if (rls->_order < other->_order) hi = mid; else lo = mid + 1;
+    }
+    CFArrayInsertValueAtIndex(rlm->_orderedSources0, lo, rls);
 }
 
 static void __CFRunLoopCollectSources0(const void *value, void *context) {
@@ -1765,10 +2245,18 @@ static Boolean __CFRunLoopDoSources0(CFRunLoopRef rl, CFRunLoopModeRef rlm, Bool
     CHECK_FOR_FORK();
     CFTypeRef sources = NULL;
     Boolean sourceHandled = false;
+    Boolean sourcesRemain = false;
 
     /* Fire the version 0 sources */
-    if (NULL != rlm->_sources0 && 0 < CFSetGetCount(rlm->_sources0)) {
-	CFSetApplyFunction(rlm->_sources0, (__CFRunLoopCollectSources0), &sources);
+    if (NULL != rlm->_orderedSources0 && 0 < CFArrayGetCount(rlm->_orderedSources0)) {
+        // read the generation before looking at any signalled bits, so a signal racing with the scan is seen on the next pass
+        uintptr_t generation = __sync_fetch_and_add(&__CFRunLoopSources0SignalGeneration, 0);
+        if (rlm->_sources0Pending || generation != rlm->_sources0Generation) {
+            rlm->_sources0Generation = generation;
+            rlm->_sources0Pending = false;
+            // already in order, so only the signalled sources are looked at again below
+            CFArrayApplyFunction(rlm->_orderedSources0, CFRangeMake(0, CFArrayGetCount(rlm->_orderedSources0)), (__CFRunLoopCollectSources0), &sources);
+        }
     }
     if (NULL != sources) {
 	__CFRunLoopModeUnlock(rlm);
@@ -1781,7 +2269,9 @@ static Boolean __CFRunLoopDoSources0(CFRunLoopRef rl, CFRunLoopModeRef rlm, Bool
 	        __CFRunLoopSourceUnsetSignaled(rls);
 	        if (__CFIsValid(rls)) {
 	            __CFRunLoopSourceUnlock(rls);
+                    uint64_t calloutStartTSR = __CFRunLoopProfileCalloutBegin(rl);
                     __CFRUNLOOP_IS_CALLING_OUT_TO_A_SOURCE0_PERFORM_FUNCTION__(rls->_context.version0.perform, rls->_context.version0.info);
+                    __CFRunLoopProfileCalloutEnd(rl, calloutStartTSR, __kCFRunLoopProfileSource0, (const void *)rls->_context.version0.perform, rls->_context.version0.info);
 	            CHECK_FOR_FORK();
 	            sourceHandled = true;
 	        } else {
@@ -1792,7 +2282,6 @@ static Boolean __CFRunLoopDoSources0(CFRunLoopRef rl, CFRunLoopModeRef rlm, Bool
             }
 	} else {
 	    CFIndex cnt = CFArrayGetCount((CFArrayRef)sources);
-	    CFArraySortValues((CFMutableArrayRef)sources, CFRangeMake(0, cnt), (__CFRunLoopSourceComparator), NULL);
 	    for (CFIndex idx = 0; idx < cnt; idx++) {
 		CFRunLoopSourceRef rls = (CFRunLoopSourceRef)CFArrayGetValueAtIndex((CFArrayRef)sources, idx);
 		__CFRunLoopSourceLock(rls);
@@ -1800,7 +2289,9 @@ static Boolean __CFRunLoopDoSources0(CFRunLoopRef rl, CFRunLoopModeRef rlm, Bool
 		    __CFRunLoopSourceUnsetSignaled(rls);
 		    if (__CFIsValid(rls)) {
 		        __CFRunLoopSourceUnlock(rls);
+                        uint64_t calloutStartTSR = __CFRunLoopProfileCalloutBegin(rl);
                         __CFRUNLOOP_IS_CALLING_OUT_TO_A_SOURCE0_PERFORM_FUNCTION__(rls->_context.version0.perform, rls->_context.version0.info);
+                        __CFRunLoopProfileCalloutEnd(rl, calloutStartTSR, __kCFRunLoopProfileSource0, (const void *)rls->_context.version0.perform, rls->_context.version0.info);
 		        CHECK_FOR_FORK();
 		        sourceHandled = true;
 		    } else {
@@ -1810,6 +2301,7 @@ static Boolean __CFRunLoopDoSources0(CFRunLoopRef rl, CFRunLoopModeRef rlm, Bool
                     __CFRunLoopSourceUnlock(rls);
                 }
 		if (stopAfterHandle && sourceHandled) {
+		    sourcesRemain = (idx + 1 < cnt);
 		    break;
 		}
 	    }
@@ -1817,6 +2309,8 @@ static Boolean __CFRunLoopDoSources0(CFRunLoopRef rl, CFRunLoopModeRef rlm, Bool
 	CFRelease(sources);
 	__CFRunLoopLock(rl);
 	__CFRunLoopModeLock(rlm);
+        // the sources left unfired are still signalled, but the generation will not say so
+        if (sourcesRemain) rlm->_sources0Pending = true;
     }
     return sourceHandled;
 }
@@ -1824,7 +2318,7 @@ static Boolean __CFRunLoopDoSources0(CFRunLoopRef rl, CFRunLoopModeRef rlm, Bool
 CF_INLINE void __CFRunLoopDebugInfoForRunLoopSource(CFRunLoopSourceRef rls) {
 }
 
-// msg, size and reply are unused on Windows
+// msg, size and reply are unused on Windows and Linux
 static Boolean __CFRunLoopDoSource1() __attribute__((noinline));
 static Boolean __CFRunLoopDoSource1(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunLoopSourceRef rls
 #if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
@@ -1843,11 +2337,13 @@ static Boolean __CFRunLoopDoSource1(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRun
 	__CFRunLoopSourceUnsetSignaled(rls);
 	__CFRunLoopSourceUnlock(rls);
         __CFRunLoopDebugInfoForRunLoopSource(rls);
+        uint64_t calloutStartTSR = __CFRunLoopProfileCalloutBegin(rl);
         __CFRUNLOOP_IS_CALLING_OUT_TO_A_SOURCE1_PERFORM_FUNCTION__(rls->_context.version1.perform,
 #if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
             msg, size, reply,
 #endif
             rls->_context.version1.info);
+        __CFRunLoopProfileCalloutEnd(rl, calloutStartTSR, __kCFRunLoopProfileSource1, (const void *)rls->_context.version1.perform, rls->_context.version1.info);
 	CHECK_FOR_FORK();
 	sourceHandled = true;
     } else {
@@ -1860,40 +2356,86 @@ static Boolean __CFRunLoopDoSource1(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRun
     return sourceHandled;
 }
 
-static CFIndex __CFRunLoopInsertionIndexInTimerArray(CFArrayRef array, CFRunLoopTimerRef rlt) __attribute__((noinline));
-static CFIndex __CFRunLoopInsertionIndexInTimerArray(CFArrayRef array, CFRunLoopTimerRef rlt) {
-    CFIndex cnt = CFArrayGetCount(array);
-    if (cnt <= 0) {
-        return 0;
+// The timers of a mode live in _timers, a CFBinaryHeap ordered by fire TSR, so its
+// minimum is always the next timer due. A timer can be in several modes, so its position
+// in each mode's heap is kept in that mode's _timerIndexes, which the heap updates as the
+// timer moves; a timer can then be rescheduled or removed in O(log n) without a search.
+// All of these expect rlm locked; anything that changes a timer's _fireTSR must also
+// hold the TSRLock until the timer has been repositioned in every mode it is in.
+
+CF_INLINE Boolean __CFRunLoopTimerFiresBefore(CFRunLoopTimerRef rlt1, CFRunLoopTimerRef rlt2) {
+    if (rlt1->_fireTSR != rlt2->_fireTSR) return rlt1->_fireTSR < rlt2->_fireTSR;
+    return rlt1->_fireSequence < rlt2->_fireSequence;
+}
+
+static CFComparisonResult __CFRunLoopTimerCompareFireOrder(const void *val1, const void *val2, void *context) {
+    CFRunLoopTimerRef rlt1 = (CFRunLoopTimerRef)val1, rlt2 = (CFRunLoopTimerRef)val2;
+    if (rlt1 == rlt2) return kCFCompareEqualTo;
+    return __CFRunLoopTimerFiresBefore(rlt1, rlt2) ? kCFCompareLessThan : kCFCompareGreaterThan;
+}
+
+static void __CFRunLoopTimerHeapSetPosition(const void *value, CFIndex position, void *info) {
+    CFRunLoopModeRef rlm = (CFRunLoopModeRef)info;
+    if (kCFNotFound == position) {
+        CFDictionaryRemoveValue(rlm->_timerIndexes, value);
+    } else {
+        CFDictionarySetValue(rlm->_timerIndexes, value, (const void *)position);
     }
-    if (256 < cnt) {
-        CFRunLoopTimerRef item = (CFRunLoopTimerRef)CFArrayGetValueAtIndex(array, cnt - 1);
-        if (item->_fireTSR <= rlt->_fireTSR) {
-            return cnt;
-        }
-        item = (CFRunLoopTimerRef)CFArrayGetValueAtIndex(array, 0);
-        if (rlt->_fireTSR < item->_fireTSR) {
-            return 0;
-        }
+}
+
+static void __CFRunLoopTimerHeapCreate(CFRunLoopModeRef rlm) {
+    CFBinaryHeapCallBacks cb = {0, __CFTypeCollectionRetain, __CFTypeCollectionRelease, CFCopyDescription, __CFRunLoopTimerCompareFireOrder};
+    CFBinaryHeapCompareContext ctx = {0, rlm, NULL, NULL, NULL};	/* the mode owns the heap, so it is not retained */
+    rlm->_timerIndexes = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, NULL, NULL);
+    rlm->_timers = CFBinaryHeapCreate(kCFAllocatorSystemDefault, 0, &cb, &ctx);
+    _CFBinaryHeapSetPositionCallBack(rlm->_timers, __CFRunLoopTimerHeapSetPosition);
+}
+
+CF_INLINE CFIndex __CFRunLoopTimerHeapIndexOfTimer(CFRunLoopModeRef rlm, CFRunLoopTimerRef rlt) {
+    const void *idx = NULL;
+    if (NULL == rlm->_timerIndexes || !CFDictionaryGetValueIfPresent(rlm->_timerIndexes, rlt, &idx)) return kCFNotFound;
+    return (CFIndex)idx;
+}
+
+struct __CFRunLoopTimerDeadlines {
+    uint64_t soft;
+    uint64_t hard;
+};
+
+// Fold a timer's soft and hard deadlines into the running minimums. Everything below a timer
+// fires no earlier than it does, so once a timer's soft deadline is past the hard deadline
+// found so far, nothing under it can lower either value.
+static Boolean __CFRunLoopTimerHeapCollectDeadlines(const void *value, void *context) {
+    CFRunLoopTimerRef t = (CFRunLoopTimerRef)value;
+    struct __CFRunLoopTimerDeadlines *deadlines = (struct __CFRunLoopTimerDeadlines *)context;
+    if (t->_fireTSR > deadlines->hard) return false;
+    // discount timers currently firing, but not the timers below them
+    if (!__CFRunLoopTimerIsFiring(t)) {
+        int32_t err = CHECKINT_NO_ERROR;
+        uint64_t oneTimerSoftDeadline = t->_fireTSR;
+        uint64_t oneTimerHardDeadline = check_uint64_add(t->_fireTSR, __CFTimeIntervalToTSR(t->_tolerance), &err);
+        if (err != CHECKINT_NO_ERROR) oneTimerHardDeadline = UINT64_MAX;
+        if (oneTimerSoftDeadline < deadlines->soft) deadlines->soft = oneTimerSoftDeadline;
+        if (oneTimerHardDeadline < deadlines->hard) deadlines->hard = oneTimerHardDeadline;
     }
+    return true;
+}
 
-    CFIndex add = (1 << flsl(cnt)) * 2;
-    CFIndex idx = 0;
-    Boolean lastTestLEQ;
-    do {
-        add = add / 2;
-	lastTestLEQ = false;
-        CFIndex testIdx = idx + add;
-        if (testIdx < cnt) {
-            CFRunLoopTimerRef item = (CFRunLoopTimerRef)CFArrayGetValueAtIndex(array, testIdx);
-            if (item->_fireTSR <= rlt->_fireTSR) {
-                idx = testIdx;
-		lastTestLEQ = true;
-            }
-        }
-    } while (0 < add);
+struct __CFRunLoopTimersDue {
+    uint64_t limitTSR;
+    CFMutableArrayRef timers;
+};
 
-    return lastTestLEQ ? idx + 1 : idx;
+// Append the timer if it is valid, not firing, and due by limitTSR
+static Boolean __CFRunLoopTimerHeapCollectDue(const void *value, void *context) {
+    CFRunLoopTimerRef rlt = (CFRunLoopTimerRef)value;
+    struct __CFRunLoopTimersDue *due = (struct __CFRunLoopTimersDue *)context;
+    if (due->limitTSR < rlt->_fireTSR) return false;
+    if (__CFIsValid(rlt) && !__CFRunLoopTimerIsFiring(rlt)) {
+        if (!due->timers) due->timers = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
+        CFArrayAppendValue(due->timers, rlt);
+    }
+    return true;
 }
 
 static void __CFArmNextTimerInMode(CFRunLoopModeRef rlm, CFRunLoopRef rl) {    
@@ -1901,32 +2443,14 @@ static void __CFArmNextTimerInMode(CFRunLoopModeRef rlm, CFRunLoopRef rl) {
     uint64_t nextSoftDeadline = UINT64_MAX;
 
     if (rlm->_timers) {
-        // Look at the list of timers. We will calculate two TSR values; the next soft and next hard deadline.
-        // The next soft deadline is the first time we can fire any timer. This is the fire date of the first timer in our sorted list of timers.
+        // Look at the heap of timers. We will calculate two TSR values; the next soft and next hard deadline.
+        // The next soft deadline is the first time we can fire any timer. This is the fire date of the earliest timer not currently firing.
         // The next hard deadline is the last time at which we can fire the timer before we've moved out of the allowable tolerance of the timers in our list.
-        for (CFIndex idx = 0, cnt = CFArrayGetCount(rlm->_timers); idx < cnt; idx++) {
-            CFRunLoopTimerRef t = (CFRunLoopTimerRef)CFArrayGetValueAtIndex(rlm->_timers , idx);
-            // discount timers currently firing
-            if (__CFRunLoopTimerIsFiring(t)) continue;
-            
-            int32_t err = CHECKINT_NO_ERROR;
-            uint64_t oneTimerSoftDeadline = t->_fireTSR;
-            uint64_t oneTimerHardDeadline = check_uint64_add(t->_fireTSR, __CFTimeIntervalToTSR(t->_tolerance), &err);
-            if (err != CHECKINT_NO_ERROR) oneTimerHardDeadline = UINT64_MAX;
-            
-            // We can stop searching if the soft deadline for this timer exceeds the current hard deadline. Otherwise, later timers with lower tolerance could still have earlier hard deadlines.
-            if (oneTimerSoftDeadline > nextHardDeadline) {
-                break;
-            }
-            
-            if (oneTimerSoftDeadline < nextSoftDeadline) {
-                nextSoftDeadline = oneTimerSoftDeadline;
-            }
-            
-            if (oneTimerHardDeadline < nextHardDeadline) {
-                nextHardDeadline = oneTimerHardDeadline;
-            }
-        }
+        // Timers with later soft deadlines but lower tolerance could still have earlier hard deadlines, so this walks every subheap that could hold one.
+        struct __CFRunLoopTimerDeadlines deadlines = {UINT64_MAX, UINT64_MAX};
+        _CFBinaryHeapApplyFunctionToSubheaps(rlm->_timers, __CFRunLoopTimerHeapCollectDeadlines, &deadlines);
+        nextSoftDeadline = deadlines.soft;
+        nextHardDeadline = deadlines.hard;
         
         if (nextSoftDeadline < UINT64_MAX && (nextHardDeadline != rlm->_timerHardDeadline || nextSoftDeadline != rlm->_timerSoftDeadline)) {
             if (CFRUNLOOP_NEXT_TIMER_ARMED_ENABLED()) {
@@ -1942,7 +2466,7 @@ static void __CFArmNextTimerInMode(CFRunLoopModeRef rlm, CFRunLoopRef rl) {
                 // <rdar://problem/14447675>
                 
                 // Cancel the mk timer
-                if (rlm->_mkTimerArmed && rlm->_timerPort) {
+                if (rlm->_mkTimerArmed && MACH_PORT_NULL != rlm->_timerPort) {
                     AbsoluteTime dummy;
                     mk_timer_cancel(rlm->_timerPort, &dummy);
                     rlm->_mkTimerArmed = false;
@@ -1960,7 +2484,7 @@ static void __CFArmNextTimerInMode(CFRunLoopModeRef rlm, CFRunLoopRef rl) {
                 }
                 
                 // Arm the mk timer
-                if (rlm->_timerPort) {
+                if (MACH_PORT_NULL != rlm->_timerPort) {
                     mk_timer_arm(rlm->_timerPort, __CFUInt64ToAbsoluteTime(nextSoftDeadline));
                     rlm->_mkTimerArmed = true;
                 }
@@ -1969,14 +2493,15 @@ static void __CFArmNextTimerInMode(CFRunLoopModeRef rlm, CFRunLoopRef rl) {
             _dispatch_source_set_runloop_timer_4CF(rlm->_timerSource, deadline, DISPATCH_TIME_FOREVER, leeway);
 #endif
 #else
-            if (rlm->_timerPort) {
+            if (MACH_PORT_NULL != rlm->_timerPort) {
                 mk_timer_arm(rlm->_timerPort, __CFUInt64ToAbsoluteTime(nextSoftDeadline));
+                rlm->_mkTimerArmed = true;
             }
 #endif
         } else if (nextSoftDeadline == UINT64_MAX) {
             // Disarm the timers - there is no timer scheduled
             
-            if (rlm->_mkTimerArmed && rlm->_timerPort) {
+            if (rlm->_mkTimerArmed && MACH_PORT_NULL != rlm->_timerPort) {
                 AbsoluteTime dummy;
                 mk_timer_cancel(rlm->_timerPort, &dummy);
                 rlm->_mkTimerArmed = false;
@@ -1999,24 +2524,17 @@ static void __CFRepositionTimerInMode(CFRunLoopModeRef rlm, CFRunLoopTimerRef rl
 static void __CFRepositionTimerInMode(CFRunLoopModeRef rlm, CFRunLoopTimerRef rlt, Boolean isInArray) {
     if (!rlt) return;
     
-    CFMutableArrayRef timerArray = rlm->_timers;
-    if (!timerArray) return;
-    Boolean found = false;
+    if (!rlm->_timers) return;
     
-    // If we know in advance that the timer is not in the array (just being added now) then we can skip this search
+    // If we know in advance that the timer is not in the heap (just being added now) then we can skip the lookup
     if (isInArray) {
-        CFIndex idx = CFArrayGetFirstIndexOfValue(timerArray, CFRangeMake(0, CFArrayGetCount(timerArray)), rlt);
-        if (kCFNotFound != idx) {
-            CFRetain(rlt);
-            CFArrayRemoveValueAtIndex(timerArray, idx);
-            found = true;
-        }
+        CFIndex idx = __CFRunLoopTimerHeapIndexOfTimer(rlm, rlt);
+        if (kCFNotFound == idx) return;
+        _CFBinaryHeapValueChangedAtPosition(rlm->_timers, idx);
+    } else {
+        CFBinaryHeapAddValue(rlm->_timers, rlt);
     }
-    if (!found && isInArray) return;
-    CFIndex newIdx = __CFRunLoopInsertionIndexInTimerArray(timerArray, rlt);
-    CFArrayInsertValueAtIndex(timerArray, newIdx, rlt);
     __CFArmNextTimerInMode(rlm, rlt->_runLoop);
-    if (isInArray) CFRelease(rlt);
 }
 
 
@@ -2052,7 +2570,9 @@ static Boolean __CFRunLoopDoTimer(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunLo
 
 	__CFRunLoopModeUnlock(rlm);
 	__CFRunLoopUnlock(rl);
+	uint64_t calloutStartTSR = __CFRunLoopProfileCalloutBegin(rl);
 	__CFRUNLOOP_IS_CALLING_OUT_TO_A_TIMER_CALLBACK_FUNCTION__(rlt->_callout, rlt, context_info);
+	__CFRunLoopProfileCalloutEnd(rl, calloutStartTSR, __kCFRunLoopProfileTimer, (const void *)rlt->_callout, context_info);
 	CHECK_FOR_FORK();
         if (doInvalidate) {
             CFRunLoopTimerInvalidate(rlt);      /* DOES CALLOUT */
@@ -2124,7 +2644,7 @@ static Boolean __CFRunLoopDoTimer(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunLo
 		    CFRelease(name);
 		}
 		__CFRunLoopTimerFireTSRLock();
-		rlt->_fireTSR = nextFireTSR;
+		__CFRunLoopTimerSetFireTSR(rlt, nextFireTSR);
                 rlt->_nextFireDate = CFAbsoluteTimeGetCurrent() + __CFTimeIntervalUntilTSR(nextFireTSR);
 		for (CFIndex idx = 0; idx < cnt; idx++) {
 		    CFRunLoopModeRef rlm = (CFRunLoopModeRef)modes[idx];
@@ -2140,7 +2660,7 @@ static Boolean __CFRunLoopDoTimer(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunLo
 	    } else {
 		__CFRunLoopTimerUnlock(rlt);
 		__CFRunLoopTimerFireTSRLock();
-		rlt->_fireTSR = nextFireTSR;
+		__CFRunLoopTimerSetFireTSR(rlt, nextFireTSR);
                 rlt->_nextFireDate = CFAbsoluteTimeGetCurrent() + __CFTimeIntervalUntilTSR(nextFireTSR);
 		__CFRunLoopTimerFireTSRUnlock();
             }
@@ -2156,17 +2676,11 @@ static Boolean __CFRunLoopDoTimer(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunLo
 // rl and rlm are locked on entry and exit
 static Boolean __CFRunLoopDoTimers(CFRunLoopRef rl, CFRunLoopModeRef rlm, uint64_t limitTSR) {	/* DOES CALLOUT */
     Boolean timerHandled = false;
-    CFMutableArrayRef timers = NULL;
-    for (CFIndex idx = 0, cnt = rlm->_timers ? CFArrayGetCount(rlm->_timers) : 0; idx < cnt; idx++) {
-        CFRunLoopTimerRef rlt = (CFRunLoopTimerRef)CFArrayGetValueAtIndex(rlm->_timers, idx);
-        
-        if (__CFIsValid(rlt) && !__CFRunLoopTimerIsFiring(rlt)) {
-            if (rlt->_fireTSR <= limitTSR) {
-                if (!timers) timers = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
-                CFArrayAppendValue(timers, rlt);
-            }
-        }
-    }
+    struct __CFRunLoopTimersDue due = {limitTSR, NULL};
+    if (rlm->_timers) _CFBinaryHeapApplyFunctionToSubheaps(rlm->_timers, __CFRunLoopTimerHeapCollectDue, &due);
+    CFMutableArrayRef timers = due.timers;
+    // fire in the order the timers came due
+    if (timers) CFArraySortValues(timers, CFRangeMake(0, CFArrayGetCount(timers)), __CFRunLoopTimerCompareFireOrder, NULL);
     
     for (CFIndex idx = 0, cnt = timers ? CFArrayGetCount(timers) : 0; idx < cnt; idx++) {
         CFRunLoopTimerRef rlt = (CFRunLoopTimerRef)CFArrayGetValueAtIndex(timers, idx);
@@ -2304,6 +2818,50 @@ static Boolean __CFRunLoopWaitForMultipleObjects(__CFPortSet portSet, HANDLE *on
     return result;
 }
 
+#elif DEPLOYMENT_TARGET_LINUX
+
+#define TIMEOUT_INFINITY (-1)
+
+// Wait for one of the ports in portSet to become readable. epoll hands back ready
+// descriptors round-robin when asked for one at a time, so a busy port cannot starve the others.
+static Boolean __CFRunLoopServicePortSet(__CFPortSet portSet, int timeout, __CFPort *livePort) {
+    for (;;) {		/* In that sleep of death what nightmares may come ... */
+        struct epoll_event event;
+        if (TIMEOUT_INFINITY == timeout) { CFRUNLOOP_SLEEP(); } else { CFRUNLOOP_POLL(); }
+        int ret = epoll_wait(portSet, &event, 1, timeout);
+        CFRUNLOOP_WAKEUP(ret);
+        if (0 < ret) {
+            *livePort = event.data.fd;
+            return true;
+        }
+        if (0 == ret) {
+            *livePort = CFPORT_NULL;
+            return false;
+        }
+        if (EINTR != errno) break;
+    }
+    HALT;
+    return false;
+}
+
+// Check a single port without going through a port set
+static Boolean __CFRunLoopServicePort(__CFPort port, int timeout, __CFPort *livePort) {
+    struct pollfd pfd;
+    pfd.fd = port;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int ret;
+    do {
+        ret = poll(&pfd, 1, timeout);
+    } while (-1 == ret && EINTR == errno);
+    if (0 < ret && (pfd.revents & POLLIN)) {
+        *livePort = port;
+        return true;
+    }
+    *livePort = CFPORT_NULL;
+    return false;
+}
+
 #endif
 
 struct __timeout_context {
@@ -2390,6 +2948,8 @@ static int32_t __CFRunLoopRun(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFTimeInter
 #elif DEPLOYMENT_TARGET_WINDOWS
         HANDLE livePort = NULL;
         Boolean windowsMessageReceived = false;
+#elif DEPLOYMENT_TARGET_LINUX
+        __CFPort livePort = CFPORT_NULL;
 #endif
 	__CFPortSet waitSet = rlm->_portSet;
 
@@ -2417,6 +2977,10 @@ static int32_t __CFRunLoopRun(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFTimeInter
             if (__CFRunLoopWaitForMultipleObjects(NULL, &dispatchPort, 0, 0, &livePort, NULL)) {
                 goto handle_msg;
             }
+#elif DEPLOYMENT_TARGET_LINUX
+            if (__CFRunLoopServicePort(dispatchPort, 0, &livePort)) {
+                goto handle_msg;
+            }
 #endif
         }
 
@@ -2436,6 +3000,7 @@ static int32_t __CFRunLoopRun(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFTimeInter
 	__CFRunLoopUnlock(rl);
 
         CFAbsoluteTime sleepStart = poll ? 0.0 : CFAbsoluteTimeGetCurrent();
+        uint64_t profileSleepTSR = (!poll && __CFRunLoopIsProfiling(rl)) ? mach_absolute_time() : 0ULL;
 
 #if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
 #if USE_DISPATCH_SOURCE_FOR_TIMERS
@@ -2478,12 +3043,15 @@ static int32_t __CFRunLoopRun(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFTimeInter
 #elif DEPLOYMENT_TARGET_WINDOWS
         // Here, use the app-supplied message queue mask. They will set this if they are interested in having this run loop receive windows messages.
         __CFRunLoopWaitForMultipleObjects(waitSet, NULL, poll ? 0 : TIMEOUT_INFINITY, rlm->_msgQMask, &livePort, &windowsMessageReceived);
+#elif DEPLOYMENT_TARGET_LINUX
+        __CFRunLoopServicePortSet(waitSet, poll ? 0 : TIMEOUT_INFINITY, &livePort);
 #endif
         
         __CFRunLoopLock(rl);
         __CFRunLoopModeLock(rlm);
 
         rl->_sleepTime += (poll ? 0.0 : (CFAbsoluteTimeGetCurrent() - sleepStart));
+        __CFRunLoopProfileSleep(rl, profileSleepTSR);
 
         // Must remove the local-to-this-activation ports in on every loop
         // iteration, as this mode could be run re-entrantly and we don't
@@ -2540,18 +3108,25 @@ static int32_t __CFRunLoopRun(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFTimeInter
 #endif
         if (MACH_PORT_NULL == livePort) {
             CFRUNLOOP_WAKEUP_FOR_NOTHING();
+            __CFRunLoopProfileWakeUp(rl, __kCFRunLoopProfileWakeUpForNothing);
             // handle nothing
         } else if (livePort == rl->_wakeUpPort) {
             CFRUNLOOP_WAKEUP_FOR_WAKEUP();
+            // The timeout wakes the run loop through the wakeup port too, having cleared termTSR first; count that wakeup as the timeout only
+            __CFRunLoopProfileWakeUp(rl, (0.0 < seconds && 0ULL == timeout_context->termTSR) ? __kCFRunLoopProfileWakeUpForTimeout : __kCFRunLoopProfileWakeUpForWakeUp);
             // do nothing on Mac OS
 #if DEPLOYMENT_TARGET_WINDOWS
             // Always reset the wake up port, or risk spinning forever
             ResetEvent(rl->_wakeUpPort);
+#elif DEPLOYMENT_TARGET_LINUX
+            // Same for the eventfd; the port set is level triggered
+            __CFPortDrain(rl->_wakeUpPort);
 #endif
         }
 #if USE_DISPATCH_SOURCE_FOR_TIMERS
         else if (modeQueuePort != MACH_PORT_NULL && livePort == modeQueuePort) {
             CFRUNLOOP_WAKEUP_FOR_TIMER();
+            __CFRunLoopProfileWakeUp(rl, __kCFRunLoopProfileWakeUpForTimer);
             if (!__CFRunLoopDoTimers(rl, rlm, mach_absolute_time())) {
                 // Re-arm the next timer, because we apparently fired early
                 __CFArmNextTimerInMode(rlm, rl);
@@ -2561,6 +3136,12 @@ static int32_t __CFRunLoopRun(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFTimeInter
 #if USE_MK_TIMER_TOO
         else if (rlm->_timerPort != MACH_PORT_NULL && livePort == rlm->_timerPort) {
             CFRUNLOOP_WAKEUP_FOR_TIMER();
+            __CFRunLoopProfileWakeUp(rl, __kCFRunLoopProfileWakeUpForTimer);
+#if DEPLOYMENT_TARGET_LINUX
+            // Read the expiration count so the timerfd stops polling readable; it is re-armed below as needed
+            __CFPortDrain(rlm->_timerPort);
+            rlm->_mkTimerArmed = false;
+#endif
             // On Windows, we have observed an issue where the timer port is set before the time which we requested it to be set. For example, we set the fire time to be TSR 167646765860, but it is actually observed firing at TSR 167646764145, which is 1715 ticks early. The result is that, when __CFRunLoopDoTimers checks to see if any of the run loop timers should be firing, it appears to be 'too early' for the next timer, and no timers are handled.
             // In this case, the timer port has been automatically reset (since it was returned from MsgWaitForMultipleObjectsEx), and if we do not re-arm it, then no timers will ever be serviced again unless something adjusts the timer list (e.g. adding or removing timers). The fix for the issue is to reset the timer here if CFRunLoopDoTimers did not handle a timer itself. 9308754
             if (!__CFRunLoopDoTimers(rl, rlm, mach_absolute_time())) {
@@ -2571,13 +3152,19 @@ static int32_t __CFRunLoopRun(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFTimeInter
 #endif
         else if (livePort == dispatchPort) {
             CFRUNLOOP_WAKEUP_FOR_DISPATCH();
+            __CFRunLoopProfileWakeUp(rl, __kCFRunLoopProfileWakeUpForDispatch);
             __CFRunLoopModeUnlock(rlm);
             __CFRunLoopUnlock(rl);
             _CFSetTSD(__CFTSDKeyIsInGCDMainQ, (void *)6, NULL);
 #if DEPLOYMENT_TARGET_WINDOWS
             void *msg = 0;
+#elif DEPLOYMENT_TARGET_LINUX
+            void *msg = 0;
+            __CFPortDrain(dispatchPort);
 #endif
+            uint64_t calloutStartTSR = __CFRunLoopProfileCalloutBegin(rl);
             __CFRUNLOOP_IS_SERVICING_THE_MAIN_DISPATCH_QUEUE__(msg);
+            __CFRunLoopProfileCalloutEnd(rl, calloutStartTSR, __kCFRunLoopProfileMainQueue, (const void *)_dispatch_main_queue_callback_4CF, NULL);
             _CFSetTSD(__CFTSDKeyIsInGCDMainQ, (void *)0, NULL);
             __CFRunLoopLock(rl);
             __CFRunLoopModeLock(rlm);
@@ -2585,9 +3172,12 @@ static int32_t __CFRunLoopRun(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFTimeInter
             didDispatchPortLastTime = true;
         } else {
             CFRUNLOOP_WAKEUP_FOR_SOURCE();
+            __CFRunLoopProfileWakeUp(rl, __kCFRunLoopProfileWakeUpForSource);
             
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
             // If we received a voucher from this mach_msg, then put a copy of the new voucher into TSD. CFMachPortBoost will look in the TSD for the voucher. By using the value in the TSD we tie the CFMachPortBoost to this received mach_msg explicitly without a chance for anything in between the two pieces of code to set the voucher again.
             voucher_t previousVoucher = _CFSetTSD(__CFTSDKeyMachMessageHasVoucher, (void *)voucherCopy, os_release);
+#endif
 
             // Despite the name, this works for windows handles as well
             CFRunLoopSourceRef rls = __CFRunLoopModeFindSourceForMachPort(rl, rlm, livePort);
@@ -2599,13 +3189,15 @@ static int32_t __CFRunLoopRun(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFTimeInter
 		    (void)mach_msg(reply, MACH_SEND_MSG, reply->msgh_size, 0, MACH_PORT_NULL, 0, MACH_PORT_NULL);
 		    CFAllocatorDeallocate(kCFAllocatorSystemDefault, reply);
 		}
-#elif DEPLOYMENT_TARGET_WINDOWS
+#elif DEPLOYMENT_TARGET_WINDOWS || DEPLOYMENT_TARGET_LINUX
                 sourceHandledThisLoop = __CFRunLoopDoSource1(rl, rlm, rls) || sourceHandledThisLoop;
 #endif
 	    }
             
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
             // Restore the previous voucher
             _CFSetTSD(__CFTSDKeyMachMessageHasVoucher, previousVoucher, os_release);
+#endif
             
         } 
 #if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
@@ -2691,7 +3283,7 @@ CFAbsoluteTime CFRunLoopGetNextTimerFireDate(CFRunLoopRef rl, CFStringRef modeNa
     __CFRunLoopLock(rl);
     CFRunLoopModeRef rlm = __CFRunLoopFindMode(rl, modeName, false);
     CFAbsoluteTime at = 0.0;
-    CFRunLoopTimerRef nextTimer = (rlm && rlm->_timers && 0 < CFArrayGetCount(rlm->_timers)) ? (CFRunLoopTimerRef)CFArrayGetValueAtIndex(rlm->_timers, 0) : NULL;
+    CFRunLoopTimerRef nextTimer = (rlm && rlm->_timers && 0 < CFBinaryHeapGetCount(rlm->_timers)) ? (CFRunLoopTimerRef)CFBinaryHeapGetMinimum(rlm->_timers) : NULL;
     if (nextTimer) {
         at = CFRunLoopTimerGetNextFireDate(nextTimer);
     }
@@ -2722,6 +3314,10 @@ void CFRunLoopWakeUp(CFRunLoopRef rl) {
     if (ret != MACH_MSG_SUCCESS && ret != MACH_SEND_TIMED_OUT) CRASH("*** Unable to send message to wake up port. (%d) ***", ret);
 #elif DEPLOYMENT_TARGET_WINDOWS
     SetEvent(rl->_wakeUpPort);
+#elif DEPLOYMENT_TARGET_LINUX
+    /* Like the Mach case, a write can only fail (EAGAIN) when the counter
+     * is saturated, in which case a wakeup is already pending. */
+    eventfd_write(rl->_wakeUpPort, 1);
 #endif
     __CFRunLoopUnlock(rl);
 }
@@ -2858,15 +3454,19 @@ void CFRunLoopAddSource(CFRunLoopRef rl, CFRunLoopSourceRef rls, CFStringRef mod
 	CFRunLoopModeRef rlm = __CFRunLoopFindMode(rl, modeName, true);
 	if (NULL != rlm && NULL == rlm->_sources0) {
 	    rlm->_sources0 = CFSetCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeSetCallBacks);
+	    rlm->_orderedSources0 = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
 	    rlm->_sources1 = CFSetCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeSetCallBacks);
 	    rlm->_portToV1SourceMap = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, NULL, NULL);
 	}
 	if (NULL != rlm && !CFSetContainsValue(rlm->_sources0, rls) && !CFSetContainsValue(rlm->_sources1, rls)) {
 	    if (0 == rls->_context.version0.version) {
 	        CFSetAddValue(rlm->_sources0, rls);
+	        __CFRunLoopModeInsertOrderedSource0(rlm, rls);
+	        // it may have been signalled before it was added
+	        rlm->_sources0Pending = true;
 	    } else if (1 == rls->_context.version0.version) {
 	        CFSetAddValue(rlm->_sources1, rls);
-		__CFPort src_port = rls->_context.version1.getPort(rls->_context.version1.info);
+		__CFPort src_port = __CFRunLoopSourceGetPort(rls);
 		if (CFPORT_NULL != src_port) {
 		    CFDictionarySetValue(rlm->_portToV1SourceMap, (const void *)(uintptr_t)src_port, rls);
 		    __CFPortSetInsert(src_port, rlm->_portSet);
@@ -2919,13 +3519,17 @@ void CFRunLoopRemoveSource(CFRunLoopRef rl, CFRunLoopSourceRef rls, CFStringRef
 	if (NULL != rlm && ((NULL != rlm->_sources0 && CFSetContainsValue(rlm->_sources0, rls)) || (NULL != rlm->_sources1 && CFSetContainsValue(rlm->_sources1, rls)))) {
 	    CFRetain(rls);
 	    if (1 == rls->_context.version0.version) {
-		__CFPort src_port = rls->_context.version1.getPort(rls->_context.version1.info);
+		__CFPort src_port = __CFRunLoopSourceGetPort(rls);
                 if (CFPORT_NULL != src_port) {
 		    CFDictionaryRemoveValue(rlm->_portToV1SourceMap, (const void *)(uintptr_t)src_port);
                     __CFPortSetRemove(src_port, rlm->_portSet);
                 }
 	    }
-	    CFSetRemoveValue(rlm->_sources0, rls);
+	    if (0 == rls->_context.version0.version) {
+	        CFSetRemoveValue(rlm->_sources0, rls);
+	        CFIndex idx = CFArrayGetFirstIndexOfValue(rlm->_orderedSources0, CFRangeMake(0, CFArrayGetCount(rlm->_orderedSources0)), rls);
+	        if (kCFNotFound != idx) CFArrayRemoveValueAtIndex(rlm->_orderedSources0, idx);
+	    }
 	    CFSetRemoveValue(rlm->_sources1, rls);
             __CFRunLoopSourceLock(rls);
             if (NULL != rls->_runLoops) {
@@ -3115,10 +3719,7 @@ Boolean CFRunLoopContainsTimer(CFRunLoopRef rl, CFRunLoopTimerRef rlt, CFStringR
     } else {
 	CFRunLoopModeRef rlm = __CFRunLoopFindMode(rl, modeName, false);
 	if (NULL != rlm) {
-            if (NULL != rlm->_timers) {
-                CFIndex idx = CFArrayGetFirstIndexOfValue(rlm->_timers, CFRangeMake(0, CFArrayGetCount(rlm->_timers)), rlt);
-                hasValue = (kCFNotFound != idx);
-            }
+            hasValue = (kCFNotFound != __CFRunLoopTimerHeapIndexOfTimer(rlm, rlt));
 	    __CFRunLoopModeUnlock(rlm);
 	}
     }
@@ -3147,9 +3748,7 @@ void CFRunLoopAddTimer(CFRunLoopRef rl, CFRunLoopTimerRef rlt, CFStringRef modeN
 	CFRunLoopModeRef rlm = __CFRunLoopFindMode(rl, modeName, true);
 	if (NULL != rlm) {
             if (NULL == rlm->_timers) {
-                CFArrayCallBacks cb = kCFTypeArrayCallBacks;
-                cb.equal = NULL;
-                rlm->_timers = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &cb);
+                __CFRunLoopTimerHeapCreate(rlm);
             }
 	}
 	if (NULL != rlm && !CFSetContainsValue(rlt->_rlModes, rlm->_name)) {
@@ -3198,12 +3797,8 @@ void CFRunLoopRemoveTimer(CFRunLoopRef rl, CFRunLoopTimerRef rlt, CFStringRef mo
     } else {
 	CFRunLoopModeRef rlm = __CFRunLoopFindMode(rl, modeName, false);
         CFIndex idx = kCFNotFound;
-        CFMutableArrayRef timerList = NULL;
         if (NULL != rlm) {
-            timerList = rlm->_timers;
-            if (NULL != timerList) {
-                idx = CFArrayGetFirstIndexOfValue(timerList, CFRangeMake(0, CFArrayGetCount(timerList)), rlt);
-            }
+            idx = __CFRunLoopTimerHeapIndexOfTimer(rlm, rlt);
         }
         if (kCFNotFound != idx) {
             __CFRunLoopTimerLock(rlt);
@@ -3212,7 +3807,7 @@ void CFRunLoopRemoveTimer(CFRunLoopRef rl, CFRunLoopTimerRef rlt, CFStringRef mo
                 rlt->_runLoop = NULL;
             }
             __CFRunLoopTimerUnlock(rlt);
-	    CFArrayRemoveValueAtIndex(timerList, idx);
+            _CFBinaryHeapRemoveValueAtPosition(rlm->_timers, idx);
             __CFArmNextTimerInMode(rlm, rl);
         }
         if (NULL != rlm) {
@@ -3256,7 +3851,7 @@ static CFStringRef __CFRunLoopSourceCopyDescription(CFTypeRef cf) {	/* DOES CALL
     }
     if (NULL == contextDesc) {
 	void *addr = rls->_context.version0.version == 0 ? (void *)rls->_context.version0.perform : (rls->_context.version0.version == 1 ? (void *)rls->_context.version1.perform : NULL);
-#if DEPLOYMENT_TARGET_WINDOWS
+#if DEPLOYMENT_TARGET_WINDOWS || DEPLOYMENT_TARGET_LINUX
 	contextDesc = CFStringCreateWithFormat(kCFAllocatorSystemDefault, NULL, CFSTR("<CFRunLoopSource context>{version = %ld, info = %p, callout = %p}"), rls->_context.version0.version, rls->_context.version0.info, addr);
 #elif DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
 	Dl_info info;
@@ -3415,21 +4010,25 @@ void CFRunLoopSourceGetContext(CFRunLoopSourceRef rls, CFRunLoopSourceContext *c
     memmove(context, &rls->_context, size);
 }
 
+// Returns true if the source went from unsignalled to signalled
+static Boolean __CFRunLoopSourceSignal(CFRunLoopSourceRef rls) {
+    if (!__CFIsValid(rls) || !__CFRunLoopSourceSetSignaled(rls)) return false;
+    // lost a race with CFRunLoopSourceInvalidate(), which clears the bit under the lock
+    if (!__CFIsValid(rls)) {
+        __CFRunLoopSourceUnsetSignaled(rls);
+        return false;
+    }
+    return true;
+}
+
 void CFRunLoopSourceSignal(CFRunLoopSourceRef rls) {
     CHECK_FOR_FORK();
-    __CFRunLoopSourceLock(rls);
-    if (__CFIsValid(rls)) {
-	__CFRunLoopSourceSetSignaled(rls);
-    }
-    __CFRunLoopSourceUnlock(rls);
+    if (__CFRunLoopSourceSignal(rls)) __CFRunLoopNoteSources0Signaled();
 }
 
 Boolean CFRunLoopSourceIsSignalled(CFRunLoopSourceRef rls) {
     CHECK_FOR_FORK();
-    __CFRunLoopSourceLock(rls);
-    Boolean ret = __CFRunLoopSourceIsSignaled(rls) ? true : false;
-    __CFRunLoopSourceUnlock(rls);
-    return ret;
+    return __CFRunLoopSourceIsSignaled(rls) ? true : false;
 }
 
 CF_PRIVATE void _CFRunLoopSourceWakeUpRunLoops(CFRunLoopSourceRef rls) {
@@ -3445,6 +4044,43 @@ CF_PRIVATE void _CFRunLoopSourceWakeUpRunLoops(CFRunLoopSourceRef rls) {
     }
 }
 
+static void __CFRunLoopSourceCollectLoop(const void *value, void *context) {
+    CFSetAddValue((CFMutableSetRef)context, value);
+}
+
+void _CFRunLoopSourcesSignalAndWakeUp(const CFRunLoopSourceRef *sources, CFIndex count) {
+    CHECK_FOR_FORK();
+    CFMutableSetRef loops = NULL;
+    CFRunLoopSourceRef first = NULL;
+    for (CFIndex idx = 0; idx < count; idx++) {
+        CFRunLoopSourceRef rls = sources[idx];
+        // a source that was already signalled has a wake up on the way
+        if (!__CFRunLoopSourceSignal(rls)) continue;
+        if (NULL == first) {
+            first = rls;
+            continue;
+        }
+        if (NULL == loops) {
+            loops = CFSetCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeSetCallBacks);
+            __CFRunLoopSourceLock(first);
+            if (__CFIsValid(first) && NULL != first->_runLoops) CFBagApplyFunction(first->_runLoops, __CFRunLoopSourceCollectLoop, loops);
+            __CFRunLoopSourceUnlock(first);
+        }
+        __CFRunLoopSourceLock(rls);
+        if (__CFIsValid(rls) && NULL != rls->_runLoops) CFBagApplyFunction(rls->_runLoops, __CFRunLoopSourceCollectLoop, loops);
+        __CFRunLoopSourceUnlock(rls);
+    }
+    if (NULL == first) return;
+    __CFRunLoopNoteSources0Signaled();
+    if (NULL == loops) {
+        _CFRunLoopSourceWakeUpRunLoops(first);
+    } else {
+        // each run loop is woken once, however many of its sources were signalled
+        CFSetApplyFunction(loops, __CFRunLoopSourceWakeUpLoop, NULL);
+        CFRelease(loops);
+    }
+}
+
 /* CFRunLoopObserver */
 
 static CFStringRef __CFRunLoopObserverCopyDescription(CFTypeRef cf) {	/* DOES CALLOUT */
@@ -3457,7 +4093,7 @@ static CFStringRef __CFRunLoopObserverCopyDescription(CFTypeRef cf) {	/* DOES CA
     if (!contextDesc) {
 	contextDesc = CFStringCreateWithFormat(kCFAllocatorSystemDefault, NULL, CFSTR("<CFRunLoopObserver context %p>"), rlo->_context.info);
     }
-#if DEPLOYMENT_TARGET_WINDOWS
+#if DEPLOYMENT_TARGET_WINDOWS || DEPLOYMENT_TARGET_LINUX
     result = CFStringCreateWithFormat(kCFAllocatorSystemDefault, NULL, CFSTR("<CFRunLoopObserver %p [%p]>{valid = %s, activities = 0x%x, repeats = %s, order = %d, callout = %p, context = %@}"), cf, CFGetAllocator(rlo), __CFIsValid(rlo) ? "Yes" : "No", rlo->_activities, __CFRunLoopObserverRepeats(rlo) ? "Yes" : "No", rlo->_order, rlo->_callout, contextDesc);    
 #elif DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
     void *addr = rlo->_callout;
@@ -3720,6 +4356,9 @@ CFRunLoopTimerRef CFRunLoopTimerCreate(CFAllocatorRef allocator, CFAbsoluteTime
     } else {
 	memory->_fireTSR = now2 + __CFTimeIntervalToTSR(fireDate - now1);
     }
+    __CFRunLoopTimerFireTSRLock();
+    memory->_fireSequence = ++__CFRLTFireSequence;
+    __CFRunLoopTimerFireTSRUnlock();
     memory->_callout = callout;
     if (NULL != context) {
 	if (context->retain) {
@@ -3807,7 +4446,7 @@ void CFRunLoopTimerSetNextFireDate(CFRunLoopTimerRef rlt, CFAbsoluteTime fireDat
 	    CFRelease(name);
         }
         __CFRunLoopTimerFireTSRLock();
-	rlt->_fireTSR = nextFireTSR;
+	__CFRunLoopTimerSetFireTSR(rlt, nextFireTSR);
         rlt->_nextFireDate = fireDate;
         for (CFIndex idx = 0; idx < cnt; idx++) {
 	    CFRunLoopModeRef rlm = (CFRunLoopModeRef)modes[idx];
@@ -3829,7 +4468,7 @@ void CFRunLoopTimerSetNextFireDate(CFRunLoopTimerRef rlt, CFAbsoluteTime fireDat
         CFRelease(rl);
      } else {
         __CFRunLoopTimerFireTSRLock();
-	rlt->_fireTSR = nextFireTSR;
+	__CFRunLoopTimerSetFireTSR(rlt, nextFireTSR);
         rlt->_nextFireDate = fireDate;
         __CFRunLoopTimerFireTSRUnlock();
          __CFRunLoopTimerUnlock(rlt);
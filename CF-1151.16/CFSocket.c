@@ -960,6 +960,20 @@ Boolean __CFSocketGetBytesAvailable(CFSocketRef s, CFIndex* ctBytesAvailable) {
 #include <sys/un.h>
 #include <libc.h>
 #include <dlfcn.h>
+#elif DEPLOYMENT_TARGET_LINUX
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/ioctl.h>
+#include <sys/param.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/prctl.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
 #endif
 #include <CoreFoundation/CFArray.h>
 #include <CoreFoundation/CFData.h>
@@ -1003,10 +1017,11 @@ CF_PRIVATE int _NS_gettimeofday(struct timeval *tv, struct timezone *tz);
 
 // On Mach we use a v0 RunLoopSource to make client callbacks.  That source is signalled by a
 // separate SocketManager thread who uses select() to watch the sockets' fds.
+// On Linux the SocketManager thread waits on an epoll instance instead; see __CFSocketUpdateEpollInterest.
 
 //#define LOG_CFSOCKET
 
-#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI || DEPLOYMENT_TARGET_LINUX
 #define INVALID_SOCKET (CFSocketNativeHandle)(-1)
 #define closesocket(a) close((a))
 #define ioctlsocket(a,b,c) ioctl((a),(b),(c))
@@ -1050,6 +1065,11 @@ CF_INLINE Boolean __CFSocketFdSet(CFSocketNativeHandle sock, CFMutableDataRef fd
 #define MAX_SOCKADDR_LEN 256
 #define MAX_DATA_SIZE 65535
 #define MAX_CONNECTION_ORIENTED_DATA_SIZE 32768
+#define MIN_HANDOFF_DATA_SIZE 4096
+#define MAX_SEND_IOVECS 64
+#if !defined(IOV_MAX)
+#define IOV_MAX 1024
+#endif
 
 /* locks are to be acquired in the following order:
    (1) __CFAllSocketsLock
@@ -1065,6 +1085,7 @@ static CFMutableArrayRef __CFReadSockets = NULL;
 static CFMutableDataRef __CFWriteSocketsFds = NULL;
 static CFMutableDataRef __CFReadSocketsFds = NULL;
 static CFDataRef zeroLengthData = NULL;
+static uint8_t *__CFSocketReceiveBuffer = NULL;
 static Boolean __CFReadSocketsTimeoutInvalid = true;  /* rebuild the timeout value before calling select */
 
 static CFSocketNativeHandle __CFWakeupSocketPair[2] = {INVALID_SOCKET, INVALID_SOCKET};
@@ -1232,7 +1253,7 @@ CF_INLINE Boolean __CFSocketFdClr(CFSocketNativeHandle sock, CFMutableDataRef fd
 }
 
 static SInt32 __CFSocketCreateWakeupSocketPair(void) {
-#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI || DEPLOYMENT_TARGET_LINUX
     SInt32 error;
 
     error = socketpair(PF_LOCAL, SOCK_DGRAM, 0, __CFWakeupSocketPair);
@@ -1274,6 +1295,99 @@ static SInt32 __CFSocketCreateWakeupSocketPair(void) {
 }
 
 
+#if DEPLOYMENT_TARGET_LINUX
+// The read and write fd sets remain the record of what each socket is armed for, but rather
+// than have the manager copy them and select() over every fd each time around, every change
+// to them is mirrored into an epoll registration here as it happens. epoll_wait() then sees
+// the change without the manager being woken, and hands back only the fds that are ready.
+static int __CFSocketEpollFd = -1;
+static CFMutableDictionaryRef __CFSocketsByFd = NULL; /* fd -> CFSocketRef (not retained) for registered fds; controlled by __CFActiveSocketsLock */
+
+CF_INLINE Boolean __CFSocketFdIsSet(CFSocketNativeHandle sock, CFDataRef fdSet) {
+    return 0 <= sock && sock < __CFSocketFdGetSize(fdSet) && FD_ISSET(sock, (fd_set *)CFDataGetBytePtr(fdSet));
+}
+
+// Call with __CFActiveSocketsLock held, after s->_socket changed in either fd set
+static void __CFSocketUpdateEpollInterest(CFSocketRef s) {
+    CFSocketNativeHandle sock = s->_socket;
+    if (0 > __CFSocketEpollFd || INVALID_SOCKET == sock || 0 > sock) return;
+    uint32_t events = (__CFSocketFdIsSet(sock, __CFReadSocketsFds) ? EPOLLIN : 0) | (__CFSocketFdIsSet(sock, __CFWriteSocketsFds) ? EPOLLOUT : 0);
+    Boolean registered = CFDictionaryContainsKey(__CFSocketsByFd, (const void *)(uintptr_t)sock);
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = sock;
+    if (0 == events) {
+        if (registered) {
+            // the fd may already have been closed, which removes it from the epoll set by itself
+            epoll_ctl(__CFSocketEpollFd, EPOLL_CTL_DEL, sock, NULL);
+            CFDictionaryRemoveValue(__CFSocketsByFd, (const void *)(uintptr_t)sock);
+        }
+        return;
+    }
+    int ret = -1;
+    // ENOENT: the fd was closed and reused behind our back, so it needs adding afresh
+    if (registered) ret = epoll_ctl(__CFSocketEpollFd, EPOLL_CTL_MOD, sock, &event);
+    if (0 != ret) ret = epoll_ctl(__CFSocketEpollFd, EPOLL_CTL_ADD, sock, &event);
+    if (0 == ret) {
+        CFDictionarySetValue(__CFSocketsByFd, (const void *)(uintptr_t)sock, s);
+    } else {
+        CFLog(kCFLogLevelWarning, CFSTR("*** CFSocket could not watch socket %d: %d"), sock, __CFSocketLastError());
+        if (registered) CFDictionaryRemoveValue(__CFSocketsByFd, (const void *)(uintptr_t)sock);
+    }
+}
+
+// The manager only has to be woken for a change to the read fds when it may move the
+// earliest read buffer timeout, since epoll already sees the change to the fds themselves.
+CF_INLINE Boolean __CFSocketAffectsReadTimeout(CFSocketRef s) {
+    return timerisset(&s->_readBufferTimeout) || NULL != s->_leftoverBytes;
+}
+
+// The manager recomputes the timeout before it next waits, so it never has to wake itself.
+// Until the thread that started the manager has recorded it, this is false, which costs
+// no more than a spurious wakeup.
+CF_INLINE Boolean __CFSocketIsManagerThread(void) {
+    return NULL != __CFSocketManagerThread && pthread_equal(pthread_self(), (pthread_t)__CFSocketManagerThread);
+}
+
+// Version 0 RunLoopSources set a mask in an FD set to control what socket activity we hear about.
+// Changes to the master fs_sets occur via these 4 functions.
+CF_INLINE Boolean __CFSocketSetFDForRead(CFSocketRef s) {
+    Boolean timeoutChanged = __CFSocketAffectsReadTimeout(s);
+    if (timeoutChanged) __CFReadSocketsTimeoutInvalid = true;
+    Boolean b = __CFSocketFdSet(s->_socket, __CFReadSocketsFds);
+    if (b) __CFSocketUpdateEpollInterest(s);
+    if (b && timeoutChanged && INVALID_SOCKET != __CFWakeupSocketPair[0] && !__CFSocketIsManagerThread()) {
+        uint8_t c = 'r';
+        send(__CFWakeupSocketPair[0], (const char *)&c, sizeof(c), 0);
+    }
+    return b;
+}
+
+CF_INLINE Boolean __CFSocketClearFDForRead(CFSocketRef s) {
+    Boolean timeoutChanged = __CFSocketAffectsReadTimeout(s);
+    if (timeoutChanged) __CFReadSocketsTimeoutInvalid = true;
+    Boolean b = __CFSocketFdClr(s->_socket, __CFReadSocketsFds);
+    if (b) __CFSocketUpdateEpollInterest(s);
+    if (b && timeoutChanged && INVALID_SOCKET != __CFWakeupSocketPair[0] && !__CFSocketIsManagerThread()) {
+        uint8_t c = 's';
+        send(__CFWakeupSocketPair[0], (const char *)&c, sizeof(c), 0);
+    }
+    return b;
+}
+
+CF_INLINE Boolean __CFSocketSetFDForWrite(CFSocketRef s) {
+    Boolean b = __CFSocketFdSet(s->_socket, __CFWriteSocketsFds);
+    if (b) __CFSocketUpdateEpollInterest(s);
+    return b;
+}
+
+CF_INLINE Boolean __CFSocketClearFDForWrite(CFSocketRef s) {
+    Boolean b = __CFSocketFdClr(s->_socket, __CFWriteSocketsFds);
+    if (b) __CFSocketUpdateEpollInterest(s);
+    return b;
+}
+#else
 // Version 0 RunLoopSources set a mask in an FD set to control what socket activity we hear about.
 // Changes to the master fs_sets occur via these 4 functions.
 CF_INLINE Boolean __CFSocketSetFDForRead(CFSocketRef s) {
@@ -1315,6 +1429,7 @@ CF_INLINE Boolean __CFSocketClearFDForWrite(CFSocketRef s) {
     }
     return b;
 }
+#endif
 
 #if DEPLOYMENT_TARGET_WINDOWS
 static Boolean WinSockUsed = FALSE;
@@ -1374,6 +1489,19 @@ static void __CFSocketInitializeSockets(void) {
         ioctlsocket(__CFWakeupSocketPair[1], FIONBIO, (u_long *)&yes);
         __CFSocketFdSet(__CFWakeupSocketPair[1], __CFReadSocketsFds);
     }
+#if DEPLOYMENT_TARGET_LINUX
+    __CFSocketsByFd = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, NULL, NULL);
+    __CFSocketEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (0 > __CFSocketEpollFd) {
+        CFLog(kCFLogLevelWarning, CFSTR("*** Could not create epoll instance for CFSocket!!!"));
+    } else if (INVALID_SOCKET != __CFWakeupSocketPair[1]) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = __CFWakeupSocketPair[1];
+        epoll_ctl(__CFSocketEpollFd, EPOLL_CTL_ADD, __CFWakeupSocketPair[1], &event);
+    }
+#endif
 }
 
 static CFRunLoopRef __CFSocketCopyRunLoopToWakeUp(CFRunLoopSourceRef src, CFMutableArrayRef runLoops) {
@@ -1540,17 +1668,13 @@ static void __CFSocketHandleRead(CFSocketRef s, Boolean causedByTimeout)
     CFSocketNativeHandle sock = INVALID_SOCKET;
     if (!CFSocketIsValid(s)) return;
     if (__CFSocketReadCallBackType(s) == kCFSocketDataCallBack) {
-        uint8_t bufferArray[MAX_CONNECTION_ORIENTED_DATA_SIZE], *buffer;
         uint8_t name[MAX_SOCKADDR_LEN];
         int namelen = sizeof(name);
         SInt32 recvlen = 0;
-        if (__CFSocketIsConnectionOriented(s)) {
-            buffer = bufferArray;
-            recvlen = recvfrom(s->_socket, (char *)buffer, MAX_CONNECTION_ORIENTED_DATA_SIZE, 0, (struct sockaddr *)name, (socklen_t *)&namelen);
-        } else {
-            buffer = (uint8_t *)malloc(MAX_DATA_SIZE);
-            if (buffer) recvlen = recvfrom(s->_socket, (char *)buffer, MAX_DATA_SIZE, 0, (struct sockaddr *)name, (socklen_t *)&namelen);
-        }
+        CFIndex maxlen = __CFSocketIsConnectionOriented(s) ? MAX_CONNECTION_ORIENTED_DATA_SIZE : MAX_DATA_SIZE;
+        /* only the manager thread reads here, so the receive buffer needs no lock */
+        if (NULL == __CFSocketReceiveBuffer) __CFSocketReceiveBuffer = (uint8_t *)malloc(MAX_DATA_SIZE);
+        if (__CFSocketReceiveBuffer) recvlen = recvfrom(s->_socket, (char *)__CFSocketReceiveBuffer, maxlen, 0, (struct sockaddr *)name, (socklen_t *)&namelen);
 #if defined(LOG_CFSOCKET)
         fprintf(stdout, "read %ld bytes on socket %d\n", (long)recvlen, s->_socket);
 #endif
@@ -1558,10 +1682,15 @@ static void __CFSocketHandleRead(CFSocketRef s, Boolean causedByTimeout)
             //??? should return error if <0
             /* zero-length data is the signal for perform to invalidate */
             data = (CFDataRef)CFRetain(zeroLengthData);
+        } else if (recvlen < MIN_HANDOFF_DATA_SIZE) {
+            data = CFDataCreate(CFGetAllocator(s), __CFSocketReceiveBuffer, recvlen);
         } else {
-            data = CFDataCreate(CFGetAllocator(s), buffer, recvlen);
+            /* large reads hand the buffer itself to the CFData rather than copying it; a new one is allocated on the next read */
+            uint8_t *buffer = (uint8_t *)realloc(__CFSocketReceiveBuffer, recvlen);
+            if (NULL == buffer) buffer = __CFSocketReceiveBuffer;
+            __CFSocketReceiveBuffer = NULL;
+            data = CFDataCreateWithBytesNoCopy(CFGetAllocator(s), buffer, recvlen, kCFAllocatorMalloc);
         }
-        if (buffer && buffer != bufferArray) free(buffer);
         __CFSocketLock(s);
         if (!__CFSocketIsValid(s)) {
             CFRelease(data);
@@ -1834,8 +1963,15 @@ void __CFSocketSetSocketReadBufferAttrs(CFSocketRef s, CFTimeInterval timeout, C
             fprintf(stdout, "%s(%d): WARNING: shouldn't set read buffer length while data (%ld bytes) is still in the read buffer (leftover total %ld)", __FUNCTION__, __LINE__, ctBuffer, s->_leftoverBytes? CFDataGetLength(s->_leftoverBytes) : 0);
 #endif
             
-            if (s->_leftoverBytes == NULL)
+            if (s->_leftoverBytes == NULL) {
                 s->_leftoverBytes = CFDataCreateMutable(CFGetAllocator(s), 0);
+                /* the socket now wants kicking right away */
+                __CFReadSocketsTimeoutInvalid = true;
+                if (INVALID_SOCKET != __CFWakeupSocketPair[0]) {
+                    uint8_t c = 'b';
+                    send(__CFWakeupSocketPair[0], (const char *)&c, sizeof(c), 0);
+                }
+            }
             
             /* append the current buffered bytes over.  We'll keep draining _leftoverBytes while we have them... */
             CFDataAppendBytes(s->_leftoverBytes, CFDataGetBytePtr(s->_readBuffer) + s->_bytesToBufferReadPos, ctBuffer);
@@ -1879,6 +2015,11 @@ void __CFSocketSetSocketReadBufferAttrs(CFSocketRef s, CFTimeInterval timeout, C
     if (timercmp(&s->_readBufferTimeout, &timeoutVal, !=)) {
         s->_readBufferTimeout = timeoutVal;
         __CFReadSocketsTimeoutInvalid = true;
+        /* a manager thread blocked without a timeout must recompute it */
+        if (INVALID_SOCKET != __CFWakeupSocketPair[0]) {
+            uint8_t c = 'b';
+            send(__CFWakeupSocketPair[0], (const char *)&c, sizeof(c), 0);
+        }
     }
     
     __CFUnlock(&__CFActiveSocketsLock);
@@ -2018,6 +2159,132 @@ static void __CFSocketWriteSocketList(CFArrayRef sockets, CFDataRef fdSet, Boole
 }
 #endif
 
+#if DEPLOYMENT_TARGET_LINUX
+#define __CFSocketManagerMaxEvents 256
+
+static void *__CFSocketManager(void * arg)
+{
+    prctl(PR_SET_NAME, "CFSocket.private", 0, 0, 0);
+    SInt32 idx, nevents;
+    uint8_t buffer[256];
+    struct epoll_event events[__CFSocketManagerMaxEvents];
+    CFMutableArrayRef selectedWriteSockets = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
+    CFMutableArrayRef selectedReadSockets = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
+    CFIndex selectedWriteSocketsIndex = 0, selectedReadSocketsIndex = 0;
+
+    struct timeval tv;
+    struct timeval* pTimeout = NULL;
+    struct timeval timeBeforeWait;
+
+    for (;;) {
+        __CFLock(&__CFActiveSocketsLock);
+        __CFSocketManagerIteration++;
+        if (__CFReadSocketsTimeoutInvalid) {
+            struct timeval* minTimeout = NULL;
+            __CFReadSocketsTimeoutInvalid = false;
+            CFArrayApplyFunction(__CFReadSockets, CFRangeMake(0, CFArrayGetCount(__CFReadSockets)), _calcMinTimeout_locked, (void*) &minTimeout);
+            if (minTimeout == NULL) {
+                pTimeout = NULL;
+            } else {
+                tv = *minTimeout;
+                pTimeout = &tv;
+            }
+        }
+        int timeoutMS = -1;
+        if (pTimeout) {
+            gettimeofday(&timeBeforeWait, NULL);
+            // round up, so a short timeout does not turn into a busy poll
+            long long ms = (long long)pTimeout->tv_sec * 1000 + (pTimeout->tv_usec + 999) / 1000;
+            timeoutMS = (INT_MAX < ms) ? INT_MAX : (int)ms;
+        }
+        __CFUnlock(&__CFActiveSocketsLock);
+
+        nevents = epoll_wait(__CFSocketEpollFd, events, __CFSocketManagerMaxEvents, timeoutMS);
+
+#if defined(LOG_CFSOCKET)
+        fprintf(stdout, "socket manager woke from epoll_wait, ret=%ld\n", (long)nevents);
+#endif
+        if (0 > nevents) {
+            // closed fds leave the epoll set by themselves, so there is no EBADF to recover from here
+            if (EINTR != __CFSocketLastError()) CFLog(kCFLogLevelWarning, CFSTR("*** CFSocket manager epoll_wait failed: %d"), __CFSocketLastError());
+            continue;
+        }
+
+        __CFLock(&__CFActiveSocketsLock);
+        if (0 == nevents && pTimeout) {
+            // expire the buffered reads, exactly as the select() manager does on a timeout
+            for (idx = 0; idx < CFArrayGetCount(__CFReadSockets); idx++) {
+                CFSocketRef s = (CFSocketRef)CFArrayGetValueAtIndex(__CFReadSockets, idx);
+                if ((timerisset(&s->_readBufferTimeout) || s->_leftoverBytes) && __CFSocketFdIsSet(s->_socket, __CFReadSocketsFds)) {
+                    CFArraySetValueAtIndex(selectedReadSockets, selectedReadSocketsIndex, s);
+                    selectedReadSocketsIndex++;
+                    /* socket is removed from fds here, will be restored in read handling or in perform function */
+                    __CFSocketClearFDForRead(s);
+                }
+            }
+            // leftover bytes may have been drained since the timeout was computed
+            __CFReadSocketsTimeoutInvalid = true;
+        }
+        for (idx = 0; idx < nevents; idx++) {
+            CFSocketNativeHandle sock = events[idx].data.fd;
+            if (sock == __CFWakeupSocketPair[1]) {
+                while (0 < recv(__CFWakeupSocketPair[1], (char *)buffer, sizeof(buffer), 0));
+                continue;
+            }
+            CFSocketRef s = (CFSocketRef)CFDictionaryGetValue(__CFSocketsByFd, (const void *)(uintptr_t)sock);
+            if (NULL == s || s->_socket != sock) continue;
+            uint32_t revents = events[idx].events;
+            // errors and hangups are reported to whichever directions are armed, as select() would
+            if ((revents & (EPOLLOUT | EPOLLERR | EPOLLHUP)) && __CFSocketFdIsSet(sock, __CFWriteSocketsFds)) {
+                CFArraySetValueAtIndex(selectedWriteSockets, selectedWriteSocketsIndex, s);
+                selectedWriteSocketsIndex++;
+                /* socket is removed from fds here, restored by CFSocketReschedule */
+                __CFSocketClearFDForWrite(s);
+            }
+            if ((revents & (EPOLLIN | EPOLLERR | EPOLLHUP)) && __CFSocketFdIsSet(sock, __CFReadSocketsFds)) {
+                s->_hitTheTimeout = false;
+                CFArraySetValueAtIndex(selectedReadSockets, selectedReadSocketsIndex, s);
+                selectedReadSocketsIndex++;
+                /* socket is removed from fds here, will be restored in read handling or in perform function */
+                __CFSocketClearFDForRead(s);
+            }
+        }
+        if (pTimeout && 0 != nevents) {
+            // sockets whose buffered read timeout passed while other sockets kept the wait from timing out
+            struct timeval timeNow;
+            gettimeofday(&timeNow, NULL);
+            for (idx = 0; idx < CFArrayGetCount(__CFReadSockets); idx++) {
+                CFSocketRef s = (CFSocketRef)CFArrayGetValueAtIndex(__CFReadSockets, idx);
+                s->_hitTheTimeout = false;
+                if (timerisset(&s->_readBufferTimeoutNotificationTime) && timercmp(&timeNow, &s->_readBufferTimeoutNotificationTime, >) && __CFSocketFdIsSet(s->_socket, __CFReadSocketsFds)) {
+                    s->_hitTheTimeout = true;
+                    CFArraySetValueAtIndex(selectedReadSockets, selectedReadSocketsIndex, s);
+                    selectedReadSocketsIndex++;
+                    __CFSocketClearFDForRead(s);
+                }
+            }
+        }
+        __CFUnlock(&__CFActiveSocketsLock);
+
+        for (idx = 0; idx < selectedWriteSocketsIndex; idx++) {
+            CFSocketRef s = (CFSocketRef)CFArrayGetValueAtIndex(selectedWriteSockets, idx);
+            if (kCFNull == (CFNullRef)s) continue;
+            __CFSocketHandleWrite(s, FALSE);
+            CFArraySetValueAtIndex(selectedWriteSockets, idx, kCFNull);
+        }
+        selectedWriteSocketsIndex = 0;
+
+        for (idx = 0; idx < selectedReadSocketsIndex; idx++) {
+            CFSocketRef s = (CFSocketRef)CFArrayGetValueAtIndex(selectedReadSockets, idx);
+            if (kCFNull == (CFNullRef)s) continue;
+            __CFSocketHandleRead(s, nevents == 0 || s->_hitTheTimeout);
+            CFArraySetValueAtIndex(selectedReadSockets, idx, kCFNull);
+        }
+        selectedReadSocketsIndex = 0;
+    }
+    return NULL;
+}
+#else
 static void
 clearInvalidFileDescriptors(CFMutableDataRef d)
 {
@@ -2314,6 +2581,7 @@ static void *__CFSocketManager(void * arg)
     }
     return NULL;
 }
+#endif
 
 static CFStringRef __CFSocketCopyDescription(CFTypeRef cf) {
     CFSocketRef s = (CFSocketRef)cf;
@@ -2503,7 +2771,9 @@ static CFSocketRef _CFSocketCreateWithNative(CFAllocatorRef allocator, CFSocketN
         pthread_attr_init(&attr);
         pthread_attr_setscope(&attr, PTHREAD_SCOPE_SYSTEM);
         pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+#if !DEPLOYMENT_TARGET_LINUX
         pthread_attr_set_qos_class_np(&attr, qos_class_main(), 0);
+#endif
         pthread_create(&tid, &attr, __CFSocketManager, 0);
         pthread_attr_destroy(&attr);
 //warning CF: we dont actually know that a pthread_t is the same size as void *
@@ -3144,6 +3414,90 @@ CFSocketError CFSocketSendData(CFSocketRef s, CFDataRef address, CFDataRef data,
     return (size > 0) ? kCFSocketSuccess : kCFSocketError;
 }
 
+CFSocketError _CFSocketSendDataVector(CFSocketRef s, CFDataRef address, const CFDataRef *datas, CFIndex count, CFTimeInterval timeout) {
+    CHECK_FOR_FORK();
+    __CFGenericValidateType(s, CFSocketGetTypeID());
+    if (NULL == datas || count <= 0) return kCFSocketError;
+    if (1 == count) return CFSocketSendData(s, address, datas[0], timeout);
+#if DEPLOYMENT_TARGET_WINDOWS
+    // No sendmsg here; gather into one buffer and send that
+    CFMutableDataRef joined = CFDataCreateMutable(kCFAllocatorSystemDefault, 0);
+    for (CFIndex idx = 0; idx < count; idx++) CFDataAppendBytes(joined, CFDataGetBytePtr(datas[idx]), CFDataGetLength(datas[idx]));
+    CFSocketError result = CFSocketSendData(s, address, joined, timeout);
+    CFRelease(joined);
+    return result;
+#else
+    const uint8_t *addrptr = NULL;
+    SInt32 addrlen = 0;
+    CFIndex iovcnt = 0, total = 0, sent = 0;
+    struct iovec iovArray[MAX_SEND_IOVECS], *iovBase = iovArray, *iov;
+    CFSocketNativeHandle sock = INVALID_SOCKET;
+    Boolean failed = false;
+    struct timeval tv;
+    if (address) {
+        addrptr = CFDataGetBytePtr(address);
+        addrlen = CFDataGetLength(address);
+    }
+    if (MAX_SEND_IOVECS < count) iovBase = (struct iovec *)malloc(count * sizeof(struct iovec));
+    if (NULL == iovBase) return kCFSocketError;
+    for (CFIndex idx = 0; idx < count; idx++) {
+        CFIndex len = CFDataGetLength(datas[idx]);
+        if (0 == len) continue;
+        iovBase[iovcnt].iov_base = (void *)CFDataGetBytePtr(datas[idx]);
+        iovBase[iovcnt].iov_len = len;
+        iovcnt++;
+        total += len;
+    }
+    iov = iovBase;
+    if (CFSocketIsValid(s)) sock = CFSocketGetNative(s);
+    if (INVALID_SOCKET != sock && 0 < total) {
+        Boolean connectionOriented = __CFSocketIsConnectionOriented(s);
+        CFRetain(s);
+        __CFSocketWriteLock(s);
+        tv.tv_sec = (timeout <= 0.0 || (CFTimeInterval)INT_MAX <= timeout) ? INT_MAX : (int)floor(timeout);
+        tv.tv_usec = (int)floor(1.0e+6 * (timeout - floor(timeout)));
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (char *)&tv, sizeof(tv));
+        while (0 < iovcnt && !failed) {
+            struct msghdr msg;
+            ssize_t size;
+            memset(&msg, 0, sizeof(msg));
+            if (NULL != addrptr && 0 < addrlen) {
+                msg.msg_name = (void *)addrptr;
+                msg.msg_namelen = addrlen;
+            }
+            msg.msg_iov = iov;
+            // A stream can be fed IOV_MAX pieces at a time; a datagram must go out whole
+            msg.msg_iovlen = (connectionOriented && IOV_MAX < iovcnt) ? IOV_MAX : iovcnt;
+            size = sendmsg(sock, &msg, 0);
+#if defined(LOG_CFSOCKET)
+            fprintf(stdout, "wrote %ld bytes to socket %d\n", (long)size, sock);
+#endif
+            if (size < 0 && EINTR == errno) continue;
+            if (size <= 0) {
+                failed = true;
+                break;
+            }
+            sent += size;
+            if (!connectionOriented) break;
+            // Skip past whatever went out, including a partially written piece
+            while (0 < iovcnt && (size_t)size >= iov->iov_len) {
+                size -= iov->iov_len;
+                iov++;
+                iovcnt--;
+            }
+            if (0 < iovcnt) {
+                iov->iov_base = (uint8_t *)iov->iov_base + size;
+                iov->iov_len -= size;
+            }
+        }
+        __CFSocketWriteUnlock(s);
+        CFRelease(s);
+    }
+    if (iovBase != iovArray) free(iovBase);
+    return (!failed && 0 < total && sent == total) ? kCFSocketSuccess : kCFSocketError;
+#endif
+}
+
 CFSocketError CFSocketSetAddress(CFSocketRef s, CFDataRef address) {
     CHECK_FOR_FORK();
     struct sockaddr *name;
@@ -192,7 +192,17 @@ CF_EXTERN_C_END
  * file.  If the underlying file descriptor is not open, the property
  * value will be NULL (as opposed to containing ((int) -1)).
  */
-CF_EXPORT const CFStringRef _kCFStreamPropertyFileNativeHandle CF_AVAILABLE_IOS(5_0);
+CF_EXPORT const CFStringRef _kCFStreamPropertyFileNativeHandle CF_AVAILABLE(10_10, 5_0);
+
+/*
+ * for CFReadStreamSetProperty on a stream created from a file.  The
+ * value is a CFNumberRef giving a size in bytes.  Readers of the stream
+ * that can, such as CFPropertyListCreateWithStream, map the rest of the
+ * file instead of reading it when at least that many bytes remain.  The
+ * file must then not be truncated while the mapped data is in use.
+ * Unset, or NULL, means the file is always read.
+ */
+CF_EXPORT const CFStringRef _kCFStreamPropertyFileMapThreshold CF_AVAILABLE(10_10, 8_0);
 
 #endif /* ! __COREFOUNDATION_CFSTREAMPRIV__ */
 
@@ -238,6 +238,7 @@ struct __CFTimeZone {
     CFDataRef _data;		/* immutable */
     CFTZPeriod *_periods;	/* immutable */
     int32_t _periodCnt;		/* immutable */
+    CFIndex _lastPeriodIdx;	/* hint only: the period found by the last lookup; racy, always checked before use */
 };
 
 /* startSec is the whole integer seconds from a CFAbsoluteTime, giving dates
@@ -283,16 +284,40 @@ static CFComparisonResult __CFCompareTZPeriods(const void *val1, const void *val
     return kCFCompareGreaterThan;
 }
 
-static CFIndex __CFBSearchTZPeriods(CFTimeZoneRef tz, CFAbsoluteTime at) {
-    CFTZPeriod elem;
-    __CFTZPeriodInit(&elem, (int32_t)floor(at + 1.0), NULL, 0, false);
-    CFIndex idx = CFBSearch(&elem, sizeof(CFTZPeriod), tz->_periods, tz->_periodCnt, __CFCompareTZPeriods, NULL);
-    if (tz->_periodCnt <= idx) {
-	idx = tz->_periodCnt;
-    } else if (0 == idx) {
-	idx = 1;
+/* The period in effect for a time is the last one starting at or before
+ * the time's whole second, or the first period if none does. Lookups for
+ * nearby times find the same or the next period, so the period found last
+ * is checked (along with the one after it) before searching. */
+CF_INLINE Boolean __CFTZPeriodIndexCovers(CFTimeZoneRef tz, CFIndex idx, int32_t sec) {
+    if (0 < idx && sec < __CFTZPeriodStartSeconds(&(tz->_periods[idx]))) return false;
+    return (tz->_periodCnt <= idx + 1) || (sec < __CFTZPeriodStartSeconds(&(tz->_periods[idx + 1])));
+}
+
+static CFIndex __CFTZPeriodIndexForSeconds(CFTimeZoneRef tz, int32_t sec, CFIndex hint) {
+    CFIndex cnt = tz->_periodCnt;
+    if (cnt <= 1) return 0;
+    if (0 <= hint && hint < cnt) {
+	if (__CFTZPeriodIndexCovers(tz, hint, sec)) return hint;
+	if (hint + 1 < cnt && __CFTZPeriodIndexCovers(tz, hint + 1, sec)) return hint + 1;
     }
-    return idx - 1;
+    CFIndex lo = 0, hi = cnt;	/* find the first period starting after sec */
+    while (lo < hi) {
+	CFIndex mid = lo + (hi - lo) / 2;
+	if (__CFTZPeriodStartSeconds(&(tz->_periods[mid])) <= sec) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid;
+	}
+    }
+    return (0 == lo) ? 0 : lo - 1;
+}
+
+static CFIndex __CFBSearchTZPeriods(CFTimeZoneRef tz, CFAbsoluteTime at) {
+    CFIndex hint = tz->_lastPeriodIdx;
+    CFIndex idx = __CFTZPeriodIndexForSeconds(tz, (int32_t)floor(at), hint);
+    // Time zones are shared between threads; only write the hint when it moves, so lookups in the same period leave its cache line clean
+    if (idx != hint) ((struct __CFTimeZone *)tz)->_lastPeriodIdx = idx;
+    return idx;
 }
 
 
@@ -1062,9 +1087,20 @@ CFTimeZoneRef CFTimeZoneCreateWithTimeIntervalFromGMT(CFAllocatorRef allocator,
     return result;
 }
 
+static CFTimeZoneRef __CFTimeZoneCopyCached(CFStringRef name) {
+    CFTimeZoneRef result = NULL;
+    __CFTimeZoneLockGlobal();
+    if (NULL != __CFTimeZoneCache && CFDictionaryGetValueIfPresent(__CFTimeZoneCache, name, (const void **)&result)) {
+	CFRetain(result);
+    }
+    __CFTimeZoneUnlockGlobal();
+    return result;
+}
+
 CFTimeZoneRef CFTimeZoneCreateWithName(CFAllocatorRef allocator, CFStringRef name, Boolean tryAbbrev) {
     CFTimeZoneRef result = NULL;
     CFStringRef tzName = NULL;
+    CFStringRef requestedName = name;
     CFDataRef data = NULL;
 
     if (allocator == NULL) allocator = __CFGetDefaultAllocator();
@@ -1075,12 +1111,8 @@ CFTimeZoneRef CFTimeZoneCreateWithName(CFAllocatorRef allocator, CFStringRef nam
 	// following stuff will fail anyway
 	return NULL;
     }
-    __CFTimeZoneLockGlobal();
-    if (NULL != __CFTimeZoneCache && CFDictionaryGetValueIfPresent(__CFTimeZoneCache, name, (const void **)&result)) {
-	__CFTimeZoneUnlockGlobal();
-	return (CFTimeZoneRef)CFRetain(result);
-    }
-    __CFTimeZoneUnlockGlobal();
+    result = __CFTimeZoneCopyCached(name);
+    if (NULL != result) return result;
     CFIndex len = CFStringGetLength(name);
     if (6 == len || 8 == len) {
 	UniChar buffer[8];
@@ -1119,7 +1151,8 @@ CFTimeZoneRef CFTimeZoneCreateWithName(CFAllocatorRef allocator, CFStringRef nam
     if (tryAbbrev) {
 	CFDictionaryRef abbrevs = CFTimeZoneCopyAbbreviationDictionary();
 	tzName = CFDictionaryGetValue(abbrevs, name);
-	if (NULL != tzName) {
+	if (NULL != tzName) result = __CFTimeZoneCopyCached(tzName);
+	if (NULL != tzName && NULL == result) {
 	    tempURL = CFURLCreateCopyAppendingPathComponent(kCFAllocatorSystemDefault, baseURL, tzName, false);
 	    if (NULL != tempURL) {
 		if (_CFReadBytesFromFile(kCFAllocatorSystemDefault, tempURL, &bytes, &length, 0, 0)) {
@@ -1130,7 +1163,7 @@ CFTimeZoneRef CFTimeZoneCreateWithName(CFAllocatorRef allocator, CFStringRef nam
 	}
 	CFRelease(abbrevs);
     }
-    if (NULL == data) {
+    if (NULL == data && NULL == result) {
 	CFDictionaryRef dict = __CFTimeZoneCopyCompatibilityDictionary();
 	CFStringRef mapping = CFDictionaryGetValue(dict, name);
 	if (mapping) {
@@ -1152,10 +1185,13 @@ CFTimeZoneRef CFTimeZoneCreateWithName(CFAllocatorRef allocator, CFStringRef nam
 	}
 	CFRelease(dict);
 	if (CFEqual(CFSTR(""), name)) {
+	    CFRelease(baseURL);
 	    return NULL;
 	}
+	tzName = name;
+	result = __CFTimeZoneCopyCached(tzName);
     }
-    if (NULL == data) {
+    if (NULL == data && NULL == result) {
        tzName = name;
        tempURL = CFURLCreateCopyAppendingPathComponent(kCFAllocatorSystemDefault, baseURL, tzName, false);
        if (NULL != tempURL) {
@@ -1168,15 +1204,16 @@ CFTimeZoneRef CFTimeZoneCreateWithName(CFAllocatorRef allocator, CFStringRef nam
     CFRelease(baseURL);
     if (NULL != data) {
 	result = CFTimeZoneCreate(allocator, tzName, data);
-	if (name != tzName) {
-	    CFStringRef nameCopy = (CFStringRef)CFStringCreateCopy(allocator, name);
-	    __CFTimeZoneLockGlobal();
-	    CFDictionaryAddValue(__CFTimeZoneCache, nameCopy, result);
-	    __CFTimeZoneUnlockGlobal();
-	    CFRelease(nameCopy);
-	}
 	CFRelease(data);
     }
+    if (NULL != result && !CFEqual(requestedName, tzName)) {
+	// Remember the zone under the name it was asked for too, so abbreviations and old names resolve once
+	CFStringRef nameCopy = (CFStringRef)CFStringCreateCopy(allocator, requestedName);
+	__CFTimeZoneLockGlobal();
+	CFDictionaryAddValue(__CFTimeZoneCache, nameCopy, result);
+	__CFTimeZoneUnlockGlobal();
+	CFRelease(nameCopy);
+    }
     return result;
 }
 
@@ -1220,6 +1257,28 @@ CFTimeInterval CFTimeZoneGetSecondsFromGMT(CFTimeZoneRef tz, CFAbsoluteTime at)
     return __CFTZPeriodGMTOffset(&(tz->_periods[idx]));
 }
 
+void _CFTimeZoneGetSecondsFromGMTForTimes(CFTimeZoneRef tz, const CFAbsoluteTime *times, CFTimeInterval *offsets, CFIndex count) {
+    __CFGenericValidateType(tz, CFTimeZoneGetTypeID());
+    if (count <= 0) return;
+    CFIndex hint = tz->_lastPeriodIdx, idx = hint;
+    if (tz->_periodCnt <= 1) {
+	CFTimeInterval offset = __CFTZPeriodGMTOffset(&(tz->_periods[0]));
+	for (CFIndex tidx = 0; tidx < count; tidx++) offsets[tidx] = offset;
+	return;
+    }
+    for (CFIndex tidx = 0; tidx < count; tidx++) {
+	idx = __CFTZPeriodIndexForSeconds(tz, (int32_t)floor(times[tidx]), idx);
+	offsets[tidx] = __CFTZPeriodGMTOffset(&(tz->_periods[idx]));
+    }
+    if (idx != hint) ((struct __CFTimeZone *)tz)->_lastPeriodIdx = idx;
+}
+
+CF_PRIVATE Boolean _CFTimeZoneGetFixedSecondsFromGMT(CFTimeZoneRef tz, int32_t *seconds) {
+    if (CF_IS_OBJC(CFTimeZoneGetTypeID(), tz) || 1 != tz->_periodCnt) return false;
+    if (seconds) *seconds = __CFTZPeriodGMTOffset(&(tz->_periods[0]));
+    return true;
+}
+
 CFStringRef CFTimeZoneCopyAbbreviation(CFTimeZoneRef tz, CFAbsoluteTime at) {
     CFStringRef result;
     CFIndex idx;
@@ -509,6 +509,23 @@ CF_INLINE Boolean _translateBytes(UniChar ch1, UniChar ch2, uint8_t *result) {
     return true;
 }
 
+// Returns the string's 8-bit backing store when it holds only ASCII, so that character indexes and byte offsets coincide; NULL otherwise
+static const UInt8 *_getASCIIBytePtr(CFStringRef string, CFIndex length) {
+    const UInt8 *bytes = (const UInt8 *)CFStringGetCStringPtr(string, __CFStringGetEightBitStringEncoding());
+    CFIndex idx = 0;
+    if (!bytes) return NULL;
+    // Test a word at a time for high bits; memcpy keeps the loads legal for any alignment
+    for (; idx + (CFIndex)sizeof(uintptr_t) <= length; idx += sizeof(uintptr_t)) {
+        uintptr_t word;
+        memcpy(&word, bytes + idx, sizeof(uintptr_t));
+        if (word & (UINTPTR_MAX / 0xFF * 0x80)) return NULL;
+    }
+    for (; idx < length; idx ++) {
+        if (bytes[idx] & 0x80) return NULL;
+    }
+    return bytes;
+}
+
 CF_INLINE Boolean _haveTestedOriginalString(CFURLRef url) {
     return ((url->_flags & ORIGINAL_AND_URL_STRINGS_MATCH) != 0) || (_getSanitizedString(url) != NULL);
 }
@@ -1085,6 +1102,12 @@ CFStringRef  CFURLCreateStringByReplacingPercentEscapes(CFAllocatorRef alloc, CF
         return (CFStringRef)CFStringCreateCopy(alloc, originalString);
     }
     
+    // Most strings carry no escapes at all; memchr over the 8-bit contents answers that without walking the string a character at a time
+    const UInt8 *asciiBytes = _getASCIIBytePtr(originalString, length);
+    if (asciiBytes && !memchr(asciiBytes, '%', length)) {
+        return (CFStringRef)CFStringCreateCopy(alloc, originalString);
+    }
+    
     if ( escapeAll ) {
         return ( UnescapeAllWithUTF8(alloc, originalString) );
     }
@@ -1338,7 +1361,33 @@ CF_EXPORT CFStringRef CFURLCreateStringByAddingPercentEscapes(CFAllocatorRef all
     if (length == 0) return (CFStringRef)CFStringCreateCopy(allocator, originalString);
     CFStringInitInlineBuffer(originalString, &buf, CFRangeMake(0, length));
 
-    for (idx = 0; idx < length; idx ++) {
+    idx = 0;
+    const UInt8 *asciiBytes = _getASCIIBytePtr(originalString, length);
+    if (asciiBytes) {
+        // Fold both character sets into a table over ASCII once, then skip the prefix that needs no escaping straight from the 8-bit contents
+        Boolean escapeTable[128];
+        CFIndex ch;
+        for (ch = 0; ch < 128; ch ++) {
+            escapeTable[ch] = !isURLLegalCharacter(ch);
+        }
+        if (charactersToLeaveUnescaped) {
+            CFIndex i, c = CFStringGetLength(charactersToLeaveUnescaped);
+            for (i = 0; i < c; i ++) {
+                UniChar setCh = CFStringGetCharacterAtIndex(charactersToLeaveUnescaped, i);
+                if (setCh < 128 && !isURLLegalCharacter(setCh)) escapeTable[setCh] = false;
+            }
+        }
+        if (legalURLCharactersToBeEscaped) {
+            CFIndex i, c = CFStringGetLength(legalURLCharactersToBeEscaped);
+            for (i = 0; i < c; i ++) {
+                UniChar setCh = CFStringGetCharacterAtIndex(legalURLCharactersToBeEscaped, i);
+                if (setCh < 128 && isURLLegalCharacter(setCh)) escapeTable[setCh] = true;
+            }
+        }
+        while (idx < length && !escapeTable[asciiBytes[idx]]) idx ++;
+    }
+
+    for (; idx < length; idx ++) {
         UniChar ch = __CFStringGetCharacterFromInlineBufferQuick(&buf, idx);
         Boolean shouldReplace = (isURLLegalCharacter(ch) == false);
         if (shouldReplace) {
@@ -2469,8 +2518,8 @@ CFURLRef CFURLCreateAbsoluteURLWithBytes(CFAllocatorRef alloc, const UInt8 *rela
     return ( result );
 }
 
-/* This function is this way because I pulled it out of _resolvedURLPath (so that _resolvedFileSystemPath could use it), and I didn't want to spend a bunch of energy reworking the code.  So instead of being a bit more intelligent about inputs, it just demands a slightly perverse set of parameters, to match the old _resolvedURLPath code.  -- REW, 6/14/99 */
-static CFStringRef _resolvedPath(UniChar *pathStr, UniChar *end, UniChar pathDelimiter, Boolean stripLeadingDotDots, Boolean stripTrailingDelimiter, CFAllocatorRef alloc) {
+/* Compacts the "." and ".." components of the NUL-terminated path in place and returns its new end.  pathStr must have room for at least three characters. */
+static UniChar *_resolvePathInPlace(UniChar *pathStr, UniChar *end, UniChar pathDelimiter, Boolean stripLeadingDotDots, Boolean stripTrailingDelimiter) {
     UniChar *idx = pathStr;
     while (idx < end) {
         if (*idx == '.') {
@@ -2535,6 +2584,12 @@ static CFStringRef _resolvedPath(UniChar *pathStr, UniChar *end, UniChar pathDel
     if (stripTrailingDelimiter && end > pathStr && end-1 != pathStr && *(end-1) == pathDelimiter) {
         end --;
     }
+    return end;
+}
+
+/* This function is this way because I pulled it out of _resolvedURLPath (so that _resolvedFileSystemPath could use it), and I didn't want to spend a bunch of energy reworking the code.  So instead of being a bit more intelligent about inputs, it just demands a slightly perverse set of parameters, to match the old _resolvedURLPath code.  -- REW, 6/14/99 */
+static CFStringRef _resolvedPath(UniChar *pathStr, UniChar *end, UniChar pathDelimiter, Boolean stripLeadingDotDots, Boolean stripTrailingDelimiter, CFAllocatorRef alloc) {
+    end = _resolvePathInPlace(pathStr, end, pathDelimiter, stripLeadingDotDots, stripTrailingDelimiter);
     // return an zero-length string if end < pathStr
     return CFStringCreateWithCharactersNoCopy(alloc, pathStr, end >= pathStr ? end - pathStr : 0, alloc);
 }
@@ -2569,7 +2624,7 @@ static CFMutableStringRef resolveAbsoluteURLStringBuffer(CFAllocatorRef alloc, C
         if (relFlags & HAS_PATH) {
             CFRange relPathRg = _rangeForComponent(relFlags, relRanges, HAS_PATH);
             CFRange basePathRg = _rangeForComponent(baseFlags, baseRanges, HAS_PATH);
-            CFStringRef newPath;
+            CFIndex newPathLength;
             Boolean useRelPath = false;
             Boolean useBasePath = false;
             if (basePathRg.location == kCFNotFound) {
@@ -2582,21 +2637,23 @@ static CFMutableStringRef resolveAbsoluteURLStringBuffer(CFAllocatorRef alloc, C
                 useRelPath = true;
             }
             if (useRelPath) {
-                newPath = CFStringCreateWithSubstring(alloc, relString, relPathRg);
+                CFStringGetCharacters(relString, relPathRg, buf);
+                newPathLength = relPathRg.length;
             } else if (useBasePath) {
-                newPath = CFStringCreateWithSubstring(alloc, baseString, basePathRg);
+                CFStringGetCharacters(baseString, basePathRg, buf);
+                newPathLength = basePathRg.length;
             } else {
-                // FIXME: Get rid of this allocation
-                UniChar *newPathBuf = (UniChar *)CFAllocatorAllocate(alloc, sizeof(UniChar) * (relPathRg.length + basePathRg.length + 1), 0);
+                // Merge the relative path onto the base path's directory and resolve it in buf, which has room for both paths and a terminator
                 UniChar *idx, *end;
-                CFStringGetCharacters(baseString, basePathRg, newPathBuf);
-                idx = newPathBuf + basePathRg.length - 1;
-                while (idx != newPathBuf && *idx != '/') idx --;
+                CFStringGetCharacters(baseString, basePathRg, buf);
+                idx = buf + basePathRg.length - 1;
+                while (idx != buf && *idx != '/') idx --;
                 if (*idx == '/') idx ++;
                 CFStringGetCharacters(relString, relPathRg, idx);
                 end = idx + relPathRg.length;
                 *end = 0;
-                newPath = _resolvedPath(newPathBuf, end, '/', false, false, alloc);
+                end = _resolvePathInPlace(buf, end, '/', false, false);
+                newPathLength = end >= buf ? end - buf : 0;
             }
             /* Under Win32 absolute path can begin with letter
              * so we have to add one '/' to the newString
@@ -2609,13 +2666,12 @@ static CFMutableStringRef resolveAbsoluteURLStringBuffer(CFAllocatorRef alloc, C
             
             // if the relative URL does not begin with a slash and
             // the base does not end with a slash, add a slash
-            if ((basePathRg.location == kCFNotFound || basePathRg.length == 0) && CFStringGetCharacterAtIndex(newPath, 0) != '/') {
+            if ((basePathRg.location == kCFNotFound || basePathRg.length == 0) && 0 < newPathLength && buf[0] != '/') {
                 chars[0] = '/';
                 CFStringAppendCharactersToAppendBuffer(&appendBuffer, chars, 1);
             }
             
-            CFStringAppendStringToAppendBuffer(&appendBuffer, newPath);
-            CFRelease(newPath);
+            CFStringAppendCharactersToAppendBuffer(&appendBuffer, buf, newPathLength);
             rg.location = relPathRg.location + relPathRg.length;
             rg.length = CFStringGetLength(relString);
             if (rg.length > rg.location) {
@@ -2687,7 +2743,7 @@ static CFMutableStringRef resolveAbsoluteURLStringBuffer(CFAllocatorRef alloc, C
 
 static CFMutableStringRef resolveAbsoluteURLString(CFAllocatorRef alloc, CFStringRef relString, UInt32 relFlags, const CFRange *relRanges, CFStringRef baseString, UInt32 baseFlags, const CFRange *baseRanges) {
     CFMutableStringRef result;
-    CFIndex bufLen = CFStringGetLength(baseString) + CFStringGetLength(relString); // Overkill, but guarantees we never allocate again
+    CFIndex bufLen = CFStringGetLength(baseString) + CFStringGetLength(relString) + 3; // Overkill, but guarantees we never allocate again; the extra room is for the terminator and "./" written when resolving a merged path
     if ( bufLen <= 1024 ) {
         STACK_BUFFER_DECL(UniChar, buf, bufLen);
         result = resolveAbsoluteURLStringBuffer(alloc, relString, relFlags, relRanges, baseString, baseFlags, baseRanges, buf);
@@ -3521,6 +3577,33 @@ CFRange CFURLGetByteRangeForComponent(CFURLRef url, CFURLComponentType component
     return byteRange;
 }
 
+Boolean _CFURLGetComponentByteRanges(CFURLRef url, const UInt8 **bytes, CFIndex *length, CFRange *ranges, CFRange *rangesIncludingSeparators) {
+    CFURLComponentType component;
+    CFIndex stringLength;
+    const UInt8 *asciiBytes;
+    url = _CFURLFromNSURL(url);
+    if (!__CFStringEncodingIsSupersetOfASCII(url->_encoding)) return false;
+    stringLength = CFStringGetLength(url->_string);
+    asciiBytes = _getASCIIBytePtr(url->_string, stringLength);
+    if (!asciiBytes) return false;
+
+    // With ASCII contents the parse-time character ranges are already byte ranges, so they can be handed out as they are
+    for (component = kCFURLComponentScheme; component <= kCFURLComponentFragment; component ++) {
+        CFRange charRangeWithSeparators;
+        if (!(url->_flags & IS_DECOMPOSABLE)) {
+            ranges[component - 1] = _getCharRangeInNonDecomposableURL(url, component, &charRangeWithSeparators);
+        } else {
+            ranges[component - 1] = _getCharRangeInDecomposableURL(url, component, &charRangeWithSeparators);
+        }
+        if (rangesIncludingSeparators) {
+            rangesIncludingSeparators[component - 1] = (charRangeWithSeparators.location == kCFNotFound) ? CFRangeMake(kCFNotFound, 0) : charRangeWithSeparators;
+        }
+    }
+    *bytes = asciiBytes;
+    if (length) *length = stringLength;
+    return true;
+}
+
 /* Component support */
 
 static Boolean decomposeToNonHierarchical(CFURLRef url, CFURLComponentsNonHierarchical *components) {
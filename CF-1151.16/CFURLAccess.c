@@ -274,10 +274,21 @@ static Boolean _CFFileURLWritePropertiesToResource(CFURLRef url, CFDictionaryRef
     return result;
 }
 
-static Boolean _CFFileURLCreateDataAndPropertiesFromResource(CFAllocatorRef alloc, CFURLRef url, CFDataRef *fetchedData, CFArrayRef desiredProperties, CFDictionaryRef *fetchedProperties, SInt32 *errorCode) {
+// Files of at least mapThreshold bytes are mapped rather than read; 0 means always read
+static Boolean _CFFileURLCreateDataAndPropertiesFromResource(CFAllocatorRef alloc, CFURLRef url, CFDataRef *fetchedData, CFArrayRef desiredProperties, CFDictionaryRef *fetchedProperties, CFIndex mapThreshold, SInt32 *errorCode) {
     Boolean success = true;
 
     if (errorCode) *errorCode = 0;
+#if !DEPLOYMENT_TARGET_WINDOWS
+    if (fetchedData && 0 < mapThreshold) {
+        char path[CFMaxPathSize];
+        *fetchedData = CFURLGetFileSystemRepresentation(url, true, (uint8_t *)path, CFMaxPathSize) ? _CFDataCreateWithMappedPath(alloc, path, mapThreshold) : NULL;
+        if (!*fetchedData) {
+            if (errorCode) *errorCode = kCFURLUnknownError;
+            success = false;
+        }
+    } else
+#endif
     if (fetchedData) {
         void *bytes;
         CFIndex length;
@@ -316,6 +327,20 @@ static Boolean _CFFileURLCreateDataAndPropertiesFromResource(CFAllocatorRef allo
     return success;
 }
 
+CFDataRef _CFDataCreateWithMappedFile(CFAllocatorRef alloc, CFURLRef url, CFIndex mapThreshold) {
+    char path[CFMaxPathSize];
+    if (!CFURLGetFileSystemRepresentation(url, true, (uint8_t *)path, CFMaxPathSize)) return NULL;
+#if DEPLOYMENT_TARGET_WINDOWS
+    void *bytes;
+    CFIndex length;
+    if (!alloc) alloc = __CFGetDefaultAllocator();
+    if (!_CFReadBytesFromFile(alloc, url, &bytes, &length, 0, 0)) return NULL;
+    return CFDataCreateWithBytesNoCopy(alloc, (const UInt8 *)bytes, length, alloc);
+#else
+    return _CFDataCreateWithMappedPath(alloc, path, (0 < mapThreshold) ? mapThreshold : 1);
+#endif
+}
+
 /*
  * Support for data: URLs - RFC 2397
  * Currently this is spi for CFNetwork, to make it API, just put these constants in CFURLAccess.h
@@ -716,6 +741,10 @@ static Boolean _CFDataURLCreateDataAndPropertiesFromResource(CFAllocatorRef allo
 /*************************/
 
 Boolean CFURLCreateDataAndPropertiesFromResource(CFAllocatorRef alloc, CFURLRef url, CFDataRef *fetchedData, CFDictionaryRef *fetchedProperties, CFArrayRef desiredProperties, SInt32 *errorCode) {
+    return _CFURLCreateDataAndPropertiesFromResourceMappingData(alloc, url, fetchedData, fetchedProperties, desiredProperties, 0, errorCode);
+}
+
+Boolean _CFURLCreateDataAndPropertiesFromResourceMappingData(CFAllocatorRef alloc, CFURLRef url, CFDataRef *fetchedData, CFDictionaryRef *fetchedProperties, CFArrayRef desiredProperties, CFIndex mapThreshold, SInt32 *errorCode) {
     CFStringRef scheme = CFURLCopyScheme(url);
 
     if (!scheme) {
@@ -726,7 +755,7 @@ Boolean CFURLCreateDataAndPropertiesFromResource(CFAllocatorRef alloc, CFURLRef
     } else {
         Boolean result;
         if (CFStringCompare(scheme, CFSTR("file"), kCFCompareCaseInsensitive) == kCFCompareEqualTo) {
-            result = _CFFileURLCreateDataAndPropertiesFromResource(alloc, url, fetchedData, desiredProperties, fetchedProperties, errorCode);
+            result = _CFFileURLCreateDataAndPropertiesFromResource(alloc, url, fetchedData, desiredProperties, fetchedProperties, mapThreshold, errorCode);
         } else if (CFStringCompare(scheme, CFSTR("data"), kCFCompareCaseInsensitive) == kCFCompareEqualTo) {
 	    result = _CFDataURLCreateDataAndPropertiesFromResource(alloc, url, fetchedData, desiredProperties, fetchedProperties, errorCode);
 	} else {
@@ -27,35 +27,25 @@
 */
 
 #include <CoreFoundation/CFUUID.h>
+#include <CoreFoundation/CFPriv.h>
 #include "CFInternal.h"
 
-#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_WINDOWS
-#include <dispatch/dispatch.h>
+// Uniqued UUIDs are spread over several tables, each with its own lock, so threads creating unrelated UUIDs rarely contend. The tables do not retain their values; a CFUUID removes itself from its table when it is deallocated.
+#define __CFUUIDStripeCount 16
 
-static CFMutableDictionaryRef _uniquedUUIDs = NULL;
-CF_INLINE void LOCKED(dispatch_block_t work) {
-    static dispatch_once_t guard;
-    static dispatch_queue_t CFUUIDGlobalDataLock;
-    dispatch_once(&guard, ^{
-        dispatch_queue_attr_t dqattr = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, qos_class_main(), 0);
-        CFUUIDGlobalDataLock = dispatch_queue_create("com.apple.CFUUID", dqattr);
-    });
-    dispatch_sync(CFUUIDGlobalDataLock, work);
-}
-
-#else
-// Platforms without dispatch
-
-static CFMutableDictionaryRef _uniquedUUIDs = NULL;
-static CFLock_t _uniquedUUIDsLock = CFLockInit;
-
-CF_INLINE void LOCKED(void (^work)(void)) {
-    __CFLock(&_uniquedUUIDsLock);
-    work();
-    __CFUnlock(&_uniquedUUIDsLock);
-}
-
-#endif
+typedef struct {
+    CFLock_t lock;
+    CFMutableDictionaryRef uuids;
+} __CFUUIDStripe;
+
+#define __CFUUIDStripeInit {CFLockInit, NULL}
+static __CFUUIDStripe __CFUUIDStripes[__CFUUIDStripeCount] = {
+    __CFUUIDStripeInit, __CFUUIDStripeInit, __CFUUIDStripeInit, __CFUUIDStripeInit,
+    __CFUUIDStripeInit, __CFUUIDStripeInit, __CFUUIDStripeInit, __CFUUIDStripeInit,
+    __CFUUIDStripeInit, __CFUUIDStripeInit, __CFUUIDStripeInit, __CFUUIDStripeInit,
+    __CFUUIDStripeInit, __CFUUIDStripeInit, __CFUUIDStripeInit, __CFUUIDStripeInit,
+};
+#undef __CFUUIDStripeInit
 
 struct __CFUUID {
     CFRuntimeBase _base;
@@ -174,7 +164,13 @@ static void grow_has_lock() {
 
 /***** end of weak set */
 
-static void __CFUUIDAddUniqueUUIDHasLock(CFUUIDRef uuid) {
+CF_INLINE __CFUUIDStripe *__CFUUIDStripeForBytes(const CFUUIDBytes *bytes) {
+    // The GC weak set is a single table, so it stays behind a single lock
+    if (kCFUseCollectableAllocator) return &__CFUUIDStripes[0];
+    return &__CFUUIDStripes[__CFhashUUIDBytes(bytes) & (__CFUUIDStripeCount - 1)];
+}
+
+static void __CFUUIDAddUniqueUUIDHasLock(__CFUUIDStripe *stripe, CFUUIDRef uuid) {
     CFDictionaryKeyCallBacks __CFUUIDBytesDictionaryKeyCallBacks = {0, NULL, NULL, NULL, __CFisEqualUUIDBytes, __CFhashUUIDBytes};
     CFDictionaryValueCallBacks __CFnonRetainedUUIDDictionaryValueCallBacks = {0, NULL, NULL, CFCopyDescription, CFEqual};
 
@@ -182,21 +178,21 @@ static void __CFUUIDAddUniqueUUIDHasLock(CFUUIDRef uuid) {
         enter_has_lock((__CFUUID_t *)uuid);
         if (_UUIDWeakSet.count > (3 * _UUIDWeakSet.size / 4)) grow_has_lock();
     } else {
-        if (!_uniquedUUIDs) _uniquedUUIDs = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, &__CFUUIDBytesDictionaryKeyCallBacks, &__CFnonRetainedUUIDDictionaryValueCallBacks);
-        CFDictionarySetValue(_uniquedUUIDs, &(uuid->_bytes), uuid);
+        if (!stripe->uuids) stripe->uuids = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, &__CFUUIDBytesDictionaryKeyCallBacks, &__CFnonRetainedUUIDDictionaryValueCallBacks);
+        CFDictionarySetValue(stripe->uuids, &(uuid->_bytes), uuid);
     }
 }
 
-static void __CFUUIDRemoveUniqueUUIDHasLock(CFUUIDRef uuid) {
-    if (_uniquedUUIDs) CFDictionaryRemoveValue(_uniquedUUIDs, &(uuid->_bytes));
+static void __CFUUIDRemoveUniqueUUIDHasLock(__CFUUIDStripe *stripe, CFUUIDRef uuid) {
+    if (stripe->uuids) CFDictionaryRemoveValue(stripe->uuids, &(uuid->_bytes));
 }
 
-static CFUUIDRef __CFUUIDGetUniquedUUIDHasLock(const CFUUIDBytes *bytes) {
+static CFUUIDRef __CFUUIDGetUniquedUUIDHasLock(__CFUUIDStripe *stripe, const CFUUIDBytes *bytes) {
     CFUUIDRef uuid = NULL;
     if (kCFUseCollectableAllocator) {
         uuid = (CFUUIDRef)find_has_lock(bytes);
-    } else if (_uniquedUUIDs) {
-        uuid = (CFUUIDRef)CFDictionaryGetValue(_uniquedUUIDs, bytes);
+    } else if (stripe->uuids) {
+        uuid = (CFUUIDRef)CFDictionaryGetValue(stripe->uuids, bytes);
     }
     return uuid;
 }
@@ -205,9 +201,10 @@ static void __CFUUIDDeallocate(CFTypeRef cf) {
     if (kCFUseCollectableAllocator) return;
     
     __CFUUID_t *uuid = (__CFUUID_t *)cf;
-    LOCKED(^{
-    __CFUUIDRemoveUniqueUUIDHasLock(uuid);
-    });
+    __CFUUIDStripe *stripe = __CFUUIDStripeForBytes(&uuid->_bytes);
+    __CFLock(&stripe->lock);
+    __CFUUIDRemoveUniqueUUIDHasLock(stripe, uuid);
+    __CFUnlock(&stripe->lock);
 }
 
 static CFStringRef __CFUUIDCopyDescription(CFTypeRef cf) {
@@ -242,22 +239,23 @@ CFTypeID CFUUIDGetTypeID(void) {
 }
 
 static CFUUIDRef __CFUUIDCreateWithBytesPrimitive(CFAllocatorRef allocator, CFUUIDBytes bytes, Boolean isConst) {
-    __block __CFUUID_t *uuid = NULL;
-    LOCKED(^{
-        uuid = (__CFUUID_t *)__CFUUIDGetUniquedUUIDHasLock(&bytes);
-        if (!uuid) {
-            size_t size;
-            size = sizeof(__CFUUID_t) - sizeof(CFRuntimeBase);
-            uuid = (__CFUUID_t *)_CFRuntimeCreateInstance(kCFUseCollectableAllocator ? kCFAllocatorSystemDefault : allocator, CFUUIDGetTypeID(), size, NULL);
-            
-            if (!uuid) return;
-            
+    __CFUUIDStripe *stripe = __CFUUIDStripeForBytes(&bytes);
+    __CFUUID_t *uuid = NULL;
+    __CFLock(&stripe->lock);
+    uuid = (__CFUUID_t *)__CFUUIDGetUniquedUUIDHasLock(stripe, &bytes);
+    if (!uuid) {
+        size_t size;
+        size = sizeof(__CFUUID_t) - sizeof(CFRuntimeBase);
+        uuid = (__CFUUID_t *)_CFRuntimeCreateInstance(kCFUseCollectableAllocator ? kCFAllocatorSystemDefault : allocator, CFUUIDGetTypeID(), size, NULL);
+
+        if (uuid) {
             uuid->_bytes = bytes;
-            __CFUUIDAddUniqueUUIDHasLock(uuid);
-        } else if (!isConst) {
-            CFRetain(uuid);
+            __CFUUIDAddUniqueUUIDHasLock(stripe, uuid);
         }
-    });
+    } else if (!isConst) {
+        CFRetain(uuid);
+    }
+    __CFUnlock(&stripe->lock);
 
     return (CFUUIDRef)uuid;
 }
@@ -266,37 +264,141 @@ static CFUUIDRef __CFUUIDCreateWithBytesPrimitive(CFAllocatorRef allocator, CFUU
 #include <Rpc.h>
 #elif DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED
 #include <uuid/uuid.h>
+#elif DEPLOYMENT_TARGET_LINUX
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
-CFUUIDRef CFUUIDCreate(CFAllocatorRef alloc) {
-    /* Create a new bytes struct and then call the primitive. */
-    __block CFUUIDBytes bytes;
-    __block uint32_t retval = 0;
-    
-    LOCKED(^{
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_LINUX
+/* Random UUIDs are carved out of a per-thread buffer of CSPRNG output, so the kernel is entered once per __CFUUIDRandomBufferSize / 16 UUIDs rather than once per UUID. Bytes are wiped from the buffer as they are handed out, and a forked child discards the buffers it inherited, since the parent will hand out the same bytes. */
+#define __CFUUIDRandomBufferSize 512
+
+typedef struct {
+    int32_t forkGeneration;
+    uint32_t used;
+    uint8_t bytes[__CFUUIDRandomBufferSize];
+} __CFUUIDRandomBuffer;
+
+static volatile int32_t __CFUUIDForkGeneration = 0;
+static pthread_once_t __CFUUIDAtForkOnce = PTHREAD_ONCE_INIT;
+
+static void __CFUUIDAtForkChild(void) {
+    __CFUUIDForkGeneration++;
+}
+
+static void __CFUUIDRegisterAtFork(void) {
+    pthread_atfork(NULL, NULL, __CFUUIDAtForkChild);
+}
+
+static void __CFUUIDRandomBufferDestructor(void *context) {
+    memset(context, 0, sizeof(__CFUUIDRandomBuffer));
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, context);
+}
+
+static Boolean __CFUUIDFillRandomBytes(uint8_t *bytes, size_t length) {
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED
+    arc4random_buf(bytes, length);
+    return true;
+#else
+#if defined(SYS_getrandom)
+    while (length > 0) {
+        long result = syscall(SYS_getrandom, bytes, length, 0);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        bytes += result;
+        length -= result;
+    }
+    if (length == 0) return true;
+#endif
+    // Kernels older than 3.17 have no getrandom()
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    while (length > 0) {
+        ssize_t result = read(fd, bytes, length);
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) break;
+        bytes += result;
+        length -= result;
+    }
+    close(fd);
+    return (length == 0);
+#endif
+}
+
+static Boolean __CFUUIDGetRandomBytes(CFUUIDBytes *bytes) {
+    __CFUUIDRandomBuffer *buffer = (__CFUUIDRandomBuffer *)_CFGetTSD(__CFTSDKeyUUIDRandomBuffer);
+    if (!buffer) {
+        pthread_once(&__CFUUIDAtForkOnce, __CFUUIDRegisterAtFork);
+        buffer = (__CFUUIDRandomBuffer *)CFAllocatorAllocate(kCFAllocatorSystemDefault, sizeof(__CFUUIDRandomBuffer), 0);
+        if (!buffer) return false;
+        buffer->forkGeneration = __CFUUIDForkGeneration;
+        buffer->used = __CFUUIDRandomBufferSize;
+        _CFSetTSD(__CFTSDKeyUUIDRandomBuffer, buffer, __CFUUIDRandomBufferDestructor);
+    }
+    if (buffer->forkGeneration != __CFUUIDForkGeneration) {
+        buffer->forkGeneration = __CFUUIDForkGeneration;
+        buffer->used = __CFUUIDRandomBufferSize;
+    }
+    if (buffer->used + sizeof(CFUUIDBytes) > __CFUUIDRandomBufferSize) {
+        if (!__CFUUIDFillRandomBytes(buffer->bytes, __CFUUIDRandomBufferSize)) return false;
+        buffer->used = 0;
+    }
+    memcpy(bytes, buffer->bytes + buffer->used, sizeof(CFUUIDBytes));
+    memset(buffer->bytes + buffer->used, 0, sizeof(CFUUIDBytes));
+    buffer->used += sizeof(CFUUIDBytes);
+    // RFC 4122 version 4, variant 10
+    bytes->byte6 = (bytes->byte6 & 0x0F) | 0x40;
+    bytes->byte8 = (bytes->byte8 & 0x3F) | 0x80;
+    return true;
+}
+#endif
+
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED
+static Boolean __CFUUIDUseV1UUIDs = false;
+static pthread_once_t __CFUUIDVersionOnce = PTHREAD_ONCE_INIT;
+
+static void __CFUUIDReadVersion(void) {
+    const char *value = __CFgetenv("CFUUIDVersionNumber");
+    if (value) {
+        if (1 == strtoul_l(value, NULL, 0, NULL)) __CFUUIDUseV1UUIDs = true;
+    }
+}
+#endif
+
+static Boolean __CFUUIDGenerateBytes(CFUUIDBytes *bytes) {
 #if DEPLOYMENT_TARGET_WINDOWS
-        UUID u;
-        long rStatus = UuidCreate(&u);
-        if (RPC_S_OK != rStatus && RPC_S_UUID_LOCAL_ONLY != rStatus) retval = 1;
-        memmove(&bytes, &u, sizeof(bytes));
+    UUID u;
+    long rStatus = UuidCreate(&u);
+    if (RPC_S_OK != rStatus && RPC_S_UUID_LOCAL_ONLY != rStatus) return false;
+    memmove(bytes, &u, sizeof(CFUUIDBytes));
+    return true;
 #elif DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED
-        static Boolean useV1UUIDs = false, checked = false;
+    pthread_once(&__CFUUIDVersionOnce, __CFUUIDReadVersion);
+    if (__CFUUIDUseV1UUIDs) {
         uuid_t uuid;
-        if (!checked) {
-            const char *value = __CFgetenv("CFUUIDVersionNumber");
-            if (value) {
-                if (1 == strtoul_l(value, NULL, 0, NULL)) useV1UUIDs = true;
-            }
-            checked = true;
-        }
-        if (useV1UUIDs) uuid_generate_time(uuid); else uuid_generate_random(uuid);
-        memcpy((void *)&bytes, uuid, sizeof(uuid));
+        uuid_generate_time(uuid);
+        memcpy((void *)bytes, uuid, sizeof(uuid));
+        return true;
+    }
+    return __CFUUIDGetRandomBytes(bytes);
+#elif DEPLOYMENT_TARGET_LINUX
+    return __CFUUIDGetRandomBytes(bytes);
 #else
-        retval = 1;
+    return false;
 #endif
-    });
+}
+
+CFUUIDRef CFUUIDCreate(CFAllocatorRef alloc) {
+    /* Create a new bytes struct and then call the primitive. */
+    CFUUIDBytes bytes;
+    return __CFUUIDGenerateBytes(&bytes) ? __CFUUIDCreateWithBytesPrimitive(alloc, bytes, false) : NULL;
+}
 
-    return (retval == 0) ? __CFUUIDCreateWithBytesPrimitive(alloc, bytes, false) : NULL;
+Boolean _CFUUIDGenerateBytes(CFUUIDBytes *bytes) {
+    return __CFUUIDGenerateBytes(bytes);
 }
 
 CFUUIDRef CFUUIDCreateWithBytes(CFAllocatorRef alloc, uint8_t byte0, uint8_t byte1, uint8_t byte2, uint8_t byte3, uint8_t byte4, uint8_t byte5, uint8_t byte6, uint8_t byte7, uint8_t byte8, uint8_t byte9, uint8_t byte10, uint8_t byte11, uint8_t byte12, uint8_t byte13, uint8_t byte14, uint8_t byte15) {
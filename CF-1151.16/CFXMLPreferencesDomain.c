@@ -34,10 +34,12 @@
 #include <CoreFoundation/CFDate.h>
 #include "CFInternal.h"
 #include <time.h>
-#if DEPLOYMENT_TARGET_MACOSX
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_LINUX
 #include <unistd.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#endif
+#if DEPLOYMENT_TARGET_MACOSX
 #include <mach/mach.h>
 #include <mach/mach_syscalls.h>
 #endif
@@ -49,6 +51,8 @@ typedef struct {
     CFMutableArrayRef _dirtyKeys; // The array of keys which must be synchronized
     CFAbsoluteTime _lastReadTime; // The last time we synchronized with the disk
     CFLock_t _lock; // Lock for accessing fields in the domain
+    volatile int32_t _changeCount; // Bumped when the file is seen to change on disk
+    int32_t _checkedChangeCount; // _changeCount when _domainDict was last checked against the file
     Boolean _isWorldReadable; // HACK - this is because we have no good way to propogate the kCFPreferencesAnyUser information from the upper level CFPreferences routines  REW, 1/13/00
     char _padding[3];
 } _CFXMLPreferencesDomain;
@@ -64,6 +68,121 @@ static void setXMLDomainIsWorldReadable(CFTypeRef context, void *domain, Boolean
 
 CF_PRIVATE const _CFPreferencesDomainCallBacks __kCFXMLPropertyListDomainCallBacks = {createXMLDomain, freeXMLDomain, fetchXMLValue, writeXMLValue, synchronizeXMLDomain, getXMLKeysAndValues, copyXMLDomainDictionary, setXMLDomainIsWorldReadable};
 
+// Write-behind state. While an interval is set, synchronizing a dirty domain only queues it, and the queued domains are written together as binary plists once the interval has passed or _CFPreferencesFlushPendingWrites is called. The flush lock is held while queued domains are written, so freeXMLDomain cannot free one in the middle of a write.
+static CFLock_t __CFPreferencesWriteBehindLock = CFLockInit;
+static CFLock_t __CFPreferencesFlushLock = CFLockInit;
+static CFTimeInterval __CFPreferencesWriteBehindInterval = 0.0;
+static Boolean __CFPreferencesFsyncWrites = true;
+static Boolean __CFPreferencesFlushScheduled = false;
+static Boolean __CFPreferencesFlushAtExitRegistered = false;
+static CFMutableDictionaryRef __CFPreferencesPendingDomains = NULL; // domain pointer -> domain URL
+static uint64_t __CFPreferencesBytesWritten = 0;
+static uint64_t __CFPreferencesBytesChanged = 0;
+
+// Change detection. On Linux the directories holding loaded domains are watched with inotify. An event naming a domain's file bumps that domain's change count and drops the merged search lists that include it, so lookups notice the change without stat'ing the file each time. Events for other files, such as the temporary files of a safe save, are ignored. Elsewhere nothing is watched and a change is only picked up on synchronization, as before.
+CF_PRIVATE void _CFPreferencesDomainStorageHasChanged(void *domainStorage);
+
+#if DEPLOYMENT_TARGET_LINUX
+#include <sys/inotify.h>
+#include <fcntl.h>
+
+static CFLock_t __CFPreferencesWatchLock = CFLockInit;
+static int __CFPreferencesWatchFD = -2; // -2 until first used, -1 if inotify is unavailable
+static dispatch_source_t __CFPreferencesWatchSource = NULL;
+static CFMutableDictionaryRef __CFPreferencesWatchedDirectories = NULL; // watch descriptor -> directory path
+static CFMutableDictionaryRef __CFPreferencesWatchedDomains = NULL; // file path -> _CFXMLPreferencesDomain, not retained
+
+static void __CFPreferencesWatchEventsAvailable(void *context) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    void *changedBuf[32];
+    CFIndex changedCount = 0;
+    ssize_t length;
+    while ((length = read(__CFPreferencesWatchFD, buffer, sizeof(buffer))) > 0) {
+        __CFLock(&__CFPreferencesWatchLock);
+        for (char *ptr = buffer; ptr < buffer + length; ) {
+            const struct inotify_event *event = (const struct inotify_event *)ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+            const void *wdKey = (const void *)(intptr_t)event->wd;
+            if (event->mask & IN_IGNORED) {
+                CFDictionaryRemoveValue(__CFPreferencesWatchedDirectories, wdKey);
+                continue;
+            }
+            CFStringRef dirPath = (CFStringRef)CFDictionaryGetValue(__CFPreferencesWatchedDirectories, wdKey);
+            if (!dirPath || event->len == 0) continue;
+            CFStringRef path = CFStringCreateWithFormat(kCFAllocatorSystemDefault, NULL, CFSTR("%@/%s"), dirPath, event->name);
+            _CFXMLPreferencesDomain *domain = (_CFXMLPreferencesDomain *)CFDictionaryGetValue(__CFPreferencesWatchedDomains, path);
+            CFRelease(path);
+            if (!domain) continue;
+            OSAtomicIncrement32Barrier(&domain->_changeCount);
+            CFIndex idx;
+            for (idx = 0; idx < changedCount && changedBuf[idx] != domain; idx++);
+            if (idx == changedCount && changedCount < 32) changedBuf[changedCount++] = domain;
+        }
+        __CFUnlock(&__CFPreferencesWatchLock);
+    }
+    // Outside the watch lock, which freeXMLDomain takes; the pointers are only compared, never followed
+    for (CFIndex idx = 0; idx < changedCount; idx++) _CFPreferencesDomainStorageHasChanged(changedBuf[idx]);
+}
+
+static void __CFPreferencesWatchDomain(CFURLRef url, _CFXMLPreferencesDomain *domain) {
+    char path[CFMaxPathSize];
+    if (!CFURLGetFileSystemRepresentation(url, true, (uint8_t *)path, CFMaxPathSize)) return;
+    char *lastSlash = strrchr(path, '/');
+    if (!lastSlash || lastSlash == path) return;
+
+    __CFLock(&__CFPreferencesWatchLock);
+    if (__CFPreferencesWatchFD == -2) {
+        __CFPreferencesWatchFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (__CFPreferencesWatchFD >= 0) {
+            __CFPreferencesWatchSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, __CFPreferencesWatchFD, 0, __CFDispatchQueueGetGenericBackground());
+            if (__CFPreferencesWatchSource) {
+                __CFPreferencesWatchedDirectories = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, NULL, &kCFTypeDictionaryValueCallBacks);
+                __CFPreferencesWatchedDomains = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeDictionaryKeyCallBacks, NULL);
+                dispatch_source_set_event_handler_f(__CFPreferencesWatchSource, __CFPreferencesWatchEventsAvailable);
+                dispatch_resume(__CFPreferencesWatchSource);
+            } else {
+                close(__CFPreferencesWatchFD);
+                __CFPreferencesWatchFD = -1;
+            }
+        }
+    }
+    if (__CFPreferencesWatchFD >= 0) {
+        CFStringRef filePath = CFStringCreateWithFileSystemRepresentation(kCFAllocatorSystemDefault, path);
+        *lastSlash = '\0';
+        // Watching an already watched directory just returns its existing watch descriptor
+        int wd = inotify_add_watch(__CFPreferencesWatchFD, path, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+        if (wd >= 0 && filePath) {
+            CFStringRef dirPath = CFStringCreateWithFileSystemRepresentation(kCFAllocatorSystemDefault, path);
+            if (dirPath) {
+                CFDictionarySetValue(__CFPreferencesWatchedDirectories, (const void *)(intptr_t)wd, dirPath);
+                CFDictionarySetValue(__CFPreferencesWatchedDomains, filePath, domain);
+                CFRelease(dirPath);
+            }
+        }
+        if (filePath) CFRelease(filePath);
+    }
+    __CFUnlock(&__CFPreferencesWatchLock);
+}
+
+static void __CFPreferencesUnwatchDomain(CFURLRef url, _CFXMLPreferencesDomain *domain) {
+    char path[CFMaxPathSize];
+    if (!CFURLGetFileSystemRepresentation(url, true, (uint8_t *)path, CFMaxPathSize)) return;
+    CFStringRef filePath = CFStringCreateWithFileSystemRepresentation(kCFAllocatorSystemDefault, path);
+    if (!filePath) return;
+    __CFLock(&__CFPreferencesWatchLock);
+    if (__CFPreferencesWatchedDomains && CFDictionaryGetValue(__CFPreferencesWatchedDomains, filePath) == domain) {
+        CFDictionaryRemoveValue(__CFPreferencesWatchedDomains, filePath);
+    }
+    __CFUnlock(&__CFPreferencesWatchLock);
+    CFRelease(filePath);
+}
+#endif
+
+// Assumes the domain has already been locked. A domain with unsynchronized changes is never considered stale, since reloading it would drop them.
+CF_INLINE Boolean __CFXMLDomainMayBeStale(_CFXMLPreferencesDomain *domain) {
+    return domain->_checkedChangeCount != domain->_changeCount && CFArrayGetCount(domain->_dirtyKeys) == 0;
+}
+
 // Directly ripped from Foundation....
 static void __CFMilliSleep(uint32_t msecs) {
 #if DEPLOYMENT_TARGET_WINDOWS
@@ -137,6 +256,8 @@ static void *createXMLDomain(CFAllocatorRef allocator, CFTypeRef context) {
     _CFXMLPreferencesDomain *domain = (_CFXMLPreferencesDomain*) CFAllocatorAllocate(allocator, sizeof(_CFXMLPreferencesDomain), 0);
     domain->_lastReadTime = 0.0;
     domain->_domainDict = NULL;
+    domain->_changeCount = 0;
+    domain->_checkedChangeCount = 0;
     domain->_dirtyKeys = CFArrayCreateMutable(allocator, 0, & kCFTypeArrayCallBacks);
 	const CFLock_t lock = CFLockInit;
     domain->_lock = lock;
@@ -144,8 +265,21 @@ static void *createXMLDomain(CFAllocatorRef allocator, CFTypeRef context) {
     return domain;
 }
 
+static Boolean _synchronizeXMLDomainNow(CFTypeRef context, _CFXMLPreferencesDomain *domain);
+
 static void freeXMLDomain(CFAllocatorRef allocator, CFTypeRef context, void *tDomain) {
     _CFXMLPreferencesDomain *domain = (_CFXMLPreferencesDomain *)tDomain;
+    // Don't lose changes still waiting for a write-behind flush
+    __CFLock(&__CFPreferencesFlushLock);
+    __CFLock(&__CFPreferencesWriteBehindLock);
+    Boolean pending = __CFPreferencesPendingDomains && CFDictionaryContainsKey(__CFPreferencesPendingDomains, domain);
+    if (pending) CFDictionaryRemoveValue(__CFPreferencesPendingDomains, domain);
+    __CFUnlock(&__CFPreferencesWriteBehindLock);
+    if (pending) _synchronizeXMLDomainNow(context, domain);
+    __CFUnlock(&__CFPreferencesFlushLock);
+#if DEPLOYMENT_TARGET_LINUX
+    __CFPreferencesUnwatchDomain((CFURLRef)context, domain);
+#endif
     if (domain->_domainDict) CFRelease(domain->_domainDict);
     if (domain->_dirtyKeys) CFRelease(domain->_dirtyKeys);
     CFAllocatorDeallocate(allocator, domain);
@@ -155,6 +289,8 @@ static void freeXMLDomain(CFAllocatorRef allocator, CFTypeRef context, void *tDo
 static void _loadXMLDomainIfStale(CFURLRef url, _CFXMLPreferencesDomain *domain) {
     CFAllocatorRef alloc = __CFPreferencesAllocator();
     int idx;
+    // Sample the change count before looking at the file, so a change made while we read is not lost
+    int32_t changeCount = domain->_changeCount;
     if (domain->_domainDict) {
         CFDateRef modDate;
         CFAbsoluteTime modTime;
@@ -173,6 +309,7 @@ static void _loadXMLDomainIfStale(CFURLRef url, _CFXMLPreferencesDomain *domain)
         if (modDate) CFRelease(modDate);
         
         if (modDate != NULL && modTime < domain->_lastReadTime) {            // We're up-to-date
+            domain->_checkedChangeCount = changeCount;
             return;
         }
     }
@@ -184,6 +321,10 @@ static void _loadXMLDomainIfStale(CFURLRef url, _CFXMLPreferencesDomain *domain)
         domain->_domainDict = NULL;
     }
 
+#if DEPLOYMENT_TARGET_LINUX
+    __CFPreferencesWatchDomain(url, domain);
+#endif
+
     // We no longer lock on read; instead, we assume parse failures are because someone else is writing the file, and just try to parse again.  If we fail 3 times in a row, we assume the file is corrupted.  REW, 7/13/99
 
     for (idx = 0; idx < 3; idx ++) {
@@ -211,6 +352,7 @@ static void _loadXMLDomainIfStale(CFURLRef url, _CFXMLPreferencesDomain *domain)
         domain->_domainDict = CFDictionaryCreateMutable(alloc, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
     }
     domain->_lastReadTime = CFAbsoluteTimeGetCurrent();
+    domain->_checkedChangeCount = changeCount;
 }
 
 static CFTypeRef fetchXMLValue(CFTypeRef context, void *xmlDomain, CFStringRef key) {
@@ -219,7 +361,7 @@ static CFTypeRef fetchXMLValue(CFTypeRef context, void *xmlDomain, CFStringRef k
  
     // Never reload if we've looked at the file system within the last 5 seconds.
     __CFLock(&domain->_lock);
-    if (domain->_domainDict == NULL) _loadXMLDomainIfStale((CFURLRef )context, domain);
+    if (domain->_domainDict == NULL || __CFXMLDomainMayBeStale(domain)) _loadXMLDomainIfStale((CFURLRef )context, domain);
     result = CFDictionaryGetValue(domain->_domainDict, key);
     if (result) CFRetain(result); 
     __CFUnlock(&domain->_lock);
@@ -228,7 +370,7 @@ static CFTypeRef fetchXMLValue(CFTypeRef context, void *xmlDomain, CFStringRef k
 }
 
 
-#if DEPLOYMENT_TARGET_MACOSX
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_LINUX
 #include <sys/fcntl.h>
 
 /* __CFWriteBytesToFileWithAtomicity is a "safe save" facility. Write the bytes using the specified mode on the file to the provided URL. If the atomic flag is true, try to do it in a fashion that will enable a safe save.
@@ -276,7 +418,9 @@ static Boolean __CFWriteBytesToFileWithAtomicity(CFURLRef url, const void *bytes
     
     if (fd < 0) return false;
     
-    if (length && (write(fd, bytes, length) != length || fsync(fd) < 0)) {
+    // Only write-behind lets the caller trade durability for speed; synchronous writes are always fsynced
+    Boolean shouldFsync = !(__CFPreferencesWriteBehindInterval > 0.0 && !__CFPreferencesFsyncWrites);
+    if (length && (write(fd, bytes, length) != length || (shouldFsync && fsync(fd) < 0))) {
         int saveerr = thread_errno();
         close(fd);
         if (atomic)
@@ -320,16 +464,22 @@ static Boolean _writeXMLFile(CFURLRef url, CFMutableDictionaryRef dict, Boolean
         }
         if (val) CFRelease(val);
     } else {
-        CFPropertyListFormat desiredFormat = __CFPreferencesShouldWriteXML() ? kCFPropertyListXMLFormat_v1_0 : kCFPropertyListBinaryFormat_v1_0;
+        // Write-behind exists to cut write cost, so it always uses the compact binary format
+        CFPropertyListFormat desiredFormat = (__CFPreferencesShouldWriteXML() && __CFPreferencesWriteBehindInterval == 0.0) ? kCFPropertyListXMLFormat_v1_0 : kCFPropertyListBinaryFormat_v1_0;
         CFDataRef data = CFPropertyListCreateData(alloc, dict, desiredFormat, 0, NULL);
         if (data) {
             SInt32 mode;
-#if DEPLOYMENT_TARGET_MACOSX
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_LINUX
             mode = isWorldReadable ? S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH : S_IRUSR|S_IWUSR;
 #else
 	    mode = 0666;
 #endif
-#if DEPLOYMENT_TARGET_MACOSX
+            if (__CFPreferencesWriteBehindInterval > 0.0) {
+                __CFLock(&__CFPreferencesWriteBehindLock);
+                __CFPreferencesBytesWritten += CFDataGetLength(data);
+                __CFUnlock(&__CFPreferencesWriteBehindLock);
+            }
+#if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_LINUX
             {	// Try quick atomic way first, then fallback to slower ways and error cases
                 CFStringRef scheme = CFURLCopyScheme(url);
                 if (!scheme) {
@@ -473,7 +623,7 @@ static CFDictionaryRef copyXMLDomainDictionary(CFTypeRef context, void *xmlDomai
     CFDictionaryRef result;
     
     __CFLock(&domain->_lock);
-    if(!domain->_domainDict) {
+    if(!domain->_domainDict || __CFXMLDomainMayBeStale(domain)) {
         _loadXMLDomainIfStale((CFURLRef)context, domain);
     }
     
@@ -488,8 +638,7 @@ static void setXMLDomainIsWorldReadable(CFTypeRef context, void *domain, Boolean
     ((_CFXMLPreferencesDomain *)domain)->_isWorldReadable = isWorldReadable;
 }
 
-static Boolean synchronizeXMLDomain(CFTypeRef context, void *xmlDomain) {
-    _CFXMLPreferencesDomain *domain = (_CFXMLPreferencesDomain *)xmlDomain;
+static Boolean _synchronizeXMLDomainNow(CFTypeRef context, _CFXMLPreferencesDomain *domain) {
     CFMutableDictionaryRef cachedDict;
     CFMutableArrayRef changedKeys;
     SInt32 idx,  count;
@@ -510,6 +659,28 @@ static Boolean synchronizeXMLDomain(CFTypeRef context, void *xmlDomain) {
         return true;
     }
 
+    // Account for the size of what actually changed, to compare against the bytes written for it. Encoding the values costs about as much as the write itself, so this is only done while write-behind is on.
+    if (__CFPreferencesWriteBehindInterval > 0.0) {
+        uint64_t bytesChanged = 0;
+        for (idx = 0; idx < count; idx ++) {
+            CFStringRef key = (CFStringRef) CFArrayGetValueAtIndex(changedKeys, idx);
+            CFTypeRef value = CFDictionaryGetValue(cachedDict, key);
+            CFIndex keyLength = 0;
+            CFStringGetBytes(key, CFRangeMake(0, CFStringGetLength(key)), kCFStringEncodingUTF8, 0, false, NULL, 0, &keyLength);
+            bytesChanged += keyLength;
+            if (value) {
+                CFDataRef valueData = CFPropertyListCreateData(kCFAllocatorSystemDefault, value, kCFPropertyListBinaryFormat_v1_0, 0, NULL);
+                if (valueData) {
+                    bytesChanged += CFDataGetLength(valueData);
+                    CFRelease(valueData);
+                }
+            }
+        }
+        __CFLock(&__CFPreferencesWriteBehindLock);
+        __CFPreferencesBytesChanged += bytesChanged;
+        __CFUnlock(&__CFPreferencesWriteBehindLock);
+    }
+
     domain->_domainDict = NULL; // This forces a reload.  Note that we now have a retain on cachedDict
     do {
         _loadXMLDomainIfStale((CFURLRef )context, domain);
@@ -536,3 +707,91 @@ static Boolean synchronizeXMLDomain(CFTypeRef context, void *xmlDomain) {
     return success;
 }
 
+static void __CFPreferencesQueueDomainForWrite(const void *key, const void *value, void *context) {
+    CFArrayAppendValue((CFMutableArrayRef)context, key);
+    CFArrayAppendValue((CFMutableArrayRef)context, value);
+}
+
+CF_EXPORT Boolean _CFPreferencesFlushPendingWrites(void) {
+    Boolean result = true;
+    __CFLock(&__CFPreferencesFlushLock);
+    __CFLock(&__CFPreferencesWriteBehindLock);
+    CFMutableArrayRef queued = NULL;
+    if (__CFPreferencesPendingDomains && CFDictionaryGetCount(__CFPreferencesPendingDomains) > 0) {
+        // domain, URL pairs; the URLs are retained by the array, the domains are kept alive by the flush lock
+        const CFArrayCallBacks callBacks = {0, NULL, NULL, NULL, NULL};
+        queued = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &callBacks);
+        CFDictionaryApplyFunction(__CFPreferencesPendingDomains, __CFPreferencesQueueDomainForWrite, queued);
+        for (CFIndex idx = 1; idx < CFArrayGetCount(queued); idx += 2) CFRetain(CFArrayGetValueAtIndex(queued, idx));
+        CFDictionaryRemoveAllValues(__CFPreferencesPendingDomains);
+    }
+    __CFUnlock(&__CFPreferencesWriteBehindLock);
+    if (queued) {
+        for (CFIndex idx = 0; idx < CFArrayGetCount(queued); idx += 2) {
+            CFURLRef url = (CFURLRef)CFArrayGetValueAtIndex(queued, idx + 1);
+            if (!_synchronizeXMLDomainNow(url, (_CFXMLPreferencesDomain *)CFArrayGetValueAtIndex(queued, idx))) result = false;
+            CFRelease(url);
+        }
+        CFRelease(queued);
+    }
+    __CFUnlock(&__CFPreferencesFlushLock);
+    return result;
+}
+
+static void __CFPreferencesWriteBehindTimerFired(void *context) {
+    __CFLock(&__CFPreferencesWriteBehindLock);
+    __CFPreferencesFlushScheduled = false;
+    __CFUnlock(&__CFPreferencesWriteBehindLock);
+    _CFPreferencesFlushPendingWrites();
+}
+
+static Boolean synchronizeXMLDomain(CFTypeRef context, void *xmlDomain) {
+    _CFXMLPreferencesDomain *domain = (_CFXMLPreferencesDomain *)xmlDomain;
+    __CFLock(&domain->_lock);
+    Boolean dirty = CFArrayGetCount(domain->_dirtyKeys) > 0;
+    __CFUnlock(&domain->_lock);
+    if (dirty) {
+        // With write-behind on, coalesce this write with any others arriving within the interval
+        Boolean scheduleFlush = false;
+        CFTimeInterval interval;
+        __CFLock(&__CFPreferencesWriteBehindLock);
+        interval = __CFPreferencesWriteBehindInterval;
+        if (interval > 0.0) {
+            if (!__CFPreferencesPendingDomains) __CFPreferencesPendingDomains = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, NULL, &kCFTypeDictionaryValueCallBacks);
+            CFDictionarySetValue(__CFPreferencesPendingDomains, domain, context);
+            scheduleFlush = !__CFPreferencesFlushScheduled;
+            __CFPreferencesFlushScheduled = true;
+        }
+        __CFUnlock(&__CFPreferencesWriteBehindLock);
+        if (scheduleFlush) {
+            dispatch_after_f(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)), __CFDispatchQueueGetGenericBackground(), NULL, __CFPreferencesWriteBehindTimerFired);
+        }
+        if (interval > 0.0) return true;
+    }
+    return _synchronizeXMLDomainNow(context, domain);
+}
+
+static void __CFPreferencesFlushPendingWritesAtExit(void) {
+    _CFPreferencesFlushPendingWrites();
+}
+
+CF_EXPORT void _CFPreferencesSetWriteBehindInterval(CFTimeInterval interval, Boolean fsyncWrites) {
+    __CFLock(&__CFPreferencesWriteBehindLock);
+    Boolean wasEnabled = (__CFPreferencesWriteBehindInterval > 0.0);
+    __CFPreferencesWriteBehindInterval = (interval > 0.0) ? interval : 0.0;
+    __CFPreferencesFsyncWrites = fsyncWrites;
+    // Synchronize has already reported queued changes as saved, so they must not be lost when the process exits inside the interval
+    Boolean registerAtExit = (interval > 0.0 && !__CFPreferencesFlushAtExitRegistered);
+    if (registerAtExit) __CFPreferencesFlushAtExitRegistered = true;
+    __CFUnlock(&__CFPreferencesWriteBehindLock);
+    if (registerAtExit) atexit(__CFPreferencesFlushPendingWritesAtExit);
+    // Turning write-behind off must not strand queued changes
+    if (wasEnabled && interval <= 0.0) _CFPreferencesFlushPendingWrites();
+}
+
+CF_EXPORT void _CFPreferencesGetWriteStatistics(uint64_t *bytesWritten, uint64_t *bytesChanged) {
+    __CFLock(&__CFPreferencesWriteBehindLock);
+    if (bytesWritten) *bytesWritten = __CFPreferencesBytesWritten;
+    if (bytesChanged) *bytesChanged = __CFPreferencesBytesChanged;
+    __CFUnlock(&__CFPreferencesWriteBehindLock);
+}
@@ -186,6 +186,20 @@ void OSMemoryBarrier();
 CF_INLINE size_t malloc_size(void *memblock) {
     return malloc_usable_size(memblock);
 }
+
+#include <time.h>
+CF_INLINE uint64_t mach_absolute_time() {
+    // TSR units are nanoseconds of CLOCK_MONOTONIC, the clock timerfd deadlines are given in
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+#include <unistd.h>
+#include <sys/syscall.h>
+CF_INLINE int pthread_main_np(void) {
+    return getpid() == (pid_t)syscall(SYS_gettid);
+}
     
 // substitute for dispatch_once
 typedef pthread_once_t dispatch_once_t;
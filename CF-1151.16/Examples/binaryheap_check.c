@@ -0,0 +1,228 @@
+// Mac OS X: clang -O2 -F<path-to-CFLite-framework> -framework CoreFoundation Examples/binaryheap_check.c -o binaryheap_check
+//  note: When running this sample, be sure to set the environment variable DYLD_FRAMEWORK_PATH to point to the directory containing your new version of CoreFoundation.
+//   e.g.
+//  DYLD_FRAMEWORK_PATH=/tmp/CF-Root ./binaryheap_check
+//
+// Linux: clang -O2 -I/usr/local/include -L/usr/local/lib -lCoreFoundation binaryheap_check.c -o binaryheap_check
+
+/*
+ This example checks the CFBinaryHeap SPI in CFPriv.h against a simple model of the heap:
+    1. _CFBinaryHeapCreateWithValues orders values in place, so that every value is no smaller
+       than its parent in the 4-ary layout, and reports every value's position.
+    2. _CFBinaryHeapValueChangedAtPosition restores the order after keys move in either direction.
+    3. _CFBinaryHeapRemoveValueAtPosition removes arbitrary values and reports kCFNotFound for them.
+    4. _CFBinaryHeapApplyFunctionToSubheaps, pruned at a bound, visits exactly the values up to it.
+    5. Draining the heap with CFBinaryHeapRemoveMinimumValue returns the keys in order.
+ It then times heapifying a million values against adding them one at a time. It prints each
+ failure and exits with a nonzero status if there were any. An optional argument seeds the
+ random number generator.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <CoreFoundation/CoreFoundation.h>
+
+// From CFPriv.h
+extern CFBinaryHeapRef _CFBinaryHeapCreateWithValues(CFAllocatorRef allocator, const void **values, CFIndex numValues, const CFBinaryHeapCallBacks *callBacks, const CFBinaryHeapCompareContext *compareContext);
+typedef void (*_CFBinaryHeapPositionCallBack)(const void *value, CFIndex position, void *info);
+extern void _CFBinaryHeapSetPositionCallBack(CFBinaryHeapRef heap, _CFBinaryHeapPositionCallBack callBack);
+extern const void *_CFBinaryHeapGetValueAtPosition(CFBinaryHeapRef heap, CFIndex position);
+extern void _CFBinaryHeapValueChangedAtPosition(CFBinaryHeapRef heap, CFIndex position);
+extern void _CFBinaryHeapRemoveValueAtPosition(CFBinaryHeapRef heap, CFIndex position);
+typedef Boolean (*_CFBinaryHeapSubheapApplierFunction)(const void *value, void *context);
+extern void _CFBinaryHeapApplyFunctionToSubheaps(CFBinaryHeapRef heap, _CFBinaryHeapSubheapApplierFunction applier, void *context);
+
+#define ARITY 4
+
+typedef struct {
+    long key;
+    CFIndex position;
+} Item;
+
+static int failures = 0;
+
+static void fail(const char *what, long detail) {
+    if (failures++ < 20) fprintf(stderr, "FAIL: %s (%ld)\n", what, detail);
+}
+
+static CFComparisonResult compareItems(const void *ptr1, const void *ptr2, void *context) {
+    long key1 = ((const Item *)ptr1)->key, key2 = ((const Item *)ptr2)->key;
+    return (key1 < key2) ? kCFCompareLessThan : (key1 > key2) ? kCFCompareGreaterThan : kCFCompareEqualTo;
+}
+
+static void setPosition(const void *value, CFIndex position, void *info) {
+    ((Item *)value)->position = position;
+    (*(long *)info)++;
+}
+
+static const CFBinaryHeapCallBacks itemCallBacks = {0, NULL, NULL, NULL, compareItems};
+
+static int compareLongs(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x < y) ? -1 : (x > y);
+}
+
+// Checks that each item in the heap is where its position says, and is no smaller than its parent
+static void checkHeap(CFBinaryHeapRef heap, Item *items, CFIndex numItems, const char *when) {
+    CFIndex count = CFBinaryHeapGetCount(heap), inHeap = 0;
+    for (CFIndex idx = 0; idx < numItems; idx++) {
+        CFIndex position = items[idx].position;
+        if (kCFNotFound == position) continue;
+        inHeap++;
+        if (position < 0 || count <= position || _CFBinaryHeapGetValueAtPosition(heap, position) != &items[idx]) fail(when, idx);
+    }
+    if (inHeap != count) fail("count of values with a position", inHeap - count);
+    for (CFIndex position = 1; position < count; position++) {
+        const Item *child = _CFBinaryHeapGetValueAtPosition(heap, position);
+        const Item *parent = _CFBinaryHeapGetValueAtPosition(heap, (position - 1) / ARITY);
+        if (child->key < parent->key) fail("heap order", position);
+    }
+}
+
+typedef struct {
+    long bound;
+    CFIndex visited;
+    CFIndex beyond;	// values over the bound the applier was called on
+} Walk;
+
+static Boolean visitUpToBound(const void *value, void *context) {
+    Walk *walk = (Walk *)context;
+    if (walk->bound < ((const Item *)value)->key) {
+        walk->beyond++;
+        return false;
+    }
+    walk->visited++;
+    return true;
+}
+
+// Values over the bound may only be visited as the roots of pruned subheaps, never below one
+static void checkWalk(CFBinaryHeapRef heap, Item *items, CFIndex numItems, long bound) {
+    Walk walk = {bound, 0, 0};
+    _CFBinaryHeapApplyFunctionToSubheaps(heap, visitUpToBound, &walk);
+    CFIndex expected = 0, count = CFBinaryHeapGetCount(heap), roots = 0;
+    for (CFIndex idx = 0; idx < numItems; idx++) {
+        if (kCFNotFound != items[idx].position && items[idx].key <= bound) expected++;
+    }
+    for (CFIndex position = 0; position < count; position++) {
+        const Item *item = _CFBinaryHeapGetValueAtPosition(heap, position);
+        const Item *parent = position ? _CFBinaryHeapGetValueAtPosition(heap, (position - 1) / ARITY) : NULL;
+        if (bound < item->key && (!parent || parent->key <= bound)) roots++;
+    }
+    if (walk.visited != expected) fail("values visited up to the bound", walk.visited - expected);
+    if (walk.beyond != roots) fail("pruned subheaps visited", walk.beyond - roots);
+}
+
+static double secondsSince(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char **argv) {
+    unsigned seed = (1 < argc) ? (unsigned)strtoul(argv[1], NULL, 0) : (unsigned)time(NULL);
+    srandom(seed);
+    printf("seed %u\n", seed);
+
+    const CFIndex numItems = 5000;
+    Item *items = calloc(numItems, sizeof(Item));
+    const void **values = calloc(numItems, sizeof(void *));
+    long moves = 0;
+    CFBinaryHeapCompareContext context = {0, &moves, NULL, NULL, NULL};
+
+    // Only the first half goes in at creation; the rest is added later
+    for (CFIndex idx = 0; idx < numItems; idx++) {
+        items[idx].key = random() % 1000;
+        items[idx].position = kCFNotFound;
+        values[idx] = &items[idx];
+    }
+    CFBinaryHeapRef heap = _CFBinaryHeapCreateWithValues(kCFAllocatorSystemDefault, values, numItems / 2, &itemCallBacks, &context);
+    // Setting the callback reports where the values already in the heap are
+    _CFBinaryHeapSetPositionCallBack(heap, setPosition);
+    if (moves != numItems / 2) fail("positions reported when the callback is set", moves);
+    checkHeap(heap, items, numItems, "heapify");
+    for (CFIndex idx = numItems / 2; idx < numItems; idx++) {
+        CFBinaryHeapAddValue(heap, &items[idx]);
+        if (kCFNotFound == items[idx].position) fail("position reported on add", idx);
+    }
+    checkHeap(heap, items, numItems, "add");
+
+    for (int round = 0; round < 20000; round++) {
+        Item *item = &items[random() % numItems];
+        switch (random() % 3) {
+        case 0:	// move the key either way
+            if (kCFNotFound == item->position) break;
+            item->key += (random() % 2001) - 1000;
+            _CFBinaryHeapValueChangedAtPosition(heap, item->position);
+            break;
+        case 1:
+            if (kCFNotFound == item->position) break;
+            _CFBinaryHeapRemoveValueAtPosition(heap, item->position);
+            if (kCFNotFound != item->position) fail("position after remove", (long)(item - items));
+            break;
+        case 2:
+            if (kCFNotFound != item->position) break;
+            item->key = random() % 1000;
+            CFBinaryHeapAddValue(heap, item);
+            break;
+        }
+        if (0 == round % 500) checkHeap(heap, items, numItems, "after random operations");
+    }
+    checkHeap(heap, items, numItems, "after random operations");
+    for (long bound = -1000; bound <= 2000; bound += 250) checkWalk(heap, items, numItems, bound);
+
+    // The minimum and a sorted drain must agree with the keys still in the heap
+    CFIndex remaining = CFBinaryHeapGetCount(heap);
+    long *expected = calloc(remaining + 1, sizeof(long));
+    CFIndex cnt = 0;
+    for (CFIndex idx = 0; idx < numItems; idx++) {
+        if (kCFNotFound != items[idx].position) expected[cnt++] = items[idx].key;
+    }
+    qsort(expected, cnt, sizeof(long), compareLongs);
+    CFBinaryHeapRef copy = CFBinaryHeapCreateCopy(kCFAllocatorSystemDefault, 0, heap);
+    const void **sorted = calloc(remaining + 1, sizeof(void *));
+    CFBinaryHeapGetValues(copy, sorted);
+    for (CFIndex idx = 0; idx < remaining; idx++) {
+        if (((const Item *)sorted[idx])->key != expected[idx]) fail("CFBinaryHeapGetValues order", idx);
+    }
+    CFRelease(copy);
+    for (CFIndex idx = 0; idx < remaining; idx++) {
+        Item *item = (Item *)CFBinaryHeapGetMinimum(heap);
+        if (item->key != expected[idx]) fail("drain order", idx);
+        CFBinaryHeapRemoveMinimumValue(heap);
+        if (kCFNotFound != item->position) fail("position after remove minimum", idx);
+    }
+    if (0 != CFBinaryHeapGetCount(heap)) fail("count after drain", CFBinaryHeapGetCount(heap));
+    CFRelease(heap);
+    free(sorted);
+    free(expected);
+    free(values);
+    free(items);
+    printf("%ld position callbacks\n", moves);
+
+    // Building a heap from values in one pass against adding them one at a time
+    const CFIndex numTimed = 1000000;
+    Item *timed = calloc(numTimed, sizeof(Item));
+    const void **timedValues = calloc(numTimed, sizeof(void *));
+    for (CFIndex idx = 0; idx < numTimed; idx++) {
+        timed[idx].key = random();
+        timedValues[idx] = &timed[idx];
+    }
+    clock_t start = clock();
+    heap = _CFBinaryHeapCreateWithValues(kCFAllocatorSystemDefault, timedValues, numTimed, &itemCallBacks, NULL);
+    printf("heapify %ld values: %.3f s\n", (long)numTimed, secondsSince(start));
+    CFRelease(heap);
+    start = clock();
+    heap = CFBinaryHeapCreate(kCFAllocatorSystemDefault, 0, &itemCallBacks, NULL);
+    for (CFIndex idx = 0; idx < numTimed; idx++) CFBinaryHeapAddValue(heap, timedValues[idx]);
+    printf("add %ld values: %.3f s\n", (long)numTimed, secondsSince(start));
+    start = clock();
+    for (CFIndex idx = 0; idx < numTimed; idx++) CFBinaryHeapRemoveMinimumValue(heap);
+    printf("remove %ld minimums: %.3f s\n", (long)numTimed, secondsSince(start));
+    CFRelease(heap);
+    free(timedValues);
+    free(timed);
+
+    printf("%s: %d failures\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
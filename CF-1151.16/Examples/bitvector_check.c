@@ -0,0 +1,198 @@
+// Mac OS X: clang -O2 -F<path-to-CFLite-framework> -framework CoreFoundation Examples/bitvector_check.c -o bitvector_check
+//  note: When running this sample, be sure to set the environment variable DYLD_FRAMEWORK_PATH to point to the directory containing your new version of CoreFoundation.
+//   e.g.
+//  DYLD_FRAMEWORK_PATH=/tmp/CF-Root ./bitvector_check
+//
+// Linux: clang -O2 -I/usr/local/include -L/usr/local/lib -lCoreFoundation bitvector_check.c -o bitvector_check
+
+/*
+ This example checks the CFBitVector operations that work a word at a time against a plain array
+ of bits. Vectors of random lengths are queried and changed over random ranges, which start and
+ end at arbitrary bits within a word, including:
+    1. CFBitVectorGetCountOfBit, ContainsBit, GetFirstIndexOfBit and GetLastIndexOfBit, and GetBits
+       for ranges that start on a byte.
+    2. CFBitVectorSetBits, FlipBits and SetAllBits, and growing a vector with SetCount.
+    3. _CFBitVectorCombineBits from CFPriv.h, with each operation and with a vector combined with itself.
+ It then times counting and searching a large vector. It prints each failure and exits with a
+ nonzero status if there were any. An optional argument seeds the random number generator.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <CoreFoundation/CoreFoundation.h>
+
+// From CFPriv.h
+typedef CF_ENUM(CFIndex, _CFBitVectorOperation) {
+    _CFBitVectorOperationAnd = 0,
+    _CFBitVectorOperationOr,
+    _CFBitVectorOperationXor,
+    _CFBitVectorOperationAndNot
+};
+extern void _CFBitVectorCombineBits(CFMutableBitVectorRef bv, CFBitVectorRef other, CFRange range, _CFBitVectorOperation operation);
+
+#define MAX_BITS 1000
+
+static int failures = 0;
+
+static void fail(const char *what, CFIndex count, CFRange range) {
+    if (failures++ < 20) fprintf(stderr, "FAIL: %s (count %ld, range %ld+%ld)\n", what, (long)count, (long)range.location, (long)range.length);
+}
+
+static CFRange randomRange(CFIndex count) {
+    CFIndex location = random() % (count + 1);
+    return CFRangeMake(location, random() % (count - location + 1));
+}
+
+static void fillRandomly(CFMutableBitVectorRef bv, unsigned char *model, CFIndex count) {
+    // Mostly-clear and mostly-set vectors make the searches go further than evenly mixed ones
+    int density = random() % 3;
+    for (CFIndex idx = 0; idx < count; idx++) {
+        int bit = (0 == density) ? (0 == random() % 50) : (1 == density) ? (0 != random() % 50) : (int)(random() & 1);
+        model[idx] = bit;
+        CFBitVectorSetBitAtIndex(bv, idx, bit);
+    }
+}
+
+static void checkContents(CFBitVectorRef bv, const unsigned char *model, CFIndex count, const char *when) {
+    if (CFBitVectorGetCount(bv) != count) fail(when, count, CFRangeMake(0, CFBitVectorGetCount(bv)));
+    for (CFIndex idx = 0; idx < count; idx++) {
+        if (CFBitVectorGetBitAtIndex(bv, idx) != model[idx]) {
+            fail(when, count, CFRangeMake(idx, 1));
+            return;
+        }
+    }
+}
+
+static void checkQueries(CFBitVectorRef bv, const unsigned char *model, CFIndex count, CFRange range) {
+    for (CFBit value = 0; value <= 1; value++) {
+        CFIndex expectedCount = 0, first = kCFNotFound, last = kCFNotFound;
+        for (CFIndex idx = range.location; idx < range.location + range.length; idx++) {
+            if (model[idx] != value) continue;
+            expectedCount++;
+            if (kCFNotFound == first) first = idx;
+            last = idx;
+        }
+        if (CFBitVectorGetCountOfBit(bv, range, value) != expectedCount) fail("CFBitVectorGetCountOfBit", count, range);
+        if (CFBitVectorContainsBit(bv, range, value) != (0 < expectedCount)) fail("CFBitVectorContainsBit", count, range);
+        if (CFBitVectorGetFirstIndexOfBit(bv, range, value) != first) fail("CFBitVectorGetFirstIndexOfBit", count, range);
+        if (CFBitVectorGetLastIndexOfBit(bv, range, value) != last) fail("CFBitVectorGetLastIndexOfBit", count, range);
+    }
+    // CFBitVectorGetBits still copies a byte at a time and does not pack ranges that start in the middle of a byte, so only those that start on a byte are compared
+    if (range.location % 8) return;
+    UInt8 bytes[MAX_BITS / 8 + 2];
+    memset(bytes, 0, sizeof(bytes));
+    CFBitVectorGetBits(bv, range, bytes);
+    for (CFIndex idx = 0; idx < range.length; idx++) {
+        if (((bytes[idx / 8] >> (7 - idx % 8)) & 1) != model[range.location + idx]) {
+            fail("CFBitVectorGetBits", count, range);
+            break;
+        }
+    }
+}
+
+static void checkCombine(CFIndex count) {
+    static const char *names[] = {"_CFBitVectorCombineBits AND", "_CFBitVectorCombineBits OR", "_CFBitVectorCombineBits XOR", "_CFBitVectorCombineBits AND-NOT"};
+    unsigned char model[MAX_BITS], otherModel[MAX_BITS];
+    CFMutableBitVectorRef bv = CFBitVectorCreateMutable(kCFAllocatorSystemDefault, 0);
+    CFMutableBitVectorRef other = CFBitVectorCreateMutable(kCFAllocatorSystemDefault, 0);
+    CFBitVectorSetCount(bv, count);
+    CFBitVectorSetCount(other, count);
+    for (_CFBitVectorOperation op = _CFBitVectorOperationAnd; op <= _CFBitVectorOperationAndNot; op++) {
+        fillRandomly(bv, model, count);
+        fillRandomly(other, otherModel, count);
+        CFRange range = randomRange(count);
+        Boolean withSelf = (0 == random() % 4);
+        const unsigned char *operand = withSelf ? model : otherModel;
+        unsigned char expected[MAX_BITS];
+        memcpy(expected, model, count);
+        for (CFIndex idx = range.location; idx < range.location + range.length; idx++) {
+            switch (op) {
+            case _CFBitVectorOperationAnd: expected[idx] = model[idx] & operand[idx]; break;
+            case _CFBitVectorOperationOr: expected[idx] = model[idx] | operand[idx]; break;
+            case _CFBitVectorOperationXor: expected[idx] = model[idx] ^ operand[idx]; break;
+            case _CFBitVectorOperationAndNot: expected[idx] = model[idx] & !operand[idx]; break;
+            }
+        }
+        _CFBitVectorCombineBits(bv, withSelf ? bv : other, range, op);
+        checkContents(bv, expected, count, names[op]);
+        checkContents(other, otherModel, count, "_CFBitVectorCombineBits changed its operand");
+    }
+    CFRelease(other);
+    CFRelease(bv);
+}
+
+static double secondsSince(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char **argv) {
+    unsigned seed = (1 < argc) ? (unsigned)strtoul(argv[1], NULL, 0) : (unsigned)time(NULL);
+    srandom(seed);
+    printf("seed %u\n", seed);
+
+    unsigned char model[MAX_BITS + 64];
+    for (int round = 0; round < 2000; round++) {
+        CFIndex count = random() % MAX_BITS;
+        CFMutableBitVectorRef bv = CFBitVectorCreateMutable(kCFAllocatorSystemDefault, 0);
+        CFBitVectorSetCount(bv, count);
+        fillRandomly(bv, model, count);
+        checkContents(bv, model, count, "CFBitVectorSetBitAtIndex");
+        for (int query = 0; query < 8; query++) checkQueries(bv, model, count, randomRange(count));
+
+        CFRange range = randomRange(count);
+        CFBit value = random() & 1;
+        CFBitVectorSetBits(bv, range, value);
+        memset(model + range.location, value, range.length);
+        checkContents(bv, model, count, "CFBitVectorSetBits");
+
+        range = randomRange(count);
+        CFBitVectorFlipBits(bv, range);
+        for (CFIndex idx = range.location; idx < range.location + range.length; idx++) model[idx] = !model[idx];
+        checkContents(bv, model, count, "CFBitVectorFlipBits");
+        checkQueries(bv, model, count, randomRange(count));
+
+        // Bits added by growing the vector must read as clear
+        CFIndex grown = count + random() % 64;
+        CFBitVectorSetCount(bv, grown);
+        memset(model + count, 0, grown - count);
+        checkContents(bv, model, grown, "CFBitVectorSetCount");
+
+        CFBitVectorRef copy = CFBitVectorCreateCopy(kCFAllocatorSystemDefault, bv);
+        checkContents(copy, model, grown, "CFBitVectorCreateCopy");
+        checkQueries(copy, model, grown, CFRangeMake(0, grown));
+        CFRelease(copy);
+
+        value = random() & 1;
+        CFBitVectorSetAllBits(bv, value);
+        memset(model, value, grown);
+        checkContents(bv, model, grown, "CFBitVectorSetAllBits");
+        checkQueries(bv, model, grown, randomRange(grown));
+        CFRelease(bv);
+
+        checkCombine(random() % MAX_BITS);
+    }
+
+    // Counting and searching a large, sparse vector
+    const CFIndex numTimed = 64 * 1024 * 1024;
+    CFMutableBitVectorRef big = CFBitVectorCreateMutable(kCFAllocatorSystemDefault, 0);
+    CFBitVectorSetCount(big, numTimed);
+    CFBitVectorSetBitAtIndex(big, numTimed - 3, 1);
+    clock_t start = clock();
+    CFIndex found = 0;
+    for (int pass = 0; pass < 10; pass++) found += CFBitVectorGetCountOfBit(big, CFRangeMake(pass, numTimed - pass), 1);
+    printf("count bits in %ld bits: %.2f ms\n", (long)numTimed, secondsSince(start) * 100.0);
+    start = clock();
+    for (int pass = 0; pass < 10; pass++) found += CFBitVectorGetFirstIndexOfBit(big, CFRangeMake(pass, numTimed - pass), 1);
+    printf("find first bit in %ld bits: %.2f ms\n", (long)numTimed, secondsSince(start) * 100.0);
+    start = clock();
+    for (int pass = 0; pass < 10; pass++) CFBitVectorFlipBits(big, CFRangeMake(pass, numTimed - 2 * pass));
+    printf("flip %ld bits: %.2f ms\n", (long)numTimed, secondsSince(start) * 100.0);
+    if (found != 10 + 10 * (numTimed - 3)) fail("large vector", numTimed, CFRangeMake(0, numTimed));
+    CFRelease(big);
+
+    printf("%s: %d failures\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
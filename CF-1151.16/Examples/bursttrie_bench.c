@@ -0,0 +1,161 @@
+// Mac OS X: clang -O2 -F<path-to-CFLite-framework> -framework CoreFoundation Examples/bursttrie_bench.c -o bursttrie_bench
+//  note: When running this sample, be sure to set the environment variable DYLD_FRAMEWORK_PATH to point to the directory containing your new version of CoreFoundation.
+//   e.g.
+//  DYLD_FRAMEWORK_PATH=/tmp/CF-Root ./bursttrie_bench
+//
+// Linux: clang -O2 -I/usr/local/include -L/usr/local/lib -lCoreFoundation bursttrie_bench.c -o bursttrie_bench
+
+/*
+ This example measures the size and lookup speed of serialized CFBurstTrie files. It builds a
+ vocabulary of 10 million terms (or the number given as an argument), serializes it in each of
+ these formats, maps the file back in with CFBurstTrieCreateFromFile() and looks up every term:
+    1. kCFBurstTriePrefixCompression, with fixed-width list entries.
+    2. kCFBurstTriePrefixCompression with kCFBurstTriePackedPageEntries.
+    3. kCFBurstTrieBitmapCompression.
+ For each format it reports the file size, the bytes per term, and lookups per second for terms
+ that are present and for terms that are not. The payloads found are checked, and a cursor
+ traversal of every format must visit the same number of terms. It prints each failure and exits
+ with a nonzero status if there were any.
+*/
+
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <CoreFoundation/CFBurstTrie.h>
+
+#define MAX_TERM_LENGTH 24
+
+static int failures = 0;
+
+static void fail(const char *what, long detail) {
+    if (failures++ < 20) fprintf(stderr, "FAIL: %s (%ld)\n", what, detail);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Terms are generated again from their index instead of being kept, so that 10 million of them cost no memory
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    return x ^ (x >> 33);
+}
+
+// Terms share prefixes the way words do: a few leading letters are drawn from a small set of common syllables
+static CFIndex makeTerm(uint64_t index, UInt8 *term) {
+    static const char *syllables[] = {"re", "con", "de", "pre", "in", "un", "com", "pro", "dis", "ex", "per", "sub", "trans", "inter", "over", "under"};
+    uint64_t bits = mix(index);
+    const char *syllable = syllables[bits & 15];
+    CFIndex length = strlen(syllable);
+    memcpy(term, syllable, length);
+    bits >>= 4;
+    CFIndex extra = 3 + (bits % 12);
+    bits >>= 4;
+    uint64_t more = mix(index ^ 0x9e3779b97f4a7c15ULL);
+    for (CFIndex idx = 0; idx < extra; idx++) {
+        if (0 == (idx % 12)) bits ^= more, more = mix(more);
+        term[length++] = 'a' + (bits % 26);
+        bits /= 26;
+    }
+    return length;
+}
+
+// Every occurrence of a term gets the same payload, so duplicates among the generated terms do not matter
+static uint32_t payloadForTerm(const UInt8 *term, CFIndex length) {
+    uint32_t hash = 2166136261U;
+    for (CFIndex idx = 0; idx < length; idx++) hash = (hash ^ term[idx]) * 16777619U;
+    return (hash & 0x3FFFFFFF) | 1;
+}
+
+static void countTerm(void *context, const UInt8 *key, uint32_t keyLength, uint32_t payload, Boolean *stop) {
+    (*(long *)context)++;
+}
+
+static long countTerms(CFBurstTrieRef trie) {
+    long count = 0;
+    CFBurstTrieCursorRef cursor = CFBurstTrieCreateCursorForBytes(trie, (const UInt8 *)"", 0);
+    if (cursor) {
+        CFBurstTrieTraverseFromCursor(cursor, &count, countTerm);
+        CFBurstTrieCursorRelease(cursor);
+    }
+    return count;
+}
+
+static long bench(const char *name, CFBurstTrieOpts opts, long numTerms, const char *path) {
+    UInt8 term[MAX_TERM_LENGTH + 1];
+    double began = now();
+    CFBurstTrieRef trie = CFBurstTrieCreate();
+    for (long idx = 0; idx < numTerms; idx++) {
+        CFIndex length = makeTerm(idx, term);
+        CFBurstTrieAddUTF8String(trie, term, length, payloadForTerm(term, length));
+    }
+    unlink(path);
+    CFStringRef pathString = CFStringCreateWithCString(kCFAllocatorSystemDefault, path, kCFStringEncodingUTF8);
+    if (!CFBurstTrieSerialize(trie, pathString, opts)) fail("CFBurstTrieSerialize", (long)opts);
+    CFBurstTrieRelease(trie);
+    double built = now() - began;
+
+    struct stat sb;
+    long size = (0 == stat(path, &sb)) ? (long)sb.st_size : 0;
+    trie = CFBurstTrieCreateFromFile(pathString);
+    CFRelease(pathString);
+    if (!trie) {
+        fail("CFBurstTrieCreateFromFile", (long)opts);
+        return 0;
+    }
+
+    began = now();
+    for (long idx = 0; idx < numTerms; idx++) {
+        CFIndex length = makeTerm(idx, term);
+        uint32_t payload = 0;
+        if (!CFBurstTrieContainsUTF8String(trie, term, length, &payload)) fail("term not found", idx);
+        else if (payload != payloadForTerm(term, length)) fail("wrong payload", idx);
+    }
+    double hits = now() - began;
+    // Upper case letters never appear in the vocabulary, so these terms share its prefixes but are all missing
+    began = now();
+    for (long idx = 0; idx < numTerms; idx++) {
+        CFIndex length = makeTerm(idx, term);
+        term[length - 1] = 'A' + (term[length - 1] - 'a');
+        uint32_t payload = 0;
+        if (CFBurstTrieContainsUTF8String(trie, term, length, &payload)) fail("missing term found", idx);
+    }
+    double misses = now() - began;
+    long count = (opts & (kCFBurstTriePrefixCompression | kCFBurstTrieSortByKey)) ? countTerms(trie) : -1;
+    CFBurstTrieRelease(trie);
+    unlink(path);
+
+    printf("%-22s %10ld bytes  %6.2f bytes/term  build %6.2f s  hits %10.0f/s  misses %10.0f/s\n", name, size, (double)size / numTerms, built, numTerms / hits, numTerms / misses);
+    return count;
+}
+
+int main(int argc, char **argv) {
+    long numTerms = (1 < argc) ? atol(argv[1]) : 10000000;
+    if (numTerms <= 0) numTerms = 10000000;
+    char path[] = "/tmp/bursttrie_bench.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+    printf("%ld terms\n", numTerms);
+
+    long fixedCount = bench("prefix", kCFBurstTrieReadOnly | kCFBurstTriePrefixCompression, numTerms, path);
+    long packedCount = bench("prefix, packed entries", kCFBurstTrieReadOnly | kCFBurstTriePrefixCompression | kCFBurstTriePackedPageEntries, numTerms, path);
+    bench("bitmap", kCFBurstTrieReadOnly | kCFBurstTrieBitmapCompression, numTerms, path);
+    if (fixedCount <= 0 || fixedCount != packedCount) fail("terms visited by cursor traversal", packedCount - fixedCount);
+
+    printf("%s: %d failures\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,269 @@
+// Mac OS X: clang -O2 -F<path-to-CFLite-framework> -framework CoreFoundation -licucore Examples/iso8601_check.c -o iso8601_check
+//  note: When running this sample, be sure to set the environment variable DYLD_FRAMEWORK_PATH to point to the directory containing your new version of CoreFoundation.
+//   e.g.
+//  DYLD_FRAMEWORK_PATH=/tmp/CF-Root ./iso8601_check
+//
+// Linux: clang -O2 -I/usr/local/include -L/usr/local/lib -lCoreFoundation -licui18n -licuuc iso8601_check.c -o iso8601_check
+
+/*
+ This example checks CFDateFormatter's fixed ISO 8601 path against ICU itself. For every
+ yyyy-MM-dd'T'HH:mm:ss pattern the fast path takes, with and without .SSS, and for fixed time zones
+ east and west of GMT, GMT itself and a zone with daylight saving time (which stays on ICU), it:
+    1. Formats times spread over the years 1600 to 9999, along with the first and last moments of
+       years, leap days and the edges of the range, with CFDateFormatterCreateStringWithAbsoluteTime()
+       and with udat_format() on a UDateFormat opened with the same pattern, locale and zone. The
+       strings must be identical.
+    2. Parses each of ICU's strings with CFDateFormatterGetAbsoluteTimeFromString() and with
+       udat_parse(). Both must succeed or fail together, with the same time.
+    3. Parses strings the fast path must refuse, such as out-of-range fields, and checks that the
+       answer is still the same as ICU's.
+ It then times formatting and parsing through CFDateFormatter against ICU directly. An optional
+ argument gives the number of random times per pattern and zone (default 20000). It prints each
+ failure and exits with a nonzero status if there were any.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <unicode/udat.h>
+#include <unicode/ustring.h>
+
+static int failures = 0;
+
+static void fail(const char *what, const char *pattern, const char *zone, const char *detail) {
+    if (failures++ < 20) fprintf(stderr, "FAIL: %s [%s, %s] %s\n", what, pattern, zone, detail);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct {
+    const char *icuID;		// zone as ICU names it
+    CFTimeInterval offset;	// fixed offset from GMT, or NAN to look icuID up as a named zone
+} Zone;
+
+static const Zone zones[] = {
+    {"GMT", 0.0},
+    {"GMT+05:30", 19800.0},
+    {"GMT-08:00", -28800.0},
+    {"GMT+14:00", 50400.0},
+    {"America/New_York", NAN},
+};
+
+static const char *patterns[] = {
+    "yyyy-MM-dd'T'HH:mm:ss",
+    "yyyy-MM-dd'T'HH:mm:ss'Z'",
+    "yyyy-MM-dd'T'HH:mm:ssZ",
+    "yyyy-MM-dd'T'HH:mm:ssZZZZZ",
+    "yyyy-MM-dd'T'HH:mm:ssXXX",
+    "yyyy-MM-dd'T'HH:mm:ssXXXXX",
+    "yyyy-MM-dd'T'HH:mm:ss.SSS",
+    "yyyy-MM-dd'T'HH:mm:ss.SSS'Z'",
+    "yyyy-MM-dd'T'HH:mm:ss.SSSZ",
+    "yyyy-MM-dd'T'HH:mm:ss.SSSZZZZZ",
+    "yyyy-MM-dd'T'HH:mm:ss.SSSXXX",
+    "yyyy-MM-dd'T'HH:mm:ss.SSSXXXXX",
+};
+
+// Strings either side of what the fast path accepts
+static const char *oddStrings[] = {
+    "1599-12-31T23:59:59Z", "10000-01-01T00:00:00Z", "2014-02-29T12:00:00Z", "2000-02-29T12:00:00Z",
+    "2014-13-01T00:00:00Z", "2014-00-10T00:00:00Z", "2014-04-31T00:00:00Z", "2014-06-01T24:00:00Z",
+    "2014-06-01T23:60:00Z", "2014-06-01T23:59:60Z", "2014-06-01T12:00:00+00:00", "2014-06-01T12:00:00+1500",
+    "2014-06-01T12:00:00+05:30", "2014-06-01T12:00:00-0800", "2014-06-01T12:00:00.5Z", "2014-06-01 12:00:00Z",
+    "2014-06-01T12:00:00", "2014-06-01T12:00:00.123", "2014-06-01T12:00:00.123Z", "2014-6-1T12:00:00Z",
+    "+2014-06-01T12:00:00Z", "2014-06-01T12:00:00Zjunk", "", "2014",
+};
+
+#define ICU_EPOCH_OFFSET 978307200.0	// kCFAbsoluteTimeIntervalSince1970
+
+static UDateFormat *openICU(const char *pattern, const char *zone) {
+    UChar upattern[64], uzone[64];
+    u_uastrcpy(upattern, pattern);
+    u_uastrcpy(uzone, zone);
+    UErrorCode status = U_ZERO_ERROR;
+    UDateFormat *df = udat_open(UDAT_PATTERN, UDAT_PATTERN, "en_US_POSIX", uzone, -1, upattern, -1, &status);
+    if (U_FAILURE(status)) return NULL;
+    udat_setLenient(df, false);
+    return df;
+}
+
+static CFDateFormatterRef createFormatter(const char *pattern, const Zone *zone) {
+    CFLocaleRef locale = CFLocaleCreate(kCFAllocatorSystemDefault, CFSTR("en_US_POSIX"));
+    CFDateFormatterRef df = CFDateFormatterCreate(kCFAllocatorSystemDefault, locale, kCFDateFormatterNoStyle, kCFDateFormatterNoStyle);
+    CFRelease(locale);
+    CFStringRef format = CFStringCreateWithCString(kCFAllocatorSystemDefault, pattern, kCFStringEncodingASCII);
+    CFDateFormatterSetFormat(df, format);
+    CFRelease(format);
+    CFTimeZoneRef tz;
+    if (!isnan(zone->offset)) {
+        tz = CFTimeZoneCreateWithTimeIntervalFromGMT(kCFAllocatorSystemDefault, zone->offset);
+    } else {
+        CFStringRef name = CFStringCreateWithCString(kCFAllocatorSystemDefault, zone->icuID, kCFStringEncodingASCII);
+        tz = CFTimeZoneCreateWithName(kCFAllocatorSystemDefault, name, true);
+        CFRelease(name);
+    }
+    CFDateFormatterSetProperty(df, kCFDateFormatterTimeZone, tz);
+    CFRelease(tz);
+    CFDateFormatterSetProperty(df, kCFDateFormatterIsLenient, kCFBooleanFalse);
+    return df;
+}
+
+// Formats at both ways, and parses ICU's string both ways
+static void checkTime(CFDateFormatterRef df, UDateFormat *icu, CFAbsoluteTime at, const char *pattern, const char *zone) {
+    UChar ubuffer[128];
+    char expected[128], actual[128], detail[300];
+    UErrorCode status = U_ZERO_ERROR;
+    UDate ud = (at + ICU_EPOCH_OFFSET) * 1000.0 + 0.5;
+    int32_t len = udat_format(icu, ud, ubuffer, 128, NULL, &status);
+    if (U_FAILURE(status)) {
+        fail("udat_format", pattern, zone, "");
+        return;
+    }
+    u_austrncpy(expected, ubuffer, len);
+    expected[len] = '\0';
+
+    CFStringRef string = CFDateFormatterCreateStringWithAbsoluteTime(kCFAllocatorSystemDefault, df, at);
+    if (!string || !CFStringGetCString(string, actual, sizeof(actual), kCFStringEncodingUTF8)) actual[0] = '\0';
+    if (string) CFRelease(string);
+    if (0 != strcmp(expected, actual)) {
+        snprintf(detail, sizeof(detail), "at %.3f: ICU \"%s\", CF \"%s\"", at, expected, actual);
+        fail("format", pattern, zone, detail);
+    }
+
+    status = U_ZERO_ERROR;
+    int32_t pos = 0;
+    UDate parsed = udat_parse(icu, ubuffer, len, &pos, &status);
+    Boolean icuOK = U_SUCCESS(status) && pos == len;
+    CFStringRef input = CFStringCreateWithCharacters(kCFAllocatorSystemDefault, (const UniChar *)ubuffer, len);
+    CFAbsoluteTime cfParsed = 0.0;
+    CFRange range = CFRangeMake(0, len);
+    Boolean cfOK = CFDateFormatterGetAbsoluteTimeFromString(df, input, &range, &cfParsed) && range.length == len;
+    CFRelease(input);
+    if (icuOK != cfOK || (icuOK && cfParsed != parsed / 1000.0 - ICU_EPOCH_OFFSET)) {
+        snprintf(detail, sizeof(detail), "\"%s\": ICU %s %.3f, CF %s %.3f", expected, icuOK ? "ok" : "failed", parsed / 1000.0 - ICU_EPOCH_OFFSET, cfOK ? "ok" : "failed", cfParsed);
+        fail("parse", pattern, zone, detail);
+    }
+}
+
+static void checkString(CFDateFormatterRef df, UDateFormat *icu, const char *string, const char *pattern, const char *zone) {
+    UChar ustr[64];
+    char detail[300];
+    u_uastrcpy(ustr, string);
+    int32_t len = u_strlen(ustr), pos = 0;
+    UErrorCode status = U_ZERO_ERROR;
+    UDate parsed = udat_parse(icu, ustr, len, &pos, &status);
+    Boolean icuOK = U_SUCCESS(status) && pos == len;
+    CFStringRef input = CFStringCreateWithCString(kCFAllocatorSystemDefault, string, kCFStringEncodingASCII);
+    CFAbsoluteTime cfParsed = 0.0;
+    CFRange range = CFRangeMake(0, len);
+    Boolean cfOK = CFDateFormatterGetAbsoluteTimeFromString(df, input, &range, &cfParsed) && range.length == len;
+    CFRelease(input);
+    if (icuOK != cfOK || (icuOK && cfParsed != parsed / 1000.0 - ICU_EPOCH_OFFSET)) {
+        snprintf(detail, sizeof(detail), "\"%s\": ICU %s %.3f, CF %s %.3f", string, icuOK ? "ok" : "failed", parsed / 1000.0 - ICU_EPOCH_OFFSET, cfOK ? "ok" : "failed", cfParsed);
+        fail("parse of an odd string", pattern, zone, detail);
+    }
+}
+
+// Absolute time of the start of a day in GMT
+static CFAbsoluteTime dayStart(int year, int month, int day) {
+    // Days from 1970-01-01 by the usual civil calendar arithmetic
+    int y = year - (month <= 2), era = (0 <= y ? y : y - 399) / 400, yoe = y - era * 400;
+    int doy = (153 * (month + (2 < month ? -3 : 9)) + 2) / 5 + day - 1, doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return ((double)era * 146097 + doe - 719468) * 86400.0 - ICU_EPOCH_OFFSET;
+}
+
+int main(int argc, char **argv) {
+    long numRandom = (1 < argc) ? atol(argv[1]) : 20000;
+    if (numRandom <= 0) numRandom = 20000;
+    srandom(1);
+    int numPatterns = sizeof(patterns) / sizeof(patterns[0]), numZones = sizeof(zones) / sizeof(zones[0]);
+    CFAbsoluteTime first = dayStart(1600, 1, 1), last = dayStart(10000, 1, 1);
+
+    for (int pidx = 0; pidx < numPatterns; pidx++) {
+        for (int zidx = 0; zidx < numZones; zidx++) {
+            const char *pattern = patterns[pidx], *zone = zones[zidx].icuID;
+            CFDateFormatterRef df = createFormatter(pattern, &zones[zidx]);
+            UDateFormat *icu = openICU(pattern, zone);
+            if (!icu) {
+                fail("udat_open", pattern, zone, "");
+                CFRelease(df);
+                continue;
+            }
+            // The edges of the range, where the fast path hands over to ICU, and a day either side
+            static const double edges[] = {-86400.0, -1.0, -0.001, -0.0005, 0.0, 0.0004, 0.001, 1.0, 86400.0};
+            for (int eidx = 0; eidx < 9; eidx++) {
+                checkTime(df, icu, first + edges[eidx], pattern, zone);
+                checkTime(df, icu, last + edges[eidx], pattern, zone);
+            }
+            // The turn of every 37th year, and every leap day
+            for (int year = 1600; year < 10000; year += 37) {
+                checkTime(df, icu, dayStart(year, 1, 1), pattern, zone);
+                checkTime(df, icu, dayStart(year, 1, 1) - 0.001, pattern, zone);
+            }
+            for (int year = 1600; year < 10000; year += 4) {
+                if (0 == year % 100 && 0 != year % 400) continue;
+                checkTime(df, icu, dayStart(year, 2, 29) + 43200.5, pattern, zone);
+            }
+            for (long idx = 0; idx < numRandom; idx++) {
+                // Whole milliseconds and arbitrary fractions of them
+                double fraction = (double)random() / RAND_MAX;
+                CFAbsoluteTime at = first + fraction * (last - first);
+                if (idx & 1) at = floor(at * 1000.0) / 1000.0;
+                checkTime(df, icu, at, pattern, zone);
+            }
+            for (size_t sidx = 0; sidx < sizeof(oddStrings) / sizeof(oddStrings[0]); sidx++) checkString(df, icu, oddStrings[sidx], pattern, zone);
+            udat_close(icu);
+            CFRelease(df);
+        }
+    }
+
+    // Timing, for the RFC 3339 pattern in GMT
+    const char *pattern = "yyyy-MM-dd'T'HH:mm:ss.SSSXXX";
+    CFDateFormatterRef df = createFormatter(pattern, &zones[0]);
+    UDateFormat *icu = openICU(pattern, "GMT");
+    long numTimed = 10 * numRandom;
+    CFAbsoluteTime base = dayStart(2014, 6, 1);
+    CFStringRef *strings = calloc(numTimed, sizeof(CFStringRef));
+    double began = now();
+    for (long idx = 0; idx < numTimed; idx++) strings[idx] = CFDateFormatterCreateStringWithAbsoluteTime(kCFAllocatorSystemDefault, df, base + idx * 0.731);
+    double cfFormat = now() - began;
+    UChar ubuffer[64];
+    began = now();
+    for (long idx = 0; idx < numTimed && icu; idx++) {
+        UErrorCode status = U_ZERO_ERROR;
+        udat_format(icu, (base + idx * 0.731 + ICU_EPOCH_OFFSET) * 1000.0 + 0.5, ubuffer, 64, NULL, &status);
+    }
+    double icuFormat = now() - began;
+    began = now();
+    for (long idx = 0; idx < numTimed; idx++) {
+        CFAbsoluteTime at;
+        if (!CFDateFormatterGetAbsoluteTimeFromString(df, strings[idx], NULL, &at)) fail("timed parse", pattern, "GMT", "");
+    }
+    double cfParse = now() - began;
+    began = now();
+    for (long idx = 0; idx < numTimed && icu; idx++) {
+        UniChar chars[64];
+        CFIndex len = CFStringGetLength(strings[idx]);
+        CFStringGetCharacters(strings[idx], CFRangeMake(0, len), chars);
+        UErrorCode status = U_ZERO_ERROR;
+        udat_parse(icu, (const UChar *)chars, (int32_t)len, NULL, &status);
+    }
+    double icuParse = now() - began;
+    for (long idx = 0; idx < numTimed; idx++) CFRelease(strings[idx]);
+    free(strings);
+    printf("format %8ld times: CFDateFormatter %8.3f s, udat_format %8.3f s\n", numTimed, cfFormat, icuFormat);
+    printf("parse  %8ld times: CFDateFormatter %8.3f s, udat_parse  %8.3f s\n", numTimed, cfParse, icuParse);
+    if (icu) udat_close(icu);
+    CFRelease(df);
+
+    printf("%s: %d failures\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
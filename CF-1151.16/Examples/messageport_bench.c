@@ -0,0 +1,168 @@
+// Mac OS X: clang -O2 -F<path-to-CFLite-framework> -framework CoreFoundation Examples/messageport_bench.c -o messageport_bench
+//  note: When running this sample, be sure to set the environment variable DYLD_FRAMEWORK_PATH to point to the directory containing your new version of CoreFoundation.
+//   e.g.
+//  DYLD_FRAMEWORK_PATH=/tmp/CF-Root ./messageport_bench
+//
+// CFMessagePort is only available on Mach, so there is no Linux build of this example.
+
+/*
+ This example measures CFMessagePort between processes. It forks two servers, which echo the
+ length of each request back to the client; only the second accepts shared memory rings, through
+ _CFMessagePortSetSharedMemoryThreshold(). Against each server it times:
+    1. Round trips of a 16 byte request, which always travels inline in the Mach message.
+    2. The bandwidth of requests from 64KB to 16MB, sent out-of-line to the first server and
+       through the ring to the second.
+ An optional argument gives the number of round trips in the latency test (default 20000).
+*/
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <mach/mach_time.h>
+
+#include <CoreFoundation/CoreFoundation.h>
+
+// From CFPriv.h
+extern void _CFMessagePortSetSharedMemoryThreshold(CFMessagePortRef local, CFIndex minBytes);
+
+#define STOP_MSGID 0
+#define ECHO_MSGID 1
+
+static CFDataRef serverCallBack(CFMessagePortRef local, SInt32 msgid, CFDataRef data, void *info) {
+    if (STOP_MSGID == msgid) {
+        CFRunLoopStop(CFRunLoopGetCurrent());
+        return NULL;
+    }
+    // Touch both ends of the payload, as a real server would read it
+    uint64_t reply[2] = {0, 0};
+    CFIndex length = data ? CFDataGetLength(data) : 0;
+    if (0 < length) {
+        const UInt8 *bytes = CFDataGetBytePtr(data);
+        reply[0] = length;
+        reply[1] = bytes[0] + bytes[length - 1];
+    }
+    return CFDataCreate(kCFAllocatorSystemDefault, (const UInt8 *)reply, sizeof(reply));
+}
+
+static void runServer(const char *cname, Boolean useRing) {
+    CFStringRef name = CFStringCreateWithCString(kCFAllocatorSystemDefault, cname, kCFStringEncodingUTF8);
+    CFMessagePortRef local = CFMessagePortCreateLocal(kCFAllocatorSystemDefault, name, serverCallBack, NULL, NULL);
+    if (!local) {
+        fprintf(stderr, "server: could not register the port\n");
+        exit(1);
+    }
+    if (useRing) _CFMessagePortSetSharedMemoryThreshold(local, 65536);
+    CFRunLoopSourceRef source = CFMessagePortCreateRunLoopSource(kCFAllocatorSystemDefault, local, 0);
+    CFRunLoopAddSource(CFRunLoopGetCurrent(), source, kCFRunLoopDefaultMode);
+    CFRunLoopRun();
+    CFRelease(source);
+    CFMessagePortInvalidate(local);
+    CFRelease(local);
+    exit(0);
+}
+
+static double secondsSince(uint64_t start) {
+    static mach_timebase_info_data_t timebase;
+    if (0 == timebase.denom) mach_timebase_info(&timebase);
+    return (double)(mach_absolute_time() - start) * timebase.numer / timebase.denom / 1e9;
+}
+
+static CFMessagePortRef connectToServer(CFStringRef name) {
+    for (int attempt = 0; attempt < 500; attempt++) {
+        CFMessagePortRef remote = CFMessagePortCreateRemote(kCFAllocatorSystemDefault, name);
+        if (remote) return remote;
+        usleep(10000);
+    }
+    return NULL;
+}
+
+static Boolean sendRequest(CFMessagePortRef remote, CFDataRef data) {
+    CFDataRef reply = NULL;
+    SInt32 status = CFMessagePortSendRequest(remote, ECHO_MSGID, data, 10.0, 10.0, kCFRunLoopDefaultMode, &reply);
+    Boolean ok = (kCFMessagePortSuccess == status && reply && sizeof(uint64_t) <= CFDataGetLength(reply) && *(const uint64_t *)CFDataGetBytePtr(reply) == (uint64_t)CFDataGetLength(data));
+    if (reply) CFRelease(reply);
+    if (!ok) fprintf(stderr, "request of %ld bytes failed (%d)\n", (long)CFDataGetLength(data), (int)status);
+    return ok;
+}
+
+static void runClient(const char *cname, Boolean useRing, int roundTrips) {
+    CFStringRef name = CFStringCreateWithCString(kCFAllocatorSystemDefault, cname, kCFStringEncodingUTF8);
+    CFMessagePortRef remote = connectToServer(name);
+    CFRelease(name);
+    if (!remote) {
+        fprintf(stderr, "client: could not find the server\n");
+        return;
+    }
+    const char *transport = useRing ? "shared memory" : "out-of-line";
+
+    uint8_t small[16] = {1};
+    CFDataRef smallData = CFDataCreate(kCFAllocatorSystemDefault, small, sizeof(small));
+    sendRequest(remote, smallData);
+    uint64_t start = mach_absolute_time();
+    for (int idx = 0; idx < roundTrips; idx++) {
+        if (!sendRequest(remote, smallData)) break;
+    }
+    double elapsed = secondsSince(start);
+    printf("%-14s %10s  %8.2f us per round trip\n", transport, "16 B", elapsed * 1e6 / roundTrips);
+    CFRelease(smallData);
+
+    // The client offers the server a ring with its first large request, so make that before timing anything
+    CFMutableDataRef warmup = CFDataCreateMutable(kCFAllocatorSystemDefault, 0);
+    CFDataSetLength(warmup, 1024 * 1024);
+    sendRequest(remote, warmup);
+    CFRelease(warmup);
+
+    for (CFIndex size = 65536; size <= 16 * 1024 * 1024; size *= 4) {
+        CFMutableDataRef data = CFDataCreateMutable(kCFAllocatorSystemDefault, size);
+        CFDataSetLength(data, size);
+        memset(CFDataGetMutableBytePtr(data), 0x5A, size);
+        // Enough iterations to move 1GB
+        int iterations = (int)((1024 * 1024 * 1024) / size);
+        start = mach_absolute_time();
+        for (int idx = 0; idx < iterations; idx++) {
+            // Dirty the payload each time, so that copy-on-write mappings cannot be reused for free
+            CFDataGetMutableBytePtr(data)[idx % size] = (uint8_t)idx;
+            if (!sendRequest(remote, data)) break;
+        }
+        elapsed = secondsSince(start);
+        printf("%-14s %8ld KB  %8.1f MB/s  %8.2f us per request\n", transport, (long)(size / 1024), (double)size * iterations / elapsed / (1024 * 1024), elapsed * 1e6 / iterations);
+        CFRelease(data);
+    }
+
+    CFMessagePortSendRequest(remote, STOP_MSGID, NULL, 1.0, 0.0, NULL, NULL);
+    CFMessagePortInvalidate(remote);
+    CFRelease(remote);
+}
+
+int main(int argc, char **argv) {
+    int roundTrips = (1 < argc) ? atoi(argv[1]) : 20000;
+    if (roundTrips <= 0) roundTrips = 20000;
+    // CoreFoundation cannot be used in a child forked after the parent has used it, so start both servers first
+    char names[2][128];
+    pid_t children[2];
+    for (int pass = 0; pass < 2; pass++) {
+        snprintf(names[pass], sizeof(names[pass]), "com.apple.CoreFoundation.messageport-bench.%d.%d", (int)getpid(), pass);
+        children[pass] = fork();
+        if (children[pass] < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (0 == children[pass]) runServer(names[pass], 1 == pass);
+    }
+    for (int pass = 0; pass < 2; pass++) {
+        runClient(names[pass], 1 == pass, roundTrips);
+    }
+    for (int pass = 0; pass < 2; pass++) {
+        int status = 0;
+        if (0 == waitpid(children[pass], &status, WNOHANG)) {
+            sleep(1);
+            kill(children[pass], SIGTERM);
+            waitpid(children[pass], &status, 0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,263 @@
+// Mac OS X: clang -O2 -F<path-to-CFLite-framework> -framework CoreFoundation Examples/preferences_check.c -o preferences_check
+//  note: When running this sample, be sure to set the environment variable DYLD_FRAMEWORK_PATH to point to the directory containing your new version of CoreFoundation.
+//   e.g.
+//  DYLD_FRAMEWORK_PATH=/tmp/CF-Root ./preferences_check
+//
+// Linux: clang -O2 -I/usr/local/include -L/usr/local/lib -lCoreFoundation -lpthread preferences_check.c -o preferences_check
+
+/*
+ This example checks CFPreferences write-behind and the read path. It points CFFIXED_USER_HOME at a
+ new temporary directory, so the user's own preferences are never touched. The checks are:
+    1. With _CFPreferencesSetWriteBehindInterval() from CFPriv.h, CFPreferencesAppSynchronize()
+       returns before the file is written, values still read back at once, and the file appears
+       after _CFPreferencesFlushPendingWrites(), or by itself once the interval has passed.
+    2. _CFPreferencesGetWriteStatistics() counts the bytes written and the bytes that changed.
+    3. Threads reading values while another thread changes them only ever see values that were set.
+    4. On Linux, a change made to the file by another program is seen without synchronizing.
+ It also reports how many values per second the readers got. It prints each failure and exits with
+ a nonzero status if there were any.
+*/
+
+#include <sys/stat.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <CoreFoundation/CoreFoundation.h>
+
+// From CFPriv.h
+extern void _CFPreferencesSetWriteBehindInterval(CFTimeInterval interval, Boolean fsyncWrites);
+extern Boolean _CFPreferencesFlushPendingWrites(void);
+extern void _CFPreferencesGetWriteStatistics(uint64_t *bytesWritten, uint64_t *bytesChanged);
+
+#define APP_ID "com.apple.CoreFoundation.preferences-check"
+#define WRITE_BEHIND_INTERVAL 0.5
+#define NUM_READERS 8
+#define NUM_KEYS 16
+
+static int failures = 0;
+static char plistPath[PATH_MAX];
+
+static void fail(const char *what) {
+    if (failures++ < 20) fprintf(stderr, "FAIL: %s\n", what);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static CFStringRef createKey(int idx) {
+    return CFStringCreateWithFormat(kCFAllocatorSystemDefault, NULL, CFSTR("key%d"), idx);
+}
+
+static void setNumber(CFStringRef key, int value) {
+    CFNumberRef number = CFNumberCreate(kCFAllocatorSystemDefault, kCFNumberIntType, &value);
+    CFPreferencesSetAppValue(key, number, CFSTR(APP_ID));
+    CFRelease(number);
+}
+
+// Returns -1 if the value is missing or not a number
+static int copyNumber(CFStringRef key) {
+    int value = -1;
+    CFPropertyListRef plist = CFPreferencesCopyAppValue(key, CFSTR(APP_ID));
+    if (plist) {
+        if (CFGetTypeID(plist) != CFNumberGetTypeID() || !CFNumberGetValue((CFNumberRef)plist, kCFNumberIntType, &value)) value = -1;
+        CFRelease(plist);
+    }
+    return value;
+}
+
+// Reads the file directly, without going through CFPreferences; returns NULL if there is no file
+static CFDictionaryRef copyFileContents(void) {
+    FILE *file = fopen(plistPath, "r");
+    if (!file) return NULL;
+    CFMutableDataRef data = CFDataCreateMutable(kCFAllocatorSystemDefault, 0);
+    UInt8 buffer[4096];
+    size_t length;
+    while (0 < (length = fread(buffer, 1, sizeof(buffer), file))) CFDataAppendBytes(data, buffer, length);
+    fclose(file);
+    CFPropertyListRef plist = CFPropertyListCreateWithData(kCFAllocatorSystemDefault, data, kCFPropertyListImmutable, NULL, NULL);
+    CFRelease(data);
+    if (plist && CFGetTypeID(plist) != CFDictionaryGetTypeID()) {
+        CFRelease(plist);
+        plist = NULL;
+    }
+    return (CFDictionaryRef)plist;
+}
+
+static int fileNumber(CFDictionaryRef dict, CFStringRef key) {
+    int value = -1;
+    CFTypeRef number = dict ? CFDictionaryGetValue(dict, key) : NULL;
+    if (!number || CFGetTypeID(number) != CFNumberGetTypeID() || !CFNumberGetValue((CFNumberRef)number, kCFNumberIntType, &value)) value = -1;
+    return value;
+}
+
+static void checkWriteBehind(void) {
+    _CFPreferencesSetWriteBehindInterval(WRITE_BEHIND_INTERVAL, false);
+    CFStringRef first = CFSTR("first"), second = CFSTR("second");
+
+    setNumber(first, 1);
+    setNumber(second, 2);
+    double firstSync = now();
+    if (!CFPreferencesAppSynchronize(CFSTR(APP_ID))) fail("CFPreferencesAppSynchronize with write-behind");
+    if (1 != copyNumber(first) || 2 != copyNumber(second)) fail("values read back before the write");
+    if (!_CFPreferencesFlushPendingWrites()) fail("_CFPreferencesFlushPendingWrites");
+    CFDictionaryRef contents = copyFileContents();
+    if (!contents) {
+        fail("no file after _CFPreferencesFlushPendingWrites");
+    } else {
+        if (1 != fileNumber(contents, first) || 2 != fileNumber(contents, second)) fail("file contents after flush");
+        CFRelease(contents);
+    }
+    uint64_t bytesWritten = 0, bytesChanged = 0;
+    _CFPreferencesGetWriteStatistics(&bytesWritten, &bytesChanged);
+    if (0 == bytesWritten || 0 == bytesChanged) fail("_CFPreferencesGetWriteStatistics");
+    printf("after flush: %llu bytes written for %llu bytes changed\n", (unsigned long long)bytesWritten, (unsigned long long)bytesChanged);
+
+    // Let the write scheduled by the first synchronization go by, then several synchronizations within one interval are written once, when it has passed
+    while (now() - firstSync < WRITE_BEHIND_INTERVAL * 2) usleep(10000);
+    double burstSync = now();
+    for (int idx = 0; idx < 10; idx++) {
+        setNumber(second, 100 + idx);
+        CFPreferencesAppSynchronize(CFSTR(APP_ID));
+    }
+    contents = copyFileContents();
+    // A slow machine may legitimately have reached the end of the interval already, so only a write seen inside it is a failure
+    if (2 != fileNumber(contents, second) && now() - burstSync < WRITE_BEHIND_INTERVAL) fail("file written before the write-behind interval passed");
+    if (contents) CFRelease(contents);
+    if (109 != copyNumber(second)) fail("value read back inside the write-behind interval");
+    int written = -1;
+    while (109 != written && now() - burstSync < WRITE_BEHIND_INTERVAL + 5.0) {
+        contents = copyFileContents();
+        written = fileNumber(contents, second);
+        if (contents) CFRelease(contents);
+        if (109 != written) usleep(10000);
+    }
+    if (109 != written) fail("file not written after the write-behind interval");
+    _CFPreferencesGetWriteStatistics(&bytesWritten, &bytesChanged);
+    printf("after interval: %llu bytes written for %llu bytes changed\n", (unsigned long long)bytesWritten, (unsigned long long)bytesChanged);
+
+    _CFPreferencesSetWriteBehindInterval(0.0, false);
+}
+
+// The writer only ever stores values that are multiples of the key's index plus one, so a reader can tell a torn or stray value
+static volatile int writerDone = 0;
+
+static void *readWorker(void *arg) {
+    CFStringRef keys[NUM_KEYS];
+    for (int idx = 0; idx < NUM_KEYS; idx++) keys[idx] = createKey(idx);
+    long reads = 0, bad = 0;
+    while (!writerDone) {
+        int which = (int)(reads % NUM_KEYS);
+        int value = copyNumber(keys[which]);
+        if (value < 0 || 0 != value % (which + 1)) bad++;
+        reads++;
+    }
+    for (int idx = 0; idx < NUM_KEYS; idx++) CFRelease(keys[idx]);
+    *(long *)arg = reads;
+    return (void *)bad;
+}
+
+static void checkReadPath(void) {
+    CFStringRef keys[NUM_KEYS];
+    for (int idx = 0; idx < NUM_KEYS; idx++) {
+        keys[idx] = createKey(idx);
+        setNumber(keys[idx], idx + 1);
+    }
+    CFPreferencesAppSynchronize(CFSTR(APP_ID));
+
+    pthread_t threads[NUM_READERS];
+    long reads[NUM_READERS];
+    writerDone = 0;
+    for (int idx = 0; idx < NUM_READERS; idx++) pthread_create(&threads[idx], NULL, readWorker, &reads[idx]);
+    double began = now();
+    for (int round = 1; round <= 2000; round++) {
+        int which = round % NUM_KEYS;
+        setNumber(keys[which], (which + 1) * round);
+        if (0 == round % 100) CFPreferencesAppSynchronize(CFSTR(APP_ID));
+    }
+    usleep(200000);
+    writerDone = 1;
+    long totalReads = 0;
+    for (int idx = 0; idx < NUM_READERS; idx++) {
+        void *bad = NULL;
+        pthread_join(threads[idx], &bad);
+        if (bad) fail("reader saw a value that was never set");
+        totalReads += reads[idx];
+    }
+    double elapsed = now() - began;
+    printf("%d readers: %.0f values/s\n", NUM_READERS, totalReads / elapsed);
+    for (int idx = 0; idx < NUM_KEYS; idx++) CFRelease(keys[idx]);
+}
+
+#if DEPLOYMENT_TARGET_LINUX || defined(__linux__)
+// Replaces the file the way another program saving it would, and waits for the change to show up
+static void checkExternalChange(void) {
+    CFStringRef key = CFSTR("external");
+    setNumber(key, 1);
+    CFPreferencesAppSynchronize(CFSTR(APP_ID));
+    if (1 != copyNumber(key)) fail("value before the external change");
+
+    CFDictionaryRef contents = copyFileContents();
+    CFMutableDictionaryRef changed = contents ? CFDictionaryCreateMutableCopy(kCFAllocatorSystemDefault, 0, contents) : CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    if (contents) CFRelease(contents);
+    int value = 2;
+    CFNumberRef number = CFNumberCreate(kCFAllocatorSystemDefault, kCFNumberIntType, &value);
+    CFDictionarySetValue(changed, key, number);
+    CFRelease(number);
+    CFDataRef data = CFPropertyListCreateData(kCFAllocatorSystemDefault, changed, kCFPropertyListXMLFormat_v1_0, 0, NULL);
+    CFRelease(changed);
+    char tmpPath[PATH_MAX + 8];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.new", plistPath);
+    FILE *file = fopen(tmpPath, "w");
+    if (!data || !file || CFDataGetLength(data) != (CFIndex)fwrite(CFDataGetBytePtr(data), 1, CFDataGetLength(data), file) || 0 != fclose(file) || 0 != rename(tmpPath, plistPath)) {
+        fail("could not rewrite the file");
+        if (data) CFRelease(data);
+        return;
+    }
+    CFRelease(data);
+
+    double began = now();
+    while (2 != copyNumber(key) && now() - began < 2.0) usleep(10000);
+    if (2 != copyNumber(key)) fail("external change not seen without synchronizing");
+    else printf("external change seen after %.1f ms\n", (now() - began) * 1000.0);
+}
+#endif
+
+int main(int argc, char **argv) {
+    // Everything has to be in place before CoreFoundation first looks for the home directory
+    char home[] = "/tmp/preferences_check.XXXXXX";
+    if (!mkdtemp(home)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/Library", home);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%s/Library/Preferences", home);
+    mkdir(path, 0700);
+    snprintf(plistPath, sizeof(plistPath), "%s/%s.plist", path, APP_ID);
+    setenv("CFFIXED_USER_HOME", home, 1);
+    printf("preferences in %s\n", path);
+
+    checkWriteBehind();
+    checkReadPath();
+#if DEPLOYMENT_TARGET_LINUX || defined(__linux__)
+    checkExternalChange();
+#endif
+
+    unlink(plistPath);
+    rmdir(path);
+    snprintf(path, sizeof(path), "%s/Library", home);
+    rmdir(path);
+    rmdir(home);
+
+    printf("%s: %d failures\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,215 @@
+// Mac OS X: clang -O2 -F<path-to-CFLite-framework> -framework CoreFoundation Examples/runloop_latency.c -o runloop_latency
+//  note: When running this sample, be sure to set the environment variable DYLD_FRAMEWORK_PATH to point to the directory containing your new version of CoreFoundation.
+//   e.g.
+//  DYLD_FRAMEWORK_PATH=/tmp/CF-Root ./runloop_latency
+//
+// Linux: clang -O2 -I/usr/local/include -L/usr/local/lib -lCoreFoundation -lpthread runloop_latency.c -o runloop_latency
+
+/*
+ This example measures how quickly a CFRunLoop responds. The main thread runs the run loop while:
+    1. Another thread signals a version 0 source and wakes the run loop with CFRunLoopWakeUp(), then
+       waits for the source's perform callout. The time from the signal to the callout is the wakeup
+       latency.
+    2. A repeating timer fires every 5ms. The time from each fire date to its callout is the timer
+       jitter.
+ It reports the minimum, median, 99th percentile and maximum of each, in microseconds. It also
+ checks that a source signalled in one mode is only performed when the run loop runs in that mode.
+ An optional argument gives the number of wakeups and timer fires (default 2000). It prints each
+ failure and exits with a nonzero status if there were any.
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <CoreFoundation/CFRunLoop.h>
+
+#define TIMER_INTERVAL 0.005
+
+static int failures = 0;
+
+static void fail(const char *what) {
+    if (failures++ < 20) fprintf(stderr, "FAIL: %s\n", what);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x < y) ? -1 : (x > y);
+}
+
+static void report(const char *name, double *samples, int count) {
+    if (count <= 0) return;
+    qsort(samples, count, sizeof(double), compareDoubles);
+    printf("%-16s %6d samples  min %8.1f us  median %8.1f us  p99 %8.1f us  max %8.1f us\n", name, count, samples[0] * 1e6, samples[count / 2] * 1e6, samples[(count * 99) / 100] * 1e6, samples[count - 1] * 1e6);
+}
+
+// The thread signalling the source and the source's callout hand each wakeup back and forth
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    CFRunLoopRef runLoop;
+    CFRunLoopSourceRef source;
+    double signalled;
+    double *latencies;
+    int count;
+    int performed;
+    Boolean finished;
+} WakeUpState;
+
+static void performWakeUp(void *info) {
+    WakeUpState *state = (WakeUpState *)info;
+    double performed = now();
+    pthread_mutex_lock(&state->lock);
+    if (state->performed < state->count) state->latencies[state->performed] = performed - state->signalled;
+    state->performed++;
+    pthread_cond_signal(&state->done);
+    Boolean finished = state->finished;
+    pthread_mutex_unlock(&state->lock);
+    if (finished) CFRunLoopStop(CFRunLoopGetCurrent());
+}
+
+static void *signalWorker(void *arg) {
+    WakeUpState *state = (WakeUpState *)arg;
+    for (int idx = 0; idx < state->count; idx++) {
+        pthread_mutex_lock(&state->lock);
+        state->finished = (idx == state->count - 1);
+        state->signalled = now();
+        CFRunLoopSourceSignal(state->source);
+        CFRunLoopWakeUp(state->runLoop);
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += 2;
+        while (state->performed <= idx) {
+            if (ETIMEDOUT == pthread_cond_timedwait(&state->done, &state->lock, &deadline)) {
+                fail("wakeup lost");
+                state->performed = idx + 1;
+            }
+        }
+        pthread_mutex_unlock(&state->lock);
+        // A short idle gap, so that the run loop goes back to sleep before the next wakeup
+        struct timespec gap = {0, 200000};
+        nanosleep(&gap, NULL);
+    }
+    return NULL;
+}
+
+static void measureWakeUps(int count) {
+    WakeUpState state;
+    memset(&state, 0, sizeof(state));
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.done, NULL);
+    state.runLoop = CFRunLoopGetCurrent();
+    state.latencies = calloc(count, sizeof(double));
+    state.count = count;
+    CFRunLoopSourceContext context = {0, &state, NULL, NULL, NULL, NULL, NULL, NULL, NULL, performWakeUp};
+    state.source = CFRunLoopSourceCreate(kCFAllocatorSystemDefault, 0, &context);
+    CFRunLoopAddSource(state.runLoop, state.source, kCFRunLoopDefaultMode);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, signalWorker, &state);
+    // Keep running until every wakeup has been performed, unless a whole run passes without one
+    int lastPerformed = -1;
+    for (;;) {
+        pthread_mutex_lock(&state.lock);
+        int performed = state.performed;
+        pthread_mutex_unlock(&state.lock);
+        if (count <= performed) break;
+        if (performed == lastPerformed) {
+            fail("run loop stopped performing the source");
+            break;
+        }
+        lastPerformed = performed;
+        CFRunLoopRunInMode(kCFRunLoopDefaultMode, 5.0, false);
+    }
+    pthread_join(thread, NULL);
+    report("wakeup latency", state.latencies, state.performed < count ? state.performed : count);
+
+    CFRunLoopRemoveSource(state.runLoop, state.source, kCFRunLoopDefaultMode);
+    CFRelease(state.source);
+    free(state.latencies);
+}
+
+typedef struct {
+    double *lateness;
+    int count;
+    int fired;
+    CFAbsoluteTime firstFireDate;
+} TimerState;
+
+static void timerFired(CFRunLoopTimerRef timer, void *info) {
+    TimerState *state = (TimerState *)info;
+    CFAbsoluteTime current = CFAbsoluteTimeGetCurrent();
+    if (state->fired < state->count) {
+        // A repeating timer keeps to its original schedule, skipping any fire dates it has missed entirely
+        double elapsed = current - state->firstFireDate;
+        double expected = state->firstFireDate + (elapsed < 0 ? 0 : (long)(elapsed / TIMER_INTERVAL)) * TIMER_INTERVAL;
+        state->lateness[state->fired] = current - expected;
+    }
+    if (++state->fired >= state->count) CFRunLoopStop(CFRunLoopGetCurrent());
+}
+
+static void measureTimerJitter(int count) {
+    TimerState state = {calloc(count, sizeof(double)), count, 0, CFAbsoluteTimeGetCurrent() + TIMER_INTERVAL};
+    CFRunLoopTimerContext context = {0, &state, NULL, NULL, NULL};
+    CFRunLoopTimerRef timer = CFRunLoopTimerCreate(kCFAllocatorSystemDefault, state.firstFireDate, TIMER_INTERVAL, 0, 0, timerFired, &context);
+    CFRunLoopAddTimer(CFRunLoopGetCurrent(), timer, kCFRunLoopDefaultMode);
+    while (state.fired < count) {
+        if (kCFRunLoopRunFinished == CFRunLoopRunInMode(kCFRunLoopDefaultMode, 5.0, false)) break;
+    }
+    CFRunLoopTimerInvalidate(timer);
+    CFRelease(timer);
+    if (state.fired < count) fail("timer stopped firing");
+    report("timer jitter", state.lateness, state.fired < count ? state.fired : count);
+    free(state.lateness);
+}
+
+static void performCount(void *info) {
+    (*(int *)info)++;
+}
+
+// A source only in another mode must wait until the run loop runs in that mode
+static void checkModes(void) {
+    CFStringRef otherMode = CFSTR("com.apple.CoreFoundation.runloop-latency.other");
+    int performed = 0;
+    CFRunLoopSourceContext context = {0, &performed, NULL, NULL, NULL, NULL, NULL, NULL, NULL, performCount};
+    CFRunLoopSourceRef source = CFRunLoopSourceCreate(kCFAllocatorSystemDefault, 0, &context);
+    CFRunLoopRef runLoop = CFRunLoopGetCurrent();
+    CFRunLoopAddSource(runLoop, source, otherMode);
+    // Something must be in the default mode too, or running it returns at once
+    CFRunLoopTimerRef keepAlive = CFRunLoopTimerCreate(kCFAllocatorSystemDefault, CFAbsoluteTimeGetCurrent() + 3600.0, 0, 0, 0, NULL, NULL);
+    CFRunLoopAddTimer(runLoop, keepAlive, kCFRunLoopDefaultMode);
+
+    CFRunLoopSourceSignal(source);
+    CFRunLoopWakeUp(runLoop);
+    CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.05, false);
+    if (0 != performed) fail("source performed in a mode it is not in");
+    CFRunLoopRunInMode(otherMode, 0.05, true);
+    if (1 != performed) fail("source not performed in its own mode");
+
+    CFRunLoopTimerInvalidate(keepAlive);
+    CFRelease(keepAlive);
+    CFRunLoopSourceInvalidate(source);
+    CFRelease(source);
+}
+
+int main(int argc, char **argv) {
+    int count = (1 < argc) ? atoi(argv[1]) : 2000;
+    if (count <= 0) count = 2000;
+
+    checkModes();
+    measureWakeUps(count);
+    measureTimerJitter(count);
+
+    printf("%s: %d failures\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+// Mac OS X: clang -O2 -F<path-to-CFLite-framework> -framework CoreFoundation Examples/runloop_timer_bench.c -o runloop_timer_bench
+//  note: When running this sample, be sure to set the environment variable DYLD_FRAMEWORK_PATH to point to the directory containing your new version of CoreFoundation.
+//   e.g.
+//  DYLD_FRAMEWORK_PATH=/tmp/CF-Root ./runloop_timer_bench
+//
+// Linux: clang -O2 -I/usr/local/include -L/usr/local/lib -lCoreFoundation runloop_timer_bench.c -o runloop_timer_bench
+
+/*
+ This example measures a run loop holding many timers at once. It schedules 50000 one-shot timers
+ (or the number given as an argument) in one mode, and times:
+    1. Adding them with CFRunLoopAddTimer().
+    2. Moving each of them several times with CFRunLoopTimerSetNextFireDate().
+    3. Invalidating half of them.
+    4. Running the run loop until the rest have fired.
+ It checks that every remaining timer fires exactly once, never before its fire date, and that the
+ timers fire in order of their fire dates. It prints each failure and exits with a nonzero status
+ if there were any.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <CoreFoundation/CFRunLoop.h>
+
+#define RESCHEDULES 4
+
+typedef struct {
+    CFRunLoopTimerRef timer;
+    CFAbsoluteTime fireDate;
+    int fired;
+    Boolean invalidated;
+} TimerInfo;
+
+static int failures = 0;
+static int numFired = 0;
+static CFAbsoluteTime lastFireDate = 0.0;
+
+static void fail(const char *what, long detail) {
+    if (failures++ < 20) fprintf(stderr, "FAIL: %s (%ld)\n", what, detail);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void timerFired(CFRunLoopTimerRef timer, void *context) {
+    TimerInfo *info = (TimerInfo *)context;
+    // Fire dates pass through the run loop's own clock, so allow a little slack against CFAbsoluteTimeGetCurrent()
+    if (CFAbsoluteTimeGetCurrent() < info->fireDate - 0.001) fail("timer fired early", (long)numFired);
+    if (info->fireDate < lastFireDate) fail("timers fired out of order", (long)numFired);
+    lastFireDate = info->fireDate;
+    info->fired++;
+    numFired++;
+}
+
+int main(int argc, char **argv) {
+    long numTimers = (1 < argc) ? atol(argv[1]) : 50000;
+    if (numTimers <= 0) numTimers = 50000;
+    srandom(1);
+    TimerInfo *infos = calloc(numTimers, sizeof(TimerInfo));
+    CFRunLoopRef runLoop = CFRunLoopGetCurrent();
+    CFStringRef mode = kCFRunLoopDefaultMode;
+
+    // Fire dates are spread over a second, starting far enough ahead that nothing fires while the timers are being set up
+    CFAbsoluteTime base = CFAbsoluteTimeGetCurrent() + 2.0 + numTimers / 100000.0;
+    double began = now();
+    for (long idx = 0; idx < numTimers; idx++) {
+        CFRunLoopTimerContext context = {0, &infos[idx], NULL, NULL, NULL};
+        infos[idx].fireDate = base + (random() % 1000000) / 1e6;
+        infos[idx].timer = CFRunLoopTimerCreate(kCFAllocatorSystemDefault, infos[idx].fireDate, 0.0, 0, 0, timerFired, &context);
+        CFRunLoopAddTimer(runLoop, infos[idx].timer, mode);
+    }
+    double elapsed = now() - began;
+    printf("add        %8ld timers  %8.3f s  %10.0f per second\n", numTimers, elapsed, numTimers / elapsed);
+
+    began = now();
+    for (int pass = 0; pass < RESCHEDULES; pass++) {
+        for (long idx = 0; idx < numTimers; idx++) {
+            infos[idx].fireDate = base + (random() % 1000000) / 1e6;
+            CFRunLoopTimerSetNextFireDate(infos[idx].timer, infos[idx].fireDate);
+        }
+    }
+    elapsed = now() - began;
+    printf("reschedule %8ld timers  %8.3f s  %10.0f per second\n", numTimers * RESCHEDULES, elapsed, numTimers * RESCHEDULES / elapsed);
+
+    began = now();
+    long remaining = 0;
+    for (long idx = 0; idx < numTimers; idx++) {
+        if (random() & 1) {
+            CFRunLoopTimerInvalidate(infos[idx].timer);
+            infos[idx].invalidated = true;
+        } else {
+            remaining++;
+        }
+    }
+    elapsed = now() - began;
+    printf("invalidate %8ld timers  %8.3f s  %10.0f per second\n", numTimers - remaining, elapsed, (numTimers - remaining) / elapsed);
+
+    if (CFAbsoluteTimeGetCurrent() >= base) fail("setting up took longer than the head start given to the timers", 0);
+    began = now();
+    CFAbsoluteTime deadline = base + 10.0;
+    while (numFired < remaining && CFAbsoluteTimeGetCurrent() < deadline) {
+        CFRunLoopRunInMode(mode, 1.0, false);
+    }
+    elapsed = now() - began;
+    printf("fire       %8ld timers  %8.3f s\n", remaining, elapsed);
+
+    for (long idx = 0; idx < numTimers; idx++) {
+        if (infos[idx].fired != (infos[idx].invalidated ? 0 : 1)) fail(infos[idx].invalidated ? "invalidated timer fired" : "timer did not fire exactly once", idx);
+        CFRunLoopTimerInvalidate(infos[idx].timer);
+        CFRelease(infos[idx].timer);
+    }
+    free(infos);
+
+    printf("%s: %d failures\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
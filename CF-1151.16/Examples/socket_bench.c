@@ -0,0 +1,271 @@
+// Mac OS X: clang -O2 -F<path-to-CFLite-framework> -framework CoreFoundation Examples/socket_bench.c -o socket_bench
+//  note: When running this sample, be sure to set the environment variable DYLD_FRAMEWORK_PATH to point to the directory containing your new version of CoreFoundation.
+//   e.g.
+//  DYLD_FRAMEWORK_PATH=/tmp/CF-Root ./socket_bench
+//
+// Linux: clang -O2 -I/usr/local/include -L/usr/local/lib -lCoreFoundation -lpthread socket_bench.c -o socket_bench
+
+/*
+ This example drives the CFSocket manager thread through a loopback echo server. The server is a
+ listening CFSocket on the main thread's run loop; each connection it accepts gets a CFSocket with
+ a data callback that echoes what it reads. Plain BSD sockets on other threads act as clients:
+    1. Idle connections are opened first and left open, 2000 of them by default, so that the
+       manager is watching more sockets than FD_SETSIZE allows select() to handle.
+    2. Several threads then connect, send 16 bytes, wait for the echo and close, over and over. This
+       reports connections per second.
+    3. One connection sends 64KB at a time and waits for each echo, which reports throughput.
+ Every echo is checked, and the server must have closed every connection by the end. The first
+ optional argument gives the number of idle connections, the second the number of connections
+ made by the churning threads (default 20000). It prints each failure and exits with a nonzero
+ status if there were any.
+*/
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <CoreFoundation/CFRunLoop.h>
+#include <CoreFoundation/CFSocket.h>
+
+#define CHURN_THREADS 8
+#define CHUNK_SIZE 65536
+#define THROUGHPUT_BYTES (512L * 1024 * 1024)
+
+static int failures = 0;
+static pthread_mutex_t failuresLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void fail(const char *what) {
+    pthread_mutex_lock(&failuresLock);
+    if (failures++ < 20) fprintf(stderr, "FAIL: %s\n", what);
+    pthread_mutex_unlock(&failuresLock);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Server side; these are only touched on the main thread, from the run loop's callbacks
+
+static long numAccepted = 0;
+static long numOpen = 0;
+
+static void echoCallBack(CFSocketRef s, CFSocketCallBackType type, CFDataRef address, const void *data, void *info) {
+    CFDataRef received = (CFDataRef)data;
+    if (0 == CFDataGetLength(received)) {
+        // The client closed its end
+        CFSocketInvalidate(s);
+        CFRelease(s);
+        numOpen--;
+        return;
+    }
+    if (kCFSocketSuccess != CFSocketSendData(s, NULL, received, 10.0)) fail("CFSocketSendData");
+}
+
+static void acceptCallBack(CFSocketRef s, CFSocketCallBackType type, CFDataRef address, const void *data, void *info) {
+    CFSocketNativeHandle handle = *(const CFSocketNativeHandle *)data;
+    CFSocketRef connection = CFSocketCreateWithNative(kCFAllocatorSystemDefault, handle, kCFSocketDataCallBack, echoCallBack, NULL);
+    if (!connection) {
+        fail("CFSocketCreateWithNative");
+        close(handle);
+        return;
+    }
+    CFRunLoopSourceRef source = CFSocketCreateRunLoopSource(kCFAllocatorSystemDefault, connection, 0);
+    CFRunLoopAddSource(CFRunLoopGetCurrent(), source, kCFRunLoopDefaultMode);
+    CFRelease(source);
+    numAccepted++;
+    numOpen++;
+}
+
+// Client side
+
+static struct sockaddr_in serverAddress;
+
+static int connectToServer(void) {
+    int fd = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) return -1;
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    if (0 != connect(fd, (struct sockaddr *)&serverAddress, sizeof(serverAddress))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static Boolean sendAll(int fd, const char *bytes, size_t length) {
+    while (0 < length) {
+        ssize_t sent = send(fd, bytes, length, 0);
+        if (sent <= 0) return false;
+        bytes += sent;
+        length -= sent;
+    }
+    return true;
+}
+
+static Boolean receiveAll(int fd, char *bytes, size_t length) {
+    while (0 < length) {
+        ssize_t received = recv(fd, bytes, length, 0);
+        if (received <= 0) return false;
+        bytes += received;
+        length -= received;
+    }
+    return true;
+}
+
+static Boolean echo(int fd, const char *request, char *reply, size_t length) {
+    return sendAll(fd, request, length) && receiveAll(fd, reply, length) && 0 == memcmp(request, reply, length);
+}
+
+static long numChurned = 0;
+
+static void *churnWorker(void *arg) {
+    long count = (long)arg;
+    char request[16], reply[16];
+    for (long idx = 0; idx < count; idx++) {
+        int fd = connectToServer();
+        if (fd < 0) {
+            fail("connect");
+            break;
+        }
+        snprintf(request, sizeof(request), "%015ld", idx);
+        if (!echo(fd, request, reply, sizeof(request))) fail("echo of a short request");
+        close(fd);
+    }
+    return NULL;
+}
+
+typedef struct {
+    long numIdle;
+    long numChurned;
+    CFRunLoopRef serverRunLoop;
+    volatile Boolean done;
+} ClientArgs;
+
+static void *clientMain(void *arg) {
+    ClientArgs *args = (ClientArgs *)arg;
+    int *idle = calloc(args->numIdle + 1, sizeof(int));
+    long numIdle = 0;
+    double began = now();
+    char request[16], reply[16];
+    for (; numIdle < args->numIdle; numIdle++) {
+        idle[numIdle] = connectToServer();
+        // Each idle connection says something once, so the server has certainly accepted it
+        snprintf(request, sizeof(request), "idle %010ld", numIdle);
+        if (idle[numIdle] < 0 || !echo(idle[numIdle], request, reply, sizeof(request))) {
+            fail("idle connection");
+            if (0 <= idle[numIdle]) close(idle[numIdle]);
+            break;
+        }
+    }
+    printf("opened %6ld idle connections     %8.3f s\n", numIdle, now() - began);
+
+    pthread_t threads[CHURN_THREADS];
+    began = now();
+    for (int idx = 0; idx < CHURN_THREADS; idx++) pthread_create(&threads[idx], NULL, churnWorker, (void *)(args->numChurned / CHURN_THREADS));
+    for (int idx = 0; idx < CHURN_THREADS; idx++) pthread_join(threads[idx], NULL);
+    double elapsed = now() - began;
+    numChurned = (args->numChurned / CHURN_THREADS) * CHURN_THREADS;
+    printf("churned %6ld connections          %8.3f s  %10.0f connections/s\n", numChurned, elapsed, numChurned / elapsed);
+
+    int fd = connectToServer();
+    if (fd < 0) {
+        fail("connect for throughput");
+    } else {
+        char *chunk = malloc(CHUNK_SIZE), *echoed = malloc(CHUNK_SIZE);
+        for (int idx = 0; idx < CHUNK_SIZE; idx++) chunk[idx] = (char)(idx * 7);
+        long chunks = THROUGHPUT_BYTES / CHUNK_SIZE;
+        began = now();
+        for (long idx = 0; idx < chunks; idx++) {
+            chunk[idx % CHUNK_SIZE] ^= 1;
+            if (!echo(fd, chunk, echoed, CHUNK_SIZE)) {
+                fail("echo of a 64KB request");
+                break;
+            }
+        }
+        elapsed = now() - began;
+        printf("echoed %6ld MB in 64KB requests     %8.3f s  %10.1f MB/s\n", THROUGHPUT_BYTES / (1024 * 1024), elapsed, THROUGHPUT_BYTES / elapsed / (1024 * 1024));
+        close(fd);
+        free(echoed);
+        free(chunk);
+    }
+
+    for (long idx = 0; idx < numIdle; idx++) close(idle[idx]);
+    free(idle);
+    args->numIdle = numIdle;
+    // Give the server a moment to see every connection close
+    sleep(1);
+    args->done = true;
+    CFRunLoopStop(args->serverRunLoop);
+    CFRunLoopWakeUp(args->serverRunLoop);
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    long numIdle = (1 < argc) ? atol(argv[1]) : 2000;
+    long numChurn = (2 < argc) ? atol(argv[2]) : 20000;
+    if (numIdle < 0) numIdle = 2000;
+    if (numChurn < CHURN_THREADS) numChurn = 20000;
+
+    // Both ends of every idle connection are in this process
+    struct rlimit limit;
+    if (0 == getrlimit(RLIMIT_NOFILE, &limit)) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+        if (limit.rlim_cur != RLIM_INFINITY && (rlim_t)(2 * numIdle + 256) > limit.rlim_cur) {
+            numIdle = ((long)limit.rlim_cur - 256) / 2;
+            printf("only %ld idle connections fit in the file descriptor limit\n", numIdle);
+        }
+    }
+
+    CFSocketRef listener = CFSocketCreate(kCFAllocatorSystemDefault, PF_INET, SOCK_STREAM, IPPROTO_TCP, kCFSocketAcceptCallBack, acceptCallBack, NULL);
+    int yes = 1;
+    setsockopt(CFSocketGetNative(listener), SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    memset(&serverAddress, 0, sizeof(serverAddress));
+#if defined(__APPLE__)
+    serverAddress.sin_len = sizeof(serverAddress);
+#endif
+    serverAddress.sin_family = AF_INET;
+    serverAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CFDataRef address = CFDataCreate(kCFAllocatorSystemDefault, (const UInt8 *)&serverAddress, sizeof(serverAddress));
+    if (kCFSocketSuccess != CFSocketSetAddress(listener, address)) {
+        fprintf(stderr, "could not listen on the loopback interface\n");
+        return 1;
+    }
+    CFRelease(address);
+    // The port was chosen by the system
+    socklen_t length = sizeof(serverAddress);
+    getsockname(CFSocketGetNative(listener), (struct sockaddr *)&serverAddress, &length);
+    CFRunLoopSourceRef source = CFSocketCreateRunLoopSource(kCFAllocatorSystemDefault, listener, 0);
+    CFRunLoopAddSource(CFRunLoopGetCurrent(), source, kCFRunLoopDefaultMode);
+    CFRelease(source);
+
+    ClientArgs args = {numIdle, numChurn, CFRunLoopGetCurrent(), false};
+    pthread_t client;
+    pthread_create(&client, NULL, clientMain, &args);
+    while (!args.done) CFRunLoopRunInMode(kCFRunLoopDefaultMode, 1.0, false);
+    pthread_join(client, NULL);
+    // Pick up any connections that closed while the run loop was stopping
+    for (int idx = 0; idx < 20 && 0 < numOpen; idx++) CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.1, false);
+
+    if (numAccepted < args.numIdle + numChurned + 1) fail("connections accepted");
+    if (0 != numOpen) fail("connections the server did not see close");
+    printf("server accepted %ld connections, %ld still open\n", numAccepted, numOpen);
+    CFSocketInvalidate(listener);
+    CFRelease(listener);
+
+    printf("%s: %d failures\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,230 @@
+// Mac OS X: clang -O2 -F<path-to-CFLite-framework> -framework CoreFoundation Examples/socket_vector_bench.c -o socket_vector_bench
+//  note: When running this sample, be sure to set the environment variable DYLD_FRAMEWORK_PATH to point to the directory containing your new version of CoreFoundation.
+//   e.g.
+//  DYLD_FRAMEWORK_PATH=/tmp/CF-Root ./socket_vector_bench
+//
+// Linux: clang -O2 -I/usr/local/include -L/usr/local/lib -lCoreFoundation -lpthread socket_vector_bench.c -o socket_vector_bench
+
+/*
+ This example measures CFSocket throughput over a TCP loopback connection with large messages, each
+ made of 16 pieces of 4KB. A CFSocket with a data callback on the main thread's run loop receives
+ them. Another thread sends the same number of bytes twice:
+    1. Joining the pieces into one CFData first and sending it with CFSocketSendData(), the way a
+       client had to before.
+    2. Passing the pieces to _CFSocketSendDataVector() from CFPriv.h, which sends them with a single
+       write and no copy.
+ For each it reports the send rate, and the number and average size of the CFDatas the receiver was
+ handed. The receiver checks every byte. It also checks that the pieces given to
+ _CFSocketSendDataVector() on a datagram socket arrive as one datagram. An optional argument gives
+ the number of megabytes to send each way (default 1024). It prints each failure and exits with a
+ nonzero status if there were any.
+*/
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <CoreFoundation/CFRunLoop.h>
+#include <CoreFoundation/CFSocket.h>
+
+// From CFPriv.h
+extern CFSocketError _CFSocketSendDataVector(CFSocketRef s, CFDataRef address, const CFDataRef *datas, CFIndex count, CFTimeInterval timeout);
+
+#define NUM_PIECES 16
+#define PIECE_SIZE 4096
+#define MESSAGE_SIZE (NUM_PIECES * PIECE_SIZE)
+
+static int failures = 0;
+
+static void fail(const char *what) {
+    if (failures++ < 20) fprintf(stderr, "FAIL: %s\n", what);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// The byte at each offset of a message; the pieces are different, so a reordered piece is noticed
+static UInt8 patternByte(long offset) {
+    offset %= MESSAGE_SIZE;
+    return (UInt8)(offset * 7 + offset / PIECE_SIZE);
+}
+
+// Receiving side, updated by the data callback on the main thread and waited for by the sender
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t progress;
+    long received;
+    long numDatas;
+    Boolean corrupt;
+    Boolean closed;
+} Receiver;
+
+static UInt8 expectedMessage[MESSAGE_SIZE];
+static Receiver receiver = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, false, false};
+
+static void dataCallBack(CFSocketRef s, CFSocketCallBackType type, CFDataRef address, const void *data, void *info) {
+    CFDataRef received = (CFDataRef)data;
+    CFIndex length = CFDataGetLength(received);
+    const UInt8 *bytes = CFDataGetBytePtr(received);
+    pthread_mutex_lock(&receiver.lock);
+    if (0 == length) {
+        receiver.closed = true;
+        CFSocketInvalidate(s);
+    }
+    // Compare against one message's worth of the pattern, a stretch at a time
+    for (CFIndex idx = 0; idx < length && !receiver.corrupt; ) {
+        long offset = (receiver.received + idx) % MESSAGE_SIZE;
+        CFIndex stretch = (length - idx < MESSAGE_SIZE - offset) ? length - idx : MESSAGE_SIZE - offset;
+        if (0 != memcmp(bytes + idx, expectedMessage + offset, stretch)) receiver.corrupt = true;
+        idx += stretch;
+    }
+    receiver.received += length;
+    receiver.numDatas++;
+    pthread_cond_signal(&receiver.progress);
+    pthread_mutex_unlock(&receiver.lock);
+}
+
+static void waitForBytes(long total) {
+    pthread_mutex_lock(&receiver.lock);
+    while (receiver.received < total && !receiver.closed) pthread_cond_wait(&receiver.progress, &receiver.lock);
+    pthread_mutex_unlock(&receiver.lock);
+}
+
+typedef struct {
+    CFSocketRef sender;
+    long numMessages;
+    CFRunLoopRef receiverRunLoop;
+    volatile Boolean done;
+} SenderArgs;
+
+static void *senderMain(void *arg) {
+    SenderArgs *args = (SenderArgs *)arg;
+    CFDataRef pieces[NUM_PIECES];
+    UInt8 piece[PIECE_SIZE];
+    for (int idx = 0; idx < NUM_PIECES; idx++) {
+        for (int offset = 0; offset < PIECE_SIZE; offset++) piece[offset] = patternByte(idx * PIECE_SIZE + offset);
+        pieces[idx] = CFDataCreate(kCFAllocatorSystemDefault, piece, PIECE_SIZE);
+    }
+    long total = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        Boolean vectored = (1 == pass);
+        pthread_mutex_lock(&receiver.lock);
+        long numDatas = receiver.numDatas;
+        pthread_mutex_unlock(&receiver.lock);
+        double began = now();
+        for (long message = 0; message < args->numMessages; message++) {
+            CFSocketError error;
+            if (vectored) {
+                error = _CFSocketSendDataVector(args->sender, NULL, pieces, NUM_PIECES, 10.0);
+            } else {
+                CFMutableDataRef joined = CFDataCreateMutable(kCFAllocatorSystemDefault, MESSAGE_SIZE);
+                for (int idx = 0; idx < NUM_PIECES; idx++) CFDataAppendBytes(joined, CFDataGetBytePtr(pieces[idx]), PIECE_SIZE);
+                error = CFSocketSendData(args->sender, NULL, joined, 10.0);
+                CFRelease(joined);
+            }
+            if (kCFSocketSuccess != error) {
+                fail(vectored ? "_CFSocketSendDataVector" : "CFSocketSendData");
+                break;
+            }
+        }
+        total += args->numMessages * MESSAGE_SIZE;
+        waitForBytes(total);
+        double elapsed = now() - began;
+        pthread_mutex_lock(&receiver.lock);
+        numDatas = receiver.numDatas - numDatas;
+        pthread_mutex_unlock(&receiver.lock);
+        printf("%-24s %8.1f MB/s  received as %8ld datas of %8.0f bytes on average\n", vectored ? "_CFSocketSendDataVector" : "CFSocketSendData", (double)args->numMessages * MESSAGE_SIZE / elapsed / (1024 * 1024), numDatas, numDatas ? (double)args->numMessages * MESSAGE_SIZE / numDatas : 0.0);
+    }
+
+    for (int idx = 0; idx < NUM_PIECES; idx++) CFRelease(pieces[idx]);
+    args->done = true;
+    CFRunLoopStop(args->receiverRunLoop);
+    CFRunLoopWakeUp(args->receiverRunLoop);
+    return NULL;
+}
+
+// The pieces of a vectored send on a datagram socket must make up a single datagram
+static void checkDatagram(void) {
+    int fds[2];
+    if (0 != socketpair(AF_UNIX, SOCK_DGRAM, 0, fds)) {
+        fail("socketpair");
+        return;
+    }
+    CFSocketRef s = CFSocketCreateWithNative(kCFAllocatorSystemDefault, fds[0], kCFSocketNoCallBack, NULL, NULL);
+    CFDataRef pieces[3] = {CFDataCreate(kCFAllocatorSystemDefault, (const UInt8 *)"one ", 4), CFDataCreate(kCFAllocatorSystemDefault, (const UInt8 *)"two ", 4), CFDataCreate(kCFAllocatorSystemDefault, (const UInt8 *)"three", 5)};
+    if (kCFSocketSuccess != _CFSocketSendDataVector(s, NULL, pieces, 3, 1.0)) fail("_CFSocketSendDataVector on a datagram socket");
+    char datagram[64];
+    ssize_t length = recv(fds[1], datagram, sizeof(datagram), 0);
+    if (13 != length || 0 != memcmp(datagram, "one two three", 13)) fail("vectored datagram");
+    for (int idx = 0; idx < 3; idx++) CFRelease(pieces[idx]);
+    CFSocketInvalidate(s);
+    CFRelease(s);
+    close(fds[1]);
+}
+
+// Connects two TCP sockets to each other through the loopback interface
+static Boolean createLoopbackPair(int fds[2]) {
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+#if defined(__APPLE__)
+    address.sin_len = sizeof(address);
+#endif
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    int listener = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener < 0) return false;
+    Boolean success = (0 == bind(listener, (struct sockaddr *)&address, sizeof(address)) && 0 == listen(listener, 1) && 0 == getsockname(listener, (struct sockaddr *)&address, &length));
+    fds[0] = fds[1] = -1;
+    if (success) fds[1] = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (success) success = (0 <= fds[1] && 0 == connect(fds[1], (struct sockaddr *)&address, sizeof(address)));
+    if (success) success = (0 <= (fds[0] = accept(listener, NULL, NULL)));
+    close(listener);
+    return success;
+}
+
+int main(int argc, char **argv) {
+    long megabytes = (1 < argc) ? atol(argv[1]) : 1024;
+    if (megabytes <= 0) megabytes = 1024;
+
+    checkDatagram();
+    for (long offset = 0; offset < MESSAGE_SIZE; offset++) expectedMessage[offset] = patternByte(offset);
+
+    int fds[2];
+    if (!createLoopbackPair(fds)) {
+        fprintf(stderr, "could not connect through the loopback interface\n");
+        return 1;
+    }
+    CFSocketRef receiving = CFSocketCreateWithNative(kCFAllocatorSystemDefault, fds[0], kCFSocketDataCallBack, dataCallBack, NULL);
+    CFRunLoopSourceRef source = CFSocketCreateRunLoopSource(kCFAllocatorSystemDefault, receiving, 0);
+    CFRunLoopAddSource(CFRunLoopGetCurrent(), source, kCFRunLoopDefaultMode);
+    CFRelease(source);
+
+    SenderArgs args = {CFSocketCreateWithNative(kCFAllocatorSystemDefault, fds[1], kCFSocketNoCallBack, NULL, NULL), megabytes * 1024 * 1024 / MESSAGE_SIZE, CFRunLoopGetCurrent(), false};
+    pthread_t sender;
+    pthread_create(&sender, NULL, senderMain, &args);
+    while (!args.done) CFRunLoopRunInMode(kCFRunLoopDefaultMode, 1.0, false);
+    pthread_join(sender, NULL);
+
+    if (receiver.corrupt) fail("received bytes differ from those sent");
+    if (receiver.received != 2 * args.numMessages * MESSAGE_SIZE) fail("number of bytes received");
+    CFSocketInvalidate(args.sender);
+    CFRelease(args.sender);
+    CFSocketInvalidate(receiving);
+    CFRelease(receiving);
+
+    printf("%s: %d failures\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
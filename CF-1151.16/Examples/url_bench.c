@@ -0,0 +1,189 @@
+// Mac OS X: clang -O2 -F<path-to-CFLite-framework> -framework CoreFoundation Examples/url_bench.c -o url_bench
+//  note: When running this sample, be sure to set the environment variable DYLD_FRAMEWORK_PATH to point to the directory containing your new version of CoreFoundation.
+//   e.g.
+//  DYLD_FRAMEWORK_PATH=/tmp/CF-Root ./url_bench
+//
+// Linux: clang -O2 -I/usr/local/include -L/usr/local/lib -lCoreFoundation url_bench.c -o url_bench
+
+/*
+ This example measures CFURL parsing. It generates 10 million URLs (or the number given as an
+ argument) with a mix of schemes, hosts, ports, paths, queries, fragments and percent escapes, and
+ times:
+    1. Creating each URL with CFURLCreateWithBytes().
+    2. Creating each URL and reading its host, path and query through _CFURLGetComponentByteRanges()
+       from CFPriv.h, without allocating.
+    3. Creating each URL and reading the same components with CFURLCopyHostName(), CFURLCopyPath()
+       and CFURLCopyQueryString().
+    4. Decoding each path with CFURLCreateStringByReplacingPercentEscapes().
+    5. Resolving relative references against a base URL with CFURLCopyAbsoluteURL().
+ For a sample of the URLs it checks that the byte ranges agree with the copied components. It
+ prints each failure and exits with a nonzero status if there were any.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <CoreFoundation/CoreFoundation.h>
+
+// From CFPriv.h
+extern Boolean _CFURLGetComponentByteRanges(CFURLRef url, const UInt8 **bytes, CFIndex *length, CFRange *ranges, CFRange *rangesIncludingSeparators);
+
+#define NUM_COMPONENTS 12
+#define CHECK_EVERY 1000
+
+static int failures = 0;
+
+static void fail(const char *what, long detail) {
+    if (failures++ < 20) fprintf(stderr, "FAIL: %s (%ld)\n", what, detail);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    return x ^ (x >> 33);
+}
+
+// URLs are generated again from their index instead of being kept
+static CFIndex makeURL(uint64_t index, char *url, size_t size) {
+    static const char *schemes[] = {"http", "https", "https", "ftp"};
+    static const char *hosts[] = {"www.example.com", "api.example.org", "cdn.example.net", "static.example.com", "192.168.0.17", "mail.example.co.uk"};
+    static const char *segments[] = {"index.html", "images", "v2", "search", "users", "a%20b", "docs", "caf%C3%A9", "2014", "download"};
+    uint64_t bits = mix(index);
+    int length = snprintf(url, size, "%s://%s", schemes[bits & 3], hosts[(bits >> 2) % 6]);
+    bits >>= 5;
+    if (0 == bits % 4) length += snprintf(url + length, size - length, ":%d", 8000 + (int)(bits % 1000));
+    bits >>= 3;
+    int depth = 1 + bits % 4;
+    bits >>= 2;
+    for (int idx = 0; idx < depth; idx++, bits /= 10) length += snprintf(url + length, size - length, "/%s", segments[bits % 10]);
+    bits = mix(bits ^ index);
+    if (bits & 1) length += snprintf(url + length, size - length, "?q=%llu&page=%d", (unsigned long long)(index % 100000), (int)(bits >> 1) % 50);
+    if (0 == (bits >> 8) % 8) length += snprintf(url + length, size - length, "#section%d", (int)(bits >> 11) % 10);
+    return length;
+}
+
+static CFURLRef createURL(const char *url, CFIndex length) {
+    return CFURLCreateWithBytes(kCFAllocatorSystemDefault, (const UInt8 *)url, length, kCFStringEncodingUTF8, NULL);
+}
+
+static Boolean rangeMatches(const UInt8 *bytes, CFRange range, CFStringRef string) {
+    if (kCFNotFound == range.location) return (NULL == string);
+    if (!string) return false;
+    char buffer[512];
+    if (!CFStringGetCString(string, buffer, sizeof(buffer), kCFStringEncodingUTF8)) return false;
+    return (CFIndex)strlen(buffer) == range.length && 0 == memcmp(buffer, bytes + range.location, range.length);
+}
+
+static void checkComponents(CFURLRef url, long index) {
+    const UInt8 *bytes = NULL;
+    CFIndex length = 0;
+    CFRange ranges[NUM_COMPONENTS], withSeparators[NUM_COMPONENTS];
+    if (!_CFURLGetComponentByteRanges(url, &bytes, &length, ranges, withSeparators)) {
+        fail("_CFURLGetComponentByteRanges", index);
+        return;
+    }
+    CFStringRef host = CFURLCopyHostName(url), path = CFURLCopyPath(url), query = CFURLCopyQueryString(url, NULL);
+    if (!rangeMatches(bytes, ranges[kCFURLComponentHost - 1], host)) fail("host range", index);
+    if (!rangeMatches(bytes, ranges[kCFURLComponentPath - 1], path)) fail("path range", index);
+    if (!rangeMatches(bytes, ranges[kCFURLComponentQuery - 1], query)) fail("query range", index);
+    if (host) CFRelease(host);
+    if (path) CFRelease(path);
+    if (query) CFRelease(query);
+}
+
+static void report(const char *name, long count, double elapsed) {
+    printf("%-44s %10ld URLs  %8.3f s  %10.0f per second\n", name, count, elapsed, count / elapsed);
+}
+
+int main(int argc, char **argv) {
+    long numURLs = (1 < argc) ? atol(argv[1]) : 10000000;
+    if (numURLs <= 0) numURLs = 10000000;
+    char url[512];
+
+    double began = now();
+    for (long idx = 0; idx < numURLs; idx++) {
+        CFURLRef parsed = createURL(url, makeURL(idx, url, sizeof(url)));
+        if (!parsed) fail("CFURLCreateWithBytes", idx);
+        else CFRelease(parsed);
+    }
+    report("CFURLCreateWithBytes", numURLs, now() - began);
+
+    began = now();
+    long componentBytes = 0;
+    for (long idx = 0; idx < numURLs; idx++) {
+        CFURLRef parsed = createURL(url, makeURL(idx, url, sizeof(url)));
+        if (!parsed) continue;
+        const UInt8 *bytes;
+        CFIndex length;
+        CFRange ranges[NUM_COMPONENTS];
+        if (_CFURLGetComponentByteRanges(parsed, &bytes, &length, ranges, NULL)) {
+            componentBytes += ranges[kCFURLComponentHost - 1].length + ranges[kCFURLComponentPath - 1].length;
+            if (kCFNotFound != ranges[kCFURLComponentQuery - 1].location) componentBytes += ranges[kCFURLComponentQuery - 1].length;
+        }
+        if (0 == idx % CHECK_EVERY) checkComponents(parsed, idx);
+        CFRelease(parsed);
+    }
+    report("create + _CFURLGetComponentByteRanges", numURLs, now() - began);
+
+    began = now();
+    long copiedBytes = 0;
+    for (long idx = 0; idx < numURLs; idx++) {
+        CFURLRef parsed = createURL(url, makeURL(idx, url, sizeof(url)));
+        if (!parsed) continue;
+        CFStringRef host = CFURLCopyHostName(parsed), path = CFURLCopyPath(parsed), query = CFURLCopyQueryString(parsed, NULL);
+        if (host) copiedBytes += CFStringGetLength(host), CFRelease(host);
+        if (path) copiedBytes += CFStringGetLength(path), CFRelease(path);
+        if (query) copiedBytes += CFStringGetLength(query), CFRelease(query);
+        CFRelease(parsed);
+    }
+    report("create + CFURLCopyHostName/Path/QueryString", numURLs, now() - began);
+    if (componentBytes != copiedBytes) fail("bytes seen through ranges and through copies differ", componentBytes - copiedBytes);
+
+    began = now();
+    for (long idx = 0; idx < numURLs; idx++) {
+        CFURLRef parsed = createURL(url, makeURL(idx, url, sizeof(url)));
+        if (!parsed) continue;
+        CFStringRef path = CFURLCopyPath(parsed);
+        CFStringRef decoded = path ? CFURLCreateStringByReplacingPercentEscapes(kCFAllocatorSystemDefault, path, CFSTR("")) : NULL;
+        if (path && !decoded) fail("CFURLCreateStringByReplacingPercentEscapes", idx);
+        if (decoded) CFRelease(decoded);
+        if (path) CFRelease(path);
+        CFRelease(parsed);
+    }
+    report("create + CFURLCopyPath + replace escapes", numURLs, now() - began);
+
+    // Relative references are resolved a tenth as often as URLs are parsed
+    static const char *references[] = {"../images/logo.png", "./a/b/../c", "search?q=1", "/absolute/path", "../../up/two", "#top", "?page=2", "sub/dir/"};
+    CFURLRef base = createURL("https://www.example.com/docs/v2/guide/index.html?lang=en", strlen("https://www.example.com/docs/v2/guide/index.html?lang=en"));
+    long numResolved = numURLs / 10;
+    began = now();
+    for (long idx = 0; idx < numResolved; idx++) {
+        const char *reference = references[idx % 8];
+        CFURLRef relative = CFURLCreateWithBytes(kCFAllocatorSystemDefault, (const UInt8 *)reference, strlen(reference), kCFStringEncodingUTF8, base);
+        CFURLRef absolute = relative ? CFURLCopyAbsoluteURL(relative) : NULL;
+        if (!absolute) fail("CFURLCopyAbsoluteURL", idx);
+        if (absolute && idx < 8) {
+            CFStringRef string = CFURLGetString(absolute);
+            char resolved[512];
+            CFStringGetCString(string, resolved, sizeof(resolved), kCFStringEncodingUTF8);
+            if (0 != strncmp(resolved, "https://www.example.com/", 24)) fail("resolved URL", idx);
+        }
+        if (absolute) CFRelease(absolute);
+        if (relative) CFRelease(relative);
+    }
+    report("CFURLCopyAbsoluteURL", numResolved, now() - began);
+    CFRelease(base);
+
+    printf("%s: %d failures\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,190 @@
+// Mac OS X: clang -O2 -F<path-to-CFLite-framework> -framework CoreFoundation Examples/uuid_bench.c -o uuid_bench
+//  note: When running this sample, be sure to set the environment variable DYLD_FRAMEWORK_PATH to point to the directory containing your new version of CoreFoundation.
+//   e.g.
+//  DYLD_FRAMEWORK_PATH=/tmp/CF-Root ./uuid_bench
+//
+// Linux: clang -O2 -I/usr/local/include -L/usr/local/lib -lCoreFoundation -lpthread uuid_bench.c -o uuid_bench
+
+/*
+ This example checks CFUUID generation and uniquing, then measures how UUID creation scales across
+ threads. The checks are:
+    1. Generated UUIDs are RFC 4122 version 4, and none repeats over a large sample.
+    2. Equal bytes give back the same uniqued CFUUID, including when many threads create them at
+       once, and UUIDs survive a round trip through their string form.
+    3. A forked child does not hand out the random bytes its parent will hand out next.
+ The benchmark times CFUUIDCreate, and _CFUUIDGenerateBytes from CFPriv.h, on 1 thread and on 32
+ threads (or the number of threads given as an argument), and reports UUIDs per second.
+*/
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <CoreFoundation/CoreFoundation.h>
+
+// From CFPriv.h
+extern Boolean _CFUUIDGenerateBytes(CFUUIDBytes *bytes);
+
+#define MAX_THREADS 256
+#define SAMPLE_SIZE 1000000
+#define SHARED_UUIDS 64
+
+static int failures = 0;
+
+static void fail(const char *what) {
+    if (failures++ < 20) fprintf(stderr, "FAIL: %s\n", what);
+}
+
+static int compareBytes(const void *a, const void *b) {
+    return memcmp(a, b, sizeof(CFUUIDBytes));
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void checkGeneratedBytes(void) {
+    CFUUIDBytes *sample = calloc(SAMPLE_SIZE, sizeof(CFUUIDBytes));
+    for (int idx = 0; idx < SAMPLE_SIZE; idx++) {
+        if (!_CFUUIDGenerateBytes(&sample[idx])) {
+            fail("_CFUUIDGenerateBytes");
+            break;
+        }
+        if (0x40 != (sample[idx].byte6 & 0xF0) || 0x80 != (sample[idx].byte8 & 0xC0)) fail("version 4, variant 10 bits");
+    }
+    qsort(sample, SAMPLE_SIZE, sizeof(CFUUIDBytes), compareBytes);
+    for (int idx = 1; idx < SAMPLE_SIZE; idx++) {
+        if (0 == compareBytes(&sample[idx - 1], &sample[idx])) fail("repeated UUID");
+    }
+    free(sample);
+}
+
+static void checkStringRoundTrip(void) {
+    for (int idx = 0; idx < 1000; idx++) {
+        CFUUIDRef uuid = CFUUIDCreate(kCFAllocatorSystemDefault);
+        CFStringRef string = CFUUIDCreateString(kCFAllocatorSystemDefault, uuid);
+        CFUUIDRef parsed = CFUUIDCreateFromString(kCFAllocatorSystemDefault, string);
+        // Uniquing means the parsed UUID is the very same object
+        if (parsed != uuid) fail("CFUUIDCreateFromString did not return the uniqued UUID");
+        if (parsed) CFRelease(parsed);
+        CFRelease(string);
+        CFRelease(uuid);
+    }
+}
+
+// Every thread creates the same few UUIDs from bytes, so the uniquing tables see the same keys from all threads at once
+static CFUUIDBytes sharedBytes[SHARED_UUIDS];
+static CFUUIDRef sharedUUIDs[SHARED_UUIDS];
+
+static void *uniqueWorker(void *arg) {
+    long bad = 0;
+    for (int round = 0; round < 20000; round++) {
+        int which = (round * 7 + (int)(long)arg) % SHARED_UUIDS;
+        CFUUIDRef uuid = CFUUIDCreateFromUUIDBytes(kCFAllocatorSystemDefault, sharedBytes[which]);
+        if (uuid != sharedUUIDs[which]) bad++;
+        CFRelease(uuid);
+    }
+    return (void *)bad;
+}
+
+static void checkConcurrentUniquing(int numThreads) {
+    for (int idx = 0; idx < SHARED_UUIDS; idx++) {
+        _CFUUIDGenerateBytes(&sharedBytes[idx]);
+        sharedUUIDs[idx] = CFUUIDCreateFromUUIDBytes(kCFAllocatorSystemDefault, sharedBytes[idx]);
+    }
+    pthread_t threads[MAX_THREADS];
+    for (long idx = 0; idx < numThreads; idx++) pthread_create(&threads[idx], NULL, uniqueWorker, (void *)idx);
+    for (int idx = 0; idx < numThreads; idx++) {
+        void *bad = NULL;
+        pthread_join(threads[idx], &bad);
+        if (bad) fail("CFUUIDCreateFromUUIDBytes returned a different object for the same bytes");
+    }
+    for (int idx = 0; idx < SHARED_UUIDS; idx++) {
+        CFUUIDBytes bytes = CFUUIDGetUUIDBytes(sharedUUIDs[idx]);
+        if (0 != compareBytes(&bytes, &sharedBytes[idx])) fail("CFUUIDGetUUIDBytes");
+        CFRelease(sharedUUIDs[idx]);
+    }
+}
+
+static void checkFork(void) {
+    int fds[2];
+    if (0 != pipe(fds)) return;
+    CFUUIDBytes parentBytes, childBytes;
+    // Leave random bytes in this thread's buffer for the child to inherit
+    _CFUUIDGenerateBytes(&parentBytes);
+    pid_t child = fork();
+    if (0 == child) {
+        _CFUUIDGenerateBytes(&childBytes);
+        ssize_t written = write(fds[1], &childBytes, sizeof(childBytes));
+        _exit(written == sizeof(childBytes) ? 0 : 1);
+    }
+    _CFUUIDGenerateBytes(&parentBytes);
+    if (child < 0 || read(fds[0], &childBytes, sizeof(childBytes)) != sizeof(childBytes)) {
+        fail("fork check could not run");
+    } else if (0 == compareBytes(&parentBytes, &childBytes)) {
+        fail("forked child generated the same UUID as its parent");
+    }
+    if (0 < child) waitpid(child, NULL, 0);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+typedef struct {
+    Boolean createObjects;
+    long iterations;
+    pthread_mutex_t start;	/* held until every thread exists */
+} BenchArgs;
+
+static void *benchWorker(void *arg) {
+    BenchArgs *args = (BenchArgs *)arg;
+    pthread_mutex_lock(&args->start);
+    pthread_mutex_unlock(&args->start);
+    for (long idx = 0; idx < args->iterations; idx++) {
+        if (args->createObjects) {
+            CFUUIDRef uuid = CFUUIDCreate(kCFAllocatorSystemDefault);
+            CFRelease(uuid);
+        } else {
+            CFUUIDBytes bytes;
+            _CFUUIDGenerateBytes(&bytes);
+        }
+    }
+    return NULL;
+}
+
+static void bench(int numThreads, Boolean createObjects) {
+    const long total = 4000000;
+    pthread_t threads[MAX_THREADS];
+    BenchArgs args = {createObjects, total / numThreads, PTHREAD_MUTEX_INITIALIZER};
+    pthread_mutex_lock(&args.start);
+    for (int idx = 0; idx < numThreads; idx++) pthread_create(&threads[idx], NULL, benchWorker, &args);
+    double began = now();
+    pthread_mutex_unlock(&args.start);
+    for (int idx = 0; idx < numThreads; idx++) pthread_join(threads[idx], NULL);
+    double elapsed = now() - began;
+    printf("%-22s %3d threads  %12.0f UUIDs/s\n", createObjects ? "CFUUIDCreate" : "_CFUUIDGenerateBytes", numThreads, args.iterations * numThreads / elapsed);
+}
+
+int main(int argc, char **argv) {
+    int numThreads = (1 < argc) ? atoi(argv[1]) : 32;
+    if (numThreads < 1 || MAX_THREADS < numThreads) numThreads = 32;
+
+    checkGeneratedBytes();
+    checkStringRoundTrip();
+    checkConcurrentUniquing(numThreads);
+    checkFork();
+
+    bench(1, false);
+    bench(numThreads, false);
+    bench(1, true);
+    bench(numThreads, true);
+
+    printf("%s: %d failures\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}